@@ -0,0 +1,34 @@
+#ifndef AllocationCounter_hpp
+#define AllocationCounter_hpp
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new, counting every allocation made through it, so benchmarks can report allocations per operation.
+// Replacement functions can't be inline, so this must only ever be included from a single translation unit (the benchmark's main).
+// They're kept out of line for the compiler too, else it pairs the malloc/free inside with new/delete at call sites and warns of a mismatch.
+
+std::atomic<size_t> bench_allocations{0};
+
+__attribute__((noinline)) void* operator new(size_t size) {
+  bench_allocations.fetch_add(1, std::memory_order_relaxed);
+  if(void* allocated = std::malloc(size > 0 ? size : 1))
+    return allocated;
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* allocated) noexcept {
+  std::free(allocated);
+}
+
+__attribute__((noinline)) void operator delete(void* allocated, size_t) noexcept {
+  std::free(allocated);
+}
+
+/// Allocations made so far, by any thread.
+inline size_t BenchAllocations() {
+  return bench_allocations.load(std::memory_order_relaxed);
+}
+
+#endif /* AllocationCounter_hpp */
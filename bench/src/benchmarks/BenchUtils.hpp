@@ -0,0 +1,60 @@
+#ifndef BenchUtils_hpp
+#define BenchUtils_hpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using BenchClock = std::chrono::steady_clock;
+
+/// Collects latency samples (in nanoseconds) and reports their distribution.
+class LatencySamples {
+public:
+  void reserve(size_t count) { _samples.reserve(count); }
+  void add(BenchClock::duration elapsed) { _samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()); }
+  size_t count() const { return _samples.size(); }
+  void merge(const LatencySamples& other) { _samples.insert(_samples.end(), other._samples.begin(), other._samples.end()); }
+
+  /// Returns the requested percentile (0 to 1, as HistogramSnapshot::percentile takes it), in nanoseconds.
+  double percentile(double quantile) {
+    if(_samples.empty()) {
+      return 0;
+    }
+    std::sort(_samples.begin(), _samples.end());
+    size_t index = std::min(_samples.size() - 1, static_cast<size_t>(quantile * _samples.size()));
+    return static_cast<double>(_samples[index]);
+  }
+
+private:
+  std::vector<long long> _samples;
+};
+
+template <typename Predicate>
+bool BenchWaitUntil(Predicate predicate, unsigned int milliseconds) {
+  auto deadline = BenchClock::now() + std::chrono::milliseconds{milliseconds};
+  while(!predicate()) {
+    if(BenchClock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+inline double BenchPerSecond(size_t operations, BenchClock::duration elapsed) {
+  return operations / std::chrono::duration<double>(elapsed).count();
+}
+
+inline void PrintLatencyResult(const std::string& name, LatencySamples& samples) {
+  std::printf("   %-44s p50 %9.2f us   p99 %9.2f us   (%zu samples)\n", name.c_str(),
+    samples.percentile(0.5) / 1000.0, samples.percentile(0.99) / 1000.0, samples.count());
+}
+
+inline void PrintThroughputResult(const std::string& name, size_t operations, BenchClock::duration elapsed) {
+  std::printf("   %-44s %12.0f msgs/s   (%zu msgs)\n", name.c_str(), BenchPerSecond(operations, elapsed), operations);
+}
+
+#endif /* BenchUtils_hpp */
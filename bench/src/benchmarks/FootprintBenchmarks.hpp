@@ -0,0 +1,52 @@
+#ifndef FootprintBenchmarks_hpp
+#define FootprintBenchmarks_hpp
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/EchoTransport.hpp"
+#include "BenchUtils.hpp"
+
+/// Bytes currently allocated from the heap, as glibc accounts them (chunk overhead included).
+inline size_t BenchHeapInUse() {
+  return mallinfo2().uordblks;
+}
+
+/// Creates many idle instances, running setup on each, and reports the footprint of a single one: its sizeof, and everything it allocates (itself included).
+template <typename CrierType>
+void BenchIdleFootprint(const std::string& name, size_t instances, const std::function<void(CrierType&)>& setup) {
+  std::vector<std::unique_ptr<CrierType>> criers;
+  criers.reserve(instances);
+  size_t heap_before = BenchHeapInUse();
+  for(size_t i = 0; i < instances; i++) {
+    criers.emplace_back(new CrierType());
+    setup(*criers.back());
+  }
+  size_t heap_after = BenchHeapInUse();
+  std::printf("   %-44s sizeof %6zu B   heap %8.0f B/instance   (%zu instances)\n", name.c_str(), sizeof(CrierType),
+    static_cast<double>(heap_after - heap_before) / instances, instances);
+}
+
+void BenchFootprint() {
+  using EchoCrier = crier::Crier<EchoTransport, crier::test::root_msg>;
+  using TcpCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+  BenchIdleFootprint<EchoCrier>("Crier<EchoTransport> idle", 100000, [](EchoCrier&){});
+  BenchIdleFootprint<TcpCrier>("Crier<TcpTransport> idle (not connected)", 100000, [](TcpCrier&){});
+  BenchIdleFootprint<EchoCrier>("Crier<EchoTransport> + permanent callback", 100000, [](EchoCrier& net_crier){
+    net_crier.registerPermanentCallback<crier::test::test_msg_1>("BenchFootprint", [](const crier::test::test_msg_1&){});
+  });
+  // Any per type override allocates the instance's rare state
+  BenchIdleFootprint<EchoCrier>("Crier<EchoTransport> + per type override", 100000, [](EchoCrier& net_crier){
+    net_crier.setInboundDispatchingForMsg<crier::test::test_msg_1>(crier::InboundDispatching::DispatchQueue);
+  });
+}
+
+#endif /* FootprintBenchmarks_hpp */
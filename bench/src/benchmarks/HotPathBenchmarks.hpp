@@ -0,0 +1,191 @@
+#ifndef HotPathBenchmarks_hpp
+#define HotPathBenchmarks_hpp
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/Reactor.hpp"
+#include "transports/EchoTransport.hpp"
+#include "AllocationCounter.hpp"
+#include "BenchUtils.hpp"
+#include "SinkTransport.hpp"
+
+using SinkCrier = crier::Crier<SinkTransport, crier::test::root_msg>;
+
+/// Runs operation(i) iterations times, after a tenth as many warm up runs, and reports its ns/op, allocations/op and operations per second.
+inline void BenchHotPath(const std::string& name, size_t iterations, const std::function<void(size_t)>& operation) {
+  for(size_t i = 0; i < iterations / 10; i++) {
+    operation(i);
+  }
+  size_t allocations_before = BenchAllocations();
+  auto start = BenchClock::now();
+  for(size_t i = 0; i < iterations; i++) {
+    operation(i);
+  }
+  auto elapsed = BenchClock::now() - start;
+  double allocations = static_cast<double>(BenchAllocations() - allocations_before) / iterations;
+  double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+  std::printf("   %-44s %9.1f ns/op %7.2f allocs/op %12.0f msgs/s\n", name.c_str(), nanoseconds, allocations, BenchPerSecond(iterations, elapsed));
+}
+
+/// Serialized root message carrying a test_msg_2 of the given payload size, as it'd arrive from a transport.
+inline std::string BenchRootPayload(size_t payload_size) {
+  crier::test::root_msg root;
+  root.mutable_test_msg_2_field()->set_data(std::string(payload_size, 'x'));
+  return root.SerializeAsString();
+}
+
+inline std::string BenchPayloadName(const std::string& name, size_t payload_size) {
+  return name + (payload_size >= 1024 ? " (" + std::to_string(payload_size / 1024) + "KB)" : " (" + std::to_string(payload_size) + "B)");
+}
+
+/// Raw protobuf, packaging a message into the root message and serializing it, then parsing it back: the floor crier's send and receive paths build on.
+void BenchProtobufBaseline(size_t payload_size, size_t iterations) {
+  crier::test::test_msg_2 msg;
+  msg.set_data(std::string(payload_size, 'x'));
+  std::string out;
+  BenchHotPath(BenchPayloadName("protobuf package + serialize", payload_size), iterations, [&msg, &out](size_t){
+    crier::test::root_msg root;
+    *root.mutable_test_msg_2_field() = msg;
+    root.SerializeToString(&out);
+  });
+  std::string payload = BenchRootPayload(payload_size);
+  BenchHotPath(BenchPayloadName("protobuf parse", payload_size), iterations, [&payload](size_t){
+    crier::test::root_msg root;
+    root.ParseFromArray(payload.data(), static_cast<int>(payload.size()));
+  });
+}
+
+/// sendMessage into a transport that drops it: packageIntoReq and serialization.
+void BenchSend(size_t payload_size, size_t iterations) {
+  SinkCrier net_crier{};
+  net_crier.connectTransport("localhost", 0);
+  crier::test::test_msg_2 msg;
+  msg.set_data(std::string(payload_size, 'x'));
+  BenchHotPath(BenchPayloadName("sendMessage", payload_size), iterations, [&net_crier, &msg](size_t){
+    net_crier.sendMessage(msg);
+  });
+}
+
+/// Receiving a message with a permanent callback: parsing, openReq and triggerCallbacksForMsg, run right away (Immediate) or queued
+/// and run by dispatchQueuedCallbacks (DispatchQueue) every batch messages.
+void BenchReceive(crier::InboundDispatching dispatching, size_t payload_size, size_t iterations, size_t batch = 64) {
+  SinkCrier net_crier{crier::UnhandledMessageBehaviour::Ignore, dispatching};
+  net_crier.connectTransport("localhost", 0);
+  size_t received = 0;
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("BenchReceive", [&received](const crier::test::test_msg_2&){ received++; });
+  std::string payload = BenchRootPayload(payload_size);
+  bool queued = dispatching == crier::InboundDispatching::DispatchQueue;
+  BenchHotPath(BenchPayloadName(queued ? "receive DispatchQueue" : "receive Immediate", payload_size), iterations,
+    [&net_crier, &payload, queued, batch](size_t i){
+      net_crier.transport().inject(payload);
+      if(queued && (i + 1) % batch == 0)
+        net_crier.dispatchQueuedCallbacks();
+    });
+  net_crier.dispatchQueuedCallbacks();
+}
+
+/// A request and its response, without and with a timeout: callback registration, timeout scheduling and invalidation, and response matching.
+//  Timeouts run on a thread each by default, or as timers of an event loop once attached to a Reactor.
+void BenchRequests(size_t iterations) {
+  std::string response = [](){
+    crier::test::root_msg root;
+    root.mutable_test_msg_1_field()->set_id(1);
+    return root.SerializeAsString();
+  }();
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  {
+    SinkCrier net_crier{};
+    net_crier.connectTransport("localhost", 0);
+    BenchHotPath("request + response", iterations, [&net_crier, &msg, &response](size_t){
+      net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg, [](const crier::test::test_msg_1&){});
+      net_crier.transport().inject(response);
+    });
+  }
+  {
+    SinkCrier net_crier{};
+    net_crier.connectTransport("localhost", 0);
+    // Every timeout's thread lives on for its whole duration, so a short one keeps them from piling up
+    BenchHotPath("request + response, thread timeout", iterations / 20, [&net_crier, &msg, &response](size_t){
+      net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_1>(msg, [](const crier::test::test_msg_1&){}, 1, [](){});
+      net_crier.transport().inject(response);
+    });
+  }
+  {
+    crier::Reactor reactor(1);
+    SinkCrier net_crier{};
+    net_crier.attachToReactor(reactor);
+    net_crier.connectTransport("localhost", 0);
+    // Answered timeouts stay listed until they expire, so this also shows the cost of having many of them pending
+    BenchHotPath("request + response, Reactor timeout", iterations / 20, [&net_crier, &msg, &response](size_t){
+      net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_1>(msg, [](const crier::test::test_msg_1&){}, 60000, [](){});
+      net_crier.transport().inject(response);
+    });
+  }
+}
+
+/// Messages received with nobody listening, under UnhandledMessageBehaviour::Enqueue: queueing them, then replaying them all to the first permanent callback.
+void BenchEnqueueReplay(size_t messages, size_t rounds) {
+  std::string payload = BenchRootPayload(64);
+  size_t queue_allocations = 0;
+  size_t replay_allocations = 0;
+  BenchClock::duration queue_time{0};
+  BenchClock::duration replay_time{0};
+  for(size_t round = 0; round < rounds; round++) {
+    SinkCrier net_crier{crier::UnhandledMessageBehaviour::Enqueue};
+    net_crier.connectTransport("localhost", 0);
+    size_t allocations = BenchAllocations();
+    auto start = BenchClock::now();
+    for(size_t i = 0; i < messages; i++) {
+      net_crier.transport().inject(payload);
+    }
+    queue_time += BenchClock::now() - start;
+    queue_allocations += BenchAllocations() - allocations;
+
+    size_t replayed = 0;
+    allocations = BenchAllocations();
+    start = BenchClock::now();
+    net_crier.registerPermanentCallback<crier::test::test_msg_2>("BenchEnqueueReplay", [&replayed](const crier::test::test_msg_2&){ replayed++; });
+    replay_time += BenchClock::now() - start;
+    replay_allocations += BenchAllocations() - allocations;
+  }
+  size_t total = messages * rounds;
+  auto print = [total](const char* name, BenchClock::duration elapsed, size_t allocations){
+    std::printf("   %-44s %9.1f ns/op %7.2f allocs/op %12.0f msgs/s\n", name, std::chrono::duration<double, std::nano>(elapsed).count() / total,
+      static_cast<double>(allocations) / total, BenchPerSecond(total, elapsed));
+  };
+  print("unhandled Enqueue (64B)", queue_time, queue_allocations);
+  print("unhandled Enqueue replay (64B)", replay_time, replay_allocations);
+}
+
+/// The whole loop through EchoTransport: sending, then receiving the echo into a permanent callback, on the same thread.
+void BenchEchoRoundTrip(size_t payload_size, size_t iterations) {
+  crier::Crier<EchoTransport, crier::test::root_msg> net_crier{};
+  net_crier.connectTransport("localhost", 0);
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("BenchEchoRoundTrip", [](const crier::test::test_msg_2&){});
+  crier::test::test_msg_2 msg;
+  msg.set_data(std::string(payload_size, 'x'));
+  BenchHotPath(BenchPayloadName("EchoTransport send + receive", payload_size), iterations, [&net_crier, &msg](size_t){
+    net_crier.sendMessage(msg);
+  });
+}
+
+void BenchHotPaths() {
+  for(size_t payload_size : {size_t(64), size_t(4096), size_t(65536)}) {
+    size_t iterations = payload_size >= 65536 ? 20000 : 200000;
+    BenchProtobufBaseline(payload_size, iterations);
+    BenchSend(payload_size, iterations);
+    BenchReceive(crier::InboundDispatching::Immediate, payload_size, iterations);
+    BenchReceive(crier::InboundDispatching::DispatchQueue, payload_size, iterations);
+    BenchEchoRoundTrip(payload_size, iterations);
+  }
+  BenchRequests(100000);
+  BenchEnqueueReplay(10000, 10);
+}
+
+#endif /* HotPathBenchmarks_hpp */
@@ -0,0 +1,66 @@
+#ifndef ReplayBenchmarks_hpp
+#define ReplayBenchmarks_hpp
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/LoadGeneratorTransport.hpp"
+#include "crier/transports/RecordingTransport.hpp"
+#include "crier/transports/ReplayTransport.hpp"
+
+/// Replays a capture recorded with RecordingTransport as fast as possible, passes times over, into an instance listening to every message type
+/// of the test protocol, and reports how fast it went. The same capture replayed before and after a change makes a regression benchmark out of real traffic.
+void BenchReplay(const std::string& capture_path, unsigned int passes) {
+  crier::ReplayTransport::Options options;
+  options.timing = crier::ReplayTransport::Timing::AsFastAsPossible;
+  options.loop = true;
+  {
+    crier::capture::Reader reader;
+    std::string err;
+    if(!reader.open(capture_path, err)) {
+      std::printf("   %s\n", err.c_str());
+      return;
+    }
+  }
+  crier::Crier<crier::ReplayTransport, crier::test::root_msg> net_crier{crier::ReplayTransport(capture_path, options)};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("BenchReplay", [](const crier::test::test_msg_1&){});
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("BenchReplay", [](const crier::test::test_msg_2&){});
+  net_crier.connectTransport("", 0);
+  while(net_crier.transport().stats().passes < passes && !net_crier.transport().finished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  net_crier.disconnectTransport();
+  auto stats = net_crier.transport().stats();
+  std::printf("   %llu messages (%llu passes) in %.2f s: %.0f msgs/s, consume p50 %.2f us, p99 %.2f us, max %.2f us\n",
+    static_cast<unsigned long long>(stats.replayed), static_cast<unsigned long long>(stats.passes), std::chrono::duration<double>(stats.elapsed).count(),
+    stats.replayedPerSecond(), stats.consume_time.percentile(0.5) / 1000.0, stats.consume_time.percentile(0.99) / 1000.0, stats.consume_time.max / 1000.0);
+}
+
+/// Records a second of LoadGeneratorTransport's bursty traffic (see BenchSoak) into a capture, for BenchReplay to run without one at hand.
+inline std::string BenchRecordCapture() {
+  const std::string path = "/tmp/crier-bench-" + std::to_string(getpid()) + ".capture";
+  crier::LoadGeneratorTransport load(crier::LoadGeneratorTransport::Options::bursts(20000, 200000, std::chrono::milliseconds{1000},
+    std::chrono::milliseconds{100}));
+  crier::test::root_msg small;
+  small.mutable_test_msg_1_field()->set_id(1);
+  load.addMessage(small, 4.0);
+  crier::test::root_msg medium;
+  medium.mutable_test_msg_2_field()->set_data(std::string(64, 'x'));
+  load.addMessage(medium, 8.0);
+  crier::test::root_msg large;
+  large.mutable_test_msg_2_field()->set_data(std::string(4096, 'x'));
+  load.addMessage(large, 1.0);
+  crier::Crier<crier::RecordingTransport<crier::LoadGeneratorTransport>, crier::test::root_msg> net_crier{
+    crier::RecordingTransport<crier::LoadGeneratorTransport>(path, std::move(load))};
+  net_crier.connectTransport("", 0);
+  std::this_thread::sleep_for(std::chrono::seconds{1});
+  net_crier.disconnectTransport();
+  return path;
+}
+
+#endif /* ReplayBenchmarks_hpp */
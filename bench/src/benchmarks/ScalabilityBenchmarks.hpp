@@ -0,0 +1,148 @@
+#ifndef ScalabilityBenchmarks_hpp
+#define ScalabilityBenchmarks_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "BenchUtils.hpp"
+#include "SinkTransport.hpp"
+
+/// Results of a single run of BenchConcurrentLoad.
+struct ScalabilityResult {
+  size_t threads = 0;
+  size_t sent = 0;
+  size_t received = 0;
+  size_t churned = 0;
+  BenchClock::duration elapsed{0};
+  double send_p99_ns = 0;
+  double receive_p99_ns = 0;
+  crier::MetricsSnapshot metrics;
+};
+
+/// Shares a single instance between threads producers calling sendMessage, threads transport threads delivering data, and a thread churning
+/// permanent callbacks (registering and clearing one, over and over) for the same type the others receive, for duration. Every 16th send and
+/// receive is timed, for the p99. Metrics are enabled, for lock contention.
+inline ScalabilityResult BenchConcurrentLoad(size_t threads, std::chrono::milliseconds duration) {
+  using ScaleCrier = crier::Crier<SinkTransport, crier::test::root_msg>;
+  ScaleCrier net_crier{};
+  net_crier.enableMetrics();
+  net_crier.connectTransport("localhost", 0);
+  std::atomic<size_t> callbacks{0};
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("BenchConcurrentLoad", [&callbacks](const crier::test::test_msg_2&){
+    callbacks.fetch_add(1, std::memory_order_relaxed); });
+
+  crier::test::test_msg_2 msg;
+  msg.set_data(std::string(64, 'x'));
+  crier::test::root_msg root;
+  *root.mutable_test_msg_2_field() = msg;
+  const std::string payload = root.SerializeAsString();
+
+  std::atomic<bool> started{false};
+  std::atomic<bool> stopping{false};
+  std::vector<size_t> sent(threads, 0);
+  std::vector<size_t> received(threads, 0);
+  std::vector<LatencySamples> send_samples(threads);
+  std::vector<LatencySamples> receive_samples(threads);
+  size_t churned = 0;
+
+  // Each thread times every 16th of its operations, counting all of them
+  auto run = [&started, &stopping](size_t& count, LatencySamples& samples, const std::function<void()>& operation){
+    while(!started.load()) { std::this_thread::yield(); }
+    while(!stopping.load(std::memory_order_relaxed)) {
+      if(count % 16 == 0) {
+        auto start = BenchClock::now();
+        operation();
+        samples.add(BenchClock::now() - start);
+      } else {
+        operation();
+      }
+      count++;
+    }
+  };
+  std::vector<std::thread> workers;
+  for(size_t i = 0; i < threads; i++) {
+    workers.emplace_back([&, i](){ run(sent[i], send_samples[i], [&net_crier, &msg](){ net_crier.sendMessage(msg); }); });
+    workers.emplace_back([&, i](){ run(received[i], receive_samples[i], [&net_crier, &payload](){ net_crier.transport().inject(payload); }); });
+  }
+  workers.emplace_back([&](){
+    LatencySamples unused;
+    run(churned, unused, [&net_crier](){
+      net_crier.registerPermanentCallback<crier::test::test_msg_2>("BenchChurn", [](const crier::test::test_msg_2&){});
+      net_crier.clearPermanentCallback<crier::test::test_msg_2>("BenchChurn");
+    });
+  });
+
+  auto start = BenchClock::now();
+  started = true;
+  std::this_thread::sleep_for(duration);
+  stopping = true;
+  for(auto& worker : workers) {
+    worker.join();
+  }
+
+  ScalabilityResult result;
+  result.threads = threads;
+  result.elapsed = BenchClock::now() - start;
+  result.churned = churned;
+  LatencySamples all_sends;
+  LatencySamples all_receives;
+  for(size_t i = 0; i < threads; i++) {
+    result.sent += sent[i];
+    result.received += received[i];
+    all_sends.merge(send_samples[i]);
+    all_receives.merge(receive_samples[i]);
+  }
+  result.send_p99_ns = all_sends.percentile(0.99);
+  result.receive_p99_ns = all_receives.percentile(0.99);
+  result.metrics = net_crier.metricsSnapshot();
+  return result;
+}
+
+/// Thread counts to sweep: powers of two up to the cores available, and at least up to 4, to also see how crier holds up oversubscribed.
+inline std::vector<size_t> BenchThreadCounts() {
+  size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+  std::vector<size_t> counts;
+  for(size_t threads = 1; threads <= std::max<size_t>(4, cores); threads *= 2) {
+    counts.push_back(threads);
+  }
+  if(counts.back() < cores)
+    counts.push_back(cores);
+  return counts;
+}
+
+/// Sweeps BenchConcurrentLoad over BenchThreadCounts, plotting the throughput and p99 latencies of each run, then the contention on each of
+/// crier's locks, for finding hotspots and measuring changes to them.
+void BenchScalability() {
+  std::vector<ScalabilityResult> results;
+  double best = 0;
+  for(size_t threads : BenchThreadCounts()) {
+    results.push_back(BenchConcurrentLoad(threads, std::chrono::milliseconds{300}));
+    best = std::max(best, BenchPerSecond(results.back().sent + results.back().received, results.back().elapsed));
+  }
+  std::printf("   %-8s %12s %12s %12s %10s  %s\n", "threads", "sends/s", "receives/s", "p99 send", "p99 recv", "throughput");
+  for(const auto& result : results) {
+    double total = BenchPerSecond(result.sent + result.received, result.elapsed);
+    int bar = best > 0 ? static_cast<int>(30 * total / best) : 0;
+    std::printf("   %-8zu %12.0f %12.0f %9.2f us %7.2f us  %s\n", result.threads, BenchPerSecond(result.sent, result.elapsed),
+      BenchPerSecond(result.received, result.elapsed), result.send_p99_ns / 1000.0, result.receive_p99_ns / 1000.0, std::string(bar, '#').c_str());
+  }
+  // Waits are only timed for the contended acquisitions, so their p99 is that of the waits that did happen
+  std::printf("   %-8s %-24s %12s %10s %9s %12s\n", "threads", "lock", "acquired", "contended", "", "p99 wait");
+  for(const auto& result : results) {
+    for(const auto& lock : result.metrics.locks) {
+      if(lock.acquisitions == 0)
+        continue;
+      std::printf("   %-8zu %-24s %12llu %10llu %8.3f%% %9.2f us\n", result.threads, lock.name.c_str(), static_cast<unsigned long long>(lock.acquisitions),
+        static_cast<unsigned long long>(lock.contended), 100.0 * lock.contended / lock.acquisitions, lock.wait_time.percentile(0.99) / 1000.0);
+    }
+  }
+}
+
+#endif /* ScalabilityBenchmarks_hpp */
@@ -0,0 +1,36 @@
+#ifndef SinkTransport_hpp
+#define SinkTransport_hpp
+
+#include <string>
+
+#include "crier/TransportConcept.hpp"
+
+/// Discards everything sent through it, and hands crier whatever data a benchmark injects, as if just received. Lets benchmarks time
+/// the send and receive paths apart, with nothing but crier running.
+class SinkTransport : public crier::TransportConcept {
+public:
+  void connect(const std::string&, int) {
+    _connected = true;
+    _on_connect_cb();
+  }
+  void disconnect() {
+    _connected = false;
+    _on_disconnect_cb("User closed transport");
+  }
+  bool isConnected() const { return _connected; }
+
+  void sendData(const std::string&) {}
+
+  /// Delivers the data to crier on the calling thread, in place as socket transports do. May be called from many threads at once, as if from many transport threads.
+  void inject(const std::string& data) {
+    if(_on_raw_data_cb)
+      _on_raw_data_cb(data.data(), data.size());
+    else
+      _on_data_cb(data);
+  }
+
+private:
+  bool _connected = false;
+};
+
+#endif /* SinkTransport_hpp */
@@ -0,0 +1,84 @@
+#ifndef SoakBenchmarks_hpp
+#define SoakBenchmarks_hpp
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/LoadGeneratorTransport.hpp"
+#include "BenchUtils.hpp"
+
+/// Resident memory of the process, in megabytes (0 where /proc isn't there).
+inline double BenchResidentMegabytes() {
+  long pages = 0;
+  FILE* statm = std::fopen("/proc/self/statm", "r");
+  if(statm == nullptr)
+    return 0;
+  if(std::fscanf(statm, "%*d %ld", &pages) != 1)
+    pages = 0;
+  std::fclose(statm);
+  return static_cast<double>(pages) * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+}
+
+/// Soaks an instance with LoadGeneratorTransport for the given amount of seconds: a 20000 msgs/s base load bursting to 200000 msgs/s for a tenth
+/// of every second, mixing small and large messages, queued for a dispatch thread. Prints, every second, how fast it was taken in, how far behind
+/// the generator fell, how deep the dispatch queue got and the memory in use, which should all hold steady however long it runs.
+void BenchSoak(unsigned int seconds) {
+  using SoakCrier = crier::Crier<crier::LoadGeneratorTransport, crier::test::root_msg>;
+  crier::LoadGeneratorTransport transport(crier::LoadGeneratorTransport::Options::bursts(20000, 200000, std::chrono::milliseconds{1000},
+    std::chrono::milliseconds{100}));
+  crier::test::root_msg small;
+  small.mutable_test_msg_1_field()->set_id(1);
+  transport.addMessage(small, 4.0);
+  crier::test::root_msg medium;
+  medium.mutable_test_msg_2_field()->set_data(std::string(64, 'x'));
+  transport.addMessage(medium, 8.0);
+  crier::test::root_msg large;
+  large.mutable_test_msg_2_field()->set_data(std::string(4096, 'x'));
+  transport.addMessage(large, 1.0);
+
+  SoakCrier net_crier{std::move(transport), crier::UnhandledMessageBehaviour::Ignore, crier::InboundDispatching::DispatchQueue};
+  net_crier.enableMetrics();
+  std::atomic<size_t> handled{0};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("BenchSoak", [&handled](const crier::test::test_msg_1&){ handled++; });
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("BenchSoak", [&handled](const crier::test::test_msg_2&){ handled++; });
+
+  std::atomic<bool> stopping{false};
+  std::thread dispatcher([&net_crier, &stopping](){
+    while(!stopping) {
+      net_crier.dispatchQueuedCallbacks();
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+  });
+  net_crier.connectTransport("localhost", 0);
+
+  std::printf("   %-6s %12s %12s %12s %10s %12s %10s\n", "second", "injected/s", "handled/s", "p99 consume", "lag", "queue peak", "rss");
+  uint64_t last_injected = 0;
+  size_t last_handled = 0;
+  for(unsigned int second = 1; second <= seconds; second++) {
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+    auto stats = net_crier.transport().stats();
+    auto metrics = net_crier.metricsSnapshot();
+    size_t now_handled = handled;
+    std::printf("   %-6u %12llu %12zu %9.2f us %7.2f ms %12llu %7.1f MB\n", second, static_cast<unsigned long long>(stats.injected - last_injected),
+      now_handled - last_handled, stats.consume_time.percentile(0.99) / 1000.0, std::chrono::duration<double, std::milli>(stats.lag).count(),
+      static_cast<unsigned long long>(metrics.dispatch_queue_peak), BenchResidentMegabytes());
+    last_injected = stats.injected;
+    last_handled = now_handled;
+  }
+
+  net_crier.disconnectTransport();
+  stopping = true;
+  dispatcher.join();
+  auto stats = net_crier.transport().stats();
+  std::printf("   %llu messages in %.1f s, %.0f msgs/s, %llu missed, max lag %.2f ms\n", static_cast<unsigned long long>(stats.injected),
+    std::chrono::duration<double>(stats.elapsed).count(), stats.injectedPerSecond(), static_cast<unsigned long long>(stats.missed),
+    std::chrono::duration<double, std::milli>(stats.max_lag).count());
+}
+
+#endif /* SoakBenchmarks_hpp */
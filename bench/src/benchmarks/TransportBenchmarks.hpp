@@ -0,0 +1,186 @@
+#ifndef TransportBenchmarks_hpp
+#define TransportBenchmarks_hpp
+
+#include <atomic>
+#include <string>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "crier/transports/IoUringTransport.hpp"
+#include "crier/transports/UdpTransport.hpp"
+#include "crier/transports/UnixTransport.hpp"
+#include "crier/transports/ShmTransport.hpp"
+#include "transports/EchoTransport.hpp"
+#include "transports/TimedEchoTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "transports/UdpEchoServer.hpp"
+#include "transports/ShmEchoPeer.hpp"
+#include "BenchUtils.hpp"
+
+/// Sends one request at a time and waits for its echo, measuring the full round trip through crier.
+template <typename Transport, typename ProtoRootMsg>
+void BenchRequestLatency(const std::string& name, crier::Crier<Transport, ProtoRootMsg>& net_crier, size_t requests) {
+  LatencySamples samples;
+  samples.reserve(requests);
+  crier::test::test_msg_1 msg;
+  for(size_t i = 0; i < requests; i++) {
+    std::atomic<bool> replied{false};
+    msg.set_id(static_cast<unsigned int>(i));
+    auto start = BenchClock::now();
+    net_crier.template sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+      [&replied](const crier::test::test_msg_1&){ replied = true; });
+    if(!BenchWaitUntil([&replied](){ return replied.load(); }, 1000)) {
+      std::printf("   %-44s timed out\n", name.c_str());
+      return;
+    }
+    samples.add(BenchClock::now() - start);
+  }
+  PrintLatencyResult(name, samples);
+}
+
+/// Sends every message back-to-back, and measures how long until all of their echoes are received.
+template <typename Transport, typename ProtoRootMsg>
+void BenchPipelinedThroughput(const std::string& name, crier::Crier<Transport, ProtoRootMsg>& net_crier, size_t messages, size_t payload_size) {
+  std::atomic<size_t> received{0};
+  net_crier.template registerPermanentCallback<crier::test::test_msg_2>("BenchPipelinedThroughput",
+    [&received](const crier::test::test_msg_2&){ received++; });
+
+  crier::test::test_msg_2 msg;
+  msg.set_data(std::string(payload_size, 'x'));
+  auto start = BenchClock::now();
+  for(size_t i = 0; i < messages; i++) {
+    net_crier.sendMessage(msg);
+  }
+  bool completed = BenchWaitUntil([&received, messages](){ return received == messages; }, 30000);
+  auto elapsed = BenchClock::now() - start;
+  net_crier.template clearPermanentCallback<crier::test::test_msg_2>("BenchPipelinedThroughput");
+
+  if(completed) {
+    PrintThroughputResult(name, messages, elapsed);
+  } else {
+    std::printf("   %-44s timed out (%zu of %zu)\n", name.c_str(), received.load(), messages);
+  }
+}
+
+/// Keeps up to window messages in flight, measuring how many echoes are received per second. Meant for lossy transports:
+/// if no echo arrives for a while, whatever is in flight is counted as lost and the window moves on.
+template <typename Transport, typename ProtoRootMsg>
+void BenchWindowedThroughput(const std::string& name, crier::Crier<Transport, ProtoRootMsg>& net_crier, size_t messages, size_t payload_size, size_t window) {
+  std::atomic<size_t> received{0};
+  net_crier.template registerPermanentCallback<crier::test::test_msg_2>("BenchWindowedThroughput",
+    [&received](const crier::test::test_msg_2&){ received++; });
+
+  crier::test::test_msg_2 msg;
+  msg.set_data(std::string(payload_size, 'x'));
+  size_t sent = 0;
+  size_t lost = 0;
+  size_t last_received = 0;
+  auto last_progress = BenchClock::now();
+  auto start = last_progress;
+  while(received + lost < messages) {
+    if(sent < messages && sent - received - lost < window) {
+      net_crier.sendMessage(msg);
+      sent++;
+      continue;
+    }
+    size_t now_received = received;
+    if(now_received != last_received) {
+      last_received = now_received;
+      last_progress = BenchClock::now();
+    } else if(BenchClock::now() - last_progress > std::chrono::milliseconds{100}) {
+      lost = sent - now_received;
+      last_progress = BenchClock::now();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  auto elapsed = BenchClock::now() - start;
+  net_crier.template clearPermanentCallback<crier::test::test_msg_2>("BenchWindowedThroughput");
+
+  std::printf("   %-44s %12.0f pkts/s   (%zu msgs, %zu lost)\n", name.c_str(), BenchPerSecond(received, elapsed), messages, lost);
+}
+
+void BenchEchoTransports() {
+  {
+    crier::Crier<EchoTransport, crier::test::root_msg> net_crier{};
+    net_crier.connectTransport("localhost", 0);
+    BenchRequestLatency("EchoTransport request latency", net_crier, 100000);
+    BenchPipelinedThroughput("EchoTransport throughput (64B)", net_crier, 200000, 64);
+    BenchPipelinedThroughput("EchoTransport throughput (4KB)", net_crier, 50000, 4096);
+  }
+  {
+    crier::Crier<TimedEchoTransport, crier::test::root_msg> net_crier{TimedEchoTransport(0)};
+    net_crier.connectTransport("localhost", 0);
+    BenchRequestLatency("TimedEchoTransport(0) request latency", net_crier, 5000);
+    BenchPipelinedThroughput("TimedEchoTransport(0) throughput (64B)", net_crier, 20000, 64);
+  }
+}
+
+/// Runs the request latency and throughput benchmarks for a socket transport, against a loopback echo server.
+/// With async_send, sends go through crier's asynchronous outbound queue instead.
+template <typename Transport>
+void BenchSocketTransport(const std::string& name, bool async_send = false) {
+  TcpEchoServer server;
+  crier::Crier<Transport, crier::test::root_msg> net_crier{};
+  if(async_send) {
+    net_crier.enableAsyncSend();
+  }
+  std::atomic<bool> connected{false};
+  net_crier.registerForTransportOpenedCallback("BenchSocketTransport", [&connected](){ connected = true; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!BenchWaitUntil([&connected](){ return connected.load(); }, 1000)) {
+    std::printf("   %s couldn't connect to the loopback echo server\n", name.c_str());
+    return;
+  }
+  BenchRequestLatency(name + " loopback request latency", net_crier, 20000);
+  BenchPipelinedThroughput(name + " loopback throughput (64B)", net_crier, 200000, 64);
+  BenchPipelinedThroughput(name + " loopback throughput (4KB)", net_crier, 50000, 4096);
+}
+
+void BenchTcpTransport() {
+  BenchSocketTransport<crier::TcpTransport>("TcpTransport");
+  BenchSocketTransport<crier::TcpTransport>("TcpTransport async", true);
+}
+
+void BenchIoUringTransport() {
+  BenchSocketTransport<crier::IoUringTransport>("IoUringTransport");
+}
+
+/// Runs against a loopback udp echo server. Throughput is measured in round trips per second, as every message is one datagram each way.
+void BenchUdpTransport() {
+  UdpEchoServer server;
+  crier::UdpTransport::Options options;
+  options.socket_buffer_size = 4 * 1024 * 1024;
+  crier::Crier<crier::UdpTransport, crier::test::root_msg> net_crier{crier::UdpTransport(options)};
+  net_crier.connectTransport("127.0.0.1", server.port());
+  BenchRequestLatency("UdpTransport loopback request latency", net_crier, 20000);
+  BenchWindowedThroughput("UdpTransport loopback throughput (64B)", net_crier, 200000, 64, 256);
+  BenchWindowedThroughput("UdpTransport loopback throughput (1KB)", net_crier, 100000, 1024, 256);
+}
+
+/// Same host transports: a unix socket, against shared memory rings with and without busy polling.
+void BenchLocalTransports() {
+  {
+    const std::string path = "@crier-bench-unix-" + std::to_string(getpid());
+    TcpEchoServer server(path);
+    crier::Crier<crier::UnixTransport, crier::test::root_msg> net_crier{};
+    net_crier.connectTransport(path, 0);
+    BenchRequestLatency("UnixTransport request latency", net_crier, 20000);
+    BenchPipelinedThroughput("UnixTransport throughput (64B)", net_crier, 200000, 64);
+  }
+  for(unsigned int busy_poll_us : {0u, 50u}) {
+    crier::ShmTransport::Options options;
+    options.busy_poll_us = busy_poll_us;
+    const std::string name = "bench-" + std::to_string(getpid());
+    const std::string label = "ShmTransport(poll " + std::to_string(busy_poll_us) + "us)";
+    crier::Crier<crier::ShmTransport, crier::test::root_msg> net_crier{crier::ShmTransport(options)};
+    net_crier.connectTransport(name, static_cast<int>(busy_poll_us));
+    ShmEchoPeer peer(options);
+    peer.connect(name, static_cast<int>(busy_poll_us));
+    BenchRequestLatency(label + " request latency", net_crier, 20000);
+    BenchPipelinedThroughput(label + " throughput (64B)", net_crier, 200000, 64);
+  }
+}
+
+#endif /* TransportBenchmarks_hpp */
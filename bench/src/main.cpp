@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "benchmarks/AllocationCounter.hpp"
+#include "benchmarks/HotPathBenchmarks.hpp"
+#include "benchmarks/ScalabilityBenchmarks.hpp"
+#include "benchmarks/SoakBenchmarks.hpp"
+#include "benchmarks/ReplayBenchmarks.hpp"
+#include "benchmarks/TransportBenchmarks.hpp"
+#include "benchmarks/FootprintBenchmarks.hpp"
+
+int main(int argc, const char *argv[]) {
+  // 'crier-bench hotpaths' or 'crier-bench scalability' run only that section, quick enough to run on every change
+  const char* only = argc > 1 ? argv[1] : nullptr;
+  auto runs = [only](const char* section){ return only == nullptr || std::strcmp(only, section) == 0; };
+  std::cout << std::endl;
+  std::cout << "========== Executing Crier Benchmarks ==========" << std::endl;
+  if(runs("hotpaths")) {
+    std::cout << " > Hot Paths:" << std::endl;
+    BenchHotPaths();
+  }
+  if(runs("scalability")) {
+    std::cout << " > Scalability:" << std::endl;
+    BenchScalability();
+  }
+  // Soaking runs for as long as asked ('crier-bench soak <seconds>'), so only when asked for
+  if(only != nullptr && std::strcmp(only, "soak") == 0) {
+    std::cout << " > Soak:" << std::endl;
+    BenchSoak(argc > 2 ? static_cast<unsigned int>(std::strtoul(argv[2], nullptr, 10)) : 10);
+  }
+  // 'crier-bench replay <capture> <passes>' replays a capture of the test protocol, or a second of recorded synthetic load without one
+  if(only != nullptr && std::strcmp(only, "replay") == 0) {
+    std::cout << " > Replay:" << std::endl;
+    std::string capture = argc > 2 && argv[2][0] != '\0' ? argv[2] : BenchRecordCapture();
+    BenchReplay(capture, argc > 3 ? static_cast<unsigned int>(std::strtoul(argv[3], nullptr, 10)) : 10);
+    if(argc <= 2 || argv[2][0] == '\0')
+      std::remove(capture.c_str());
+  }
+  if(only != nullptr) {
+    std::cout << std::endl;
+    return 0;
+  }
+  std::cout << " > Echo Transports:" << std::endl;
+  BenchEchoTransports();
+  std::cout << " > Tcp Transport:" << std::endl;
+  BenchTcpTransport();
+  std::cout << " > IoUring Transport:" << std::endl;
+  BenchIoUringTransport();
+  std::cout << " > Udp Transport:" << std::endl;
+  BenchUdpTransport();
+  std::cout << " > Local Transports:" << std::endl;
+  BenchLocalTransports();
+  std::cout << " > Instance Footprint:" << std::endl;
+  BenchFootprint();
+  std::cout << std::endl;
+}
@@ -0,0 +1,114 @@
+#ifndef CRIER_CANCELLATION_HPP
+#define CRIER_CANCELLATION_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace crier {
+
+  /// Something a RequestHandle can cancel: a pending request, a policy request or a stream.
+  class Cancellable {
+  public:
+    virtual ~Cancellable() = default;
+
+    /// Returns false if it had already finished (or been cancelled).
+    virtual bool cancel() = 0;
+  };
+
+  /// RequestHandle
+  /// Handle to a pending request, returned by the Crier request methods. Cheap to copy, and neither keeps the request alive nor cancels it when dropped.
+  //  Cancelling drops the request's callbacks (and everything they captured) right away, and frees its in-flight slot, if it took one.
+  //  Since the request already went out, crier still expects its response: it is dropped when it arrives, so it doesn't answer any other request.
+  class RequestHandle {
+  public:
+    RequestHandle() = default;
+    explicit RequestHandle(const std::shared_ptr<Cancellable>& request) : _request(request) {}
+
+    /// False once the request finished, or for a default constructed handle, that no request is behind.
+    bool valid() const { return !_request.expired(); }
+
+    /// Cancels the request, so none of its callbacks run. Returns false if it had already finished.
+    bool cancel() const {
+      std::shared_ptr<Cancellable> request = _request.lock();
+      return request && request->cancel();
+    }
+
+    const std::weak_ptr<Cancellable>& cancellable() const { return _request; }
+
+  private:
+    // Weak, as what's behind it may hold the handle itself (a future does, through the callbacks resolving it)
+    std::weak_ptr<Cancellable> _request;
+  };
+
+  /// CancellationToken
+  /// Ties many requests together (say, everything a UI screen or a client session sent), to cancel them all at once. Cheap to copy, all copies share the one token.
+  class CancellationToken {
+  public:
+    CancellationToken() : _state(std::make_shared<State>()) {}
+
+    /// Ties a request to the token. A request added once the token is cancelled is cancelled right away.
+    void add(const RequestHandle& handle) const {
+      if(!handle.valid())
+        return;
+      {
+        std::lock_guard<std::mutex> guard(_state->mutex);
+        if(!_state->cancelled) {
+          // Finished requests are only pruned as the list doubles, keeping adds cheap
+          if(_state->requests.size() >= _state->prune_at) {
+            prune();
+            _state->prune_at = 2 * _state->requests.size() + 16;
+          }
+          _state->requests.push_back(handle.cancellable());
+          return;
+        }
+      }
+      handle.cancel();
+    }
+
+    /// Cancels every request tied to the token, and the ones added from now on. Returns how many were still pending.
+    size_t cancel() const {
+      std::vector<std::weak_ptr<Cancellable>> requests;
+      {
+        std::lock_guard<std::mutex> guard(_state->mutex);
+        _state->cancelled = true;
+        requests.swap(_state->requests);
+      }
+      size_t cancelled = 0;
+      for(const auto& request : requests) {
+        std::shared_ptr<Cancellable> pending = request.lock();
+        if(pending && pending->cancel())
+          cancelled++;
+      }
+      return cancelled;
+    }
+
+    bool cancelled() const {
+      std::lock_guard<std::mutex> guard(_state->mutex);
+      return _state->cancelled;
+    }
+
+  private:
+    struct State {
+      std::mutex mutex;
+      bool cancelled = false;
+      // Weak, so the token never keeps a finished request alive
+      std::vector<std::weak_ptr<Cancellable>> requests;
+      size_t prune_at = 16;
+    };
+
+    void prune() const {
+      auto& requests = _state->requests;
+      size_t kept = 0;
+      for(size_t i = 0; i < requests.size(); i++) {
+        if(!requests[i].expired())
+          requests[kept++] = requests[i];
+      }
+      requests.resize(kept);
+    }
+
+    std::shared_ptr<State> _state;
+  };
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef CRIER_CHROME_TRACE_BUFFER_HPP
+#define CRIER_CHROME_TRACE_BUFFER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <crier/Tracing.hpp>
+
+namespace crier {
+
+  /// TraceSink keeping the latest spans in a fixed size ring buffer, in memory, to be written out as Chrome trace JSON
+  /// (loadable in chrome://tracing or Perfetto) when a latency spike needs looking into. Older spans are overwritten once full.
+  class ChromeTraceBuffer : public TraceSink {
+  public:
+    explicit ChromeTraceBuffer(size_t capacity = 65536) : _capacity(capacity > 0 ? capacity : 1), _epoch(std::chrono::steady_clock::now()) {
+      _spans.reserve(_capacity);
+    }
+
+    void record(const TraceSpan& span) override {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(_spans.size() < _capacity) {
+        _spans.push_back(span);
+      } else {
+        _spans[_next] = span;
+        _next = (_next + 1) % _capacity;
+      }
+      _recorded++;
+    }
+
+    /// Spans held, at most the capacity.
+    size_t size() const {
+      std::lock_guard<std::mutex> guard(_mutex);
+      return _spans.size();
+    }
+
+    /// Spans recorded since created, including the ones overwritten.
+    uint64_t recorded() const {
+      std::lock_guard<std::mutex> guard(_mutex);
+      return _recorded;
+    }
+
+    /// Copy of the spans held, oldest first.
+    std::vector<TraceSpan> spans() const {
+      std::lock_guard<std::mutex> guard(_mutex);
+      std::vector<TraceSpan> ordered(_spans.begin() + static_cast<std::ptrdiff_t>(_next), _spans.end());
+      ordered.insert(ordered.end(), _spans.begin(), _spans.begin() + static_cast<std::ptrdiff_t>(_next));
+      return ordered;
+    }
+
+    void clear() {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _spans.clear();
+      _next = 0;
+    }
+
+    /// Writes the spans held as a Chrome trace JSON object, timestamps in microseconds since the buffer was created.
+    void writeJson(std::ostream& out) const {
+      std::vector<TraceSpan> ordered = spans();
+      out << "{\"traceEvents\":[";
+      for(size_t i = 0; i < ordered.size(); i++) {
+        const TraceSpan& span = ordered[i];
+        out << (i > 0 ? "," : "") << "{\"name\":\"" << tracePhaseName(span.phase);
+        if(!span.type.empty()) {
+          out << " ";
+          writeEscaped(out, span.type);
+        }
+        out << "\",\"cat\":\"crier\",\"ph\":\"X\",\"ts\":" << microseconds(span.start - _epoch)
+            << ",\"dur\":" << microseconds(span.duration)
+            << ",\"pid\":1,\"tid\":" << std::hash<std::thread::id>()(span.thread) % 1000000
+            << ",\"args\":{\"type\":\"";
+        writeEscaped(out, span.type);
+        out << "\",\"key\":\"";
+        writeEscaped(out, span.key);
+        out << "\"}}";
+      }
+      out << "]}";
+    }
+
+    std::string json() const {
+      std::ostringstream out;
+      writeJson(out);
+      return out.str();
+    }
+
+  private:
+    static std::string microseconds(std::chrono::nanoseconds duration) {
+      char formatted[32];
+      std::snprintf(formatted, sizeof(formatted), "%.3f", static_cast<double>(duration.count()) / 1000.0);
+      return formatted;
+    }
+
+    static void writeEscaped(std::ostream& out, const std::string& text) {
+      for(char c : text) {
+        if(c == '"' || c == '\\') {
+          out << '\\' << c;
+        } else if(static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+          out << escaped;
+        } else {
+          out << c;
+        }
+      }
+    }
+
+    const size_t _capacity;
+    const std::chrono::steady_clock::time_point _epoch;
+    std::vector<TraceSpan> _spans;
+    size_t _next = 0;
+    uint64_t _recorded = 0;
+    mutable std::mutex _mutex;
+  };
+}
+
+#endif
@@ -14,11 +14,35 @@
 #include <list>
 #include <typeinfo>
 #include <typeindex>
+#include <condition_variable>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstddef>
+#include <type_traits>
 
 #include <google/protobuf/message.h>
 #include <google/protobuf/descriptor.h>
+#include <google/protobuf/unknown_field_set.h>
 
 #include <crier/CrierTypes.hpp>
+#include <crier/Cancellation.hpp>
+#include <crier/Metrics.hpp>
+#include <crier/Tracing.hpp>
+#include <crier/ResponseFuture.hpp>
+#include <crier/ResponseStream.hpp>
+#include <crier/private/TransportTraits.hpp>
+#include <crier/private/RootMessage.hpp>
+#include <crier/private/MpscQueue.hpp>
+#include <crier/private/RequestLimiter.hpp>
+#include <crier/private/AwaitedRequest.hpp>
+#include <crier/private/PendingRequest.hpp>
+#include <crier/private/PolicyRequest.hpp>
+#include <crier/private/MetricsRegistry.hpp>
+#include <crier/private/CrierMutex.hpp>
+#include <crier/private/CallbackAccounting.hpp>
+#include <crier/private/TraceScope.hpp>
+#include <crier/RequestAwaitable.hpp>
 
 namespace crier {
 
@@ -30,8 +54,10 @@ namespace crier {
   /// - the ProtoRootMsg must be the generated protocol buffer class that represents the root message of the protocol you wish to use with this crier instance.
   ///    If this sounds very confusing, please check the 'How to Use' of the Readme at the root of this repo. Crier will use this message in reflection in order to figure out
   ///    which message it's sending, or which message it has just received.
+  /// - the Tracer is the tracing policy (see Tracing.hpp). NoTracing by default, which compiles every trace point out. With Tracing, each step a message goes through
+  ///    is handed as a span to the sink set on 'tracer()'.
   /// Multiple crier instances can be created, using different transports and even different protocols
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer = NoTracing>
   class Crier {
   public:
 
@@ -78,11 +104,118 @@ namespace crier {
     /// Returns true if the Transport has an active connection, false otherwise (will call the void 'bool isConnected()' on your Transport concept implementation)
     bool transportConnected() const;
 
+    /// Enables automatic reconnects: whenever the transport closes without 'disconnectTransport' having been called, crier connects it again to the last ip and port
+    /// given to 'connectTransport', retrying with jittered exponential backoff as set in the policy (see ReconnectPolicy in CrierTypes.hpp).
+    //  Transport closed callbacks are only called for the disconnect that starts an outage, not for each failed attempt, and transport opened callbacks once reconnected.
+    //  Messages sent while disconnected are held (up to the policy's outage_buffer_bytes) and handed to the transport in a single batch once it's connected again,
+    //  right before the transport opened callbacks run. Without a reactor (see attachToReactor) attempts are made from a thread of the instance's own, started here.
+    //  Should be called before connecting the transport. Calling it again just replaces the policy.
+    void enableAutoReconnect(const ReconnectPolicy& policy = ReconnectPolicy());
+
+    /// Disables automatic reconnects, canceling any pending attempt and dropping the messages held for it.
+    void disableAutoReconnect();
+
+    /// Sets what happens to the requests still waiting on a response when the transport disconnects (see PendingRequestsOnDisconnect in CrierTypes.hpp), Keep by default.
+    /// Under Fail, every request sent before the disconnect fails right away, instead of waiting out its timeout (or forever, if it has none), and its callbacks are freed.
+    //  Plain requests run their timeout callback, futures and awaited requests resolve as Disconnected, streams end as Disconnected, and policy requests stop
+    //  retrying and run their timeout callback. These run where the timeout callbacks would (see 'Threading Behaviour' below). Requests still queued behind the
+    //  in-flight caps weren't sent yet, and stay queued. With automatic reconnects, requests fail as the outage starts, and the ones sent during it are kept.
+    //  Should be set before connecting the transport.
+    void setPendingRequestsOnDisconnect(PendingRequestsOnDisconnect behaviour);
+
     /// Gets a const reference to the crier managed transport instance. Usefull if you need to fetch information from it
     const Transport& ctransport() const;
     /// Gets a reference to the crier managed transport instance. Typically you shouldn't mess with it during regular usage, but it's available for edge cases
     Transport& transport();
 
+// -- Reactor
+// Sharing event loop threads among many crier instances
+
+    /// Moves this instance onto a shared Reactor (see Reactor.hpp), so it doesn't need threads of its own. Must be called before connecting the transport.
+    /// The transport is attached to one of the reactor's loops (if it supports it, as the first-party epoll transports do), and timeouts become timers on that same loop.
+    //  - drain_dispatch_queue_on_reactor, if true, callbacks placed in the dispatch queue are also dispatched on the reactor loop, as they arrive,
+    //    rather than waiting for a call to 'dispatchQueuedCallbacks'. Useful when the point of the queue is only to get callbacks off the transport's path.
+    //  The reactor must outlive this instance. Everything attached to one loop runs on its thread, so callbacks that block will stall every instance sharing it.
+    template <typename ReactorType>
+    void attachToReactor(ReactorType& reactor, bool drain_dispatch_queue_on_reactor = false);
+
+// -- Asynchronous Sends
+// Taking the transport off the sending threads' path
+
+    /// Makes sends asynchronous: sendMessage serializes the message and pushes it onto a lock-free outbound queue, returning right away, and a writer thread
+    /// of the instance's own drains the queue into the transport, handing it many messages per batch (see TransportConcept::sendDataBatch).
+    //  Callers never wait on a slow transport, and the transport's send path only ever runs on the writer thread. How far the queue may grow is set by the
+    //  options' high watermark, and what happens past it by their policy (see AsyncSendOptions in CrierTypes.hpp).
+    //  Should be called before sending anything, and only once. Messages still queued when the instance is destroyed are handed to the transport first.
+    void enableAsyncSend(const AsyncSendOptions& options = AsyncSendOptions());
+
+    /// Returns the bytes worth of messages waiting in the asynchronous outbound queue (always 0 unless enableAsyncSend was called).
+    size_t queuedOutboundBytes() const;
+
+// -- Flow Control
+// Keeping a fast peer from flooding a slow one
+
+    /// Enables end-to-end credit based flow control. Both peers must enable it, before connecting.
+    /// Each side grants the other 'window' credits on connect, and grants one back for every message it's done with (once its callbacks ran, or it was ignored),
+    /// so no more than 'window' of the peer's messages are ever waiting in this side's dispatch or unhandled queues.
+    //  Each message sent takes a credit. Out of them, sendMessage holds messages (up to max_held_bytes) and sends them, in order, as credits come back.
+    //  Grants ride on outgoing messages when there are any, and otherwise go out on their own every half window. They travel in the root message field
+    //  numbered options.credit_field_number, which your root message must leave unused (it stays an unknown field to protobuf). Custom serialization functions
+    //  must preserve unknown fields for it to work. Returns false, doing nothing, if your root message declares a field with that number.
+    bool enableFlowControl(const FlowControlOptions& options = FlowControlOptions());
+
+    /// Returns how many messages can be sent before running out of credits (always 0 unless flow control is enabled).
+    unsigned int sendCredits() const;
+
+// -- Request Limits
+// Capping how many requests are waiting on a reply at once
+
+    /// Caps the requests (sent through sendMessageWithRetCallback or sendMessageWithRetCallbackAndTimeout) in flight at once. 0, the default, lifts the cap.
+    /// A request is in flight from the moment it's sent until its reply's callback ran, or its timeout did.
+    //  Requests over the cap wait in a queue of the instance's, and are sent, oldest first, as replies and timeouts free slots up. A queued request's timeout
+    //  only starts counting once it's actually sent. Queued requests still pending when the instance is destroyed are dropped, their callbacks never called.
+    void setMaxRequestsInFlight(unsigned int max_in_flight);
+
+    /// Caps the requests of type ReqMsgData in flight at once, on top of the overall cap. 0 lifts it.
+    template <typename ReqMsgData>
+    void setMaxRequestsInFlightForMsg(unsigned int max_in_flight);
+
+    /// Returns how many requests are in flight and queued, along with queueing totals (see RequestQueueStats in CrierTypes.hpp).
+    RequestQueueStats requestQueueStats() const;
+
+    /// Returns how many requests of type ReqMsgData are queued waiting for a slot.
+    template <typename ReqMsgData>
+    size_t queuedRequestsForMsg() const;
+
+// -- Metrics
+// Seeing what an instance is up to, for exporters and dashboards
+
+    /// Starts counting messages and bytes per type, both ways, drops, queue depths, contention on crier's locks, and timing requests, parsing, the dispatch queue and callbacks.
+    /// Read them all at once with metricsSnapshot (see Metrics.hpp). Should be called before connecting the transport, and only once.
+    //  Counters are split per thread and histograms are a couple of relaxed atomic adds, so recording costs next to nothing on the message path.
+    //  Before this is called, the only cost is a pointer check. The first kMaxTypes (see MetricsRegistry) message types seen get counted, any past those don't.
+    void enableMetrics();
+
+    /// Returns a copy of the metrics counted so far, all zero unless enableMetrics was called. Safe to call from any thread, at any rate an exporter needs.
+    MetricsSnapshot metricsSnapshot() const;
+
+    /// Starts timing every callback run, by the clock and on the CPU, per message type and permanent callback key (see CallbackStats in Metrics.hpp).
+    /// Should be called before connecting the transport. Costs a lock and two clock reads per callback run, so best left for when hunting slow handlers.
+    void enableCallbackAccounting();
+
+    /// Reports every callback run taking longer than the given threshold to onSlowCallback, with its message type and key (enabling callback accounting if it wasn't yet,
+    /// so should also be called before connecting). Reports are made on the thread that ran the slow callback, as it returns. A threshold of 0 stops them.
+    void setSlowCallbackThreshold(unsigned int microseconds, const std::function<void(const SlowCallback&)>& onSlowCallback);
+
+    /// Returns the count callbacks that took the most time since callback accounting was enabled, most expensive first. Empty if it never was.
+    std::vector<CallbackStats> mostExpensiveCallbacks(size_t count) const;
+
+// -- Tracing
+// Timing every step messages go through, for instances using the Tracing policy
+
+    /// Returns the tracing policy instance, to set the sink spans go to (see Tracing::setSink), before connecting the transport.
+    Tracer& tracer();
+
 // -- Message Sends
 // Methods to send protobuf messages through the transport
 
@@ -90,8 +223,9 @@ namespace crier {
     /// The MsgData class must be present in your generated protocol buffer .cc and .h, and it must be contained in your root message (ProtoRootMsg template)
     /// as an optional member (or through a protobuf extension, check readme for an example of how your root message should look like).
     /// If these requirements are not met, crier won't be able to bundle the message and won't do anything.
+    /// Returns false if the message was dropped rather than handed over (failed serialization, a full outage or flow control buffer, or a FailFast asynchronous send past its high watermark).
     template <typename MsgData>
-    void sendMessage(const MsgData& data);
+    bool sendMessage(const MsgData& data);
 
     /// Sends a message of type MsgData, and registers a callback, expecting a response of type RetMsgData.
     /// Both the MsgData and RetMsgData classes must be present in your generated protocol buffer .cc and .h, and they must be contained in your root message (ProtoRootMsg template)
@@ -99,7 +233,7 @@ namespace crier {
     //  - data, the object of type ReqMsgData that you want to send
     //  - onSuccess, callback receiving a RetMsgData as a response. Keep in mind that this is seen as a "consumable" callback for crier. This means the first message to arrive of
     //    RetMsgData type will trigger an invokation of this callback, and the callback will be deleted afterwards. If your request results in more than one response, consider using
-    //    permanent callbacks (see below) to deal with them.
+    //    sendStreamingRequest (see below) to deal with them.
     //    Depending on the selected InboundDispatching for this RetMsgData (or the default if none is chosen), the callback can either be called instantly, or placed in a dispatch queue.
     //    Check the 'Threading Behaviour' section below for more info on this.
     //    Another thing to keep in mind is that crier has no way to discern if a received message of RetMsgData is the actual response for the sent ReqMsgData (this would be highly
@@ -108,8 +242,9 @@ namespace crier {
     //    guarantee order of delivery), then it's possible that the RetMsgData reponse for the second message arrives before the reply of the first, in which case, crier will give it
     //    to the callback registered with the first message. Consider using permanent callbacks (and application specific code in those callbacks) to deal with these situations, if
     //    at all possible in your conditions.
+    //  Returns a handle to cancel the request with (see Cancellation.hpp), which can also be added to a CancellationToken to cancel many requests at once.
     template <typename ReqMsgData, typename RetMsgData>
-    void sendMessageWithRetCallback(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess);
+    RequestHandle sendMessageWithRetCallback(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess);
 
     /// Sends a message of type MsgData, and registers a callback expecting a response of type RetMsgData, as well a callback to run if a response doesn't arrive in the specified time-frame
     /// Both the MsgData and RetMsgData classes must be present in your generated protocol buffer .cc and .h, and they must be contained in your root message (ProtoRootMsg template)
@@ -119,10 +254,70 @@ namespace crier {
     //  - onTimeout, will be called if time to get a response expires. Depending on the selected InboundDispatching for this RetMsgData (or the default if none is chosen),
     //    the timeout callback can either be called instantly, or placed in a dispatch queue. Check the 'Threading Behaviour' section below for more info on this.
     //    Keep in mind: Timeouts depend on a separate thread which is launched as soon as the message is sent. So don't panic if a unknown thread shows up in your instrumentation
+    //    (unless the instance is attached to a Reactor, where timeouts are timers on the reactor's loop instead).
+    //  Returns a handle to cancel the request with, as above. Cancelling it drops both callbacks.
     template <typename ReqMsgData, typename RetMsgData>
-    void sendMessageWithRetCallbackAndTimeout(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess,
+    RequestHandle sendMessageWithRetCallbackAndTimeout(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess,
                                                 unsigned int milliseconds_to_timeout, const std::function<void()>& onTimeout);
 
+    /// Sends a message of type ReqMsgData expecting a response of type RetMsgData, like sendMessageWithRetCallbackAndTimeout, but under a RequestPolicy:
+    /// each attempt gets policy.attempt_timeout_ms, timed out attempts are retried up to policy.max_retries times with backoff, and with policy.hedge
+    /// a duplicate is sent if no response arrived by the recent p95 response time of ReqMsgData requests. Only use it for idempotent requests.
+    //  onSuccess runs once, with the first response to arrive, and onTimeout once every attempt timed out. Crier tells responses apart by type only, so the
+    //  first response settles the request whichever attempt it answers, and the response callbacks of the other attempts stay registered to drop their duplicate
+    //  responses, until those arrive or time out. Retries and hedges are sent from the timeout's thread (or the reactor's loop).
+    //  Returns a handle to cancel the request with, which also stops any further retries or hedges.
+    template <typename ReqMsgData, typename RetMsgData>
+    RequestHandle sendMessageWithRetCallbackAndPolicy(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess,
+                                                      const RequestPolicy& policy, const std::function<void()>& onTimeout);
+
+    /// Sends a message of type ReqMsgData, returning a future for the response of type RetMsgData (see ResponseFuture.hpp).
+    /// Works like sendMessageWithRetCallbackAndTimeout (or sendMessageWithRetCallback, if milliseconds_to_timeout is 0), with the future resolving where the callbacks would run.
+    //  The future resolves as Ready with the response, TimedOut if none arrived in time, Disconnected if the transport disconnected first (only under
+    //  PendingRequestsOnDisconnect::Fail), or Abandoned if the instance goes away first. Many futures can be joined
+    //  with crier::whenAll, for fan-out requests. Each request allocates a single state, shared by the future and crier's callbacks.
+    template <typename ReqMsgData, typename RetMsgData>
+    ResponseFuture<RetMsgData> sendRequest(const ReqMsgData& data, unsigned int milliseconds_to_timeout = 0);
+
+    /// As above, with the request sent under a RequestPolicy (see sendMessageWithRetCallbackAndPolicy). The future times out once every attempt did.
+    template <typename ReqMsgData, typename RetMsgData>
+    ResponseFuture<RetMsgData> sendRequest(const ReqMsgData& data, const RequestPolicy& policy);
+
+    /// Sends a message of type ReqMsgData expecting a stream of responses of type RetMsgData, handing each to onResponse until the stream ends. Returns a handle to cancel it.
+    /// The stream ends when onResponse returns false (say, once it sees your protocol's end-of-stream marker), after options.max_responses responses, after
+    /// options.idle_timeout_ms without one, or when cancelled. onEnd, if given, is then called once with the reason (see StreamEnd).
+    //  Unlike sendMessageWithRetCallback, the callback stays registered for as long as the stream lasts, so responses are processed as they arrive instead of being
+    //  gathered first. Like it, responses go to the oldest request still waiting on their type, so a stream holds up later requests expecting the same type until it ends.
+    //  The callbacks run where response callbacks would (see 'Threading Behaviour' below), and so does onEnd, except for a cancel, which runs it on the cancelling thread.
+    //  The idle time only counts responses handed to the callback, which with the DispatchQueue inbound dispatching is when they're dispatched.
+    template <typename ReqMsgData, typename RetMsgData>
+    StreamHandle sendStreamingRequest(const ReqMsgData& data, const std::function<bool(const RetMsgData&)>& onResponse,
+                                      const StreamOptions& options = StreamOptions(), const std::function<void(StreamEnd)>& onEnd = nullptr);
+
+#ifdef CRIER_HAS_COROUTINES
+    /// Sends a message of type ReqMsgData once co_awaited, suspending the awaiting coroutine until a response of type RetMsgData arrives, or the timeout
+    /// expires (none if milliseconds_to_timeout is 0). Resumes with a RequestResult, where resume_on says (see RequestAwaitable.hpp). Only available from C++20.
+    //  Usage: 'auto result = co_await net_crier.request<Req, Ret>(msg, 500);'. The coroutine frame is the only state kept per request, and requests still go
+    //  through the in-flight caps. Keep in mind a request that never settles never resumes its coroutine, so give requests a timeout unless the peer always replies,
+    //  and let awaited requests settle before the instance is destroyed: pending ones are left suspended.
+    template <typename ReqMsgData, typename RetMsgData>
+    RequestAwaitable<Crier, ReqMsgData, RetMsgData> request(const ReqMsgData& data, unsigned int milliseconds_to_timeout = 0, ResumeOn resume_on = ResumeOn::Immediate);
+
+    /// As above, resuming the coroutine through executor.post instead, for coroutines that belong to a queue of their own (an EventLoop or Reactor, for instance).
+    template <typename ReqMsgData, typename RetMsgData, typename Executor,
+              typename = typename std::enable_if<!std::is_enum<Executor>::value && !std::is_same<typename std::decay<Executor>::type, CancellationToken>::value>::type>
+    RequestAwaitable<Crier, ReqMsgData, RetMsgData> request(const ReqMsgData& data, unsigned int milliseconds_to_timeout, Executor& executor);
+
+    /// As above, tied to a token: cancelling it first resumes the coroutine with Abandoned.
+    //  Usage: 'auto result = co_await net_crier.request<Req, Ret>(msg, 500, token);'
+    template <typename ReqMsgData, typename RetMsgData>
+    RequestAwaitable<Crier, ReqMsgData, RetMsgData> request(const ReqMsgData& data, unsigned int milliseconds_to_timeout, const CancellationToken& token,
+                                                            ResumeOn resume_on = ResumeOn::Immediate);
+
+    template <typename ReqMsgData, typename RetMsgData, typename Executor, typename = typename std::enable_if<!std::is_enum<Executor>::value>::type>
+    RequestAwaitable<Crier, ReqMsgData, RetMsgData> request(const ReqMsgData& data, unsigned int milliseconds_to_timeout, const CancellationToken& token, Executor& executor);
+#endif
+
 // -- Permanent Messsage Callbacks
 // Methods to deal with permanent callbacks for protobuf messages.
 
@@ -278,6 +473,24 @@ namespace crier {
     /// Clears away the set custom deserialization function, returning to crier's base behaviour of just calling protobuf's ParseFromString.
     void ClearCustomDeserializationFun();
 
+    /// Sets a function to be called whenever crier needs to Serialize a ProtoRootMsg, writing the serialized data into a buffer supplied by crier instead of returning a new string.
+    /// Should return false if serialization failed, in which case nothing is sent. Takes precedence over the function set with SetCustomSerializationFun.
+    //  The buffer is empty when handed to your function. Appending to it in place (as protobuf's AppendToString does) avoids the extra string copy a by-value return might incur,
+    //  which adds up for large messages or layered framing/encryption. It is reused from one send to the next on the same thread, keeping the capacity it grew to.
+    void SetCustomSerializationIntoBufferFun(const std::function<bool(const ProtoRootMsg&, std::string&)>& fun);
+
+    /// Clears away the set custom into-buffer serialization function.
+    void ClearCustomSerializationIntoBufferFun();
+
+    /// Sets a function to be called whenever crier attempts to deserialize data arriving from the transport, parsing it in place into a ProtoRootMsg owned by crier.
+    /// Receives a pointer to the raw data, its size and the ProtoRootMsg to fill in. Should return false if the data couldn't be parsed, in which case the data is dropped.
+    /// Takes precedence over the function set with SetCustomDeserializationFun.
+    //  Since the output message is never returned by value, this saves a full message copy per arrival (protobuf's move is a copy unless arenas match).
+    void SetCustomInPlaceDeserializationFun(const std::function<bool(const char*, size_t, ProtoRootMsg&)>& fun);
+
+    /// Clears away the set custom in place deserialization function.
+    void ClearCustomInPlaceDeserializationFun();
+
   private:
 #include <crier/private/Crier_priv.hpp>
   };
@@ -0,0 +1,436 @@
+#ifndef CRIER_SERVER_HPP
+#define CRIER_SERVER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <google/protobuf/message.h>
+#include <google/protobuf/descriptor.h>
+
+#include <crier/EventLoop.hpp>
+#include <crier/Reactor.hpp>
+#include <crier/transports/StreamConnection.hpp>
+#include <crier/private/RootMessage.hpp>
+
+namespace crier {
+
+  /// CrierServer
+  /// Server side counterpart of Crier (Linux only, as it's built on EventLoop). Accepts tcp connections speaking the same length-prefixed framing as TcpTransport,
+  /// so any crier instance using TcpTransport can connect to it, and dispatches the messages of every session through a single handler registry:
+  /// handlers are registered once, however many peers connect. Each handler receives a handle to the session the message arrived on, through which it can reply.
+  //  A session is no more than its socket, framing buffers and id. There's no per session callback map, timeout thread or dispatch queue, as a full Crier instance would have.
+  //  Sessions run on the server's own EventLoop thread, or spread round-robin across a Reactor's loops (see attachToReactor). A session's handlers always run on its loop's thread.
+  //  Messages travel inside ProtoRootMsg, packed and opened the same way Crier does, with protobuf's own serialization.
+  template <typename ProtoRootMsg>
+  class CrierServer {
+  public:
+    struct Options {
+      /// Amount of connections the kernel holds waiting to be accepted.
+      int backlog = 128;
+      /// Sessions receiving a frame larger than this are closed.
+      size_t max_frame_size = StreamConnection::kDefaultMaxFrameSize;
+      bool tcp_no_delay = true;
+    };
+
+    /// Session
+    /// Handle to a connected peer. Handles can be kept, and used from any thread, for as long as needed. Once the session closes, sends just fail.
+    class Session {
+    public:
+      /// Id of the session, unique within its server.
+      uint64_t id() const;
+
+      /// Sends a message of type MsgData to the peer. Returns false if the session is closed, or MsgData isn't part of ProtoRootMsg.
+      template <typename MsgData>
+      bool sendMessage(const MsgData& data);
+
+      /// Closes the session. The session closed callback will run, on the session's loop thread.
+      void close();
+
+      /// Returns true until the session is closed, by either end.
+      bool open() const;
+
+    private:
+      friend class CrierServer;
+      Session(uint64_t id, EventLoop& loop, const std::shared_ptr<StreamConnection>& connection);
+
+      uint64_t _id;
+      EventLoop& _loop;
+      std::shared_ptr<StreamConnection> _connection;
+    };
+
+    using SessionHandle = std::shared_ptr<Session>;
+
+    CrierServer();
+    explicit CrierServer(const Options& options);
+
+    CrierServer(const CrierServer& copy) = delete;
+    CrierServer(CrierServer&& copy) = delete;
+    void operator=(const CrierServer& copy) = delete;
+    void operator=(CrierServer&& copy) = delete;
+
+    /// Stops the server (see stop).
+    ~CrierServer();
+
+    /// Runs the server on a Reactor's loops, instead of on a thread of its own. Must be called before listen, and the reactor must outlive the server.
+    void attachToReactor(Reactor& reactor);
+
+    /// Starts accepting connections on the given host and port. An empty host listens on every interface, and port 0 picks any free port (see port).
+    /// Returns false if the server couldn't listen (the reason is logged).
+    bool listen(const std::string& host, int port);
+
+    /// Returns the port the server is listening on.
+    int port() const;
+
+    /// Stops accepting connections and closes every session, without running the session closed callback for them.
+    /// Once it returns, no handler is running, or will run again.
+    void stop();
+
+    /// Returns the amount of open sessions.
+    size_t sessionCount() const;
+
+    /// Registers the handler for messages of type MsgData, arriving on any session. Registering again for the same type replaces the previous handler.
+    //  The handler runs on the session's loop thread. Registering is comparatively costly (the registry is copied, lookups only wait on swapping the copy in), do it upfront.
+    template <typename MsgData>
+    void registerHandler(const std::function<void(const SessionHandle&, const MsgData&)>& handler);
+
+    /// Clears the handler for messages of type MsgData. Messages without a handler are dropped.
+    template <typename MsgData>
+    void clearHandler();
+
+    /// Sets a callback to run for every accepted session. It runs on the accepting loop's thread, before any message of the session is handled.
+    //  Set it before calling listen.
+    void setSessionOpenedCallback(const std::function<void(const SessionHandle&)>& onOpened);
+
+    /// Sets a callback to run when a session closes, either end closing it, along with the reason. It runs on the session's loop thread.
+    //  Set it before calling listen.
+    void setSessionClosedCallback(const std::function<void(const SessionHandle&, const std::string&)>& onClosed);
+
+    /// Sends a message of type MsgData to every open session, serializing it only once. Returns the amount of sessions it was sent to.
+    template <typename MsgData>
+    size_t broadcast(const MsgData& data);
+
+  private:
+    using Handler = std::function<void(const SessionHandle&, google::protobuf::Message*)>;
+    using HandlerMap = std::unordered_map<const google::protobuf::Descriptor*, Handler>;
+
+    void acceptPending();
+    void startSession(int fd);
+    void onFrame(const SessionHandle& session, const char* data, size_t size);
+    void onSessionClosed(const SessionHandle& session, const std::string& reason);
+
+    Options _options;
+    Reactor* _reactor;
+    std::unique_ptr<EventLoop> _own_loop;
+    EventLoop* _accept_loop;
+    int _listen_fd;
+    int _port;
+
+    std::atomic<uint64_t> _nextSessionId;
+    std::unordered_map<uint64_t, SessionHandle> _sessions;
+    mutable std::mutex _sessionsMutex;
+
+    std::shared_ptr<const HandlerMap> _handlers;
+    // Only held to take or swap the _handlers pointer. Registering copies the registry under _registerMutex instead
+    std::mutex _handlersMutex;
+    std::mutex _registerMutex;
+
+    std::function<void(const SessionHandle&)> _on_session_opened;
+    std::function<void(const SessionHandle&, const std::string&)> _on_session_closed;
+  };
+
+  template <typename ProtoRootMsg>
+  CrierServer<ProtoRootMsg>::Session::Session(uint64_t id, EventLoop& loop, const std::shared_ptr<StreamConnection>& connection) :
+  _id(id), _loop(loop), _connection(connection) {}
+
+  template <typename ProtoRootMsg>
+  uint64_t CrierServer<ProtoRootMsg>::Session::id() const {
+    return _id;
+  }
+
+  template <typename ProtoRootMsg>
+  template <typename MsgData>
+  bool CrierServer<ProtoRootMsg>::Session::sendMessage(const MsgData& data) {
+    ProtoRootMsg root;
+    if(!root_message::packageInto(root, data))
+      return false;
+    std::string payload = root.SerializeAsString();
+    return _connection->send(payload.data(), payload.size());
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::Session::close() {
+    _connection->close("Session closed by server", true);
+  }
+
+  template <typename ProtoRootMsg>
+  bool CrierServer<ProtoRootMsg>::Session::open() const {
+    return _connection->connected();
+  }
+
+  template <typename ProtoRootMsg>
+  CrierServer<ProtoRootMsg>::CrierServer() : CrierServer(Options()) {}
+
+  template <typename ProtoRootMsg>
+  CrierServer<ProtoRootMsg>::CrierServer(const Options& options) :
+  _options(options), _reactor(nullptr), _accept_loop(nullptr), _listen_fd(-1), _port(0), _nextSessionId(1), _handlers(std::make_shared<HandlerMap>()) {}
+
+  template <typename ProtoRootMsg>
+  CrierServer<ProtoRootMsg>::~CrierServer() {
+    stop();
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::attachToReactor(Reactor& reactor) {
+    if(!_accept_loop)
+      _reactor = &reactor;
+  }
+
+  template <typename ProtoRootMsg>
+  bool CrierServer<ProtoRootMsg>::listen(const std::string& host, int port) {
+    if(_listen_fd >= 0) {
+      std::cout << "[CRIER] ERROR: CrierServer is already listening" << std::endl;
+      return false;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    int gai_err = getaddrinfo(host.empty() ? nullptr : host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    if(gai_err != 0 || addresses == nullptr) {
+      std::cout << "[CRIER] ERROR: CrierServer couldn't resolve " << host << ": " << gai_strerror(gai_err) << std::endl;
+      return false;
+    }
+
+    int fd = socket(addresses->ai_family, addresses->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, addresses->ai_protocol);
+    int one = 1;
+    bool ok = fd >= 0 &&
+              setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0 &&
+              bind(fd, addresses->ai_addr, addresses->ai_addrlen) == 0 &&
+              ::listen(fd, _options.backlog) == 0;
+    int listen_err = errno;
+    freeaddrinfo(addresses);
+    if(!ok) {
+      if(fd >= 0)
+        ::close(fd);
+      std::cout << "[CRIER] ERROR: CrierServer couldn't listen on " << host << ":" << port << ": " << std::strerror(listen_err) << std::endl;
+      return false;
+    }
+
+    sockaddr_storage bound{};
+    socklen_t bound_len = sizeof(bound);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &bound_len);
+    _port = bound.ss_family == AF_INET6 ? ntohs(reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port)
+                                        : ntohs(reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+
+    if(_reactor) {
+      _accept_loop = &_reactor->nextLoop();
+    } else {
+      _own_loop.reset(new EventLoop());
+      _own_loop->start();
+      _accept_loop = _own_loop.get();
+    }
+    _listen_fd = fd;
+    return _accept_loop->addFd(fd, EPOLLIN | EPOLLET, [this](uint32_t){ acceptPending(); });
+  }
+
+  template <typename ProtoRootMsg>
+  int CrierServer<ProtoRootMsg>::port() const {
+    return _port;
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::stop() {
+    if(_listen_fd >= 0) {
+      _accept_loop->removeFd(_listen_fd);
+      // Waits out an accept that might be running
+      _accept_loop->runAndWait([](){});
+      ::close(_listen_fd);
+      _listen_fd = -1;
+    }
+
+    std::unordered_map<uint64_t, SessionHandle> sessions;
+    {
+      std::lock_guard<std::mutex> guard(_sessionsMutex);
+      sessions.swap(_sessions);
+    }
+    std::vector<EventLoop*> loops;
+    for(auto& entry : sessions) {
+      entry.second->_connection->close("Server stopped", false);
+      if(std::find(loops.begin(), loops.end(), &entry.second->_loop) == loops.end())
+        loops.push_back(&entry.second->_loop);
+    }
+    // Closed sessions don't deliver anything else, so once every loop is past what it was running, no handler can run again
+    for(auto loop : loops) {
+      loop->runAndWait([](){});
+    }
+
+    if(_own_loop)
+      _own_loop->stop();
+  }
+
+  template <typename ProtoRootMsg>
+  size_t CrierServer<ProtoRootMsg>::sessionCount() const {
+    std::lock_guard<std::mutex> guard(_sessionsMutex);
+    return _sessions.size();
+  }
+
+  template <typename ProtoRootMsg>
+  template <typename MsgData>
+  void CrierServer<ProtoRootMsg>::registerHandler(const std::function<void(const SessionHandle&, const MsgData&)>& handler) {
+    std::lock_guard<std::mutex> guard(_registerMutex);
+    std::shared_ptr<HandlerMap> handlers = std::make_shared<HandlerMap>(*_handlers);
+    (*handlers)[MsgData::descriptor()] = [handler](const SessionHandle& session, google::protobuf::Message* received_msg){
+      handler(session, *static_cast<MsgData*>(received_msg));};
+    std::lock_guard<std::mutex> swap_guard(_handlersMutex);
+    _handlers = handlers;
+  }
+
+  template <typename ProtoRootMsg>
+  template <typename MsgData>
+  void CrierServer<ProtoRootMsg>::clearHandler() {
+    std::lock_guard<std::mutex> guard(_registerMutex);
+    std::shared_ptr<HandlerMap> handlers = std::make_shared<HandlerMap>(*_handlers);
+    handlers->erase(MsgData::descriptor());
+    std::lock_guard<std::mutex> swap_guard(_handlersMutex);
+    _handlers = handlers;
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::setSessionOpenedCallback(const std::function<void(const SessionHandle&)>& onOpened) {
+    _on_session_opened = onOpened;
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::setSessionClosedCallback(const std::function<void(const SessionHandle&, const std::string&)>& onClosed) {
+    _on_session_closed = onClosed;
+  }
+
+  template <typename ProtoRootMsg>
+  template <typename MsgData>
+  size_t CrierServer<ProtoRootMsg>::broadcast(const MsgData& data) {
+    ProtoRootMsg root;
+    if(!root_message::packageInto(root, data))
+      return 0;
+    std::string payload = root.SerializeAsString();
+
+    std::vector<SessionHandle> sessions;
+    {
+      std::lock_guard<std::mutex> guard(_sessionsMutex);
+      sessions.reserve(_sessions.size());
+      for(const auto& entry : _sessions) {
+        sessions.push_back(entry.second);
+      }
+    }
+    size_t sent = 0;
+    for(const auto& session : sessions) {
+      if(session->_connection->send(payload.data(), payload.size()))
+        sent++;
+    }
+    return sent;
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::acceptPending() {
+    while(true) {
+      int fd = accept4(_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if(fd >= 0) {
+        startSession(fd);
+      } else if(errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      } else {
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+          std::cout << "[CRIER] ERROR: CrierServer failed to accept a connection: " << std::strerror(errno) << std::endl;
+        return;
+      }
+    }
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::startSession(int fd) {
+    if(_options.tcp_no_delay) {
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    EventLoop& loop = _reactor ? _reactor->nextLoop() : *_own_loop;
+    auto connection = StreamConnection::create(loop, fd, _options.max_frame_size);
+    SessionHandle session(new Session(_nextSessionId++, loop, connection));
+    {
+      std::lock_guard<std::mutex> guard(_sessionsMutex);
+      _sessions[session->id()] = session;
+    }
+    if(_on_session_opened)
+      _on_session_opened(session);
+
+    // The sessions map owns the session, its handlers only hold it weakly
+    std::weak_ptr<Session> weak_session = session;
+    bool started = connection->start(false, nullptr,
+      [this, weak_session](const char* data, size_t size){
+        auto session = weak_session.lock();
+        if(session)
+          onFrame(session, data, size);
+      },
+      [this, weak_session](const std::string& reason){
+        auto session = weak_session.lock();
+        if(session)
+          onSessionClosed(session, reason);
+      });
+    if(!started) {
+      std::cout << "[CRIER] ERROR: CrierServer failed to register session " << session->id() << " with its loop, it was closed" << std::endl;
+      connection->close("Failed to start the session", false);
+      onSessionClosed(session, "Failed to start the session");
+    }
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::onFrame(const SessionHandle& session, const char* data, size_t size) {
+    ProtoRootMsg root;
+    if(!root.ParseFromArray(data, static_cast<int>(size))) {
+      std::cout << "[CRIER] ERROR: Couldn't deserialize data received on session " << session->id() << ", it was dropped" << std::endl;
+      return;
+    }
+    google::protobuf::Message* received_msg = root_message::open(root);
+    if(received_msg == nullptr) {
+      std::cout << "[CRIER] ERROR: Couldn't Parse message it appears to have arrived empty" << std::endl;
+      return;
+    }
+
+    std::shared_ptr<const HandlerMap> handlers;
+    {
+      std::lock_guard<std::mutex> guard(_handlersMutex);
+      handlers = _handlers;
+    }
+    auto handler = handlers->find(received_msg->GetDescriptor());
+    if(handler != handlers->end())
+      handler->second(session, received_msg);
+  }
+
+  template <typename ProtoRootMsg>
+  void CrierServer<ProtoRootMsg>::onSessionClosed(const SessionHandle& session, const std::string& reason) {
+    {
+      std::lock_guard<std::mutex> guard(_sessionsMutex);
+      _sessions.erase(session->id());
+    }
+    if(_on_session_closed)
+      _on_session_closed(session, reason);
+  }
+}
+
+#endif
@@ -3,11 +3,108 @@
 
 #pragma once
 #include <functional>
+#include <cstddef>
+#include <cstdint>
+
+// Coroutine awaitable requests (see RequestAwaitable.hpp) are only available when building as C++20 or later
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && defined(__has_include)
+#if __has_include(<coroutine>)
+#define CRIER_HAS_COROUTINES 1
+#endif
+#endif
 
 namespace crier {    
     enum class CallbackPriority { FIRST, ASAP, NORMAL };
     enum class UnhandledMessageBehaviour { Ignore, Enqueue };
     enum class InboundDispatching { Immediate, DispatchQueue };    
+
+    /// What happens to requests still waiting on a response when the transport disconnects (see Crier::setPendingRequestsOnDisconnect).
+    //  Keep leaves them waiting, for their timeouts (or a response, if the connection comes back). Fail fails them all right away.
+    enum class PendingRequestsOnDisconnect { Keep, Fail };
+
+    /// Settings for crier's automatic reconnects (see Crier::enableAutoReconnect).
+    struct ReconnectPolicy {
+      /// Delay before the first attempt, in milliseconds. Each failed attempt multiplies it by backoff_multiplier, up to max_delay_ms.
+      unsigned int initial_delay_ms = 100;
+      unsigned int max_delay_ms = 30000;
+      double backoff_multiplier = 2.0;
+      /// Fraction of each delay that is random (0 to 1): a delay d ends up anywhere between d * (1 - jitter) and d, so peers dropped together don't all retry together.
+      double jitter = 0.5;
+      /// Attempts to make before giving up. 0 retries forever.
+      unsigned int max_attempts = 0;
+      /// Bytes worth of outbound messages held while disconnected, to be sent once reconnected. Messages sent past it are dropped.
+      size_t outage_buffer_bytes = 1024 * 1024;
+    };
+
+    /// What an asynchronous send does when the outbound queue is past its high watermark (see AsyncSendOptions).
+    //  Block waits for the writer to drain the queue below it, FailFast drops the message and sendMessage returns false,
+    //  Signal queues the message anyway and calls AsyncSendOptions::on_high_watermark, once each time the queue crosses it.
+    enum class HighWatermarkPolicy { Block, FailFast, Signal };
+
+    /// Settings for crier's asynchronous sends (see Crier::enableAsyncSend).
+    struct AsyncSendOptions {
+      /// Bytes worth of serialized messages the outbound queue holds before the policy kicks in.
+      size_t high_watermark_bytes = 4 * 1024 * 1024;
+      HighWatermarkPolicy policy = HighWatermarkPolicy::Block;
+      /// Called with the queued bytes when the queue crosses the high watermark, under the Signal policy. Runs on the sending thread.
+      std::function<void(size_t)> on_high_watermark;
+      /// Most messages the writer hands to the transport in a single batch.
+      size_t max_batch_messages = 64;
+    };
+
+    /// Settings for crier's credit based flow control (see Crier::enableFlowControl).
+    struct FlowControlOptions {
+      /// Number of the root message field credit grants travel in. No field of your root message may use it: declaring it 'reserved' in the .proto keeps it that way.
+      int credit_field_number = 536870911;
+      /// Messages the peer may send before having to wait for this side to dispatch some of them. Credits are granted back as callbacks run.
+      unsigned int window = 256;
+      /// Bytes worth of outbound messages held while out of credits. Messages sent past it are dropped.
+      size_t max_held_bytes = 1024 * 1024;
+    };
+
+    /// Settings for a request sent with retries and hedging (see Crier::sendMessageWithRetCallbackAndPolicy). Only meant for idempotent requests,
+    /// since the peer may end up handling the same request more than once.
+    struct RequestPolicy {
+      /// Milliseconds each attempt has to get a response.
+      unsigned int attempt_timeout_ms = 1000;
+      /// Attempts sent again after one times out, before giving up.
+      unsigned int max_retries = 0;
+      /// Delay before the first retry, in milliseconds. Each retry after that multiplies it by backoff_multiplier.
+      unsigned int retry_backoff_ms = 50;
+      double backoff_multiplier = 2.0;
+      /// Sends a single duplicate of the request if no response arrived after the hedge delay, taking whichever response comes first.
+      bool hedge = false;
+      /// Percentile of the latest response times for the request type to wait before hedging, once a few of them are known. hedge_delay_ms until then.
+      double hedge_percentile = 0.95;
+      unsigned int hedge_delay_ms = 100;
+    };
+
+    /// Why a streaming request ended (see Crier::sendStreamingRequest).
+    //  Completed when its callback returned false (it got the end-of-stream marker), CountLimit when it got StreamOptions::max_responses, IdleTimeout when
+    //  no response arrived for StreamOptions::idle_timeout_ms, Cancelled when cancelled through its handle, Abandoned when its crier instance went away first,
+    //  and Disconnected when the transport disconnected under PendingRequestsOnDisconnect::Fail.
+    enum class StreamEnd { Completed, CountLimit, IdleTimeout, Cancelled, Abandoned, Disconnected };
+
+    /// Settings for a streaming request (see Crier::sendStreamingRequest).
+    struct StreamOptions {
+      /// Responses after which the stream ends. 0 for no limit.
+      unsigned int max_responses = 0;
+      /// Milliseconds without a response (counting from the request being sent) after which the stream ends. 0 for no limit.
+      unsigned int idle_timeout_ms = 0;
+    };
+
+    /// Snapshot of a crier instance's request limits (see Crier::setMaxRequestsInFlight).
+    struct RequestQueueStats {
+      /// Requests sent and still waiting on their reply or timeout.
+      size_t in_flight = 0;
+      /// Requests waiting for a slot, not yet sent.
+      size_t queued = 0;
+      /// Most requests that were ever queued at once.
+      size_t peak_queued = 0;
+      /// Requests that had to be queued, overall, and the microseconds they spent queued, summed.
+      uint64_t total_queued = 0;
+      uint64_t total_wait_us = 0;
+    };
 }
 
 #endif 
\ No newline at end of file
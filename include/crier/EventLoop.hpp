@@ -0,0 +1,331 @@
+#ifndef CRIER_EVENT_LOOP_HPP
+#define CRIER_EVENT_LOOP_HPP
+
+#include <memory>
+#include <string>
+#include <deque>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <functional>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+namespace crier {
+
+  /// EventLoop
+  /// A single threaded, epoll based, event loop (Linux only). It's the building block for crier's first-party socket transports.
+  /// File descriptors are registered with the events they want to listen to (typically edge-triggered, EPOLLET) and a handler, which will
+  /// be invoked on the loop thread whenever any of those events fire. Arbitrary tasks can also be posted from any thread to run on the loop thread.
+  //  All methods are thread-safe. Handlers, posted tasks and timers always run on the loop thread, one at a time, so state only touched from them needs no locking.
+  class EventLoop {
+  public:
+    using FdHandler = std::function<void(uint32_t events)>;
+    using TimerId = uint64_t;
+
+    EventLoop();
+
+    /// Event loops cannot be copied or moved, as their thread and registered handlers point back to them.
+    EventLoop(const EventLoop& copy) = delete;
+    EventLoop(EventLoop&& copy) = delete;
+    void operator=(const EventLoop& copy) = delete;
+    void operator=(EventLoop&& copy) = delete;
+
+    /// Stops the loop thread (if running) and releases the epoll instance. Registered file descriptors are not closed, they belong to whoever registered them.
+    ~EventLoop();
+
+    /// Launches the loop thread. Calling start on an already running loop does nothing.
+    void start();
+
+    /// Stops the loop thread and waits for it to finish. Tasks that were posted but didn't run yet are discarded.
+    /// If called from the loop thread itself, the loop will exit after the current handler returns, but can't be waited on.
+    void stop();
+
+    /// Returns true if the loop thread is running.
+    bool running() const;
+
+    /// Returns true if the calling thread is this loop's thread.
+    bool inLoopThread() const;
+
+    /// Queues a task to be run on the loop thread, waking it up if it's waiting for events.
+    void post(std::function<void()> task);
+
+    /// Runs the task right away if called from the loop thread, posts it otherwise.
+    void dispatch(std::function<void()> task);
+
+    /// Runs the task on the loop thread and waits for it to finish. Runs it right away if called from the loop thread, or if the loop isn't running.
+    //  Once it returns, no handler that was running when it was called is still running. Returns without running the task if the loop is stopped meanwhile.
+    void runAndWait(std::function<void()> task);
+
+    /// Schedules a task to run on the loop thread once the delay elapses. Timers are kept in a single timerfd, however many are scheduled.
+    /// Returns an id that can be used to cancel it (never 0).
+    TimerId runAfter(std::chrono::milliseconds delay, std::function<void()> task);
+
+    /// Cancels a timer. Returns false if it already ran (or is running), or doesn't exist.
+    bool cancelTimer(TimerId id);
+
+    /// Registers a file descriptor. The handler will be invoked on the loop thread with the epoll event mask every time the fd is signaled.
+    //  - events is the epoll event mask, as in EPOLLIN | EPOLLOUT | EPOLLET. The fd should be non-blocking if registered as edge-triggered.
+    bool addFd(int fd, uint32_t events, const FdHandler& handler);
+
+    /// Changes the events being listened to for an already registered file descriptor.
+    bool modifyFd(int fd, uint32_t events);
+
+    /// Unregisters a file descriptor. Its handler is guaranteed not to be invoked again for events that weren't being handled when this was called.
+    void removeFd(int fd);
+
+  private:
+    void run();
+    void wakeup();
+    void runPostedTasks();
+    void runExpiredTimers();
+    void armTimerFdLocked();
+
+    int _epoll_fd;
+    int _wakeup_fd;
+    int _timer_fd;
+    std::thread _thread;
+    std::atomic<bool> _running;
+    std::atomic<std::thread::id> _loop_thread_id;
+
+    std::unordered_map<int, std::shared_ptr<FdHandler>> _handlers;
+    std::mutex _handlersMutex;
+
+    std::deque<std::function<void()>> _postedTasks;
+    std::mutex _postedTasksMutex;
+
+    using TimerQueue = std::multimap<std::chrono::steady_clock::time_point, TimerId>;
+    TimerQueue _timerQueue;
+    std::unordered_map<TimerId, std::pair<TimerQueue::iterator, std::function<void()>>> _timers;
+    TimerId _nextTimerId;
+    std::mutex _timersMutex;
+  };
+
+  inline EventLoop::EventLoop() :
+  _epoll_fd(epoll_create1(EPOLL_CLOEXEC)), _wakeup_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), _timer_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+  _running(false), _loop_thread_id(std::thread::id()), _nextTimerId(1) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = _wakeup_fd;
+    epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wakeup_fd, &ev);
+    ev.data.fd = _timer_fd;
+    epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _timer_fd, &ev);
+  }
+
+  inline EventLoop::~EventLoop() {
+    stop();
+    close(_timer_fd);
+    close(_wakeup_fd);
+    close(_epoll_fd);
+  }
+
+  inline void EventLoop::start() {
+    if(_running.exchange(true))
+      return;
+    if(_thread.joinable())
+      _thread.join();
+    _thread = std::thread([this](){ run(); });
+  }
+
+  inline void EventLoop::stop() {
+    if(!_running.exchange(false))
+      return;
+    wakeup();
+    if(inLoopThread()) {
+      _thread.detach();
+    } else if(_thread.joinable()) {
+      _thread.join();
+    }
+    std::lock_guard<std::mutex> guard(_postedTasksMutex);
+    _postedTasks.clear();
+  }
+
+  inline bool EventLoop::running() const {
+    return _running;
+  }
+
+  inline bool EventLoop::inLoopThread() const {
+    return _loop_thread_id.load() == std::this_thread::get_id();
+  }
+
+  inline void EventLoop::post(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> guard(_postedTasksMutex);
+      _postedTasks.push_back(std::move(task));
+    }
+    wakeup();
+  }
+
+  inline void EventLoop::dispatch(std::function<void()> task) {
+    if(inLoopThread()) {
+      task();
+    } else {
+      post(std::move(task));
+    }
+  }
+
+  inline void EventLoop::runAndWait(std::function<void()> task) {
+    if(inLoopThread() || !running()) {
+      task();
+      return;
+    }
+    auto done = std::make_shared<std::promise<void>>();
+    std::future<void> finished = done->get_future();
+    post([task, done](){
+      task();
+      done->set_value();
+    });
+    // If the loop stops first the task is discarded, breaking the promise, which also ends the wait
+    finished.wait();
+  }
+
+  inline EventLoop::TimerId EventLoop::runAfter(std::chrono::milliseconds delay, std::function<void()> task) {
+    std::lock_guard<std::mutex> guard(_timersMutex);
+    TimerId id = _nextTimerId++;
+    auto it = _timerQueue.emplace(std::chrono::steady_clock::now() + delay, id);
+    _timers.emplace(id, std::make_pair(it, std::move(task)));
+    if(it == _timerQueue.begin())
+      armTimerFdLocked();
+    return id;
+  }
+
+  inline bool EventLoop::cancelTimer(TimerId id) {
+    std::lock_guard<std::mutex> guard(_timersMutex);
+    auto it = _timers.find(id);
+    if(it == _timers.end())
+      return false;
+    _timerQueue.erase(it->second.first);
+    _timers.erase(it);
+    return true;
+  }
+
+  inline bool EventLoop::addFd(int fd, uint32_t events, const FdHandler& handler) {
+    {
+      std::lock_guard<std::mutex> guard(_handlersMutex);
+      _handlers[fd] = std::make_shared<FdHandler>(handler);
+    }
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if(epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      std::lock_guard<std::mutex> guard(_handlersMutex);
+      _handlers.erase(fd);
+      return false;
+    }
+    return true;
+  }
+
+  inline bool EventLoop::modifyFd(int fd, uint32_t events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0;
+  }
+
+  inline void EventLoop::removeFd(int fd) {
+    epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    std::lock_guard<std::mutex> guard(_handlersMutex);
+    _handlers.erase(fd);
+  }
+
+  inline void EventLoop::wakeup() {
+    uint64_t one = 1;
+    ssize_t written = write(_wakeup_fd, &one, sizeof(one));
+    (void)written; // If the counter is saturated the loop is already due to wake up
+  }
+
+  inline void EventLoop::runPostedTasks() {
+    std::deque<std::function<void()>> postedTasksAux;
+    {
+      std::lock_guard<std::mutex> guard(_postedTasksMutex);
+      postedTasksAux = std::move(_postedTasks);
+      _postedTasks.clear();
+    }
+    for(const auto& task : postedTasksAux) {
+      task();
+    }
+  }
+
+  inline void EventLoop::armTimerFdLocked() {
+    itimerspec spec{};
+    if(!_timerQueue.empty()) {
+      auto until = std::chrono::duration_cast<std::chrono::nanoseconds>(_timerQueue.begin()->first - std::chrono::steady_clock::now()).count();
+      // A zero it_value would disarm the timer, so anything already due fires in a nanosecond instead
+      if(until < 1)
+        until = 1;
+      spec.it_value.tv_sec = static_cast<time_t>(until / 1000000000);
+      spec.it_value.tv_nsec = static_cast<long>(until % 1000000000);
+    }
+    timerfd_settime(_timer_fd, 0, &spec, nullptr);
+  }
+
+  inline void EventLoop::runExpiredTimers() {
+    uint64_t expirations;
+    while(read(_timer_fd, &expirations, sizeof(expirations)) > 0) {}
+
+    std::vector<std::function<void()>> expired;
+    {
+      std::lock_guard<std::mutex> guard(_timersMutex);
+      auto now = std::chrono::steady_clock::now();
+      while(!_timerQueue.empty() && _timerQueue.begin()->first <= now) {
+        auto timer = _timers.find(_timerQueue.begin()->second);
+        expired.push_back(std::move(timer->second.second));
+        _timers.erase(timer);
+        _timerQueue.erase(_timerQueue.begin());
+      }
+      armTimerFdLocked();
+    }
+    for(const auto& task : expired) {
+      if(!_running)
+        return;
+      task();
+    }
+  }
+
+  inline void EventLoop::run() {
+    _loop_thread_id = std::this_thread::get_id();
+    std::vector<epoll_event> events(64);
+
+    while(_running) {
+      int ready = epoll_wait(_epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+      for(int i = 0; i < ready && _running; i++) {
+        int fd = events[i].data.fd;
+        if(fd == _wakeup_fd) {
+          uint64_t count;
+          while(read(_wakeup_fd, &count, sizeof(count)) > 0) {}
+          continue;
+        }
+        if(fd == _timer_fd) {
+          runExpiredTimers();
+          continue;
+        }
+
+        std::shared_ptr<FdHandler> handler;
+        {
+          std::lock_guard<std::mutex> guard(_handlersMutex);
+          auto it = _handlers.find(fd);
+          if(it != _handlers.end())
+            handler = it->second;
+        }
+        if(handler)
+          (*handler)(events[i].events);
+      }
+      if(_running)
+        runPostedTasks();
+      // A full batch likely means more events are pending, grow so they are picked up in fewer calls
+      if(ready == static_cast<int>(events.size()) && events.size() < 4096)
+        events.resize(events.size() * 2);
+    }
+    _loop_thread_id = std::thread::id();
+  }
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef CRIER_METRICS_HPP
+#define CRIER_METRICS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace crier {
+
+  /// Point in time copy of a latency histogram (see Crier::metricsSnapshot). Values are in nanoseconds.
+  //  Buckets are log-linear, as HDR histograms go: exact below 16ns, and 16 buckets per power of two above, so any value read back is within 1/16th (6.25%) of the recorded one.
+  struct HistogramSnapshot {
+    static const unsigned int kSubBuckets = 16;
+
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    /// Samples per bucket, see bucketLowerBound for where each starts.
+    std::vector<uint64_t> buckets;
+
+    double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0.0; }
+
+    /// Value below which the given fraction (0 to 1) of the samples fall, rounded up to the end of its bucket. 0 without samples.
+    uint64_t percentile(double fraction) const {
+      if(count == 0)
+        return 0;
+      uint64_t rank = static_cast<uint64_t>(fraction * count);
+      if(rank >= count)
+        rank = count - 1;
+      uint64_t seen = 0;
+      for(size_t bucket = 0; bucket < buckets.size(); bucket++) {
+        seen += buckets[bucket];
+        if(seen > rank) {
+          uint64_t upper = bucketLowerBound(bucket + 1) - 1;
+          return upper < max ? upper : max;
+        }
+      }
+      return max;
+    }
+
+    /// Smallest value that lands in the given bucket.
+    static uint64_t bucketLowerBound(size_t bucket) {
+      if(bucket < kSubBuckets)
+        return bucket;
+      size_t magnitude = bucket / kSubBuckets + 3;
+      uint64_t sub_bucket = bucket % kSubBuckets;
+      return (kSubBuckets + sub_bucket) << (magnitude - 4);
+    }
+  };
+
+  /// Traffic of a single message type, both ways.
+  struct MessageTypeMetrics {
+    std::string type;
+    uint64_t messages_in = 0;
+    uint64_t bytes_in = 0;
+    uint64_t messages_out = 0;
+    uint64_t bytes_out = 0;
+  };
+
+  /// Contention on one of crier's internal locks.
+  struct LockMetrics {
+    std::string name;
+    uint64_t acquisitions = 0;
+    /// Acquisitions that found the lock taken, and had to wait for it, for as long as wait_time shows.
+    uint64_t contended = 0;
+    HistogramSnapshot wait_time;
+  };
+
+  /// Snapshot of a crier instance's metrics, once enabled (see Crier::enableMetrics). Counters are totals since then.
+  struct MetricsSnapshot {
+    /// Every message type sent or received so far. Bytes are the serialized root messages carrying them.
+    std::vector<MessageTypeMetrics> types;
+
+    /// Messages nobody listened to, dropped under UnhandledMessageBehaviour::Ignore, and the ones dropped out of the unhandled queue as their type was set to Ignore.
+    uint64_t unhandled_ignored = 0;
+    uint64_t unhandled_queue_dropped = 0;
+    /// Messages waiting in the unhandled queue (UnhandledMessageBehaviour::Enqueue), now and at most.
+    uint64_t unhandled_queue_depth = 0;
+    uint64_t unhandled_queue_peak = 0;
+    /// Callbacks waiting in the dispatch queue (InboundDispatching::DispatchQueue), now and at most.
+    uint64_t dispatch_queue_depth = 0;
+    uint64_t dispatch_queue_peak = 0;
+    /// Received data that didn't parse into a message, and messages that weren't sent (failed serialization, or a full outage or flow control buffer).
+    uint64_t inbound_dropped = 0;
+    uint64_t outbound_dropped = 0;
+
+    /// From sending a request to its response arriving, for requests sent with callbacks, futures or policies (streams and awaited requests aren't timed).
+    HistogramSnapshot request_latency;
+    /// Deserializing received data into a root message.
+    HistogramSnapshot parse_time;
+    /// From a callback being queued in the dispatch queue to 'dispatchQueuedCallbacks' running it.
+    HistogramSnapshot dispatch_queue_time;
+    /// Running the callbacks for a received message, permanent and single use alike.
+    HistogramSnapshot callback_time;
+
+    /// Contention on each of crier's core locks, to find the hotspots when many threads share an instance.
+    std::vector<LockMetrics> locks;
+  };
+
+  /// Time spent in a single callback, since callback accounting was enabled (see Crier::enableCallbackAccounting).
+  //  Permanent callbacks go by their key, the response callbacks of requests and streams of a type all share an empty key.
+  struct CallbackStats {
+    std::string type;
+    std::string key;
+    uint64_t calls = 0;
+    /// Total time spent running it, by the clock and on the CPU. A callback blocking (on a lock, or I/O) shows up as more wall time than CPU time.
+    std::chrono::nanoseconds wall_time{0};
+    std::chrono::nanoseconds cpu_time{0};
+    std::chrono::nanoseconds max_wall_time{0};
+  };
+
+  /// A callback run that took longer than the slow callback threshold (see Crier::setSlowCallbackThreshold).
+  struct SlowCallback {
+    std::string type;
+    std::string key;
+    std::chrono::nanoseconds wall_time{0};
+    std::chrono::nanoseconds cpu_time{0};
+  };
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef CRIER_REACTOR_HPP
+#define CRIER_REACTOR_HPP
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#include <crier/EventLoop.hpp>
+
+namespace crier {
+
+  /// Reactor
+  /// A fixed pool of EventLoop threads to be shared by many crier instances, and their transports (Linux only, as it's built on EventLoop).
+  /// Without one, every crier instance ends up with threads of its own (its transport's, and one per timeout). Attaching instances to a reactor
+  /// (see Crier::attachToReactor) moves all of that onto the reactor's threads instead: transports register their sockets on one of its loops,
+  /// and timeouts and dispatch queue draining run as that loop's timers and tasks. A process holding thousands of connections needs no more threads than the pool has.
+  //  Each attached instance is pinned to a single loop, handed out round-robin, so everything about one instance still runs serialized on one thread.
+  //  The reactor must outlive every crier instance and transport attached to it.
+  class Reactor {
+  public:
+    /// Creates and starts the loops.
+    //  - threads, the amount of loops in the pool. 0 picks one per available core.
+    explicit Reactor(size_t threads = 0);
+
+    Reactor(const Reactor& copy) = delete;
+    Reactor(Reactor&& copy) = delete;
+    void operator=(const Reactor& copy) = delete;
+    void operator=(Reactor&& copy) = delete;
+
+    /// Stops every loop, waiting for their threads to finish.
+    ~Reactor();
+
+    /// Returns the amount of loops in the pool.
+    size_t size() const;
+
+    /// Returns the loop at the given index (from 0 to size() - 1).
+    EventLoop& loop(size_t index);
+
+    /// Returns the next loop in round-robin order. Used to spread attached instances across the pool.
+    EventLoop& nextLoop();
+
+    /// Posts a task to run on the next loop in round-robin order.
+    void post(std::function<void()> task);
+
+    /// Stops every loop. Anything still attached to the reactor stops being serviced.
+    void stop();
+
+  private:
+    std::vector<std::unique_ptr<EventLoop>> _loops;
+    std::atomic<size_t> _next;
+  };
+
+  inline Reactor::Reactor(size_t threads) : _next(0) {
+    if(threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    for(size_t i = 0; i < threads; i++) {
+      _loops.emplace_back(new EventLoop());
+      _loops.back()->start();
+    }
+  }
+
+  inline Reactor::~Reactor() {
+    stop();
+  }
+
+  inline size_t Reactor::size() const {
+    return _loops.size();
+  }
+
+  inline EventLoop& Reactor::loop(size_t index) {
+    return *_loops[index];
+  }
+
+  inline EventLoop& Reactor::nextLoop() {
+    return *_loops[_next++ % _loops.size()];
+  }
+
+  inline void Reactor::post(std::function<void()> task) {
+    nextLoop().post(std::move(task));
+  }
+
+  inline void Reactor::stop() {
+    for(auto& loop : _loops) {
+      loop->stop();
+    }
+  }
+}
+
+#endif
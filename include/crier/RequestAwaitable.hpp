@@ -0,0 +1,239 @@
+#ifndef CRIER_REQUEST_AWAITABLE_HPP
+#define CRIER_REQUEST_AWAITABLE_HPP
+
+#include <crier/CrierTypes.hpp>
+
+#ifdef CRIER_HAS_COROUTINES
+
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <google/protobuf/message.h>
+#include <google/protobuf/descriptor.h>
+
+#include <crier/Cancellation.hpp>
+#include <crier/ResponseFuture.hpp>
+#include <crier/private/AwaitedRequest.hpp>
+#include <crier/private/RequestLimiter.hpp>
+
+namespace crier {
+
+  /// Where a coroutine awaiting a request (see Crier::request) resumes.
+  //  Immediate resumes on whichever thread settled the request: the transport's for a response, the timeout's otherwise, or right where it was awaited if the reply
+  //  arrived while it was being sent. DispatchQueue resumes from the next 'dispatchQueuedCallbacks' call.
+  enum class ResumeOn { Immediate, DispatchQueue };
+
+  /// What an awaited request results in. The response only holds anything if the status is Ready (see ok).
+  //  The status is TimedOut if no response arrived in time, Disconnected if the transport disconnected first (under PendingRequestsOnDisconnect::Fail),
+  //  Abandoned if cancelled through its token, and never Pending.
+  template <typename T>
+  struct RequestResult {
+    ResponseStatus status = ResponseStatus::Pending;
+    T response;
+
+    bool ok() const { return status == ResponseStatus::Ready; }
+  };
+
+  /// RequestAwaitable
+  /// A request for a coroutine to co_await, returned by Crier::request. Nothing is sent until it is awaited, and it can only be awaited once.
+  //  It lives in the awaiting coroutine's frame, and crier's callbacks for it only point back to it, so no state is allocated per request. Await it in the same
+  //  expression that created it ('co_await net_crier.request<Req, Ret>(msg)'): it keeps a reference to the request message until it's sent.
+  template <typename CrierType, typename ReqMsgData, typename RetMsgData>
+  class RequestAwaitable : private AwaitedRequest {
+  public:
+    /// With a token, cancelling it first resumes the coroutine with Abandoned (a response that still arrives is dropped, as for other requests).
+    //  Cancelled while waiting for an in-flight slot, it resumes once it gets one, without being sent.
+    RequestAwaitable(CrierType& crier, const ReqMsgData& data, unsigned int milliseconds_to_timeout, ResumeOn resume_on, const CancellationToken* token = nullptr)
+      : _crier(crier), _data(data), _milliseconds_to_timeout(milliseconds_to_timeout), _resume_on(resume_on), _token(token ? new CancellationToken(*token) : nullptr) {}
+
+    /// Resumes through executor.post, which must take a std::function<void()> (both EventLoop and Reactor do). The executor must outlive the request.
+    template <typename Executor>
+    RequestAwaitable(CrierType& crier, const ReqMsgData& data, unsigned int milliseconds_to_timeout, Executor& executor, const CancellationToken* token = nullptr)
+      : _crier(crier), _data(data), _milliseconds_to_timeout(milliseconds_to_timeout), _resume_on(ResumeOn::Immediate), _executor(&executor),
+        _post([](void* target, std::coroutine_handle<> handle){ static_cast<Executor*>(target)->post([handle](){ handle.resume(); }); }),
+        _token(token ? new CancellationToken(*token) : nullptr) {}
+
+    RequestAwaitable(const RequestAwaitable&) = delete;
+    void operator=(const RequestAwaitable&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      _handle = handle;
+      // Suspending counts as a party too, so nothing resumes the coroutine before this is done with it
+      _parties = _milliseconds_to_timeout > 0 ? 3 : 2;
+      if(_token) {
+        // So does its token, until cancelling or settling first detaches it
+        _canceller = std::make_shared<Canceller>(this);
+        _parties++;
+        _token->add(RequestHandle(_canceller));
+      }
+      _limiter = _crier._requestLimiter;
+      if(!_limiter || _limiter->acquireOrEnqueue(reqType(), [this](){ return std::function<void()>([this](){ issue(); }); }))
+        issue();
+      if(_parties.fetch_sub(1) != 1)
+        return true;
+      // Already settled: carry on without suspending, unless it should resume elsewhere
+      if(_limiter)
+        _limiter->release(reqType());
+      if(_resume_on == ResumeOn::Immediate && !_post)
+        return false;
+      resume();
+      return true;
+    }
+
+    RequestResult<RetMsgData> await_resume() {
+      RequestResult<RetMsgData> result;
+      result.status = _status;
+      if(_status == ResponseStatus::Ready)
+        result.response.Swap(&_response);
+      return result;
+    }
+
+  private:
+    struct OnTimeout {
+      RequestAwaitable* request;
+      void operator()() const { request->timedOut(); }
+    };
+
+    /// What a token cancels. Only ever reaches the request while attached to it.
+    struct Canceller : Cancellable {
+      explicit Canceller(RequestAwaitable* request) : request(request) {}
+
+      bool cancel() override {
+        RequestAwaitable* cancelled = detach();
+        return cancelled && cancelled->cancelled();
+      }
+
+      RequestAwaitable* detach() {
+        std::lock_guard<std::mutex> guard(mutex);
+        RequestAwaitable* detached = request;
+        request = nullptr;
+        return detached;
+      }
+
+      std::mutex mutex;
+      RequestAwaitable* request;
+    };
+
+    static const std::string& reqType() { return ReqMsgData::descriptor()->full_name(); }
+    static const std::string& retType() { return RetMsgData::descriptor()->full_name(); }
+
+    void issue() {
+      if(claimed()) {
+        // Cancelled before it went out, neither its timeout nor its response callback will be there to leave
+        if(_milliseconds_to_timeout > 0)
+          _parties.fetch_sub(1);
+        leave();
+        return;
+      }
+      if(_milliseconds_to_timeout > 0) {
+        _timeout_id = _crier.scheduleTimeout(retType(), _milliseconds_to_timeout, OnTimeout{this}, true);
+        _timeout_scheduled = true;
+      }
+      if(!_crier.registerAwaitedResponse(retType(), this)) {
+        // Timed out or cancelled before it went out, its response callback will never be there to leave. Cancelled, its timeout may still be pending
+        if(_milliseconds_to_timeout > 0 && _crier.claimTimeout(retType(), _timeout_id))
+          _parties.fetch_sub(1);
+        leave();
+        return;
+      }
+      _crier.sendMessage(_data);
+    }
+
+    void onResponse(google::protobuf::Message* response) override {
+      if(claim()) {
+        _response.CopyFrom(*response);
+        _status = ResponseStatus::Ready;
+        if(_milliseconds_to_timeout > 0 && _crier.claimTimeout(retType(), _timeout_id))
+          _parties.fetch_sub(1);
+        detachCanceller();
+      }
+      leave();
+    }
+
+    void onDisconnect() override {
+      // Crier already took the response callback out, so this stands in for it
+      if(claim()) {
+        _status = ResponseStatus::Disconnected;
+        if(_milliseconds_to_timeout > 0 && _crier.claimTimeout(retType(), _timeout_id))
+          _parties.fetch_sub(1);
+        detachCanceller();
+      }
+      leave();
+    }
+
+    void timedOut() {
+      if(claim()) {
+        _status = ResponseStatus::TimedOut;
+        if(_crier.dropAwaitedResponse(retType(), this))
+          _parties.fetch_sub(1);
+        detachCanceller();
+      }
+      leave();
+    }
+
+    /// Runs for the token, once its canceller is detached.
+    bool cancelled() {
+      bool settled = claim();
+      if(settled) {
+        _status = ResponseStatus::Abandoned;
+        if(_timeout_scheduled && _crier.claimTimeout(retType(), _timeout_id))
+          _parties.fetch_sub(1);
+        if(_crier.dropAwaitedResponse(retType(), this))
+          _parties.fetch_sub(1);
+      }
+      leave();
+      return settled;
+    }
+
+    void detachCanceller() {
+      if(_canceller && _canceller->detach())
+        _parties.fetch_sub(1);
+    }
+
+    void leave() {
+      if(_parties.fetch_sub(1) != 1)
+        return;
+      if(_limiter)
+        _limiter->release(reqType());
+      resume();
+    }
+
+    void resume() {
+      std::coroutine_handle<> handle = _handle;
+      if(_post)
+        _post(_executor, handle);
+      else if(_resume_on == ResumeOn::DispatchQueue)
+        _crier.callOnMainThread([handle](){ handle.resume(); });
+      else
+        handle.resume();
+    }
+
+    CrierType& _crier;
+    const ReqMsgData& _data;
+    unsigned int _milliseconds_to_timeout;
+    ResumeOn _resume_on;
+    void* _executor = nullptr;
+    void (*_post)(void*, std::coroutine_handle<>) = nullptr;
+
+    std::coroutine_handle<> _handle;
+    std::shared_ptr<RequestLimiter> _limiter;
+    unsigned int _timeout_id = 0;
+    std::atomic<bool> _timeout_scheduled{false};
+    // Only allocated for requests tied to a token
+    std::unique_ptr<CancellationToken> _token;
+    std::shared_ptr<Canceller> _canceller;
+    std::atomic<unsigned int> _parties{0};
+    ResponseStatus _status = ResponseStatus::Pending;
+    RetMsgData _response;
+  };
+}
+
+#endif
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef CRIER_RESPONSE_FUTURE_HPP
+#define CRIER_RESPONSE_FUTURE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <crier/Cancellation.hpp>
+
+namespace crier {
+
+  /// How a request returned by Crier::sendRequest ended up.
+  //  Pending until one of the others. Ready when the response arrived, TimedOut when it didn't in time, Abandoned when it never can
+  //  (the request was cancelled, the crier instance was destroyed, or the response callback cleared, with the request still pending),
+  //  and Disconnected when the transport disconnected first, under PendingRequestsOnDisconnect::Fail.
+  enum class ResponseStatus { Pending, Ready, TimedOut, Abandoned, Disconnected };
+
+  /// State shared between a request's future and the callbacks crier runs for it. Resolves exactly once.
+  class ResponseStateBase {
+  public:
+    ResponseStatus status() const {
+      std::lock_guard<std::mutex> guard(_mutex);
+      return _status;
+    }
+
+    ResponseStatus wait() const {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _resolved.wait(lock, [this](){ return _status != ResponseStatus::Pending; });
+      return _status;
+    }
+
+    template <typename Rep, typename Period>
+    ResponseStatus waitFor(const std::chrono::duration<Rep, Period>& duration) const {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _resolved.wait_for(lock, duration, [this](){ return _status != ResponseStatus::Pending; });
+      return _status;
+    }
+
+    /// Runs the continuation once resolved, on the thread resolving it, or right away if it already is.
+    void onResolved(std::function<void()> continuation) {
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if(_status == ResponseStatus::Pending) {
+          _continuations.push_back(std::move(continuation));
+          return;
+        }
+      }
+      continuation();
+    }
+
+    /// Counts the promises (see ResponsePromise) able to resolve this state, so the last one going away unresolved abandons it.
+    std::atomic<unsigned int> promises{0};
+
+  protected:
+    /// Resolves with status, running setter under the lock first. Returns false if it was already resolved.
+    template <typename Setter>
+    bool resolve(ResponseStatus status, Setter setter) {
+      std::vector<std::function<void()>> continuations;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if(_status != ResponseStatus::Pending)
+          return false;
+        setter();
+        _status = status;
+        continuations.swap(_continuations);
+      }
+      _resolved.notify_all();
+      for(const auto& continuation : continuations) {
+        continuation();
+      }
+      return true;
+    }
+
+    mutable std::mutex _mutex;
+    mutable std::condition_variable _resolved;
+    ResponseStatus _status = ResponseStatus::Pending;
+    std::vector<std::function<void()>> _continuations;
+  };
+
+  template <typename T>
+  class ResponseState : public ResponseStateBase {
+  public:
+    bool setValue(const T& value) {
+      return resolve(ResponseStatus::Ready, [this, &value](){ _value = value; });
+    }
+
+    bool setStatus(ResponseStatus status) {
+      return resolve(status, [](){});
+    }
+
+    /// Only meaningful once resolved as Ready, a default constructed T otherwise.
+    const T& value() const {
+      return _value;
+    }
+
+  private:
+    T _value;
+  };
+
+  /// The resolving end of a ResponseState, held by the callbacks crier runs for a request. When the last copy is destroyed with the state still pending,
+  /// (the callbacks were dropped without running) the state is abandoned, so nobody waits on it forever.
+  template <typename T>
+  class ResponsePromise {
+  public:
+    explicit ResponsePromise(const std::shared_ptr<ResponseState<T>>& state) : _state(state) { _state->promises++; }
+    ResponsePromise(const ResponsePromise& other) : _state(other._state) { _state->promises++; }
+    void operator=(const ResponsePromise& other) = delete;
+    ~ResponsePromise() {
+      if(_state->promises.fetch_sub(1) == 1)
+        _state->setStatus(ResponseStatus::Abandoned);
+    }
+
+    void fulfill(const T& value) const { _state->setValue(value); }
+    void timeOut() const { _state->setStatus(ResponseStatus::TimedOut); }
+    void disconnect() const { _state->setStatus(ResponseStatus::Disconnected); }
+
+  private:
+    std::shared_ptr<ResponseState<T>> _state;
+  };
+
+  /// ResponseFuture
+  /// The response to a request sent with Crier::sendRequest, to wait on, or join with others (see whenAll). Cheap to copy, all copies share the one state.
+  //  Keep in mind responses are resolved where their callbacks would run: if the response type uses the DispatchQueue inbound dispatching, the future
+  //  only resolves once 'dispatchQueuedCallbacks' is called, so don't wait on it from the thread that calls it.
+  template <typename T>
+  class ResponseFuture {
+  public:
+    ResponseFuture() = default;
+    explicit ResponseFuture(const std::shared_ptr<ResponseState<T>>& state, const RequestHandle& handle = RequestHandle()) : _state(state), _handle(handle) {}
+
+    /// False for a default constructed future, that no request is behind.
+    bool valid() const { return _state != nullptr; }
+
+    ResponseStatus status() const { return _state->status(); }
+    bool ready() const { return status() != ResponseStatus::Pending; }
+
+    /// Blocks until resolved, returning how.
+    ResponseStatus wait() const { return _state->wait(); }
+
+    /// Blocks until resolved or the duration passes, returning the status at that point (Pending if the time ran out first).
+    template <typename Rep, typename Period>
+    ResponseStatus waitFor(const std::chrono::duration<Rep, Period>& duration) const { return _state->waitFor(duration); }
+
+    /// Blocks until resolved, returning the response. Only holds the response if the status is Ready, check it before trusting the returned value.
+    const T& get() const {
+      _state->wait();
+      return _state->value();
+    }
+
+    /// Cancels the request, resolving the future as Abandoned. Returns false if it had already resolved.
+    bool cancel() const { return _handle.cancel(); }
+
+    /// The request's handle, to add to a CancellationToken.
+    const RequestHandle& handle() const { return _handle; }
+
+    const std::shared_ptr<ResponseState<T>>& state() const { return _state; }
+
+  private:
+    std::shared_ptr<ResponseState<T>> _state;
+    RequestHandle _handle;
+  };
+
+  /// JoinedFuture
+  /// Resolves once every future it joins has (see whenAll). Holds no responses itself, read them from the joined futures.
+  class JoinedFuture {
+  public:
+    struct State {
+      std::mutex mutex;
+      std::condition_variable resolved;
+      size_t remaining = 0;
+      size_t not_ready = 0;
+    };
+
+    explicit JoinedFuture(const std::shared_ptr<State>& state) : _state(state) {}
+
+    bool ready() const {
+      std::lock_guard<std::mutex> guard(_state->mutex);
+      return _state->remaining == 0;
+    }
+
+    /// Blocks until every joined future resolved. Returns true if they all resolved as Ready.
+    bool wait() const {
+      std::unique_lock<std::mutex> lock(_state->mutex);
+      _state->resolved.wait(lock, [this](){ return _state->remaining == 0; });
+      return _state->not_ready == 0;
+    }
+
+    /// Blocks until every joined future resolved, or the duration passes. Returns true if they all resolved, in time, as Ready.
+    template <typename Rep, typename Period>
+    bool waitFor(const std::chrono::duration<Rep, Period>& duration) const {
+      std::unique_lock<std::mutex> lock(_state->mutex);
+      return _state->resolved.wait_for(lock, duration, [this](){ return _state->remaining == 0; }) && _state->not_ready == 0;
+    }
+
+    /// How many of the joined futures resolved as anything but Ready (so far).
+    size_t failures() const {
+      std::lock_guard<std::mutex> guard(_state->mutex);
+      return _state->not_ready;
+    }
+
+  private:
+    std::shared_ptr<State> _state;
+  };
+
+  namespace join_detail {
+    inline void join(const std::shared_ptr<JoinedFuture::State>& join_state, ResponseStateBase& response_state) {
+      ResponseStateBase* response = &response_state;
+      response_state.onResolved([join_state, response](){
+        bool ready = response->status() == ResponseStatus::Ready;
+        {
+          std::lock_guard<std::mutex> guard(join_state->mutex);
+          join_state->remaining--;
+          if(!ready)
+            join_state->not_ready++;
+          if(join_state->remaining > 0)
+            return;
+        }
+        join_state->resolved.notify_all();
+      });
+    }
+  }
+
+  /// Joins many futures into one, resolving once all of them have.
+  template <typename T>
+  JoinedFuture whenAll(const std::vector<ResponseFuture<T>>& futures) {
+    auto join_state = std::make_shared<JoinedFuture::State>();
+    join_state->remaining = futures.size();
+    for(const auto& future : futures) {
+      join_detail::join(join_state, *future.state());
+    }
+    return JoinedFuture(join_state);
+  }
+
+  /// Joins futures of different response types into one, resolving once all of them have.
+  template <typename... Ts>
+  JoinedFuture whenAll(const ResponseFuture<Ts>&... futures) {
+    auto join_state = std::make_shared<JoinedFuture::State>();
+    join_state->remaining = sizeof...(Ts);
+    int expand[] = {0, (join_detail::join(join_state, *futures.state()), 0)...};
+    (void)expand;
+    return JoinedFuture(join_state);
+  }
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef CRIER_RESPONSE_STREAM_HPP
+#define CRIER_RESPONSE_STREAM_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <google/protobuf/message.h>
+
+#include <crier/CrierTypes.hpp>
+#include <crier/Cancellation.hpp>
+
+namespace crier {
+
+  /// State of a streaming request (see Crier::sendStreamingRequest), shared by its handle and the response callback crier keeps for it. Ends exactly once.
+  class StreamState : public Cancellable {
+  public:
+    StreamState(const StreamOptions& options, const std::function<void(StreamEnd)>& on_end)
+      : _options(options), _on_end(on_end), _last_activity(std::chrono::steady_clock::now()) {}
+
+    /// Hands a response to the stream's callback, ending the stream if the callback says so or it reached its count limit. Returns false if it had already ended.
+    bool deliver(google::protobuf::Message* response) {
+      if(!active())
+        return false;
+      touch();
+      unsigned int delivered = ++_responses;
+      bool wants_more = handle(response);
+      if(!wants_more)
+        end(StreamEnd::Completed);
+      else if(_options.max_responses > 0 && delivered >= _options.max_responses)
+        end(StreamEnd::CountLimit);
+      return true;
+    }
+
+    /// Ends the stream, unregistering it and running its end callback. Returns false if it had already ended.
+    bool end(StreamEnd reason) {
+      std::function<void()> unregister;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if(!_active)
+          return false;
+        _active = false;
+        _reason = reason;
+        unregister.swap(_unregister);
+      }
+      if(unregister)
+        unregister();
+      if(_on_end)
+        _on_end(reason);
+      return true;
+    }
+
+    /// Set by crier as the stream is sent, to take it out of its callbacks as it ends. Returns false, keeping nothing, if it already ended.
+    bool setUnregister(const std::function<void()>& unregister) {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(!_active)
+        return false;
+      _unregister = unregister;
+      return true;
+    }
+
+    /// Restarts the idle time.
+    void touch() { _last_activity = std::chrono::steady_clock::now(); }
+
+    bool active() const {
+      std::lock_guard<std::mutex> guard(_mutex);
+      return _active;
+    }
+
+    /// Only meaningful once the stream ended.
+    StreamEnd reason() const {
+      std::lock_guard<std::mutex> guard(_mutex);
+      return _reason;
+    }
+
+    unsigned int responses() const { return _responses; }
+
+    unsigned int idleMilliseconds() const {
+      return static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _last_activity.load()).count());
+    }
+
+    const StreamOptions& options() const { return _options; }
+
+    bool cancel() override { return end(StreamEnd::Cancelled); }
+
+  protected:
+    /// Runs the typed callback, returning false if the response ends the stream.
+    virtual bool handle(google::protobuf::Message* response) = 0;
+
+  private:
+    const StreamOptions _options;
+    std::function<void(StreamEnd)> _on_end;
+    std::function<void()> _unregister;
+    std::atomic<std::chrono::steady_clock::time_point> _last_activity;
+    std::atomic<unsigned int> _responses{0};
+    bool _active = true;
+    StreamEnd _reason = StreamEnd::Cancelled;
+    mutable std::mutex _mutex;
+  };
+
+  template <typename T>
+  class TypedStreamState : public StreamState {
+  public:
+    TypedStreamState(const std::function<bool(const T&)>& on_response, const StreamOptions& options, const std::function<void(StreamEnd)>& on_end)
+      : StreamState(options, on_end), _on_response(on_response) {}
+
+  protected:
+    bool handle(google::protobuf::Message* response) override {
+      return _on_response(*(dynamic_cast<T*>(response)));
+    }
+
+  private:
+    std::function<bool(const T&)> _on_response;
+  };
+
+  /// Response callback of a stream, staying registered across its responses until it ends (see StreamEnd).
+  struct StreamedResponse {
+    std::shared_ptr<StreamState> stream;
+    void operator()(google::protobuf::Message* response) const { stream->deliver(response); }
+  };
+
+  /// StreamHandle
+  /// Handle to a streaming request sent with Crier::sendStreamingRequest. Cheap to copy, all copies refer to the one stream, and dropping them doesn't end it.
+  //  Cancelling (through the handle, or a CancellationToken it was added to) ends the stream with the Cancelled reason. Unlike other requests, responses
+  //  arriving after that aren't dropped, they're handled as if the stream was never sent.
+  class StreamHandle : public RequestHandle {
+  public:
+    StreamHandle() = default;
+    explicit StreamHandle(const std::shared_ptr<StreamState>& state) : RequestHandle(state), _state(state) {}
+
+    /// True until the stream ends, for whichever reason.
+    bool active() const { return _state && _state->active(); }
+
+    /// Responses delivered to the stream's callback so far.
+    unsigned int responses() const { return _state ? _state->responses() : 0; }
+
+    /// Why the stream ended, only meaningful once it's no longer active.
+    StreamEnd endReason() const { return _state ? _state->reason() : StreamEnd::Cancelled; }
+
+  private:
+    std::shared_ptr<StreamState> _state;
+  };
+}
+
+#endif
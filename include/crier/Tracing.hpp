@@ -0,0 +1,76 @@
+#ifndef CRIER_TRACING_HPP
+#define CRIER_TRACING_HPP
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace crier {
+
+  /// Steps of a message's way through crier, each traced as a span of its own.
+  //  - Receive, from a parsed root message being opened, until its callbacks ran (or got queued). Callback and Enqueue spans nest inside it.
+  //  - Parse, deserializing the transport's data into the root message.
+  //  - Enqueue, placing a callback in the dispatch queue (InboundDispatching::DispatchQueue).
+  //  - Dequeue, running a queued callback out of 'dispatchQueuedCallbacks'. Callback spans nest inside it.
+  //  - Callback, running a single permanent callback (its key being the span's), or the response callback of a request.
+  enum class TracePhase { Receive, Parse, Enqueue, Dequeue, Callback };
+
+  inline const char* tracePhaseName(TracePhase phase) {
+    switch(phase) {
+      case TracePhase::Receive: return "receive";
+      case TracePhase::Parse: return "parse";
+      case TracePhase::Enqueue: return "enqueue";
+      case TracePhase::Dequeue: return "dequeue";
+      case TracePhase::Callback: return "callback";
+    }
+    return "unknown";
+  }
+
+  /// A traced step, as handed to a TraceSink.
+  struct TraceSpan {
+    TracePhase phase;
+    /// Full name of the message type, empty while unknown (when parsing, or for callbacks queued for other reasons than a message).
+    std::string type;
+    /// Key of the permanent callback run, empty for any other span.
+    std::string key;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds duration;
+    std::thread::id thread;
+  };
+
+  /// Receives the spans of a crier instance using the Tracing policy. Called from whichever thread the traced step ran on, so must be thread-safe.
+  class TraceSink {
+  public:
+    virtual ~TraceSink() = default;
+    virtual void record(const TraceSpan& span) = 0;
+  };
+
+  /// Tracing Policies
+  /// Crier's third template parameter, picking at compile time whether it traces at all. A policy has a static 'enabled' flag and a 'record(const TraceSpan&)' method.
+  //  NoTracing is the default: every trace point is compiled out, not even reading the clock.
+  struct NoTracing {
+    static const bool enabled = false;
+    void record(const TraceSpan&) {}
+  };
+
+  /// Traces every step into the sink set, if any (see ChromeTraceBuffer for one).
+  class Tracing {
+  public:
+    static const bool enabled = true;
+
+    /// Should be set before connecting the transport, spans are recorded without synchronizing on it.
+    void setSink(const std::shared_ptr<TraceSink>& sink) { _sink = sink; }
+    const std::shared_ptr<TraceSink>& sink() const { return _sink; }
+
+    void record(const TraceSpan& span) {
+      if(_sink)
+        _sink->record(span);
+    }
+
+  private:
+    std::shared_ptr<TraceSink> _sink;
+  };
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define CRIER_TRANSPORT_HPP
 
 #include <string>
+#include <vector>
 #include <functional>
 
 namespace crier {
@@ -27,6 +28,14 @@ namespace crier {
     /// Will be called by crier whenever it needs to send post serialization data to the transport. (after you call the 'sendMessage' method, for example)
     virtual void sendData(const std::string& data_to_send) = 0;
 
+    /// Will be called by crier when it has many messages to send at once (the ones held during an outage, for instance). Sends them one by one by default,
+    /// override it if your transport can send them together for less. Transports that don't inherit from this class don't need to provide it.
+    virtual void sendDataBatch(const std::vector<std::string>& batch) {
+      for(const auto& data : batch) {
+        sendData(data);
+      }
+    }
+
     /// Will be called by crier on initialization. Crier will use this in order to be able to receive what you deem to be the 'connection was successfully opened' event.
     virtual void setOnConnectCallback(const std::function<void(void)>& on_connect){
       _on_connect_cb = on_connect;
@@ -37,6 +46,12 @@ namespace crier {
       _on_data_cb = on_data;
     }
 
+    /// Will be called by crier on initialization. Crier will use this in order to be able to receive data straight out of your transport's own buffers.
+    //  Transports that don't inherit from this class don't need to provide this method, crier will only use _on_data_cb with those.
+    virtual void setOnRawDataCallback(const std::function<void(const char*, size_t)>& on_raw_data){
+      _on_raw_data_cb = on_raw_data;
+    }
+
     /// Will be called by crier on initialization. Crier will use this in order to be able to receive what you deem to be the 'connection was broken' event.
     virtual void setOnDisconnectCallback(const std::function<void(const std::string&)>& on_disconnect){
       _on_disconnect_cb = on_disconnect;
@@ -49,6 +64,10 @@ namespace crier {
     /// Whenever your receive data from your underlying socket implementation, you should invoke this callback.
     std::function<void(const std::string&)> _on_data_cb;
 
+    /// Alternative to _on_data_cb, for when the received data sits in a buffer your transport owns. Crier parses it in place, sparing the copy into a std::string.
+    /// The data only needs to remain valid for the duration of the call.
+    std::function<void(const char*, size_t)> _on_raw_data_cb;
+
     /// Whenever your underlying socket implementation has it's connection broken you should invoke this callback, passing it a string that identifies the issue.
     std::function<void(const std::string&)> _on_disconnect_cb;
   };
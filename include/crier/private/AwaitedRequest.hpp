@@ -0,0 +1,36 @@
+#ifndef CRIER_AWAITED_REQUEST_HPP
+#define CRIER_AWAITED_REQUEST_HPP
+
+#include <atomic>
+
+#include <google/protobuf/message.h>
+
+namespace crier {
+
+  /// A request a coroutine awaits (see RequestAwaitable.hpp), as seen from crier's response callbacks.
+  //  Whichever of its response or its timeout claims it first settles it. Crier leaves the entries of claimed requests out of its callback maps.
+  class AwaitedRequest {
+  public:
+    virtual void onResponse(google::protobuf::Message* response) = 0;
+    /// Runs instead of onResponse when the transport disconnects under PendingRequestsOnDisconnect::Fail, once crier took the response callback out.
+    virtual void onDisconnect() = 0;
+
+    /// True for the first caller only.
+    bool claim() { return !_claimed.exchange(true); }
+    bool claimed() const { return _claimed.load(); }
+
+  protected:
+    ~AwaitedRequest() = default;
+
+  private:
+    std::atomic<bool> _claimed{false};
+  };
+
+  /// Response callback of an AwaitedRequest: a bare pointer into the awaiting coroutine's frame, which std::function holds without allocating.
+  struct AwaitedResponse {
+    AwaitedRequest* request;
+    void operator()(google::protobuf::Message* response) const { request->onResponse(response); }
+  };
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef CRIER_CALLBACK_ACCOUNTING_HPP
+#define CRIER_CALLBACK_ACCOUNTING_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <time.h>
+
+#include <crier/Metrics.hpp>
+
+namespace crier {
+
+  /// CPU time the calling thread used so far.
+  inline std::chrono::nanoseconds threadCpuTime() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return std::chrono::seconds{now.tv_sec} + std::chrono::nanoseconds{now.tv_nsec};
+  }
+
+  /// Wall and CPU time spent in each callback, by message type and key, and the slow callback threshold (see Crier::enableCallbackAccounting).
+  class CallbackAccounting {
+  public:
+    /// Times the callback run in its scope, doing nothing without an accounting to record into.
+    class Scope {
+    public:
+      Scope(CallbackAccounting* accounting, const std::string& type, const std::string& key) : _accounting(accounting), _type(type), _key(key) {
+        if(_accounting) {
+          _wall_start = std::chrono::steady_clock::now();
+          _cpu_start = threadCpuTime();
+        }
+      }
+
+      Scope(const Scope&) = delete;
+      void operator=(const Scope&) = delete;
+
+      ~Scope() {
+        if(_accounting)
+          _accounting->record(_type, _key, std::chrono::steady_clock::now() - _wall_start, threadCpuTime() - _cpu_start);
+      }
+
+    private:
+      CallbackAccounting* _accounting;
+      const std::string& _type;
+      const std::string& _key;
+      std::chrono::steady_clock::time_point _wall_start;
+      std::chrono::nanoseconds _cpu_start{0};
+    };
+
+    /// Key the response callbacks of requests and streams are accounted under.
+    static const std::string& responseKey() {
+      static const std::string key;
+      return key;
+    }
+
+    /// A zero threshold, or a null callback, stops reporting.
+    void setSlowThreshold(std::chrono::nanoseconds threshold, const std::function<void(const SlowCallback&)>& onSlow) {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _slow_threshold = threshold;
+      _on_slow = onSlow;
+    }
+
+    void record(const std::string& type, const std::string& key, std::chrono::nanoseconds wall_time, std::chrono::nanoseconds cpu_time) {
+      std::function<void(const SlowCallback&)> on_slow;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        CallbackStats& stats = _stats[std::make_pair(type, key)];
+        stats.calls++;
+        stats.wall_time += wall_time;
+        stats.cpu_time += cpu_time;
+        stats.max_wall_time = std::max(stats.max_wall_time, wall_time);
+        if(_on_slow && _slow_threshold.count() > 0 && wall_time >= _slow_threshold)
+          on_slow = _on_slow;
+      }
+      // Reported outside the lock, so the report may look up the accounting itself
+      if(on_slow) {
+        SlowCallback slow;
+        slow.type = type;
+        slow.key = key;
+        slow.wall_time = wall_time;
+        slow.cpu_time = cpu_time;
+        on_slow(slow);
+      }
+    }
+
+    /// The count callbacks that took the most wall time in total, most expensive first.
+    std::vector<CallbackStats> mostExpensive(size_t count) const {
+      std::vector<CallbackStats> all;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        all.reserve(_stats.size());
+        for(const auto& entry : _stats) {
+          all.push_back(entry.second);
+          all.back().type = entry.first.first;
+          all.back().key = entry.first.second;
+        }
+      }
+      count = std::min(count, all.size());
+      std::partial_sort(all.begin(), all.begin() + static_cast<std::ptrdiff_t>(count), all.end(), [](const CallbackStats& a, const CallbackStats& b){
+        return a.wall_time > b.wall_time; });
+      all.resize(count);
+      return all;
+    }
+
+  private:
+    std::map<std::pair<std::string, std::string>, CallbackStats> _stats;
+    std::chrono::nanoseconds _slow_threshold{0};
+    std::function<void(const SlowCallback&)> _on_slow;
+    mutable std::mutex _mutex;
+  };
+}
+
+#endif
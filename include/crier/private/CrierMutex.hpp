@@ -0,0 +1,43 @@
+#ifndef CRIER_CRIER_MUTEX_HPP
+#define CRIER_CRIER_MUTEX_HPP
+
+#include <chrono>
+#include <mutex>
+
+#include <crier/private/MetricsRegistry.hpp>
+
+namespace crier {
+
+  /// Mutex guarding one of crier's core maps. Behaves as a std::mutex, until given counters to record into (see Crier::enableMetrics),
+  /// from then on counting its acquisitions, the ones that found it taken, and how long those waited.
+  //  Taking it uncontended is a try_lock and a counter add, the same as a plain lock but for the add, so it can stay instrumented.
+  class CrierMutex {
+  public:
+    void lock() {
+      LockCounters* counters = _counters;
+      if(!counters) {
+        _mutex.lock();
+        return;
+      }
+      if(!_mutex.try_lock()) {
+        auto waiting_since = std::chrono::steady_clock::now();
+        _mutex.lock();
+        counters->contended.add();
+        counters->wait_time.recordSince(waiting_since);
+      }
+      counters->acquisitions.add();
+    }
+
+    bool try_lock() { return _mutex.try_lock(); }
+    void unlock() { _mutex.unlock(); }
+
+    /// Should only be called before other threads use the mutex.
+    void instrument(LockCounters* counters) { _counters = counters; }
+
+  private:
+    std::mutex _mutex;
+    LockCounters* _counters = nullptr;
+  };
+}
+
+#endif
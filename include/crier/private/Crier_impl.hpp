@@ -5,158 +5,1192 @@
 
 namespace crier {
 
-  template <typename Transport, typename ProtoRootMsg>
-  Crier<Transport, ProtoRootMsg>::Crier(UnhandledMessageBehaviour default_unhandled_behaviour,
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  Crier<Transport, ProtoRootMsg, Tracer>::Crier(UnhandledMessageBehaviour default_unhandled_behaviour,
         InboundDispatching default_inbound_dispatch) :
   _transport(new Transport()), _timeoutIds(0), _default_unhandled_behaviour(default_unhandled_behaviour), _default_inbound_dispatch(default_inbound_dispatch),
   _inboundDispatchTransportOpenSetting(default_inbound_dispatch), _inboundDispatchTransportErrorSetting(default_inbound_dispatch),
-  _supressNextTransportClosed(false), _custom_serialization_fun(nullptr), _custom_deserialization_fun(nullptr) {
+  _supressNextTransportClosed(false), _pendingRequestsOnDisconnect(PendingRequestsOnDisconnect::Keep), _rareState(nullptr) {
     _transport->setOnConnectCallback([this](){ OnTransportConnect(); });
     _transport->setOnDataCallback([this](const std::string& data){ OnTransportData(data); });
+    transport_traits::setOnRawDataCallback(*_transport, [this](const char* data, size_t size){ OnTransportData(data, size); }, 0);
     _transport->setOnDisconnectCallback([this](const std::string& reason){ OnTransportDisconnect(reason); });
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  Crier<Transport, ProtoRootMsg>::Crier(Transport transport, UnhandledMessageBehaviour default_unhandled_behaviour,
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  Crier<Transport, ProtoRootMsg, Tracer>::Crier(Transport transport, UnhandledMessageBehaviour default_unhandled_behaviour,
           InboundDispatching default_inbound_dispatch) :
   _transport(new Transport(std::move(transport))), _timeoutIds(0), _default_unhandled_behaviour(default_unhandled_behaviour), _default_inbound_dispatch(default_inbound_dispatch),
   _inboundDispatchTransportOpenSetting(default_inbound_dispatch), _inboundDispatchTransportErrorSetting(default_inbound_dispatch),
-  _supressNextTransportClosed(false), _custom_serialization_fun(nullptr), _custom_deserialization_fun(nullptr) {
+  _supressNextTransportClosed(false), _pendingRequestsOnDisconnect(PendingRequestsOnDisconnect::Keep), _rareState(nullptr) {
     _transport->setOnConnectCallback([this](){ OnTransportConnect(); });
     _transport->setOnDataCallback([this](const std::string& data){ OnTransportData(data); });
+    transport_traits::setOnRawDataCallback(*_transport, [this](const char* data, size_t size){ OnTransportData(data, size); }, 0);
     _transport->setOnDisconnectCallback([this](const std::string& reason){ OnTransportDisconnect(reason); });
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  Crier<Transport, ProtoRootMsg>::~Crier() {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  Crier<Transport, ProtoRootMsg, Tracer>::~Crier() {
+    _shuttingDown = true;
+    if(_requestLimiter)
+      _requestLimiter->close();
+    if(_asyncSend)
+      stopWriter();
+    if(_reconnect) {
+      {
+        std::lock_guard<std::mutex> guard(_reconnect->mutex);
+        _reconnect->stopping = true;
+      }
+      _reconnect->wakeup.notify_all();
+      if(_reconnect->thread.joinable())
+        _reconnect->thread.join();
+    }
+    if(_loopBinding) {
+      // Waits out any timer or drain running on the reactor loop, and keeps the ones still pending from ever touching this instance
+      std::lock_guard<std::mutex> guard(_loopBinding->mutex);
+      _loopBinding->alive = false;
+    }
+    // Timeouts (policy retries and hedges among them) may send, so they're done with before the transport goes
     invalidateAllTimeouts();
     for(auto& thread : _launchedThreads) {
       if(thread.joinable()) thread.join();
     }
+    // Transports may deliver data from their own threads, so tear them down while the rest of the instance is still valid
+    _transport.reset();
+    abandonStreams();
+    delete _rareState.load();
   }
   
-  template <typename Transport, typename ProtoRootMsg>
-  const Transport& Crier<Transport, ProtoRootMsg>::ctransport() const {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  const Transport& Crier<Transport, ProtoRootMsg, Tracer>::ctransport() const {
     return *_transport;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  Transport& Crier<Transport, ProtoRootMsg>::transport() {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  Transport& Crier<Transport, ProtoRootMsg, Tracer>::transport() {
     return *_transport;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::connectTransport(const std::string& ip, unsigned int port) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReactorType>
+  void Crier<Transport, ProtoRootMsg, Tracer>::attachToReactor(ReactorType& reactor, bool drain_dispatch_queue_on_reactor) {
+    auto& loop = reactor.nextLoop();
+    if(!transport_traits::attachToLoop(*_transport, loop, 0))
+      std::cout << "[CRIER] WARNING: Transport can't be attached to a reactor loop, it will keep running its own threads" << std::endl;
+
+    auto binding = std::make_shared<LoopBinding>();
+    binding->post = [&loop](std::function<void()> task){ loop.post(std::move(task)); };
+    binding->runAfter = [&loop](unsigned int milliseconds, std::function<void()> task){ return loop.runAfter(std::chrono::milliseconds{milliseconds}, std::move(task)); };
+    binding->cancelTimer = [&loop](uint64_t timer){ return loop.cancelTimer(timer); };
+    binding->drainDispatchQueue = drain_dispatch_queue_on_reactor;
+    _loopBinding = binding;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::connectTransport(const std::string& ip, unsigned int port) {
     _supressNextTransportClosed = false;
+    if(_reconnect) {
+      std::lock_guard<std::mutex> guard(_reconnect->mutex);
+      _reconnect->host = ip;
+      _reconnect->port = port;
+      _reconnect->user_disconnected = false;
+      _reconnect->attempts = 0;
+      _reconnect->attempt_scheduled = false;
+      _reconnect->generation++;
+    }
     _transport->connect(ip, port);
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::disconnectTransport() {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::disconnectTransport() {
+    if(_reconnect) {
+      std::lock_guard<std::mutex> guard(_reconnect->mutex);
+      _reconnect->user_disconnected = true;
+      _reconnect->reconnecting = false;
+      _reconnect->attempt_scheduled = false;
+      _reconnect->generation++;
+      _reconnect->held.clear();
+      _reconnect->held_bytes = 0;
+    }
     _transport->disconnect();
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  bool Crier<Transport, ProtoRootMsg>::transportConnected() const {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::enableAutoReconnect(const ReconnectPolicy& policy) {
+    if(!_reconnect) {
+      _reconnect.reset(new ReconnectState());
+      _reconnect->online = _transport->isConnected();
+      _reconnect->rng.seed(static_cast<unsigned int>(std::random_device()()));
+    }
+    std::lock_guard<std::mutex> guard(_reconnect->mutex);
+    _reconnect->policy = policy;
+    _reconnect->enabled = true;
+    if(!_loopBinding && !_reconnect->thread.joinable())
+      _reconnect->thread = std::thread([this](){ reconnectLoop(); });
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::disableAutoReconnect() {
+    if(!_reconnect)
+      return;
+    std::lock_guard<std::mutex> guard(_reconnect->mutex);
+    _reconnect->enabled = false;
+    _reconnect->reconnecting = false;
+    _reconnect->attempt_scheduled = false;
+    _reconnect->generation++;
+    _reconnect->held.clear();
+    _reconnect->held_bytes = 0;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::setPendingRequestsOnDisconnect(PendingRequestsOnDisconnect behaviour) {
+    _pendingRequestsOnDisconnect = behaviour;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::enableAsyncSend(const AsyncSendOptions& options) {
+    if(_asyncSend)
+      return;
+    _asyncSend.reset(new AsyncSendState());
+    _asyncSend->options = options;
+    _asyncSend->writer = std::thread([this](){ writerLoop(); });
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  size_t Crier<Transport, ProtoRootMsg, Tracer>::queuedOutboundBytes() const {
+    return _asyncSend ? _asyncSend->queued_bytes.load() : 0;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::enqueuePayload(std::string payload) {
+    AsyncSendState& async = *_asyncSend;
+    const size_t size = payload.size();
+    const size_t high_watermark = async.options.high_watermark_bytes;
+    // An empty queue always takes the message, however big, so nothing waits forever
+    size_t queued = async.queued_bytes.load();
+    if(queued > 0 && queued + size > high_watermark) {
+      if(async.options.policy == HighWatermarkPolicy::FailFast) {
+        return false;
+      } else if(async.options.policy == HighWatermarkPolicy::Block && std::this_thread::get_id() != async.writer.get_id()) {
+        // Callbacks run by the writer (a transport echoing synchronously, say) can't wait on themselves, so they skip this
+        async.blocked_senders++;
+        {
+          std::unique_lock<std::mutex> lock(async.mutex);
+          async.space.wait(lock, [&async, size, high_watermark](){
+            size_t now_queued = async.queued_bytes.load();
+            return async.stopping || now_queued == 0 || now_queued + size <= high_watermark;
+          });
+        }
+        async.blocked_senders--;
+      }
+    }
+
+    queued = pushPayload(std::move(payload));
+    if(async.options.policy == HighWatermarkPolicy::Signal && queued > high_watermark && !async.signaled.exchange(true) && async.options.on_high_watermark)
+      async.options.on_high_watermark(queued);
+    return true;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  size_t Crier<Transport, ProtoRootMsg, Tracer>::pushPayload(std::string payload) {
+    AsyncSendState& async = *_asyncSend;
+    size_t queued = async.queued_bytes.fetch_add(payload.size()) + payload.size();
+    async.queue.push(std::move(payload));
+    if(async.writer_sleeping.load()) {
+      std::lock_guard<std::mutex> guard(async.mutex);
+      async.writer_sleeping = false;
+      async.wakeup.notify_one();
+    }
+    return queued;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::writerLoop() {
+    AsyncSendState& async = *_asyncSend;
+    std::vector<std::string> batch;
+    batch.reserve(async.options.max_batch_messages);
+    std::string payload;
+    while(true) {
+      size_t batch_bytes = 0;
+      while(batch.size() < async.options.max_batch_messages && async.queue.pop(payload)) {
+        batch_bytes += payload.size();
+        batch.push_back(std::move(payload));
+      }
+
+      if(!batch.empty()) {
+        // Popped messages leave room for others right away, while the transport works through them
+        size_t queued = async.queued_bytes.fetch_sub(batch_bytes) - batch_bytes;
+        if(queued <= async.options.high_watermark_bytes)
+          async.signaled = false;
+        if(async.blocked_senders.load() > 0) {
+          std::lock_guard<std::mutex> guard(async.mutex);
+          async.space.notify_all();
+        }
+        transport_traits::sendDataBatch(*_transport, batch, 0);
+        batch.clear();
+        continue;
+      }
+
+      // Nothing left: announce we're going to sleep, then check again, so a push racing with us either is seen here or sees us asleep
+      std::unique_lock<std::mutex> lock(async.mutex);
+      if(async.stopping && async.queued_bytes.load() == 0)
+        return;
+      async.writer_sleeping = true;
+      if(async.queued_bytes.load() > 0) {
+        async.writer_sleeping = false;
+        continue;
+      }
+      async.wakeup.wait(lock, [&async](){ return !async.writer_sleeping.load() || async.stopping; });
+      async.writer_sleeping = false;
+    }
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::stopWriter() {
+    {
+      std::lock_guard<std::mutex> guard(_asyncSend->mutex);
+      _asyncSend->stopping = true;
+    }
+    _asyncSend->wakeup.notify_all();
+    _asyncSend->space.notify_all();
+    if(_asyncSend->writer.joinable())
+      _asyncSend->writer.join();
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::enableFlowControl(const FlowControlOptions& options) {
+    if(ProtoRootMsg::descriptor()->FindFieldByNumber(options.credit_field_number) != nullptr) {
+      std::cout << "[CRIER] ERROR: Root message field " << options.credit_field_number << " is taken, flow control was not enabled" << std::endl;
+      return false;
+    }
+    if(!_flowControl)
+      _flowControl.reset(new FlowControlState());
+    _flowControl->options = options;
+    _flowControl->grant_threshold = std::max(1u, (options.window + 1) / 2);
+    return true;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  unsigned int Crier<Transport, ProtoRootMsg, Tracer>::sendCredits() const {
+    if(!_flowControl)
+      return 0;
+    std::lock_guard<std::mutex> guard(_flowControl->mutex);
+    return _flowControl->credits;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::sendWithCredit(std::string&& payload) {
+    {
+      std::lock_guard<std::mutex> guard(_flowControl->mutex);
+      FlowControlState& flow = *_flowControl;
+      // Anything already held goes first, to keep messages in order
+      if(flow.credits == 0 || flow.releasing || !flow.held.empty()) {
+        if(flow.held_bytes + payload.size() > flow.options.max_held_bytes) {
+          std::cout << "[CRIER] ERROR: Out of flow control credits and buffer, message was not sent" << std::endl;
+          return false;
+        }
+        flow.held_bytes += payload.size();
+        flow.held.push_back(std::move(payload));
+        return true;
+      }
+      flow.credits--;
+    }
+    return sendPayload(std::move(payload));
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::releaseHeldForCredits() {
+    {
+      std::lock_guard<std::mutex> guard(_flowControl->mutex);
+      // Sending may bring more credits in on this same thread (a transport replying synchronously), the outer call takes care of them
+      if(_flowControl->releasing)
+        return;
+      _flowControl->releasing = true;
+    }
+    std::vector<std::string> batch;
+    while(true) {
+      {
+        std::lock_guard<std::mutex> guard(_flowControl->mutex);
+        FlowControlState& flow = *_flowControl;
+        while(flow.credits > 0 && !flow.held.empty()) {
+          flow.held_bytes -= flow.held.front().size();
+          batch.push_back(std::move(flow.held.front()));
+          flow.held.pop_front();
+          flow.credits--;
+        }
+        if(batch.empty()) {
+          flow.releasing = false;
+          return;
+        }
+      }
+      for(auto& payload : batch) {
+        sendPayload(std::move(payload));
+      }
+      batch.clear();
+    }
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::takeCredit() {
+    std::lock_guard<std::mutex> guard(_flowControl->mutex);
+    FlowControlState& flow = *_flowControl;
+    if(flow.credits == 0 || flow.releasing || !flow.held.empty())
+      return false;
+    flow.credits--;
+    return true;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::returnCredit(unsigned int grant) {
+    {
+      std::lock_guard<std::mutex> guard(_flowControl->mutex);
+      _flowControl->credits++;
+    }
+    if(grant > 0)
+      messageConsumed(grant);
+    releaseHeldForCredits();
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  unsigned int Crier<Transport, ProtoRootMsg, Tracer>::attachGrant(ProtoRootMsg& root) {
+    unsigned int grant = _flowControl->pending_grant.exchange(0);
+    if(grant > 0)
+      root.GetReflection()->MutableUnknownFields(&root)->AddVarint(_flowControl->options.credit_field_number, grant);
+    return grant;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::takeGrant(const ProtoRootMsg& root) {
+    const google::protobuf::UnknownFieldSet& unknown = root.GetReflection()->GetUnknownFields(root);
+    uint64_t grant = 0;
+    bool granted = false;
+    for(int i = 0; i < unknown.field_count(); i++) {
+      const google::protobuf::UnknownField& field = unknown.field(i);
+      if(field.number() == _flowControl->options.credit_field_number && field.type() == google::protobuf::UnknownField::TYPE_VARINT) {
+        grant += field.varint();
+        granted = true;
+      }
+    }
+    if(!granted)
+      return false;
+    {
+      std::lock_guard<std::mutex> guard(_flowControl->mutex);
+      _flowControl->credits += static_cast<unsigned int>(grant);
+    }
+    releaseHeldForCredits();
+    // A grant on its own carries no message, and so takes no credit of ours
+    return root_message::open(root) == nullptr;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::messageConsumed(unsigned int count) {
+    unsigned int pending = _flowControl->pending_grant.fetch_add(count) + count;
+    // Usually grants ride along with outgoing messages, but a peer that only sends needs them sent on their own
+    if(pending >= _flowControl->grant_threshold)
+      sendGrant(_flowControl->pending_grant.exchange(0));
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::sendGrant(unsigned int credits) {
+    if(credits == 0)
+      return;
+    ProtoRootMsg grant;
+    grant.GetReflection()->MutableUnknownFields(&grant)->AddVarint(_flowControl->options.credit_field_number, credits);
+    std::string payload;
+    if(serializeRoot(grant, payload))
+      sendPayload(std::move(payload));
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::transportConnected() const {
     return _transport->isConnected();
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename MsgData>
-  void Crier<Transport, ProtoRootMsg>::sendMessage(const MsgData& data) {
+  bool Crier<Transport, ProtoRootMsg, Tracer>::sendMessage(const MsgData& data) {
     ProtoRootMsg req;
     packageIntoReq(req, data);
+    // Grants only ride along with messages going out right away. One waiting among the held messages would keep the peer
+    // from the very credits it needs to answer them, and both ends could end up waiting on each other.
+    bool credited = _flowControl && takeCredit();
+    unsigned int grant = credited ? attachGrant(req) : 0;
+
+    // Serialized into a buffer the thread keeps from one send to the next, so sending stops allocating once it has grown to fit.
+    // Payloads are only moved out of it when they have to wait (held, queued): a synchronous send hands the transport the buffer itself.
+    // A send made while it's in use (from within a transport's synchronous callback, say) gets a buffer of its own. Past 1MB, it isn't kept
+    static thread_local std::string thread_buffer;
+    static thread_local bool thread_buffer_in_use = false;
+    struct BufferLease {
+      bool held;
+      ~BufferLease() {
+        if(!held)
+          return;
+        if(thread_buffer.capacity() > 1024 * 1024)
+          std::string().swap(thread_buffer);
+        thread_buffer_in_use = false;
+      }
+    } lease{!thread_buffer_in_use};
+    std::string own_buffer;
+    std::string& payload = lease.held ? thread_buffer : own_buffer;
+    thread_buffer_in_use = true;
+    if(!serializeRoot(req, payload)) {
+      if(credited)
+        returnCredit(grant);
+      if(_metrics)
+        _metrics->outbound_dropped.add();
+      return false;
+    }
+    if(_metrics)
+      _metrics->messageOut(data.GetDescriptor(), payload.size());
+    bool sent = credited || !_flowControl ? sendPayload(std::move(payload)) : sendWithCredit(std::move(payload));
+    if(_metrics && !sent)
+      _metrics->outbound_dropped.add();
+    return sent;
+  }
 
-    if(_custom_serialization_fun) {
-      return _transport->sendData(_custom_serialization_fun(req));
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::serializeRoot(const ProtoRootMsg& root, std::string& out) {
+    RareState* rare = rareStateIfAllocated();
+    if(rare && rare->custom_serialization_into_buffer_fun) {
+      out.clear();
+      if(!rare->custom_serialization_into_buffer_fun(root, out)) {
+        logSerializationError();
+        return false;
+      }
+    } else if(rare && rare->custom_serialization_fun) {
+      out = rare->custom_serialization_fun(root);
     } else {
-      return _transport->sendData(req.SerializeAsString());
+      root.SerializeToString(&out);
     }
+    return true;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::sendPayload(std::string&& payload) {
+    if(_shuttingDown)
+      return false;
+    if(_reconnect) {
+      std::lock_guard<std::mutex> guard(_reconnect->mutex);
+      ReconnectState& reconnect = *_reconnect;
+      if(reconnect.enabled && !reconnect.online && !reconnect.user_disconnected) {
+        if(reconnect.held_bytes + payload.size() > reconnect.policy.outage_buffer_bytes) {
+          std::cout << "[CRIER] ERROR: Outage buffer is full, message was not sent" << std::endl;
+          return false;
+        }
+        reconnect.held_bytes += payload.size();
+        reconnect.held.push_back(std::move(payload));
+        return true;
+      }
+    }
+    if(_asyncSend)
+      return enqueuePayload(std::move(payload));
+    _transport->sendData(payload);
+    return true;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::reconnectAfterDisconnect() {
+    std::lock_guard<std::mutex> guard(_reconnect->mutex);
+    ReconnectState& reconnect = *_reconnect;
+    reconnect.online = false;
+    if(!reconnect.enabled || reconnect.user_disconnected || reconnect.stopping || reconnect.host.empty())
+      return false;
+
+    // Only the disconnect starting the outage is reported, not every failed attempt
+    bool already_reconnecting = reconnect.reconnecting;
+    if(reconnect.policy.max_attempts > 0 && reconnect.attempts >= reconnect.policy.max_attempts) {
+      std::cout << "[CRIER] ERROR: Giving up reconnecting after " << reconnect.attempts << " attempts, held messages were dropped" << std::endl;
+      reconnect.reconnecting = false;
+      reconnect.held.clear();
+      reconnect.held_bytes = 0;
+      return already_reconnecting;
+    }
+    reconnect.reconnecting = true;
+    scheduleReconnectLocked();
+    return already_reconnecting;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::scheduleReconnectLocked() {
+    ReconnectState& reconnect = *_reconnect;
+    const ReconnectPolicy& policy = reconnect.policy;
+    double delay = policy.initial_delay_ms;
+    for(unsigned int i = 0; i < reconnect.attempts && delay < policy.max_delay_ms; i++) {
+      delay *= policy.backoff_multiplier;
+    }
+    delay = std::min(delay, static_cast<double>(policy.max_delay_ms));
+    delay *= 1.0 - policy.jitter * std::uniform_real_distribution<double>(0.0, 1.0)(reconnect.rng);
+    auto milliseconds = static_cast<unsigned int>(delay);
+
+    reconnect.attempts++;
+    reconnect.attempt_scheduled = true;
+    reconnect.next_attempt = std::chrono::steady_clock::now() + std::chrono::milliseconds{milliseconds};
+    if(_loopBinding) {
+      auto binding = _loopBinding;
+      uint64_t generation = reconnect.generation;
+      binding->runAfter(milliseconds, [this, binding, generation]() {
+        std::lock_guard<std::mutex> guard(binding->mutex);
+        if(binding->alive)
+          attemptReconnect(generation);
+      });
+    } else {
+      reconnect.wakeup.notify_all();
+    }
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::attemptReconnect(uint64_t generation) {
+    std::string host;
+    unsigned int port;
+    {
+      std::lock_guard<std::mutex> guard(_reconnect->mutex);
+      if(!_reconnect->attempt_scheduled || _reconnect->generation != generation || _reconnect->stopping)
+        return;
+      _reconnect->attempt_scheduled = false;
+      host = _reconnect->host;
+      port = _reconnect->port;
+    }
+    _transport->connect(host, static_cast<int>(port));
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::reconnectLoop() {
+    std::unique_lock<std::mutex> lock(_reconnect->mutex);
+    while(!_reconnect->stopping) {
+      if(!_reconnect->attempt_scheduled) {
+        _reconnect->wakeup.wait(lock);
+      } else if(std::chrono::steady_clock::now() < _reconnect->next_attempt) {
+        _reconnect->wakeup.wait_until(lock, _reconnect->next_attempt);
+      } else {
+        uint64_t generation = _reconnect->generation;
+        lock.unlock();
+        attemptReconnect(generation);
+        lock.lock();
+      }
+    }
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::flushHeldMessages() {
+    // Messages sent while flushing are held as well, and go out in the next round, so they keep their order
+    while(true) {
+      std::vector<std::string> batch;
+      {
+        std::lock_guard<std::mutex> guard(_reconnect->mutex);
+        if(_reconnect->held.empty()) {
+          _reconnect->online = true;
+          _reconnect->reconnecting = false;
+          _reconnect->attempts = 0;
+          return;
+        }
+        batch.swap(_reconnect->held);
+        _reconnect->held_bytes = 0;
+      }
+      if(_asyncSend) {
+        // Past the watermark or not, held messages were already accepted
+        for(auto& payload : batch) {
+          pushPayload(std::move(payload));
+        }
+      } else {
+        transport_traits::sendDataBatch(*_transport, batch, 0);
+      }
+    }
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestHandle Crier<Transport, ProtoRootMsg, Tracer>::sendMessageWithRetCallback(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess) {
+    return submitRequest<ReqMsgData, RetMsgData>(data, onSuccess, false, 0, nullptr);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestHandle Crier<Transport, ProtoRootMsg, Tracer>::sendMessageWithRetCallbackAndTimeout(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess, unsigned int milliseconds_to_timeout, const std::function<void()>& onTimeout) {
+    return submitRequest<ReqMsgData, RetMsgData>(data, onSuccess, true, milliseconds_to_timeout, onTimeout);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  ResponseFuture<RetMsgData> Crier<Transport, ProtoRootMsg, Tracer>::sendRequest(const ReqMsgData& data, unsigned int milliseconds_to_timeout) {
+    auto state = std::make_shared<ResponseState<RetMsgData>>();
+    ResponsePromise<RetMsgData> promise(state);
+    RequestHandle handle = submitRequest<ReqMsgData, RetMsgData>(data, [promise](const RetMsgData& response){ promise.fulfill(response); },
+      milliseconds_to_timeout > 0, milliseconds_to_timeout, [promise](){ promise.timeOut(); }, [promise](){ promise.disconnect(); });
+    return ResponseFuture<RetMsgData>(state, handle);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestHandle Crier<Transport, ProtoRootMsg, Tracer>::sendMessageWithRetCallbackAndPolicy(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess,
+                                                                                    const RequestPolicy& policy, const std::function<void()>& onTimeout) {
+    return submitPolicyRequest<ReqMsgData, RetMsgData>(data, onSuccess, policy, onTimeout, nullptr);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestHandle Crier<Transport, ProtoRootMsg, Tracer>::submitPolicyRequest(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess, const RequestPolicy& policy,
+                                                                    const std::function<void()>& onTimeout, const std::function<void()>& onDisconnect) {
+    std::string req_type = ReqMsgData().GetDescriptor()->full_name();
+    auto request = std::make_shared<PolicyRequest>(policy, req_type, RetMsgData().GetDescriptor()->full_name(),
+      [onSuccess](google::protobuf::Message* received_msg){ onSuccess(*(dynamic_cast<RetMsgData*>(received_msg))); },
+      onTimeout, onDisconnect,
+      [this, data](){ sendMessage<ReqMsgData>(data); },
+      [this, req_type](uint64_t microseconds){
+        if(_metrics)
+          _metrics->request_latency.record(microseconds * 1000);
+        RareState& rare = rareState();
+        std::lock_guard<CrierMutex> guard(rare.mutex);
+        rare.requestLatencies[req_type].record(microseconds);
+      });
+
+    std::shared_ptr<RequestLimiter> limiter = _requestLimiter;
+    if(!limiter) {
+      startPolicyRequest(request);
+      return RequestHandle(request);
+    }
+    // A single slot for the request, however many attempts it takes
+    bool acquired = limiter->acquireOrEnqueue(req_type, [&]() {
+      return std::function<void()>([this, limiter, request]() {
+        if(request->holdSlot(std::make_shared<RequestSlot>(limiter, request->req_type)))
+          startPolicyRequest(request);
+      });
+    });
+    if(acquired && request->holdSlot(std::make_shared<RequestSlot>(limiter, req_type)))
+      startPolicyRequest(request);
+    return RequestHandle(request);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename ReqMsgData, typename RetMsgData>
-  void Crier<Transport, ProtoRootMsg>::sendMessageWithRetCallback(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess) {
+  ResponseFuture<RetMsgData> Crier<Transport, ProtoRootMsg, Tracer>::sendRequest(const ReqMsgData& data, const RequestPolicy& policy) {
+    auto state = std::make_shared<ResponseState<RetMsgData>>();
+    ResponsePromise<RetMsgData> promise(state);
+    RequestHandle handle = submitPolicyRequest<ReqMsgData, RetMsgData>(data, [promise](const RetMsgData& response){ promise.fulfill(response); },
+      policy, [promise](){ promise.timeOut(); }, [promise](){ promise.disconnect(); });
+    return ResponseFuture<RetMsgData>(state, handle);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::startPolicyRequest(const std::shared_ptr<PolicyRequest>& request) {
+    if(request->policy.hedge) {
+      std::weak_ptr<PolicyRequest> hedged = request;
+      scheduleTimeout(request->ret_type, hedgeDelay(*request), [this, hedged]() {
+        std::shared_ptr<PolicyRequest> request = hedged.lock();
+        if(request && request->takeHedge())
+          sendPolicyAttempt(request);
+      }, true);
+    }
+    sendPolicyAttempt(request);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::sendPolicyAttempt(const std::shared_ptr<PolicyRequest>& request) {
+    unsigned int attempt;
+    if(!request->beginAttempt(attempt))
+      return;
     {
-      std::lock_guard<std::mutex> guard(_callbackMapMutex);
-      _callbackMap[RetMsgData().GetDescriptor()->full_name()].emplace_back([onSuccess](google::protobuf::Message* received_msg){
-        onSuccess(*(dynamic_cast<RetMsgData*>(received_msg)));});
+      std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+      _callbackMap[request->ret_type].emplace_back(PolicyAttemptResponse{request, attempt});
+    }
+    scheduleTimeout(request->ret_type, request->policy.attempt_timeout_ms, [this, request, attempt]() {
+      policyAttemptTimedOut(request, attempt);
+    }, true);
+    request->send();
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::policyAttemptTimedOut(const std::shared_ptr<PolicyRequest>& request, unsigned int attempt) {
+    // Its callback being gone means a response got to it first
+    if(!dropPolicyAttempt(request->ret_type, request.get(), attempt))
+      return;
+    unsigned int retry_delay_ms = 0;
+    switch(request->attemptTimedOut(retry_delay_ms)) {
+      case PolicyRequest::AfterTimeout::Retry:
+        if(retry_delay_ms == 0)
+          sendPolicyAttempt(request);
+        else
+          scheduleTimeout(request->ret_type, retry_delay_ms, [this, request](){ sendPolicyAttempt(request); }, true);
+        break;
+      case PolicyRequest::AfterTimeout::Fail:
+        if(getInboundDispatchingForMsg(request->ret_type) == InboundDispatching::DispatchQueue)
+          callOnMainThread([request](){ request->fail(); });
+        else
+          request->fail();
+        break;
+      case PolicyRequest::AfterTimeout::Nothing:
+        break;
     }
-    return sendMessage<ReqMsgData>(data);
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::dropPolicyAttempt(const std::string& ret_type, const PolicyRequest* request, unsigned int attempt) {
+    std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+    auto& callbacks = _callbackMap[ret_type];
+    for(auto callback = callbacks.begin(); callback != callbacks.end(); ++callback) {
+      const PolicyAttemptResponse* attempt_response = callback->template target<PolicyAttemptResponse>();
+      if(attempt_response && attempt_response->request.get() == request && attempt_response->attempt == attempt) {
+        callbacks.erase(callback);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  unsigned int Crier<Transport, ProtoRootMsg, Tracer>::hedgeDelay(const PolicyRequest& request) {
+    uint64_t microseconds = 0;
+    bool known = false;
+    RareState* rare = rareStateIfAllocated();
+    if(rare) {
+      std::lock_guard<CrierMutex> guard(rare->mutex);
+      auto latencies = rare->requestLatencies.find(request.req_type);
+      known = latencies != rare->requestLatencies.end() && latencies->second.percentile(request.policy.hedge_percentile, microseconds);
+    }
+    if(!known)
+      return request.policy.hedge_delay_ms;
+    // Rounded up, so a fast peer isn't hedged against right away
+    return static_cast<unsigned int>(microseconds / 1000 + 1);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::isSelfManagedCallback(const std::function<void(google::protobuf::Message*)>& callback) {
+    return callback.template target<AwaitedResponse>() != nullptr || callback.template target<StreamedResponse>() != nullptr ||
+           callback.template target<PolicyAttemptResponse>() != nullptr;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename ReqMsgData, typename RetMsgData>
-  void Crier<Transport, ProtoRootMsg>::sendMessageWithRetCallbackAndTimeout(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess, unsigned int milliseconds_to_timeout, const std::function<void()>& onTimeout) {
-    scheduleTimeout(RetMsgData().GetDescriptor()->full_name(), milliseconds_to_timeout, onTimeout);
-    return sendMessageWithRetCallback<ReqMsgData, RetMsgData>(data, onSuccess);
+  StreamHandle Crier<Transport, ProtoRootMsg, Tracer>::sendStreamingRequest(const ReqMsgData& data, const std::function<bool(const RetMsgData&)>& onResponse,
+                                                                    const StreamOptions& options, const std::function<void(StreamEnd)>& onEnd) {
+    std::shared_ptr<StreamState> stream = std::make_shared<TypedStreamState<RetMsgData>>(onResponse, options, onEnd);
+    std::shared_ptr<RequestLimiter> limiter = _requestLimiter;
+    if(!limiter) {
+      issueStream<ReqMsgData, RetMsgData>(data, stream, nullptr);
+      return StreamHandle(stream);
+    }
+
+    std::string req_type = ReqMsgData().GetDescriptor()->full_name();
+    bool acquired = limiter->acquireOrEnqueue(req_type, [&]() {
+      auto queued = std::make_shared<QueuedStream>(QueuedStream{stream});
+      return std::function<void()>([this, limiter, req_type, data, queued]() {
+        std::shared_ptr<StreamState> issued;
+        issued.swap(queued->stream);
+        issueStream<ReqMsgData, RetMsgData>(data, issued, std::make_shared<RequestSlot>(limiter, req_type));
+      });
+    });
+    if(acquired)
+      issueStream<ReqMsgData, RetMsgData>(data, stream, std::make_shared<RequestSlot>(limiter, req_type));
+    return StreamHandle(stream);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  void Crier<Transport, ProtoRootMsg, Tracer>::issueStream(const ReqMsgData& data, const std::shared_ptr<StreamState>& stream, const std::shared_ptr<RequestSlot>& slot) {
+    std::string ret_type = RetMsgData().GetDescriptor()->full_name();
+    const StreamState* unregistered = stream.get();
+    // Cancelled while queued, never sent
+    if(!stream->setUnregister([this, ret_type, unregistered, slot](){
+        dropStream(ret_type, unregistered);
+        if(slot)
+          slot->release();
+      }))
+      return;
+    {
+      std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+      _callbackMap[ret_type].emplace_back(StreamedResponse{stream});
+    }
+    stream->touch();
+    if(stream->options().idle_timeout_ms > 0)
+      watchStreamIdle(ret_type, stream, stream->options().idle_timeout_ms);
+    sendMessage<ReqMsgData>(data);
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::scheduleTimeout(const std::string& ret_type, unsigned int milliseconds_to_timeout, const std::function<void()>& onTimeout) {
-    std::lock_guard<std::mutex> guard(_timeoutCallbackMapMutex);
-    _timeoutCallbackMap[ret_type].push_back(TimeoutData{_timeoutIds++, true, onTimeout});
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::watchStreamIdle(const std::string& ret_type, const std::weak_ptr<StreamState>& watched, unsigned int milliseconds) {
+    scheduleTimeout(ret_type, milliseconds, [this, ret_type, watched]() {
+      std::shared_ptr<StreamState> stream = watched.lock();
+      if(!stream || !stream->active())
+        return;
+      // A single timer per idle period, pushed back by whatever responses arrived meanwhile
+      unsigned int idle = stream->idleMilliseconds();
+      unsigned int idle_timeout = stream->options().idle_timeout_ms;
+      if(idle < idle_timeout) {
+        watchStreamIdle(ret_type, stream, idle_timeout - idle);
+        return;
+      }
+      if(getInboundDispatchingForMsg(ret_type) == InboundDispatching::DispatchQueue)
+        callOnMainThread([stream](){ stream->end(StreamEnd::IdleTimeout); });
+      else
+        stream->end(StreamEnd::IdleTimeout);
+    }, true);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::dropStream(const std::string& ret_type, const StreamState* stream) {
+    std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+    auto& callbacks = _callbackMap[ret_type];
+    for(auto callback = callbacks.begin(); callback != callbacks.end(); ++callback) {
+      const StreamedResponse* streamed = callback->template target<StreamedResponse>();
+      if(streamed && streamed->stream.get() == stream) {
+        callbacks.erase(callback);
+        return;
+      }
+    }
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::abandonStreams() {
+    std::vector<std::shared_ptr<StreamState>> streams;
+    {
+      std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+      for(const auto& callbacks : _callbackMap) {
+        for(const auto& callback : callbacks.second) {
+          const StreamedResponse* streamed = callback.template target<StreamedResponse>();
+          if(streamed)
+            streams.push_back(streamed->stream);
+        }
+      }
+    }
+    for(const auto& stream : streams) {
+      stream->end(StreamEnd::Abandoned);
+    }
+  }
+
+#ifdef CRIER_HAS_COROUTINES
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestAwaitable<Crier<Transport, ProtoRootMsg, Tracer>, ReqMsgData, RetMsgData> Crier<Transport, ProtoRootMsg, Tracer>::request(const ReqMsgData& data, unsigned int milliseconds_to_timeout, ResumeOn resume_on) {
+    return RequestAwaitable<Crier, ReqMsgData, RetMsgData>(*this, data, milliseconds_to_timeout, resume_on);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData, typename Executor, typename>
+  RequestAwaitable<Crier<Transport, ProtoRootMsg, Tracer>, ReqMsgData, RetMsgData> Crier<Transport, ProtoRootMsg, Tracer>::request(const ReqMsgData& data, unsigned int milliseconds_to_timeout, Executor& executor) {
+    return RequestAwaitable<Crier, ReqMsgData, RetMsgData>(*this, data, milliseconds_to_timeout, executor);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestAwaitable<Crier<Transport, ProtoRootMsg, Tracer>, ReqMsgData, RetMsgData> Crier<Transport, ProtoRootMsg, Tracer>::request(const ReqMsgData& data, unsigned int milliseconds_to_timeout,
+                                                                                                                        const CancellationToken& token, ResumeOn resume_on) {
+    return RequestAwaitable<Crier, ReqMsgData, RetMsgData>(*this, data, milliseconds_to_timeout, resume_on, &token);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData, typename Executor, typename>
+  RequestAwaitable<Crier<Transport, ProtoRootMsg, Tracer>, ReqMsgData, RetMsgData> Crier<Transport, ProtoRootMsg, Tracer>::request(const ReqMsgData& data, unsigned int milliseconds_to_timeout,
+                                                                                                                        const CancellationToken& token, Executor& executor) {
+    return RequestAwaitable<Crier, ReqMsgData, RetMsgData>(*this, data, milliseconds_to_timeout, executor, &token);
+  }
+#endif
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::registerAwaitedResponse(const std::string& ret_type, AwaitedRequest* request) {
+    std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+    // Checked under the lock dropAwaitedResponse takes, so a request claimed by its timeout is either dropped there or never registered
+    if(request->claimed())
+      return false;
+    _callbackMap[ret_type].emplace_back(AwaitedResponse{request});
+    return true;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::dropAwaitedResponse(const std::string& ret_type, const AwaitedRequest* request) {
+    std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+    auto& callbacks = _callbackMap[ret_type];
+    for(auto callback = callbacks.begin(); callback != callbacks.end(); ++callback) {
+      const AwaitedResponse* awaited = callback->template target<AwaitedResponse>();
+      if(awaited && awaited->request == request) {
+        callbacks.erase(callback);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestHandle Crier<Transport, ProtoRootMsg, Tracer>::submitRequest(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess, bool with_timeout,
+                                                              unsigned int milliseconds_to_timeout, const std::function<void()>& onTimeout,
+                                                              const std::function<void()>& onDisconnect) {
+    auto request = std::make_shared<PendingRequest<RetMsgData>>(onSuccess, onTimeout, onDisconnect);
+    std::shared_ptr<RequestLimiter> limiter = _requestLimiter;
+    if(!limiter) {
+      issueRequest<ReqMsgData, RetMsgData>(data, request, with_timeout, milliseconds_to_timeout, nullptr);
+      return RequestHandle(request);
+    }
+
+    std::string req_type = ReqMsgData().GetDescriptor()->full_name();
+    bool acquired = limiter->acquireOrEnqueue(req_type, [&]() {
+      // Only queued requests pay for the copy
+      return std::function<void()>([this, limiter, req_type, data, request, with_timeout, milliseconds_to_timeout]() {
+        issueRequest<ReqMsgData, RetMsgData>(data, request, with_timeout, milliseconds_to_timeout, std::make_shared<RequestSlot>(limiter, req_type));
+      });
+    });
+    if(acquired)
+      issueRequest<ReqMsgData, RetMsgData>(data, request, with_timeout, milliseconds_to_timeout, std::make_shared<RequestSlot>(limiter, req_type));
+    return RequestHandle(request);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData, typename RetMsgData>
+  void Crier<Transport, ProtoRootMsg, Tracer>::issueRequest(const ReqMsgData& data, const std::shared_ptr<PendingRequest<RetMsgData>>& request, bool with_timeout,
+                                                    unsigned int milliseconds_to_timeout, const std::shared_ptr<RequestSlot>& slot) {
+    // Cancelled while queued, never sent
+    if(slot ? !request->holdSlot(slot) : request->settled())
+      return;
+    std::string ret_type = RetMsgData().GetDescriptor()->full_name();
+    if(_metrics)
+      request->sent_at = std::chrono::steady_clock::now();
+    // A cancelled request keeps both its timeout and its response callback, as they're paired up in order with the other requests for the same type
+    if(with_timeout)
+      scheduleTimeout(ret_type, milliseconds_to_timeout, [request](){ request->timeOut(); });
+    {
+      std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+      // Stays registered if the request is cancelled, dropping its response instead of letting it answer the next request
+      _callbackMap[ret_type].emplace_back(PendingResponse{request});
+    }
+    sendMessage<ReqMsgData>(data);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::failPendingRequests() {
+    std::map<std::string, std::deque<std::function<void(google::protobuf::Message*)>>> pending;
+    {
+      // Both at once, so no timeout expiring meanwhile takes the response callback of a request sent after the disconnect
+      std::lock_guard<CrierMutex> timeouts_guard(_timeoutCallbackMapMutex);
+      std::lock_guard<CrierMutex> callbacks_guard(_callbackMapMutex);
+      pending.swap(_callbackMap);
+      // The other timeouts find their requests settled
+      for(auto& timeouts : _timeoutCallbackMap) {
+        for(auto& timeout : timeouts.second) {
+          if(!timeout.owned)
+            timeout.valid = false;
+        }
+      }
+    }
+
+    for(const auto& callbacks : pending) {
+      bool queued = getInboundDispatchingForMsg(callbacks.first) == InboundDispatching::DispatchQueue;
+      for(const auto& callback : callbacks.second) {
+        std::function<void()> fail;
+        if(const PendingResponse* response = callback.template target<PendingResponse>()) {
+          std::shared_ptr<PendingRequestBase> request = response->request;
+          fail = [request](){ request->fail(); };
+        } else if(const StreamedResponse* streamed = callback.template target<StreamedResponse>()) {
+          std::shared_ptr<StreamState> stream = streamed->stream;
+          fail = [stream](){ stream->end(StreamEnd::Disconnected); };
+        } else if(const PolicyAttemptResponse* attempt = callback.template target<PolicyAttemptResponse>()) {
+          std::shared_ptr<PolicyRequest> request = attempt->request;
+          fail = [request](){ request->disconnect(); };
+        } else if(const AwaitedResponse* awaited = callback.template target<AwaitedResponse>()) {
+          // Resumes its coroutine wherever it was set to
+          awaited->request->onDisconnect();
+        }
+        if(!fail)
+          continue;
+        if(queued)
+          callOnMainThread(fail);
+        else
+          fail();
+      }
+    }
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::setMaxRequestsInFlight(unsigned int max_in_flight) {
+    requestLimiter().setMaxInFlight(max_in_flight);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData>
+  void Crier<Transport, ProtoRootMsg, Tracer>::setMaxRequestsInFlightForMsg(unsigned int max_in_flight) {
+    requestLimiter().setMaxInFlightFor(ReqMsgData().GetDescriptor()->full_name(), max_in_flight);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  RequestQueueStats Crier<Transport, ProtoRootMsg, Tracer>::requestQueueStats() const {
+    return _requestLimiter ? _requestLimiter->stats() : RequestQueueStats();
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename ReqMsgData>
+  size_t Crier<Transport, ProtoRootMsg, Tracer>::queuedRequestsForMsg() const {
+    return _requestLimiter ? _requestLimiter->queuedFor(ReqMsgData().GetDescriptor()->full_name()) : 0;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::enableMetrics() {
+    if(_metrics)
+      return;
+    _metrics.reset(new MetricsRegistry());
+    _callbackMapMutex.instrument(_metrics->lockCounters("callbackMap"));
+    _permanentObserverMapMutex.instrument(_metrics->lockCounters("permanentObserverMap"));
+    _timeoutCallbackMapMutex.instrument(_metrics->lockCounters("timeoutCallbackMap"));
+    _transportObserverMapsMutex.instrument(_metrics->lockCounters("transportObserverMaps"));
+    _mainThreadCallbacksMapMutex.instrument(_metrics->lockCounters("mainThreadCallbacksMap"));
+    RareState* rare = rareStateIfAllocated();
+    if(rare)
+      rare->mutex.instrument(_metrics->lockCounters("rareState"));
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  MetricsSnapshot Crier<Transport, ProtoRootMsg, Tracer>::metricsSnapshot() const {
+    return _metrics ? _metrics->snapshot() : MetricsSnapshot();
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::enableCallbackAccounting() {
+    if(!_callbackAccounting)
+      _callbackAccounting.reset(new CallbackAccounting());
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::setSlowCallbackThreshold(unsigned int microseconds, const std::function<void(const SlowCallback&)>& onSlowCallback) {
+    enableCallbackAccounting();
+    _callbackAccounting->setSlowThreshold(std::chrono::microseconds{microseconds}, onSlowCallback);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  std::vector<CallbackStats> Crier<Transport, ProtoRootMsg, Tracer>::mostExpensiveCallbacks(size_t count) const {
+    return _callbackAccounting ? _callbackAccounting->mostExpensive(count) : std::vector<CallbackStats>();
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  Tracer& Crier<Transport, ProtoRootMsg, Tracer>::tracer() {
+    return _tracer;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  RequestLimiter& Crier<Transport, ProtoRootMsg, Tracer>::requestLimiter() {
+    // Set up before any limited request is sent, like the rest of the instance's configuration
+    if(!_requestLimiter)
+      _requestLimiter = std::make_shared<RequestLimiter>();
+    return *_requestLimiter;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  unsigned int Crier<Transport, ProtoRootMsg, Tracer>::scheduleTimeout(const std::string& ret_type, unsigned int milliseconds_to_timeout, const std::function<void()>& onTimeout, bool owned) {
+    std::lock_guard<CrierMutex> guard(_timeoutCallbackMapMutex);
+    unsigned int timeout_id = _timeoutIds++;
+    // Past invalidateAllTimeouts in the destructor, nothing would ever join or cancel it
+    if(_shuttingDown)
+      return timeout_id;
+    _timeoutCallbackMap[ret_type].push_back(TimeoutData{timeout_id, true, onTimeout, owned});
     auto async_timeout_pointer = --_timeoutCallbackMap[ret_type].end();
 
+    if(_loopBinding) {
+      auto binding = _loopBinding;
+      async_timeout_pointer->timer = binding->runAfter(milliseconds_to_timeout, [this, binding, ret_type, async_timeout_pointer]() {
+        std::lock_guard<std::mutex> guard(binding->mutex);
+        if(binding->alive)
+          expireTimeout(ret_type, async_timeout_pointer);
+      });
+      return timeout_id;
+    }
+
     std::thread timeout([this, ret_type, async_timeout_pointer, milliseconds_to_timeout]() {
       std::this_thread::sleep_for(std::chrono::milliseconds{milliseconds_to_timeout});
+      expireTimeout(ret_type, async_timeout_pointer);
+    });
+    _launchedThreads.push_back(std::move(timeout));
+    return timeout_id;
+  }
 
-      bool valid;
-      std::function<void()> callback;
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::expireTimeout(const std::string& ret_type, typename TimeoutList::iterator async_timeout_pointer) {
+    bool valid;
+    bool owned;
+    std::function<void()> callback;
+    {
+      std::lock_guard<CrierMutex> guard(_timeoutCallbackMapMutex);
+      valid = async_timeout_pointer->valid;
+      owned = async_timeout_pointer->owned;
+      if(valid && !owned)
       {
-        std::lock_guard<std::mutex> guard(_timeoutCallbackMapMutex);
-        valid = async_timeout_pointer->valid;
-        if(valid)
         {
-          {
-            std::lock_guard<std::mutex> guard(this->_callbackMapMutex);
-            // TODO: This is still wrong: if two requests are made for the same type and the second has a smaller timeout and it expires,
-            // then the first callback will be removed and the second callback can be called upon the arrival of the first response
-            if(this->_callbackMap[ret_type].size() > 0) {
-              this->_callbackMap[ret_type].pop_front();
-            }
+          std::lock_guard<CrierMutex> guard(this->_callbackMapMutex);
+          // TODO: This is still wrong: if two requests are made for the same type and the second has a smaller timeout and it expires,
+          // then the first callback will be removed and the second callback can be called upon the arrival of the first response
+          // Awaited requests, streams and policy requests drop their own callbacks
+          auto& callbacks = this->_callbackMap[ret_type];
+          auto callback = std::find_if(callbacks.begin(), callbacks.end(), [](const std::function<void(google::protobuf::Message*)>& registered){
+            return !isSelfManagedCallback(registered); });
+          if(callback != callbacks.end()) {
+            callbacks.erase(callback);
           }
-          callback = async_timeout_pointer->callback;
         }
-        async_timeout_pointer->valid = false;
-        auto timeoutId = async_timeout_pointer->id;
-        this->_timeoutCallbackMap[ret_type].remove_if([timeoutId](const TimeoutData& elem){ return elem.id == timeoutId; });
       }
+      if(valid)
+        callback = async_timeout_pointer->callback;
+      async_timeout_pointer->valid = false;
+      auto timeoutId = async_timeout_pointer->id;
+      this->_timeoutCallbackMap[ret_type].remove_if([timeoutId](const TimeoutData& elem){ return elem.id == timeoutId; });
+    }
 
-      if(valid) {
-        InboundDispatching behaviour = _default_inbound_dispatch;
-        {
-          std::lock_guard<std::mutex> guard(_inboundDispatchSettingsMutex);
-          if(_inboundDispatchSettings.find(ret_type) != _inboundDispatchSettings.end()){
-            behaviour = _inboundDispatchSettings[ret_type];
-          }
-        }
-        if(behaviour == InboundDispatching::DispatchQueue)
-          callOnMainThread(callback);
-        else
-          callback();
-      }
-    });
-    _launchedThreads.push_back(std::move(timeout));
+    if(valid && owned) {
+      callback();
+    } else if(valid) {
+      InboundDispatching behaviour = getInboundDispatchingForMsg(ret_type);
+      if(behaviour == InboundDispatching::DispatchQueue)
+        callOnMainThread(callback);
+      else
+        callback();
+    }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::invalidateFirstTimeout(const std::string& ret_type) {
-    std::lock_guard<std::mutex> guard(_timeoutCallbackMapMutex);
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::invalidateFirstTimeout(const std::string& ret_type) {
+    {
+      std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+      // Responses going to an awaited request, a stream or a policy request aren't the reply a plain request's timeout waits on
+      const auto& callbacks = _callbackMap[ret_type];
+      if(callbacks.size() > 0 && isSelfManagedCallback(callbacks.front()))
+        return;
+    }
+    std::lock_guard<CrierMutex> guard(_timeoutCallbackMapMutex);
 
-    for(auto& timeout_pair : _timeoutCallbackMap[ret_type])
+    auto& timeouts = _timeoutCallbackMap[ret_type];
+    for(auto timeout_pair = timeouts.begin(); timeout_pair != timeouts.end(); ++timeout_pair)
     {
-      if(timeout_pair.valid == true)
+      if(timeout_pair->valid == true && !timeout_pair->owned)
       {
-        timeout_pair.valid = false;
+        timeout_pair->valid = false;
+        retireTimeout(timeouts, timeout_pair);
         break;
       }
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::invalidateAllTimeoutsForMsg(const std::string& ret_type) {
-    std::lock_guard<std::mutex> guard(_timeoutCallbackMapMutex);
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  bool Crier<Transport, ProtoRootMsg, Tracer>::claimTimeout(const std::string& ret_type, unsigned int timeout_id) {
+    std::lock_guard<CrierMutex> guard(_timeoutCallbackMapMutex);
+    auto& timeouts = _timeoutCallbackMap[ret_type];
+    for(auto timeout_pair = timeouts.begin(); timeout_pair != timeouts.end(); ++timeout_pair)
+    {
+      if(timeout_pair->id == timeout_id)
+      {
+        bool was_valid = timeout_pair->valid;
+        timeout_pair->valid = false;
+        retireTimeout(timeouts, timeout_pair);
+        return was_valid;
+      }
+    }
+    return false;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::retireTimeout(TimeoutList& timeouts, typename TimeoutList::iterator timeout) {
+    // On a reactor, an invalidated timeout's timer comes off the loop rather than holding on to its callback until due.
+    // Timeout threads hold on to their entry, which stays until they wake up
+    if(_loopBinding && timeout->timer != 0 && _loopBinding->cancelTimer(timeout->timer))
+      timeouts.erase(timeout);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::invalidateAllTimeoutsForMsg(const std::string& ret_type) {
+    std::lock_guard<CrierMutex> guard(_timeoutCallbackMapMutex);
 
     for(auto& timeout_pair : _timeoutCallbackMap[ret_type])
     {
@@ -164,9 +1198,9 @@ namespace crier {
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::invalidateAllTimeouts() {
-    std::lock_guard<std::mutex> guard(_timeoutCallbackMapMutex);
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::invalidateAllTimeouts() {
+    std::lock_guard<CrierMutex> guard(_timeoutCallbackMapMutex);
 
     for(auto& timeout_key_val : _timeoutCallbackMap)
     {
@@ -177,75 +1211,95 @@ namespace crier {
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename Msg>
-  void Crier<Transport, ProtoRootMsg>::setUnhandledBehaviourForMsg(UnhandledMessageBehaviour behaviour) {
+  void Crier<Transport, ProtoRootMsg, Tracer>::setUnhandledBehaviourForMsg(UnhandledMessageBehaviour behaviour) {
     std::string ret_type = Msg().GetDescriptor()->full_name();
-    std::lock_guard<std::mutex> guardBehaviour(_unhandledBehaviourSettingsMutex);
-    _unhandledBehaviourSettings[ret_type] = behaviour;
-
-    if (behaviour == UnhandledMessageBehaviour::Ignore) {
-      std::lock_guard<std::mutex> guardQueue(_unhandledMessageQueueMutex);
-      _unhandledMessageQueue[ret_type].clear();
+    RareState& rare = rareState();
+    size_t dropped = 0;
+    {
+      std::lock_guard<CrierMutex> guard(rare.mutex);
+      rare.unhandledBehaviourSettings[ret_type] = behaviour;
+
+      if (behaviour == UnhandledMessageBehaviour::Ignore) {
+        auto queue = rare.unhandledMessageQueue.find(ret_type);
+        if(queue != rare.unhandledMessageQueue.end()) {
+          dropped = queue->second.size();
+          rare.unhandledMessageQueue.erase(queue);
+        }
+      }
     }
+    if(_metrics && dropped > 0) {
+      _metrics->unhandled_queue_dropped.add(dropped);
+      _metrics->unhandledUnqueued(dropped);
+    }
+    // Dropped messages are done with, as far as the peer's credits go
+    if(_flowControl && dropped > 0)
+      messageConsumed(static_cast<unsigned int>(dropped));
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename Msg>
-  void Crier<Transport, ProtoRootMsg>::setUnhandledBehaviourForMsgToDefault() {
+  void Crier<Transport, ProtoRootMsg, Tracer>::setUnhandledBehaviourForMsgToDefault() {
     setUnhandledBehaviourForMsg<Msg>(_default_unhandled_behaviour);
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename Msg>
-  void Crier<Transport, ProtoRootMsg>::setInboundDispatchingForMsg(InboundDispatching behaviour) {
+  void Crier<Transport, ProtoRootMsg, Tracer>::setInboundDispatchingForMsg(InboundDispatching behaviour) {
     std::string ret_type = Msg().GetDescriptor()->full_name();
-    std::lock_guard<std::mutex> guardBehaviour(_inboundDispatchSettingsMutex);
-    _inboundDispatchSettings[ret_type] = behaviour;
+    RareState& rare = rareState();
+    std::lock_guard<CrierMutex> guard(rare.mutex);
+    rare.inboundDispatchSettings[ret_type] = behaviour;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename Msg>
-  void Crier<Transport, ProtoRootMsg>::setInboundDispatchingForMsgToDefault() {
+  void Crier<Transport, ProtoRootMsg, Tracer>::setInboundDispatchingForMsgToDefault() {
     setInboundDispatchingForMsg<Msg>(_default_inbound_dispatch);
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::setInboundDispatchingForTransportOpen(InboundDispatching behaviour) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::setInboundDispatchingForTransportOpen(InboundDispatching behaviour) {
     _inboundDispatchTransportOpenSetting = behaviour;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::setInboundDispatchingForTransportClosed(InboundDispatching behaviour) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::setInboundDispatchingForTransportClosed(InboundDispatching behaviour) {
     _inboundDispatchTransportErrorSetting = behaviour;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::setInboundDispatchingForTransportOpenToDefault() {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::setInboundDispatchingForTransportOpenToDefault() {
     _inboundDispatchTransportOpenSetting = _default_inbound_dispatch;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::setInboundDispatchingForTransportClosedToDefault() {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::setInboundDispatchingForTransportClosedToDefault() {
     _inboundDispatchTransportErrorSetting = _default_inbound_dispatch;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  InboundDispatching Crier<Transport, ProtoRootMsg>::getInboundDispatchingForMsg(const std::string& type) {
-    std::lock_guard<std::mutex> guard(_inboundDispatchSettingsMutex);
-    if(_inboundDispatchSettings.find(type) != _inboundDispatchSettings.end()){
-      return _inboundDispatchSettings[type];
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  InboundDispatching Crier<Transport, ProtoRootMsg, Tracer>::getInboundDispatchingForMsg(const std::string& type) {
+    RareState* rare = rareStateIfAllocated();
+    if(rare) {
+      std::lock_guard<CrierMutex> guard(rare->mutex);
+      auto setting = rare->inboundDispatchSettings.find(type);
+      if(setting != rare->inboundDispatchSettings.end())
+        return setting->second;
     }
     return _default_inbound_dispatch;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::dispatchQueuedCallbacks() {
-    std::deque<std::function<void()>> mainThreadCallbacksAux;
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::dispatchQueuedCallbacks() {
+    std::vector<std::function<void()>> mainThreadCallbacksAux;
     {
-      std::lock_guard<std::mutex> guard(_mainThreadCallbacksMapMutex);
+      std::lock_guard<CrierMutex> guard(_mainThreadCallbacksMapMutex);
       mainThreadCallbacksAux = std::move(_mainThreadCallbacksMap);
       _mainThreadCallbacksMap.clear();
+      if(_metrics)
+        _metrics->dispatchDepth(0);
     }
     for(const auto& callback : mainThreadCallbacksAux)
     {
@@ -253,20 +1307,23 @@ namespace crier {
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename Msg>
-  void Crier<Transport, ProtoRootMsg>::clearCallbacksForMsg() {
+  void Crier<Transport, ProtoRootMsg, Tracer>::clearCallbacksForMsg() {
     std::string ret_type = Msg().GetDescriptor()->full_name();
-    std::lock_guard<std::mutex> guard(_callbackMapMutex);
-    _callbackMap[ret_type].clear();
+    std::lock_guard<CrierMutex> guard(_callbackMapMutex);
+    // Awaited and policy requests are left to their response or timeout, their coroutines would never resume otherwise, and streams to their handles
+    auto& callbacks = _callbackMap[ret_type];
+    callbacks.erase(std::remove_if(callbacks.begin(), callbacks.end(), [](const std::function<void(google::protobuf::Message*)>& registered){
+      return !isSelfManagedCallback(registered); }), callbacks.end());
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename RetMsgData, CallbackPriority priority>
-  void Crier<Transport, ProtoRootMsg>::registerPermanentCallback(const std::string &key, const std::function<void(const RetMsgData&)>& onSuccess) {
+  void Crier<Transport, ProtoRootMsg, Tracer>::registerPermanentCallback(const std::string &key, const std::function<void(const RetMsgData&)>& onSuccess) {
     std::string ret_type = RetMsgData().GetDescriptor()->full_name();
     {
-      std::lock_guard<std::mutex> guard(_permanentObserverMapMutex);
+      std::lock_guard<CrierMutex> guard(_permanentObserverMapMutex);
       _permanentObserverMap[ret_type][{key, priority}] = [onSuccess](google::protobuf::Message* received_msg){
         onSuccess(*(dynamic_cast<RetMsgData*>(received_msg)));};
     }
@@ -274,77 +1331,129 @@ namespace crier {
     treatQueuedMessagesForType(ret_type);
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename RetMsgData, CallbackPriority priority>
-  void Crier<Transport, ProtoRootMsg>::clearPermanentCallback(const std::string &key){
+  void Crier<Transport, ProtoRootMsg, Tracer>::clearPermanentCallback(const std::string &key){
     std::string ret_type = RetMsgData().GetDescriptor()->full_name();
-    std::lock_guard<std::mutex> guard(_permanentObserverMapMutex);
+    std::lock_guard<CrierMutex> guard(_permanentObserverMapMutex);
     _permanentObserverMap[ret_type].erase({key, priority});
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <CallbackPriority priority>
-  void Crier<Transport, ProtoRootMsg>::registerForTransportClosedCallback(const std::string &key, const std::function<void(const std::string&)>& onDisconnect) {
-    std::lock_guard<std::mutex> guard(_transportClosedObserverMapMutex);
+  void Crier<Transport, ProtoRootMsg, Tracer>::registerForTransportClosedCallback(const std::string &key, const std::function<void(const std::string&)>& onDisconnect) {
+    std::lock_guard<CrierMutex> guard(_transportObserverMapsMutex);
     _transportClosedObserverMap[{key, priority}] = onDisconnect;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <CallbackPriority priority>
-  void Crier<Transport, ProtoRootMsg>::clearTransportClosedCallback(const std::string &key) {
-    std::lock_guard<std::mutex> guard(_transportClosedObserverMapMutex);
+  void Crier<Transport, ProtoRootMsg, Tracer>::clearTransportClosedCallback(const std::string &key) {
+    std::lock_guard<CrierMutex> guard(_transportObserverMapsMutex);
     _transportClosedObserverMap.erase({key, priority});
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <CallbackPriority priority>
-  void Crier<Transport, ProtoRootMsg>::registerForTransportOpenedCallback(const std::string &key, const std::function<void()>& onConnect) {
-    std::lock_guard<std::mutex> guard(_transportOpenedObserverMapMutex);
+  void Crier<Transport, ProtoRootMsg, Tracer>::registerForTransportOpenedCallback(const std::string &key, const std::function<void()>& onConnect) {
+    std::lock_guard<CrierMutex> guard(_transportObserverMapsMutex);
     _transportOpenedObserverMap[{key, priority}] = onConnect;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <CallbackPriority priority>
-  void Crier<Transport, ProtoRootMsg>::clearTransportOpenedCallback(const std::string &key) {
-    std::lock_guard<std::mutex> guard(_transportOpenedObserverMapMutex);
+  void Crier<Transport, ProtoRootMsg, Tracer>::clearTransportOpenedCallback(const std::string &key) {
+    std::lock_guard<CrierMutex> guard(_transportObserverMapsMutex);
     _transportOpenedObserverMap.erase({key, priority});
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename Msg>
-  void Crier<Transport, ProtoRootMsg>::supressTransportClosedAfterMsgOfType() {
+  void Crier<Transport, ProtoRootMsg, Tracer>::supressTransportClosedAfterMsgOfType() {
     std::string ret_type = Msg().GetDescriptor()->full_name();
-    _transportClosedSupressors[ret_type] = true;
+    rareState().transportClosedSupressors[ret_type] = true;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::clearSupressionTransportClosed() {
-    _transportClosedSupressors.clear();
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::clearSupressionTransportClosed() {
+    RareState* rare = rareStateIfAllocated();
+    if(rare)
+      rare->transportClosedSupressors.clear();
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::unhandledMessage(const ProtoRootMsg& r, const std::string& type, UnhandledMessageBehaviour behaviour) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::unhandledMessage(const ProtoRootMsg& r, const std::string& type, UnhandledMessageBehaviour behaviour) {
     if(behaviour == UnhandledMessageBehaviour::Ignore) {
-      // Do nothing
+      if(_metrics)
+        _metrics->unhandled_ignored.add();
     }
     else if(behaviour == UnhandledMessageBehaviour::Enqueue){
-      std::lock_guard<std::mutex> guard(_unhandledMessageQueueMutex);
-      _unhandledMessageQueue[type].push_back(r); // TODO NEEDS DEEP COPY
+      RareState& rare = rareState();
+      std::lock_guard<CrierMutex> guard(rare.mutex);
+      rare.unhandledMessageQueue[type].push_back(r); // TODO NEEDS DEEP COPY
+      if(_metrics)
+        _metrics->unhandledQueued();
+    }
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::callOnMainThread(const std::function<void()>& callback, const char* trace_type) {
+    TraceScope<Tracer> span(_tracer, TracePhase::Enqueue, trace_type);
+    if(Tracer::enabled) {
+      std::string type = trace_type;
+      pushMainThreadCallback([this, type, callback](){
+        TraceScope<Tracer> dequeue_span(_tracer, TracePhase::Dequeue, type.c_str());
+        callback();
+      });
+    } else {
+      pushMainThreadCallback(callback);
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::callOnMainThread(const std::function<void()>& callback) {
-    std::lock_guard<std::mutex> guard(_mainThreadCallbacksMapMutex);
-    _mainThreadCallbacksMap.push_back(callback);
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::pushMainThreadCallback(const std::function<void()>& callback) {
+    bool post_drain = false;
+    {
+      std::lock_guard<CrierMutex> guard(_mainThreadCallbacksMapMutex);
+      if(_metrics) {
+        MetricsRegistry* metrics = _metrics.get();
+        auto queued_at = std::chrono::steady_clock::now();
+        _mainThreadCallbacksMap.push_back([metrics, queued_at, callback](){
+          metrics->dispatch_queue_time.recordSince(queued_at);
+          callback();
+        });
+        metrics->dispatchDepth(_mainThreadCallbacksMap.size());
+      } else {
+        _mainThreadCallbacksMap.push_back(callback);
+      }
+      // A single drain is posted for however many callbacks queue up before it gets to run
+      if(_loopBinding && _loopBinding->drainDispatchQueue && !_loopBinding->drainPosted) {
+        _loopBinding->drainPosted = true;
+        post_drain = true;
+      }
+    }
+    if(post_drain) {
+      auto binding = _loopBinding;
+      binding->post([this, binding]() {
+        std::lock_guard<std::mutex> guard(binding->mutex);
+        if(!binding->alive)
+          return;
+        {
+          std::lock_guard<CrierMutex> queue_guard(_mainThreadCallbacksMapMutex);
+          binding->drainPosted = false;
+        }
+        dispatchQueuedCallbacks();
+      });
+    }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::receiveMessage(const ProtoRootMsg& r, google::protobuf::Message* received_msg) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::receiveMessage(const ProtoRootMsg& r, google::protobuf::Message* received_msg) {
     std::string type = received_msg->GetDescriptor()->full_name();
     invalidateFirstTimeout(type);
 
-    if(_transportClosedSupressors[type])
+    RareState* rare = rareStateIfAllocated();
+    if(rare && rare->transportClosedSupressors.count(type))
       _supressNextTransportClosed = true;
 
     // Get the threading behaviour for this message, to define where it should be called on (main thread, or helper thread)
@@ -358,22 +1467,35 @@ namespace crier {
         auto req_data = openReq(r);
         if(req_data != nullptr)
           triggerCallbacksForMsg(r, req_data);
-      });
+      }, type.c_str());
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::triggerCallbacksForMsg(const ProtoRootMsg& r, google::protobuf::Message* received_msg) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::triggerCallbacksForMsg(const ProtoRootMsg& r, google::protobuf::Message* received_msg) {
     std::string type = received_msg->GetDescriptor()->full_name();
     bool no_callbacks = true;
+    std::chrono::steady_clock::time_point callbacks_start;
+    if(_metrics)
+      callbacks_start = std::chrono::steady_clock::now();
     /// Call all Permanent callbacks
     std::vector<std::function<void(google::protobuf::Message*)>> permanentObserverList;
+    // Only gathered when tracing or accounting callbacks, to tell them apart
+    std::vector<std::string> permanentObserverKeys;
     {
-      std::lock_guard<std::mutex> guard(_permanentObserverMapMutex);
-      permanentObserverList = mapToVectorCopy(_permanentObserverMap[type]);
+      std::lock_guard<CrierMutex> guard(_permanentObserverMapMutex);
+      const auto& observers = _permanentObserverMap[type];
+      permanentObserverList = mapToVectorCopy(observers);
+      if(Tracer::enabled || _callbackAccounting) {
+        for(const auto& observer : observers) {
+          permanentObserverKeys.push_back(observer.first.first);
+        }
+      }
     }
-    for (const auto& permObserver : permanentObserverList) {
-      permObserver(received_msg);
+    for (size_t i = 0; i < permanentObserverList.size(); i++) {
+      TraceScope<Tracer> span(_tracer, TracePhase::Callback, type.c_str(), Tracer::enabled ? permanentObserverKeys[i].c_str() : "");
+      CallbackAccounting::Scope accounted(_callbackAccounting.get(), type, _callbackAccounting ? permanentObserverKeys[i] : CallbackAccounting::responseKey());
+      permanentObserverList[i](received_msg);
 
       no_callbacks = false;
     }
@@ -382,114 +1504,152 @@ namespace crier {
     _callbackMapMutex.lock();
     // This has some unexpected behaviour: if there are two requests made in succession, the first without a callback and the second with a callback,
     // then the calback will be used for the first request and not for the second
-    if(_callbackMap[type].size() > 0) {
-      auto callback = _callbackMap[type].front();
-      _callbackMap[type].pop_front();
+    auto& callbacks = _callbackMap[type];
+    // Streams stay registered for as long as they last, the ones that just ended are cleared out here
+    while(callbacks.size() > 0 && callbacks.front().template target<StreamedResponse>() && !callbacks.front().template target<StreamedResponse>()->stream->active()) {
+      callbacks.pop_front();
+    }
+    if(callbacks.size() > 0 && callbacks.front().template target<StreamedResponse>()) {
+      std::shared_ptr<StreamState> stream = callbacks.front().template target<StreamedResponse>()->stream;
+      _callbackMapMutex.unlock();     // UNLOCK _callbackMapMutex
+      TraceScope<Tracer> span(_tracer, TracePhase::Callback, type.c_str());
+      CallbackAccounting::Scope accounted(_callbackAccounting.get(), type, CallbackAccounting::responseKey());
+      stream->deliver(received_msg);
+      no_callbacks = false;
+    } else if(callbacks.size() > 0) {
+      auto callback = callbacks.front();
+      callbacks.pop_front();
       _callbackMapMutex.unlock();     // UNLOCK _callbackMapMutex
+      if(_metrics) {
+        const PendingResponse* response = callback.template target<PendingResponse>();
+        if(response && !response->request->settled())
+          _metrics->request_latency.recordSince(response->request->sent_at);
+      }
+      TraceScope<Tracer> span(_tracer, TracePhase::Callback, type.c_str());
+      CallbackAccounting::Scope accounted(_callbackAccounting.get(), type, CallbackAccounting::responseKey());
       callback(received_msg);
       no_callbacks = false;
     } else {
       _callbackMapMutex.unlock();
     }
 
-    if(no_callbacks) {
-      dealWithUnhandledMessage(r, type);
-    }
+    if(_metrics && !no_callbacks)
+      _metrics->callback_time.recordSince(callbacks_start);
+    // Enqueued messages are only done with once dispatched out of the queue
+    if(no_callbacks && dealWithUnhandledMessage(r, type) == UnhandledMessageBehaviour::Enqueue)
+      return;
+    if(_flowControl)
+      messageConsumed();
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::dealWithUnhandledMessage(const ProtoRootMsg& r, const std::string& type) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  UnhandledMessageBehaviour Crier<Transport, ProtoRootMsg, Tracer>::dealWithUnhandledMessage(const ProtoRootMsg& r, const std::string& type) {
     UnhandledMessageBehaviour unhandled_behaviour = _default_unhandled_behaviour;
-    {
-      std::lock_guard<std::mutex> guard(_unhandledBehaviourSettingsMutex);
-      if(_unhandledBehaviourSettings.find(type) != _unhandledBehaviourSettings.end()) {
-        unhandled_behaviour = _unhandledBehaviourSettings[type];
-      }
+    RareState* rare = rareStateIfAllocated();
+    if(rare) {
+      std::lock_guard<CrierMutex> guard(rare->mutex);
+      auto setting = rare->unhandledBehaviourSettings.find(type);
+      if(setting != rare->unhandledBehaviourSettings.end())
+        unhandled_behaviour = setting->second;
     }
     unhandledMessage(r, type, unhandled_behaviour);
+    return unhandled_behaviour;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::OnTransportData(const std::string& data) {
-    ProtoRootMsg container_msg;
-
-    if(_custom_deserialization_fun) {
-      container_msg = _custom_deserialization_fun(data);
-    } else {
-      container_msg.ParseFromString(data);
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::OnTransportData(const std::string& data) {
+    RareState* rare = rareStateIfAllocated();
+    if(rare && rare->custom_deserialization_fun && !rare->custom_inplace_deserialization_fun) {
+      std::chrono::steady_clock::time_point parse_start;
+      if(_metrics)
+        parse_start = std::chrono::steady_clock::now();
+      // Initialize straight from the returned message, so at least the assignment copy is elided
+      const ProtoRootMsg container_msg = [this, &rare, &data](){
+        TraceScope<Tracer> span(_tracer, TracePhase::Parse);
+        return rare->custom_deserialization_fun(data);
+      }();
+      if(_metrics)
+        _metrics->parse_time.recordSince(parse_start);
+      return receiveContainer(container_msg, data.size());
     }
-
-    google::protobuf::Message* msg_data = openReq(container_msg);
-    if(msg_data != nullptr)
-      receiveMessage(container_msg, msg_data);
+    OnTransportData(data.data(), data.size());
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  google::protobuf::Message* Crier<Transport, ProtoRootMsg>::openReq(const ProtoRootMsg& r) {
-
-    const google::protobuf::Reflection *refl = r.GetReflection();
-
-    std::vector< const google::protobuf::FieldDescriptor *> pOut;
-
-    refl->ListFields( r, &pOut );
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::OnTransportData(const char* data, size_t size) {
+    ProtoRootMsg container_msg;
+    std::chrono::steady_clock::time_point parse_start;
+    if(_metrics)
+      parse_start = std::chrono::steady_clock::now();
 
-    for( auto const &field : pOut )
     {
-      if( field == nullptr ) { continue; };
-
-      google::protobuf::Message* msgPointer = refl->MutableMessage((google::protobuf::Message*)&r, field);
-      return msgPointer;
+      TraceScope<Tracer> span(_tracer, TracePhase::Parse);
+      RareState* rare = rareStateIfAllocated();
+      if(rare && rare->custom_inplace_deserialization_fun) {
+        if(!rare->custom_inplace_deserialization_fun(data, size, container_msg)) {
+          logDeserializationError();
+          if(_metrics)
+            _metrics->inbound_dropped.add();
+          return;
+        }
+      } else if(rare && rare->custom_deserialization_fun) {
+        container_msg = rare->custom_deserialization_fun(std::string(data, size));
+      } else {
+        container_msg.ParseFromArray(data, static_cast<int>(size));
+      }
     }
+    if(_metrics)
+      _metrics->parse_time.recordSince(parse_start);
 
-    logEmptyMessageError();
-    return nullptr;
+    receiveContainer(container_msg, size);
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  template <typename MsgData>
-  void Crier<Transport, ProtoRootMsg>::packageIntoReq(ProtoRootMsg& req, const MsgData& data) {
-
-    const google::protobuf::Descriptor* data_desc	= data.GetDescriptor();
-    const google::protobuf::Descriptor* req_desc	= req.GetDescriptor();
-    const google::protobuf::Reflection* req_refl	= req.GetReflection();
-
-    int fieldCount = req_desc->field_count();
-    for( int i = 0; i<fieldCount; i++ )
-    {
-      const google::protobuf::FieldDescriptor *field = req_desc->field(i);
-
-      if(( field->type() == google::protobuf::FieldDescriptor::TYPE_MESSAGE ) && ( field->message_type()->full_name() == data_desc->full_name() ))
-      {
-        MsgData* msgPointer = (MsgData*)req_refl->MutableMessage((google::protobuf::Message*)&req, field);
-        msgPointer->CopyFrom(data);
-        return;
-      }
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::receiveContainer(const ProtoRootMsg& container_msg, size_t bytes) {
+    if(_flowControl && takeGrant(container_msg))
+      return;
+    TraceScope<Tracer> span(_tracer, TracePhase::Receive);
+    google::protobuf::Message* msg_data = openReq(container_msg);
+    if(Tracer::enabled && msg_data != nullptr)
+      span.setType(msg_data->GetDescriptor()->full_name().c_str());
+    if(_metrics) {
+      if(msg_data != nullptr)
+        _metrics->messageIn(msg_data->GetDescriptor(), bytes);
+      else
+        _metrics->inbound_dropped.add();
     }
+    if(msg_data != nullptr)
+      receiveMessage(container_msg, msg_data);
+    else if(_flowControl)
+      messageConsumed();
+  }
 
-    // Search through Extensions at File Level:
-    auto file_data_desc = data_desc->file();
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  google::protobuf::Message* Crier<Transport, ProtoRootMsg, Tracer>::openReq(const ProtoRootMsg& r) {
+    google::protobuf::Message* msgPointer = root_message::open(r);
+    if(msgPointer == nullptr)
+      logEmptyMessageError();
+    return msgPointer;
+  }
 
-    int extCount = file_data_desc->extension_count();
-    for( int i = 0; i < extCount; i++ )
-    {
-      const google::protobuf::FieldDescriptor *field = file_data_desc->extension(i);
 
-      if(( field->type() == google::protobuf::FieldDescriptor::TYPE_MESSAGE ) &&
-         ( field->containing_type()->full_name() == req_desc->full_name() ) &&
-         ( field->message_type()->full_name() == data_desc->full_name() ))
-      {
-        MsgData* msgPointer = (MsgData*)req_refl->MutableMessage((google::protobuf::Message*)&req, field);
-        msgPointer->CopyFrom(data);
-        return;
-      }
-    }
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  template <typename MsgData>
+  void Crier<Transport, ProtoRootMsg, Tracer>::packageIntoReq(ProtoRootMsg& req, const MsgData& data) {
+    root_message::packageInto(req, data);
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::OnTransportConnect(){
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::OnTransportConnect(){
+    if(_reconnect)
+      flushHeldMessages();
+    if(_flowControl)
+      sendGrant(_flowControl->options.window);
+
     std::vector<std::function<void()>> socketOpenedObserverList;
     {
-      std::lock_guard<std::mutex> guard(_transportOpenedObserverMapMutex);
+      std::lock_guard<CrierMutex> guard(_transportObserverMapsMutex);
       socketOpenedObserverList = mapToVectorCopy(_transportOpenedObserverMap);
     }
     if(_inboundDispatchTransportOpenSetting == InboundDispatching::DispatchQueue) {
@@ -504,8 +1664,19 @@ namespace crier {
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::OnTransportDisconnect(const std::string& err) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::OnTransportDisconnect(const std::string& err) {
+    if(_pendingRequestsOnDisconnect == PendingRequestsOnDisconnect::Fail)
+      failPendingRequests();
+    if(_flowControl) {
+      // Credits belong to a connection, the next one starts over with a fresh grant (held messages wait for it)
+      std::lock_guard<std::mutex> guard(_flowControl->mutex);
+      _flowControl->credits = 0;
+      _flowControl->pending_grant = 0;
+    }
+    if(_reconnect && reconnectAfterDisconnect())
+      return;
+
     if(_supressNextTransportClosed) {
       _supressNextTransportClosed = false;
       return;
@@ -513,7 +1684,7 @@ namespace crier {
 
     std::vector<std::function<void(const std::string&)>> socketClosedObserverList;
     {
-      std::lock_guard<std::mutex> guard(_transportClosedObserverMapMutex);
+      std::lock_guard<CrierMutex> guard(_transportObserverMapsMutex);
       socketClosedObserverList = mapToVectorCopy(_transportClosedObserverMap);
     }
 
@@ -528,14 +1699,22 @@ namespace crier {
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::treatQueuedMessagesForType(const std::string& ret_type) {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::treatQueuedMessagesForType(const std::string& ret_type) {
+    RareState* rare = rareStateIfAllocated();
+    if(!rare)
+      return;
     std::deque<ProtoRootMsg> unhandledMessageAux;
     {
-      std::lock_guard<std::mutex> guard(_unhandledMessageQueueMutex);
-      unhandledMessageAux = std::move(_unhandledMessageQueue[ret_type]);
-      _unhandledMessageQueue[ret_type].clear();
+      std::lock_guard<CrierMutex> guard(rare->mutex);
+      auto queue = rare->unhandledMessageQueue.find(ret_type);
+      if(queue == rare->unhandledMessageQueue.end())
+        return;
+      unhandledMessageAux = std::move(queue->second);
+      rare->unhandledMessageQueue.erase(queue);
     }
+    if(_metrics)
+      _metrics->unhandledUnqueued(unhandledMessageAux.size());
 
     for(const auto& queued_msg : unhandledMessageAux) {
       auto req_data = openReq(queued_msg);
@@ -544,14 +1723,46 @@ namespace crier {
     }
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  inline void Crier<Transport, ProtoRootMsg>::logEmptyMessageError() {
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  typename Crier<Transport, ProtoRootMsg, Tracer>::RareState& Crier<Transport, ProtoRootMsg, Tracer>::rareState() {
+    RareState* rare = _rareState.load(std::memory_order_acquire);
+    if(rare == nullptr) {
+      RareState* created = new RareState();
+      if(_metrics)
+        created->mutex.instrument(_metrics->lockCounters("rareState"));
+      if(_rareState.compare_exchange_strong(rare, created, std::memory_order_acq_rel)) {
+        rare = created;
+      } else {
+        // Another thread got to allocate it first, rare now holds theirs
+        delete created;
+      }
+    }
+    return *rare;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  typename Crier<Transport, ProtoRootMsg, Tracer>::RareState* Crier<Transport, ProtoRootMsg, Tracer>::rareStateIfAllocated() const {
+    return _rareState.load(std::memory_order_acquire);
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  inline void Crier<Transport, ProtoRootMsg, Tracer>::logEmptyMessageError() {
     std::cout << "[CRIER] ERROR: Couldn't Parse message it appears to have arrived empty" << std::endl;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  inline void Crier<Transport, ProtoRootMsg, Tracer>::logSerializationError() {
+    std::cout << "[CRIER] ERROR: Custom serialization failed, message was not sent" << std::endl;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  inline void Crier<Transport, ProtoRootMsg, Tracer>::logDeserializationError() {
+    std::cout << "[CRIER] ERROR: Custom deserialization failed, received data was dropped" << std::endl;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
   template <typename CallbackType>
-  std::vector<CallbackType> Crier<Transport, ProtoRootMsg>::mapToVectorCopy(const CallbackMap<CallbackType>& source) {
+  std::vector<CallbackType> Crier<Transport, ProtoRootMsg, Tracer>::mapToVectorCopy(const CallbackMap<CallbackType>& source) {
     std::vector<CallbackType> retVal;
     retVal.reserve(source.size());
     for (const auto& MapElem : source) {
@@ -560,24 +1771,52 @@ namespace crier {
     return retVal;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::SetCustomSerializationFun(const std::function<std::string(const ProtoRootMsg&)>& fun) {
-    _custom_serialization_fun = fun;
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::SetCustomSerializationFun(const std::function<std::string(const ProtoRootMsg&)>& fun) {
+    rareState().custom_serialization_fun = fun;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::ClearCustomSerializationFun() {
+    RareState* rare = rareStateIfAllocated();
+    if(rare)
+      rare->custom_serialization_fun = nullptr;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::SetCustomDeserializationFun(const std::function<ProtoRootMsg(const std::string&)>& fun) {
+    rareState().custom_deserialization_fun = fun;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::ClearCustomDeserializationFun() {
+    RareState* rare = rareStateIfAllocated();
+    if(rare)
+      rare->custom_deserialization_fun = nullptr;
+  }
+
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::SetCustomSerializationIntoBufferFun(const std::function<bool(const ProtoRootMsg&, std::string&)>& fun) {
+    rareState().custom_serialization_into_buffer_fun = fun;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::ClearCustomSerializationFun() {
-    _custom_serialization_fun = nullptr;
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::ClearCustomSerializationIntoBufferFun() {
+    RareState* rare = rareStateIfAllocated();
+    if(rare)
+      rare->custom_serialization_into_buffer_fun = nullptr;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::SetCustomDeserializationFun(const std::function<ProtoRootMsg(const std::string&)>& fun) {
-    _custom_deserialization_fun = fun;
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::SetCustomInPlaceDeserializationFun(const std::function<bool(const char*, size_t, ProtoRootMsg&)>& fun) {
+    rareState().custom_inplace_deserialization_fun = fun;
   }
 
-  template <typename Transport, typename ProtoRootMsg>
-  void Crier<Transport, ProtoRootMsg>::ClearCustomDeserializationFun() {
-    _custom_deserialization_fun = nullptr;
+  template <typename Transport, typename ProtoRootMsg, typename Tracer>
+  void Crier<Transport, ProtoRootMsg, Tracer>::ClearCustomInPlaceDeserializationFun() {
+    RareState* rare = rareStateIfAllocated();
+    if(rare)
+      rare->custom_inplace_deserialization_fun = nullptr;
   }
 
 }
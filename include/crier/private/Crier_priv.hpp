@@ -6,6 +6,19 @@ public:
     unsigned int id;
     bool valid;
     std::function<void()> callback;
+    // Owned timeouts just run their callback when due, leaving the response callbacks alone (awaited requests and streams take care of their own)
+    bool owned;
+    // The loop's timer, on a reactor
+    uint64_t timer = 0;
+  };
+
+  // Ends a stream queued behind the in-flight caps as Abandoned, if it's dropped without ever being sent
+  struct QueuedStream {
+    std::shared_ptr<StreamState> stream;
+    ~QueuedStream() {
+      if(stream)
+        stream->end(StreamEnd::Abandoned);
+    }
   };
 
   using PriorityKeyPair = std::pair< std::string, CallbackPriority >;
@@ -17,6 +30,102 @@ public:
     }
   };
 
+  /// Link to the reactor loop an instance is attached to. Shared with the tasks and timers posted to the loop, which may outlive the instance:
+  /// they only run while alive is set, holding the mutex.
+  struct LoopBinding {
+    std::mutex mutex;
+    bool alive = true;
+    std::function<void(std::function<void()>)> post;
+    std::function<uint64_t(unsigned int, std::function<void()>)> runAfter;
+    std::function<bool(uint64_t)> cancelTimer;
+    bool drainDispatchQueue = false;
+    // Guarded by _mainThreadCallbacksMapMutex
+    bool drainPosted = false;
+  };
+
+  /// State behind features most instances never touch (per type overrides, unhandled message queues, suppressors and custom codecs).
+  /// Allocated the first time one of them is used, so an instance that doesn't use them carries a single pointer instead (see rareState).
+  struct RareState {
+    std::map<std::string, UnhandledMessageBehaviour> unhandledBehaviourSettings;
+    std::map<std::string, std::deque<ProtoRootMsg>> unhandledMessageQueue;
+    std::map<std::string, InboundDispatching> inboundDispatchSettings;
+    CrierMutex mutex;
+
+    std::map<std::string, bool> transportClosedSupressors;
+
+    std::function<std::string(const ProtoRootMsg&)> custom_serialization_fun;
+    std::function<ProtoRootMsg(const std::string&)> custom_deserialization_fun;
+    std::function<bool(const ProtoRootMsg&, std::string&)> custom_serialization_into_buffer_fun;
+    std::function<bool(const char*, size_t, ProtoRootMsg&)> custom_inplace_deserialization_fun;
+
+    // Response times of requests sent under a policy, per request type, to hedge by
+    std::map<std::string, LatencyWindow> requestLatencies;
+  };
+
+  /// Automatic reconnect state, only allocated once enabled. Guarded by its mutex.
+  struct ReconnectState {
+    ReconnectPolicy policy;
+    bool enabled = false;
+    std::string host;
+    unsigned int port = 0;
+    // Cleared while the transport is down, messages sent meanwhile are held
+    bool online = false;
+    bool user_disconnected = false;
+    bool reconnecting = false;
+    unsigned int attempts = 0;
+    std::vector<std::string> held;
+    size_t held_bytes = 0;
+    std::minstd_rand rng;
+
+    // Pending attempt. The generation is bumped whenever the user connects, disconnects or disables, so stale attempts do nothing
+    bool attempt_scheduled = false;
+    uint64_t generation = 0;
+    std::chrono::steady_clock::time_point next_attempt;
+
+    // Attempts thread, when not attached to a reactor
+    bool stopping = false;
+    std::condition_variable wakeup;
+    std::thread thread;
+    std::mutex mutex;
+  };
+
+  /// Asynchronous send state, only allocated once enabled.
+  //  Senders push onto the queue lock-free. The mutex and condition variables are only taken to put the writer to sleep when the queue is empty,
+  //  and blocked senders to sleep while it's past the high watermark.
+  struct AsyncSendState {
+    AsyncSendOptions options;
+    MpscQueue<std::string> queue;
+    std::atomic<size_t> queued_bytes{0};
+    std::atomic<bool> signaled{false};
+
+    std::atomic<bool> writer_sleeping{false};
+    std::atomic<unsigned int> blocked_senders{0};
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable space;
+    std::thread writer;
+  };
+
+  /// Flow control state, only allocated once enabled. The credits, held messages and releasing flag are guarded by the mutex.
+  struct FlowControlState {
+    FlowControlOptions options;
+    unsigned int grant_threshold = 1;
+    std::atomic<unsigned int> pending_grant{0};
+
+    unsigned int credits = 0;
+    std::deque<std::string> held;
+    size_t held_bytes = 0;
+    // Set while held messages are being sent, so messages sent meanwhile queue up behind them
+    bool releasing = false;
+    std::mutex mutex;
+  };
+
+#ifdef CRIER_HAS_COROUTINES
+  template <typename, typename, typename>
+  friend class RequestAwaitable;
+#endif
+
   template <typename CallbackType>
   using CallbackMap = typename std::map< PriorityKeyPair, CallbackType, PriorityKeyCompare >;
   using TimeoutList = typename std::list< TimeoutData >;
@@ -26,32 +135,98 @@ public:
   google::protobuf::Message* openReq(const ProtoRootMsg& r);
 
   void unhandledMessage(const ProtoRootMsg& r, const std::string& type, UnhandledMessageBehaviour behaviour);
-  void dealWithUnhandledMessage(const ProtoRootMsg& r, const std::string& type);
+  UnhandledMessageBehaviour dealWithUnhandledMessage(const ProtoRootMsg& r, const std::string& type);
 
   void triggerCallbacksForMsg(const ProtoRootMsg& r, google::protobuf::Message* received_msg);
-  void callOnMainThread(const std::function<void()>& callback);
+  void callOnMainThread(const std::function<void()>& callback, const char* trace_type = "");
+  void pushMainThreadCallback(const std::function<void()>& callback);
   void treatQueuedMessagesForType(const std::string& ret_type);
 
   // --- Outbound
   template <typename MsgData>
   void packageIntoReq(ProtoRootMsg& req, const MsgData& data);
 
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestHandle submitRequest(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess, bool with_timeout,
+                              unsigned int milliseconds_to_timeout, const std::function<void()>& onTimeout, const std::function<void()>& onDisconnect = nullptr);
+  template <typename ReqMsgData, typename RetMsgData>
+  void issueRequest(const ReqMsgData& data, const std::shared_ptr<PendingRequest<RetMsgData>>& request, bool with_timeout,
+                    unsigned int milliseconds_to_timeout, const std::shared_ptr<RequestSlot>& slot);
+  RequestLimiter& requestLimiter();
+  void failPendingRequests();
+
+  // --- Request Policies
+  template <typename ReqMsgData, typename RetMsgData>
+  RequestHandle submitPolicyRequest(const ReqMsgData& data, const std::function<void(const RetMsgData&)>& onSuccess, const RequestPolicy& policy,
+                                    const std::function<void()>& onTimeout, const std::function<void()>& onDisconnect);
+  void startPolicyRequest(const std::shared_ptr<PolicyRequest>& request);
+  void sendPolicyAttempt(const std::shared_ptr<PolicyRequest>& request);
+  void policyAttemptTimedOut(const std::shared_ptr<PolicyRequest>& request, unsigned int attempt);
+  bool dropPolicyAttempt(const std::string& ret_type, const PolicyRequest* request, unsigned int attempt);
+  unsigned int hedgeDelay(const PolicyRequest& request);
+  static bool isSelfManagedCallback(const std::function<void(google::protobuf::Message*)>& callback);
+
+  // --- Streams
+  template <typename ReqMsgData, typename RetMsgData>
+  void issueStream(const ReqMsgData& data, const std::shared_ptr<StreamState>& stream, const std::shared_ptr<RequestSlot>& slot);
+  void watchStreamIdle(const std::string& ret_type, const std::weak_ptr<StreamState>& watched, unsigned int milliseconds);
+  void dropStream(const std::string& ret_type, const StreamState* stream);
+  void abandonStreams();
+
   // --- Schedule Timeouts
-  void scheduleTimeout(const std::string& ret_type, unsigned int miliseconds_to_timeout, const std::function<void()>& onTimeout);
+  unsigned int scheduleTimeout(const std::string& ret_type, unsigned int miliseconds_to_timeout, const std::function<void()>& onTimeout, bool owned = false);
+  bool claimTimeout(const std::string& ret_type, unsigned int timeout_id);
+  bool registerAwaitedResponse(const std::string& ret_type, AwaitedRequest* request);
+  bool dropAwaitedResponse(const std::string& ret_type, const AwaitedRequest* request);
+  void expireTimeout(const std::string& ret_type, typename TimeoutList::iterator async_timeout_pointer);
   void invalidateFirstTimeout(const std::string& ret_type);
+  void retireTimeout(TimeoutList& timeouts, typename TimeoutList::iterator timeout);
   void invalidateAllTimeoutsForMsg(const std::string& ret_type);
   void invalidateAllTimeouts();
 
+  // --- Flow Control
+  bool serializeRoot(const ProtoRootMsg& root, std::string& out);
+  bool sendWithCredit(std::string&& payload);
+  void releaseHeldForCredits();
+  bool takeCredit();
+  void returnCredit(unsigned int grant);
+  unsigned int attachGrant(ProtoRootMsg& root);
+  bool takeGrant(const ProtoRootMsg& root);
+  void messageConsumed(unsigned int count = 1);
+  void sendGrant(unsigned int credits);
+
+  // --- Async Sends
+  bool enqueuePayload(std::string payload);
+  size_t pushPayload(std::string payload);
+  void writerLoop();
+  void stopWriter();
+
+  // --- Reconnects
+  bool sendPayload(std::string&& payload);
+  bool reconnectAfterDisconnect();
+  void scheduleReconnectLocked();
+  void attemptReconnect(uint64_t generation);
+  void reconnectLoop();
+  void flushHeldMessages();
+
   // --- Transport Callbacks
   void OnTransportConnect();
   void OnTransportData(const std::string& data);
+  void OnTransportData(const char* data, size_t size);
+  void receiveContainer(const ProtoRootMsg& container_msg, size_t bytes);
   void OnTransportDisconnect(const std::string& err);
 
   // --- Inbound Dispatching
   InboundDispatching getInboundDispatchingForMsg(const std::string& type);
 
+  // - Rare State
+  RareState& rareState();
+  RareState* rareStateIfAllocated() const;
+
   // - Utils
   inline void logEmptyMessageError();
+  inline void logSerializationError();
+  inline void logDeserializationError();
   template <typename CallbackType>
   std::vector<CallbackType> mapToVectorCopy(const CallbackMap<CallbackType>& source);
 
@@ -60,42 +235,41 @@ public:
   std::unique_ptr<Transport> _transport;
 
   std::map<std::string, std::deque<std::function<void(google::protobuf::Message*)>>> _callbackMap;
-  std::mutex _callbackMapMutex;
+  CrierMutex _callbackMapMutex;
 
   std::map<std::string, CallbackMap<std::function<void(google::protobuf::Message*)>>> _permanentObserverMap;
-  std::mutex _permanentObserverMapMutex;
+  CrierMutex _permanentObserverMapMutex;
 
   std::map<std::string, TimeoutList> _timeoutCallbackMap;
-  std::mutex _timeoutCallbackMapMutex;
+  CrierMutex _timeoutCallbackMapMutex;
   unsigned int _timeoutIds;
 
   std::vector<std::thread> _launchedThreads;
+  // Set as destruction starts, so timeouts and callbacks still running stop scheduling timeouts and sending
+  std::atomic<bool> _shuttingDown{false};
 
   CallbackMap<std::function<void(const std::string&)>> _transportClosedObserverMap;
   CallbackMap<std::function<void()>> _transportOpenedObserverMap;
-  std::mutex _transportClosedObserverMapMutex;
-  std::mutex _transportOpenedObserverMapMutex;
+  CrierMutex _transportObserverMapsMutex;
 
   UnhandledMessageBehaviour _default_unhandled_behaviour;
-  std::map<std::string, UnhandledMessageBehaviour> _unhandledBehaviourSettings;
-  std::mutex _unhandledBehaviourSettingsMutex;
-
-  std::map<std::string, std::deque<ProtoRootMsg>> _unhandledMessageQueue;
-  std::mutex _unhandledMessageQueueMutex;
-
   InboundDispatching _default_inbound_dispatch;
-  std::map<std::string, InboundDispatching> _inboundDispatchSettings;
   InboundDispatching _inboundDispatchTransportOpenSetting;
   InboundDispatching _inboundDispatchTransportErrorSetting;
-  std::mutex _inboundDispatchSettingsMutex;
-
-  std::deque<std::function<void()>> _mainThreadCallbacksMap;
-  std::mutex _mainThreadCallbacksMapMutex;
-
-  std::map<std::string, bool> _transportClosedSupressors;
   bool _supressNextTransportClosed;
+  PendingRequestsOnDisconnect _pendingRequestsOnDisconnect;
+
+  std::vector<std::function<void()>> _mainThreadCallbacksMap;
+  CrierMutex _mainThreadCallbacksMapMutex;
 
-  std::function<std::string(const ProtoRootMsg&)> _custom_serialization_fun;
-  std::function<ProtoRootMsg(const std::string&)> _custom_deserialization_fun;
+  std::atomic<RareState*> _rareState;
+  std::shared_ptr<LoopBinding> _loopBinding;
+  std::unique_ptr<ReconnectState> _reconnect;
+  std::unique_ptr<AsyncSendState> _asyncSend;
+  std::unique_ptr<FlowControlState> _flowControl;
+  std::shared_ptr<RequestLimiter> _requestLimiter;
+  std::unique_ptr<MetricsRegistry> _metrics;
+  std::unique_ptr<CallbackAccounting> _callbackAccounting;
+  Tracer _tracer;
 
 #endif
@@ -0,0 +1,270 @@
+#ifndef CRIER_METRICS_REGISTRY_HPP
+#define CRIER_METRICS_REGISTRY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <google/protobuf/descriptor.h>
+
+#include <crier/Metrics.hpp>
+
+namespace crier {
+
+  namespace metrics_detail {
+    const size_t kShards = 8;
+
+    /// Shard the calling thread adds to, fixed for the thread's lifetime.
+    inline size_t threadShard() {
+      static std::atomic<size_t> next{0};
+      thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+      return shard;
+    }
+
+    inline uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    inline void raiseTo(std::atomic<uint64_t>& peak, uint64_t value) {
+      uint64_t current = peak.load(std::memory_order_relaxed);
+      while(value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+  }
+
+  /// Counter split across a few cache lines, each thread adding to its own, so threads counting at once don't contend. Reads sum them up.
+  class ShardedCounter {
+  public:
+    void add(uint64_t amount = 1) { _shards[metrics_detail::threadShard()].value.fetch_add(amount, std::memory_order_relaxed); }
+
+    uint64_t load() const {
+      uint64_t total = 0;
+      for(const auto& shard : _shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+      }
+      return total;
+    }
+
+  private:
+    // Padded rather than aligned, as over-aligned allocations need C++17
+    struct Shard {
+      std::atomic<uint64_t> value{0};
+      char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+    Shard _shards[metrics_detail::kShards];
+  };
+
+  /// Log-linear histogram of nanosecond durations (see HistogramSnapshot for the bucket layout). Recording is a couple of relaxed atomic adds.
+  class LatencyHistogram {
+  public:
+    // Values past 2^40ns (about 18 minutes) land in the last bucket
+    static const unsigned int kMaxMagnitude = 40;
+    static const size_t kBuckets = (kMaxMagnitude - 3) * HistogramSnapshot::kSubBuckets;
+
+    void record(uint64_t nanoseconds) {
+      _buckets[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+      _sum.add(nanoseconds);
+      metrics_detail::raiseTo(_max, nanoseconds);
+    }
+
+    void recordSince(std::chrono::steady_clock::time_point start) { record(metrics_detail::nanosecondsSince(start)); }
+
+    HistogramSnapshot snapshot() const {
+      HistogramSnapshot snapshot;
+      snapshot.buckets.resize(kBuckets);
+      for(size_t bucket = 0; bucket < kBuckets; bucket++) {
+        snapshot.buckets[bucket] = _buckets[bucket].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[bucket];
+      }
+      snapshot.sum = _sum.load();
+      snapshot.max = _max.load(std::memory_order_relaxed);
+      return snapshot;
+    }
+
+    static size_t bucketFor(uint64_t value) {
+      const uint64_t sub_buckets = HistogramSnapshot::kSubBuckets;
+      if(value < sub_buckets)
+        return static_cast<size_t>(value);
+      unsigned int magnitude = 63 - static_cast<unsigned int>(__builtin_clzll(value));
+      if(magnitude >= kMaxMagnitude)
+        return kBuckets - 1;
+      uint64_t sub_bucket = (value >> (magnitude - 4)) - sub_buckets;
+      return static_cast<size_t>((magnitude - 3) * sub_buckets + sub_bucket);
+    }
+
+  private:
+    std::atomic<uint64_t> _buckets[kBuckets] = {};
+    ShardedCounter _sum;
+    std::atomic<uint64_t> _max{0};
+  };
+
+  /// Traffic counters of a single message type.
+  struct MessageTypeCounters {
+    explicit MessageTypeCounters(const google::protobuf::Descriptor* descriptor) : descriptor(descriptor) {}
+
+    const google::protobuf::Descriptor* const descriptor;
+    ShardedCounter messages_in;
+    ShardedCounter bytes_in;
+    ShardedCounter messages_out;
+    ShardedCounter bytes_out;
+  };
+
+  /// Contention counters of one of crier's locks (see CrierMutex).
+  struct LockCounters {
+    explicit LockCounters(const char* name) : name(name) {}
+
+    const char* const name;
+    ShardedCounter acquisitions;
+    ShardedCounter contended;
+    LatencyHistogram wait_time;
+  };
+
+  /// Everything crier counts once metrics are enabled (see Crier::enableMetrics). Safe to record into from any thread.
+  //  Message types get their counters the first time they're seen, in a lock-free open addressed table keyed by descriptor, so lookups never take a lock.
+  class MetricsRegistry {
+  public:
+    static const size_t kMaxTypes = 256;
+
+    MetricsRegistry() {
+      for(auto& slot : _types) {
+        slot.store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    void operator=(const MetricsRegistry&) = delete;
+
+    ~MetricsRegistry() {
+      for(auto& slot : _types) {
+        delete slot.load(std::memory_order_relaxed);
+      }
+    }
+
+    /// Counters for the given type, or nullptr once kMaxTypes types were seen.
+    MessageTypeCounters* countersFor(const google::protobuf::Descriptor* descriptor) {
+      size_t start = std::hash<const void*>()(descriptor) % kMaxTypes;
+      MessageTypeCounters* created = nullptr;
+      for(size_t probe = 0; probe < kMaxTypes; probe++) {
+        std::atomic<MessageTypeCounters*>& slot = _types[(start + probe) % kMaxTypes];
+        MessageTypeCounters* counters = slot.load(std::memory_order_acquire);
+        if(!counters) {
+          if(!created)
+            created = new MessageTypeCounters(descriptor);
+          if(slot.compare_exchange_strong(counters, created, std::memory_order_acq_rel))
+            return created;
+          // Another thread took the slot meanwhile, maybe for this very type
+        }
+        if(counters->descriptor == descriptor) {
+          delete created;
+          return counters;
+        }
+      }
+      delete created;
+      return nullptr;
+    }
+
+    void messageIn(const google::protobuf::Descriptor* descriptor, size_t bytes) {
+      MessageTypeCounters* counters = countersFor(descriptor);
+      if(!counters)
+        return;
+      counters->messages_in.add();
+      counters->bytes_in.add(bytes);
+    }
+
+    void messageOut(const google::protobuf::Descriptor* descriptor, size_t bytes) {
+      MessageTypeCounters* counters = countersFor(descriptor);
+      if(!counters)
+        return;
+      counters->messages_out.add();
+      counters->bytes_out.add(bytes);
+    }
+
+    void unhandledQueued(uint64_t count = 1) {
+      uint64_t depth = _unhandled_queue_depth.fetch_add(count, std::memory_order_relaxed) + count;
+      metrics_detail::raiseTo(_unhandled_queue_peak, depth);
+    }
+
+    void unhandledUnqueued(uint64_t count) { _unhandled_queue_depth.fetch_sub(count, std::memory_order_relaxed); }
+
+    /// Counters for a lock of the given name, created on first use, so a lock of each instance's rare state shares them.
+    LockCounters* lockCounters(const char* name) {
+      std::lock_guard<std::mutex> guard(_locksMutex);
+      for(auto& counters : _locks) {
+        if(std::string(counters.name) == name)
+          return &counters;
+      }
+      _locks.emplace_back(name);
+      return &_locks.back();
+    }
+
+    /// Called with the dispatch queue's size as it changes, under its lock.
+    void dispatchDepth(uint64_t depth) {
+      _dispatch_queue_depth.store(depth, std::memory_order_relaxed);
+      metrics_detail::raiseTo(_dispatch_queue_peak, depth);
+    }
+
+    MetricsSnapshot snapshot() const {
+      MetricsSnapshot snapshot;
+      for(const auto& slot : _types) {
+        const MessageTypeCounters* counters = slot.load(std::memory_order_acquire);
+        if(!counters)
+          continue;
+        MessageTypeMetrics type;
+        type.type = counters->descriptor->full_name();
+        type.messages_in = counters->messages_in.load();
+        type.bytes_in = counters->bytes_in.load();
+        type.messages_out = counters->messages_out.load();
+        type.bytes_out = counters->bytes_out.load();
+        snapshot.types.push_back(type);
+      }
+      snapshot.unhandled_ignored = unhandled_ignored.load();
+      snapshot.unhandled_queue_dropped = unhandled_queue_dropped.load();
+      snapshot.unhandled_queue_depth = _unhandled_queue_depth.load(std::memory_order_relaxed);
+      snapshot.unhandled_queue_peak = _unhandled_queue_peak.load(std::memory_order_relaxed);
+      snapshot.dispatch_queue_depth = _dispatch_queue_depth.load(std::memory_order_relaxed);
+      snapshot.dispatch_queue_peak = _dispatch_queue_peak.load(std::memory_order_relaxed);
+      snapshot.inbound_dropped = inbound_dropped.load();
+      snapshot.outbound_dropped = outbound_dropped.load();
+      snapshot.request_latency = request_latency.snapshot();
+      snapshot.parse_time = parse_time.snapshot();
+      snapshot.dispatch_queue_time = dispatch_queue_time.snapshot();
+      snapshot.callback_time = callback_time.snapshot();
+      std::lock_guard<std::mutex> guard(_locksMutex);
+      for(const auto& counters : _locks) {
+        LockMetrics lock;
+        lock.name = counters.name;
+        lock.acquisitions = counters.acquisitions.load();
+        lock.contended = counters.contended.load();
+        lock.wait_time = counters.wait_time.snapshot();
+        snapshot.locks.push_back(lock);
+      }
+      return snapshot;
+    }
+
+    ShardedCounter unhandled_ignored;
+    ShardedCounter unhandled_queue_dropped;
+    ShardedCounter inbound_dropped;
+    ShardedCounter outbound_dropped;
+
+    LatencyHistogram request_latency;
+    LatencyHistogram parse_time;
+    LatencyHistogram dispatch_queue_time;
+    LatencyHistogram callback_time;
+
+  private:
+    std::atomic<MessageTypeCounters*> _types[kMaxTypes];
+    std::atomic<uint64_t> _unhandled_queue_depth{0};
+    std::atomic<uint64_t> _unhandled_queue_peak{0};
+    std::atomic<uint64_t> _dispatch_queue_depth{0};
+    std::atomic<uint64_t> _dispatch_queue_peak{0};
+    // Deque, as counters are handed out by pointer
+    std::deque<LockCounters> _locks;
+    mutable std::mutex _locksMutex;
+  };
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CRIER_MPSC_QUEUE_HPP
+#define CRIER_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+namespace crier {
+
+  /// MpscQueue
+  /// Unbounded lock-free queue for many producers and a single consumer (an intrusive linked list, after Dmitry Vyukov's).
+  //  Pushing is one atomic exchange and never waits on other producers or on the consumer. Popping is only safe from one thread at a time.
+  //  A producer interrupted between its exchange and linking its node briefly hides the nodes pushed after it, so pop may report empty
+  //  while a push is still completing: callers relying on a wake-up should signal after push returns.
+  template <typename T>
+  class MpscQueue {
+  public:
+    MpscQueue() : _head(new Node()), _tail(_head.load()) {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    void operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+      T discarded;
+      while(pop(discarded)) {}
+      delete _tail;
+    }
+
+    /// Safe to call from any thread.
+    void push(T value) {
+      Node* node = new Node();
+      node->value = std::move(value);
+      Node* previous = _head.exchange(node, std::memory_order_acq_rel);
+      previous->next.store(node, std::memory_order_release);
+    }
+
+    /// Consumer only. Returns false if there was nothing to pop.
+    bool pop(T& out) {
+      Node* tail = _tail;
+      Node* next = tail->next.load(std::memory_order_acquire);
+      if(!next)
+        return false;
+      // The popped node becomes the new stub
+      out = std::move(next->value);
+      _tail = next;
+      delete tail;
+      return true;
+    }
+
+  private:
+    struct Node {
+      std::atomic<Node*> next{nullptr};
+      T value;
+    };
+
+    std::atomic<Node*> _head;
+    Node* _tail;
+  };
+}
+
+#endif
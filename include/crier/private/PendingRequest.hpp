@@ -0,0 +1,126 @@
+#ifndef CRIER_PENDING_REQUEST_HPP
+#define CRIER_PENDING_REQUEST_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <google/protobuf/message.h>
+
+#include <crier/Cancellation.hpp>
+#include <crier/private/RequestLimiter.hpp>
+
+namespace crier {
+
+  /// The untyped side of a PendingRequest, that crier's response callbacks see.
+  class PendingRequestBase : public Cancellable {
+  public:
+    /// When the request went out, only set while metrics are enabled, to time it by.
+    std::chrono::steady_clock::time_point sent_at;
+
+    virtual bool settled() const = 0;
+    virtual void respond(google::protobuf::Message* response) = 0;
+    /// Fails the request as the transport disconnected, running its disconnect callback, or its timeout callback if it has none.
+    virtual void fail() = 0;
+  };
+
+  /// A request sent with sendMessageWithRetCallback(AndTimeout), shared by its response callback, its timeout and its handle.
+  //  Whichever of response, timeout, cancel or disconnect comes first settles it, taking the callbacks out, so the others find nothing left to run.
+  //  The response callback crier registers stays in place when cancelled, to drop the response still on its way.
+  template <typename RetMsgData>
+  class PendingRequest : public PendingRequestBase {
+  public:
+    PendingRequest(const std::function<void(const RetMsgData&)>& on_success, const std::function<void()>& on_timeout,
+                   const std::function<void()>& on_disconnect = nullptr)
+      : _on_success(on_success), _on_timeout(on_timeout), _on_disconnect(on_disconnect) {}
+
+    /// Keeps the in-flight slot the request was sent with, until it settles. Returns false, releasing it, if it was cancelled meanwhile.
+    bool holdSlot(const std::shared_ptr<RequestSlot>& slot) {
+      {
+        std::lock_guard<std::mutex> guard(_slotMutex);
+        if(!_settled) {
+          _slot = slot;
+          return true;
+        }
+      }
+      slot->release();
+      return false;
+    }
+
+    bool settled() const override { return _settled.load(); }
+
+    void respond(google::protobuf::Message* response) override {
+      if(_settled.exchange(true))
+        return;
+      std::function<void(const RetMsgData&)> on_success;
+      on_success.swap(_on_success);
+      _on_timeout = nullptr;
+      _on_disconnect = nullptr;
+      on_success(*(dynamic_cast<RetMsgData*>(response)));
+      releaseSlot();
+    }
+
+    void timeOut() {
+      if(_settled.exchange(true))
+        return;
+      std::function<void()> on_timeout;
+      on_timeout.swap(_on_timeout);
+      _on_success = nullptr;
+      _on_disconnect = nullptr;
+      if(on_timeout)
+        on_timeout();
+      releaseSlot();
+    }
+
+    void fail() override {
+      if(_settled.exchange(true))
+        return;
+      std::function<void()> on_fail;
+      on_fail.swap(_on_disconnect ? _on_disconnect : _on_timeout);
+      _on_success = nullptr;
+      _on_timeout = nullptr;
+      _on_disconnect = nullptr;
+      if(on_fail)
+        on_fail();
+      releaseSlot();
+    }
+
+    bool cancel() override {
+      if(_settled.exchange(true))
+        return false;
+      _on_success = nullptr;
+      _on_timeout = nullptr;
+      _on_disconnect = nullptr;
+      releaseSlot();
+      return true;
+    }
+
+  private:
+    void releaseSlot() {
+      std::shared_ptr<RequestSlot> slot;
+      {
+        std::lock_guard<std::mutex> guard(_slotMutex);
+        slot.swap(_slot);
+      }
+      if(slot)
+        slot->release();
+    }
+
+    std::function<void(const RetMsgData&)> _on_success;
+    std::function<void()> _on_timeout;
+    std::function<void()> _on_disconnect;
+    std::shared_ptr<RequestSlot> _slot;
+    std::mutex _slotMutex;
+    std::atomic<bool> _settled{false};
+  };
+
+  /// Response callback of a plain request, the only kind paired in order with the timeouts of its response type.
+  struct PendingResponse {
+    std::shared_ptr<PendingRequestBase> request;
+    void operator()(google::protobuf::Message* response) const { request->respond(response); }
+  };
+}
+
+#endif
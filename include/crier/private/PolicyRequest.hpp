@@ -0,0 +1,217 @@
+#ifndef CRIER_POLICY_REQUEST_HPP
+#define CRIER_POLICY_REQUEST_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/message.h>
+
+#include <crier/CrierTypes.hpp>
+#include <crier/Cancellation.hpp>
+#include <crier/private/RequestLimiter.hpp>
+
+namespace crier {
+
+  /// Response times of the latest requests of a type, to derive hedging delays from. Not thread-safe, crier guards it.
+  class LatencyWindow {
+  public:
+    static const size_t kCapacity = 128;
+    /// Samples needed before percentiles are trusted.
+    static const size_t kMinSamples = 20;
+
+    void record(uint64_t microseconds) {
+      if(_samples.size() < kCapacity) {
+        _samples.push_back(microseconds);
+      } else {
+        _samples[_next] = microseconds;
+        _next = (_next + 1) % kCapacity;
+      }
+    }
+
+    /// Writes the given percentile (0 to 1) of the recorded samples into microseconds, returning false if there aren't enough samples yet.
+    bool percentile(double fraction, uint64_t& microseconds) const {
+      if(_samples.size() < kMinSamples)
+        return false;
+      std::vector<uint64_t> sorted(_samples);
+      size_t rank = std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+      std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+      microseconds = sorted[rank];
+      return true;
+    }
+
+  private:
+    std::vector<uint64_t> _samples;
+    size_t _next = 0;
+  };
+
+  /// A request sent under a RequestPolicy (see Crier::sendMessageWithRetCallbackAndPolicy), across all the attempts made for it.
+  //  Every attempt registers its own response callback (a PolicyAttemptResponse) and timeout. The first response settles the request, whichever attempt
+  //  it answers, and the callbacks of the other attempts stay on to soak up their duplicate responses, until those arrive or time out themselves.
+  class PolicyRequest : public Cancellable {
+  public:
+    enum class AfterTimeout { Nothing, Retry, Fail };
+
+    PolicyRequest(const RequestPolicy& policy, const std::string& req_type, const std::string& ret_type, const std::function<void(google::protobuf::Message*)>& on_success,
+                  const std::function<void()>& on_timeout, const std::function<void()>& on_disconnect, const std::function<void()>& send,
+                  const std::function<void(uint64_t)>& record_latency)
+      : policy(policy), req_type(req_type), ret_type(ret_type), _on_success(on_success), _on_timeout(on_timeout), _on_disconnect(on_disconnect), _send(send),
+        _record_latency(record_latency) {}
+
+    /// Starts a new attempt, returning its number, or false if the request was already settled.
+    bool beginAttempt(unsigned int& attempt) {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(_settled)
+        return false;
+      attempt = static_cast<unsigned int>(_sent_at.size());
+      _sent_at.push_back(std::chrono::steady_clock::now());
+      _outstanding++;
+      return true;
+    }
+
+    void send() const { _send(); }
+
+    /// True once only, if no response arrived yet, for the hedge timer to send a duplicate.
+    bool takeHedge() {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(_settled || _hedged)
+        return false;
+      _hedged = true;
+      return true;
+    }
+
+    /// A response arrived through the callback of the given attempt. Settles the request if it's the first, recording how long the attempt took,
+    /// and returns true. Later ones are duplicates, dropped.
+    bool respond(unsigned int attempt, google::protobuf::Message* response) {
+      uint64_t microseconds;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _outstanding--;
+        if(_settled)
+          return false;
+        _settled = true;
+        microseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _sent_at[attempt]).count());
+      }
+      _record_latency(microseconds);
+      releaseSlot();
+      _on_success(response);
+      return true;
+    }
+
+    /// An attempt timed out without a response. Says whether to retry (after the returned delay), fail the request, or neither, while other attempts are out.
+    AfterTimeout attemptTimedOut(unsigned int& retry_delay_ms) {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _outstanding--;
+      if(_settled)
+        return AfterTimeout::Nothing;
+      if(_retries < policy.max_retries) {
+        double delay = policy.retry_backoff_ms;
+        for(unsigned int i = 0; i < _retries; i++) {
+          delay *= policy.backoff_multiplier;
+        }
+        retry_delay_ms = static_cast<unsigned int>(delay);
+        _retries++;
+        return AfterTimeout::Retry;
+      }
+      if(_outstanding > 0)
+        return AfterTimeout::Nothing;
+      _settled = true;
+      return AfterTimeout::Fail;
+    }
+
+    void fail() {
+      releaseSlot();
+      if(_on_timeout)
+        _on_timeout();
+    }
+
+    /// Fails the request as the transport disconnected, with no further retries, running its disconnect callback (its timeout callback if it has none).
+    /// Returns false if it was already settled.
+    bool disconnect() {
+      std::function<void()> on_fail;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if(_settled)
+          return false;
+        _settled = true;
+        on_fail.swap(_on_disconnect ? _on_disconnect : _on_timeout);
+      }
+      releaseSlot();
+      if(on_fail)
+        on_fail();
+      return true;
+    }
+
+    /// Settles the request without running any callback. The attempts already sent still drop their responses as they arrive.
+    bool cancel() override {
+      std::function<void(google::protobuf::Message*)> on_success;
+      std::function<void()> on_timeout;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if(_settled)
+          return false;
+        _settled = true;
+        on_success.swap(_on_success);
+        on_timeout.swap(_on_timeout);
+      }
+      releaseSlot();
+      return true;
+    }
+
+    /// Keeps the in-flight slot the request was sent with, until it settles. Returns false, releasing it, if it was cancelled meanwhile.
+    bool holdSlot(const std::shared_ptr<RequestSlot>& slot) {
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if(!_settled) {
+          _slot = slot;
+          return true;
+        }
+      }
+      slot->release();
+      return false;
+    }
+
+    const RequestPolicy policy;
+    const std::string req_type;
+    const std::string ret_type;
+
+  private:
+    void releaseSlot() {
+      std::shared_ptr<RequestSlot> slot;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        slot.swap(_slot);
+      }
+      if(slot)
+        slot->release();
+    }
+
+    std::function<void(google::protobuf::Message*)> _on_success;
+    std::function<void()> _on_timeout;
+    std::function<void()> _on_disconnect;
+    std::function<void()> _send;
+    std::function<void(uint64_t)> _record_latency;
+    std::shared_ptr<RequestSlot> _slot;
+
+    std::vector<std::chrono::steady_clock::time_point> _sent_at;
+    unsigned int _outstanding = 0;
+    unsigned int _retries = 0;
+    bool _hedged = false;
+    bool _settled = false;
+    std::mutex _mutex;
+  };
+
+  /// Response callback of one attempt of a PolicyRequest, carrying the attempt number so the request can time the attempt that answered.
+  struct PolicyAttemptResponse {
+    std::shared_ptr<PolicyRequest> request;
+    unsigned int attempt;
+    void operator()(google::protobuf::Message* response) const { request->respond(attempt, response); }
+  };
+}
+
+#endif
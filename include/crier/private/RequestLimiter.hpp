@@ -0,0 +1,210 @@
+#ifndef CRIER_REQUEST_LIMITER_HPP
+#define CRIER_REQUEST_LIMITER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <crier/CrierTypes.hpp>
+
+namespace crier {
+
+  /// Caps how many requests (messages sent expecting a reply) are in flight at once, overall and per request type.
+  /// Requests over a cap wait in a FIFO queue, and are issued as slots free up. Used by Crier, see Crier::setMaxRequestsInFlight.
+  //  Issuing a request runs a closure supplied by crier, which may reply synchronously and release a slot from within: only one thread
+  //  at a time issues queued requests, the others just leave the freed slot for it.
+  class RequestLimiter {
+  public:
+    /// 0 lifts the cap.
+    void setMaxInFlight(unsigned int max_in_flight);
+    void setMaxInFlightFor(const std::string& type, unsigned int max_in_flight);
+
+    /// Takes a slot for a request of the given type and returns true if there's room for it. Otherwise queues the closure make_issue returns
+    /// (only called then, so the request's copy is only made when needed), to run once a slot is taken for it, and returns false.
+    template <typename IssueFactory>
+    bool acquireOrEnqueue(const std::string& type, IssueFactory make_issue);
+
+    /// Frees a slot taken for a request of the given type, issuing whatever queued requests now fit.
+    void release(const std::string& type);
+
+    /// Drops every queued request, and stops issuing new ones. Called as the owning crier goes away.
+    void close();
+
+    RequestQueueStats stats() const;
+    size_t queuedFor(const std::string& type) const;
+
+  private:
+    struct PendingRequest {
+      std::string type;
+      std::function<void()> issue;
+      std::chrono::steady_clock::time_point queued_at;
+    };
+
+    bool hasRoomLocked(const std::string& type) const;
+    void takeSlotLocked(const std::string& type);
+    void issueQueued();
+
+    unsigned int _max_in_flight = 0;
+    std::map<std::string, unsigned int> _max_in_flight_per_type;
+    unsigned int _in_flight = 0;
+    std::map<std::string, unsigned int> _in_flight_per_type;
+    std::deque<PendingRequest> _queued;
+    bool _issuing = false;
+    bool _closed = false;
+
+    size_t _peak_queued = 0;
+    uint64_t _total_queued = 0;
+    uint64_t _total_wait_us = 0;
+    mutable std::mutex _mutex;
+  };
+
+  /// A slot taken from a RequestLimiter, released when its request is replied to or times out, or failing that, when the last callback holding it is dropped.
+  class RequestSlot {
+  public:
+    RequestSlot(const std::shared_ptr<RequestLimiter>& limiter, const std::string& type) : _limiter(limiter), _type(type), _released(false) {}
+    RequestSlot(const RequestSlot&) = delete;
+    void operator=(const RequestSlot&) = delete;
+    ~RequestSlot() { release(); }
+
+    void release() {
+      if(!_released.exchange(true))
+        _limiter->release(_type);
+    }
+
+  private:
+    std::shared_ptr<RequestLimiter> _limiter;
+    std::string _type;
+    std::atomic<bool> _released;
+  };
+
+  inline void RequestLimiter::setMaxInFlight(unsigned int max_in_flight) {
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _max_in_flight = max_in_flight;
+      if(_issuing || _closed)
+        return;
+      _issuing = true;
+    }
+    // A raised cap may let queued requests through
+    issueQueued();
+  }
+
+  inline void RequestLimiter::setMaxInFlightFor(const std::string& type, unsigned int max_in_flight) {
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(max_in_flight == 0)
+        _max_in_flight_per_type.erase(type);
+      else
+        _max_in_flight_per_type[type] = max_in_flight;
+      if(_issuing || _closed)
+        return;
+      _issuing = true;
+    }
+    issueQueued();
+  }
+
+  template <typename IssueFactory>
+  bool RequestLimiter::acquireOrEnqueue(const std::string& type, IssueFactory make_issue) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    if(_closed)
+      return false;
+    if(hasRoomLocked(type)) {
+      takeSlotLocked(type);
+      return true;
+    }
+    _queued.push_back(PendingRequest{type, make_issue(), std::chrono::steady_clock::now()});
+    _total_queued++;
+    if(_queued.size() > _peak_queued)
+      _peak_queued = _queued.size();
+    return false;
+  }
+
+  inline void RequestLimiter::release(const std::string& type) {
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _in_flight--;
+      auto per_type = _in_flight_per_type.find(type);
+      if(per_type != _in_flight_per_type.end() && --per_type->second == 0)
+        _in_flight_per_type.erase(per_type);
+      if(_issuing || _closed || _queued.empty())
+        return;
+      _issuing = true;
+    }
+    issueQueued();
+  }
+
+  inline void RequestLimiter::close() {
+    std::deque<PendingRequest> dropped;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _closed = true;
+      dropped.swap(_queued);
+    }
+  }
+
+  inline RequestQueueStats RequestLimiter::stats() const {
+    std::lock_guard<std::mutex> guard(_mutex);
+    RequestQueueStats stats;
+    stats.in_flight = _in_flight;
+    stats.queued = _queued.size();
+    stats.peak_queued = _peak_queued;
+    stats.total_queued = _total_queued;
+    stats.total_wait_us = _total_wait_us;
+    return stats;
+  }
+
+  inline size_t RequestLimiter::queuedFor(const std::string& type) const {
+    std::lock_guard<std::mutex> guard(_mutex);
+    size_t queued = 0;
+    for(const auto& pending : _queued) {
+      if(pending.type == type)
+        queued++;
+    }
+    return queued;
+  }
+
+  inline bool RequestLimiter::hasRoomLocked(const std::string& type) const {
+    if(_max_in_flight > 0 && _in_flight >= _max_in_flight)
+      return false;
+    auto max_for_type = _max_in_flight_per_type.find(type);
+    if(max_for_type == _max_in_flight_per_type.end())
+      return true;
+    auto in_flight_for_type = _in_flight_per_type.find(type);
+    return in_flight_for_type == _in_flight_per_type.end() || in_flight_for_type->second < max_for_type->second;
+  }
+
+  inline void RequestLimiter::takeSlotLocked(const std::string& type) {
+    _in_flight++;
+    _in_flight_per_type[type]++;
+  }
+
+  inline void RequestLimiter::issueQueued() {
+    while(true) {
+      std::function<void()> issue;
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        // Oldest request that fits: one whose type is at its cap doesn't hold back the others
+        auto pending = _queued.begin();
+        while(!_closed && pending != _queued.end() && !hasRoomLocked(pending->type)) {
+          ++pending;
+        }
+        if(_closed || pending == _queued.end()) {
+          _issuing = false;
+          return;
+        }
+        takeSlotLocked(pending->type);
+        _total_wait_us += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pending->queued_at).count());
+        issue = std::move(pending->issue);
+        _queued.erase(pending);
+      }
+      issue();
+    }
+  }
+}
+
+#endif
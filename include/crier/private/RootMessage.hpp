@@ -0,0 +1,75 @@
+#ifndef CRIER_ROOT_MESSAGE_HPP
+#define CRIER_ROOT_MESSAGE_HPP
+
+#include <vector>
+
+#include <google/protobuf/message.h>
+#include <google/protobuf/descriptor.h>
+
+namespace crier {
+  /// Reflection helpers for packing messages into, and opening them out of, the protocol's root message.
+  /// Shared by Crier and CrierServer, so both agree on how a message travels inside the root.
+  namespace root_message {
+
+    /// Copies data into the root field (or root extension) of its type. Returns false if the root has no field of that type.
+    template <typename ProtoRootMsg, typename MsgData>
+    bool packageInto(ProtoRootMsg& root, const MsgData& data) {
+
+      const google::protobuf::Descriptor* data_desc	= data.GetDescriptor();
+      const google::protobuf::Descriptor* req_desc	= root.GetDescriptor();
+      const google::protobuf::Reflection* req_refl	= root.GetReflection();
+
+      int fieldCount = req_desc->field_count();
+      for( int i = 0; i<fieldCount; i++ )
+      {
+        const google::protobuf::FieldDescriptor *field = req_desc->field(i);
+
+        if(( field->type() == google::protobuf::FieldDescriptor::TYPE_MESSAGE ) && ( field->message_type()->full_name() == data_desc->full_name() ))
+        {
+          MsgData* msgPointer = (MsgData*)req_refl->MutableMessage((google::protobuf::Message*)&root, field);
+          msgPointer->CopyFrom(data);
+          return true;
+        }
+      }
+
+      // Search through Extensions at File Level:
+      auto file_data_desc = data_desc->file();
+
+      int extCount = file_data_desc->extension_count();
+      for( int i = 0; i < extCount; i++ )
+      {
+        const google::protobuf::FieldDescriptor *field = file_data_desc->extension(i);
+
+        if(( field->type() == google::protobuf::FieldDescriptor::TYPE_MESSAGE ) &&
+           ( field->containing_type()->full_name() == req_desc->full_name() ) &&
+           ( field->message_type()->full_name() == data_desc->full_name() ))
+        {
+          MsgData* msgPointer = (MsgData*)req_refl->MutableMessage((google::protobuf::Message*)&root, field);
+          msgPointer->CopyFrom(data);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /// Returns the message carried by the root (its first set field), or nullptr if the root arrived empty.
+    inline google::protobuf::Message* open(const google::protobuf::Message& root) {
+
+      const google::protobuf::Reflection *refl = root.GetReflection();
+
+      std::vector< const google::protobuf::FieldDescriptor *> pOut;
+
+      refl->ListFields( root, &pOut );
+
+      for( auto const &field : pOut )
+      {
+        if( field == nullptr ) { continue; };
+
+        return refl->MutableMessage((google::protobuf::Message*)&root, field);
+      }
+      return nullptr;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CRIER_TRACE_SCOPE_HPP
+#define CRIER_TRACE_SCOPE_HPP
+
+#include <chrono>
+#include <thread>
+
+#include <crier/Tracing.hpp>
+
+namespace crier {
+
+  /// Traces the scope it lives in as a span, recorded into the tracer as it ends. Type and key are copied only then, so must outlive it.
+  template <typename Tracer, bool Enabled = Tracer::enabled>
+  class TraceScope {
+  public:
+    TraceScope(Tracer& tracer, TracePhase phase, const char* type = "", const char* key = "")
+      : _tracer(tracer), _phase(phase), _type(type), _key(key), _start(std::chrono::steady_clock::now()) {}
+
+    TraceScope(const TraceScope&) = delete;
+    void operator=(const TraceScope&) = delete;
+
+    ~TraceScope() {
+      TraceSpan span;
+      span.phase = _phase;
+      span.type = _type;
+      span.key = _key;
+      span.start = _start;
+      span.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start);
+      span.thread = std::this_thread::get_id();
+      _tracer.record(span);
+    }
+
+    /// For spans whose type is only known part way through.
+    void setType(const char* type) { _type = type; }
+
+  private:
+    Tracer& _tracer;
+    const TracePhase _phase;
+    const char* _type;
+    const char* _key;
+    const std::chrono::steady_clock::time_point _start;
+  };
+
+  /// Without tracing, scopes are empty, and compile out entirely.
+  template <typename Tracer>
+  class TraceScope<Tracer, false> {
+  public:
+    TraceScope(Tracer&, TracePhase, const char* = "", const char* = "") {}
+    void setType(const char*) {}
+  };
+}
+
+#endif
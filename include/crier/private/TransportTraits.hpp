@@ -0,0 +1,48 @@
+#ifndef CRIER_TRANSPORT_TRAITS_HPP
+#define CRIER_TRANSPORT_TRAITS_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace crier {
+  /// Helpers for the optional parts of the Transport concept.
+  /// The Transport class isn't required to inherit from TransportConcept, so crier only makes use of these methods when the class actually provides them.
+  //  Each helper is called with a literal 0, which prefers the int overload (only viable when the method exists) over the long fallback.
+  namespace transport_traits {
+
+    template <typename Transport>
+    auto setOnRawDataCallback(Transport& transport, const std::function<void(const char*, size_t)>& on_raw_data, int)
+      -> decltype(transport.setOnRawDataCallback(on_raw_data), void()) {
+      transport.setOnRawDataCallback(on_raw_data);
+    }
+
+    template <typename Transport>
+    void setOnRawDataCallback(Transport&, const std::function<void(const char*, size_t)>&, long) {}
+
+    /// Hands the transport an event loop to run on, instead of a thread of its own. Returns false if the transport can't be attached to one.
+    template <typename Transport, typename Loop>
+    auto attachToLoop(Transport& transport, Loop& loop, int) -> decltype(transport.attachToLoop(loop), bool()) {
+      transport.attachToLoop(loop);
+      return true;
+    }
+
+    template <typename Transport, typename Loop>
+    bool attachToLoop(Transport&, Loop&, long) { return false; }
+
+    /// Hands the transport many messages at once, falling back to one sendData per message.
+    template <typename Transport>
+    auto sendDataBatch(Transport& transport, const std::vector<std::string>& batch, int) -> decltype(transport.sendDataBatch(batch), void()) {
+      transport.sendDataBatch(batch);
+    }
+
+    template <typename Transport>
+    void sendDataBatch(Transport& transport, const std::vector<std::string>& batch, long) {
+      for(const auto& data : batch) {
+        transport.sendData(data);
+      }
+    }
+  }
+}
+
+#endif
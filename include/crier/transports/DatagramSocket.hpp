@@ -0,0 +1,405 @@
+#ifndef CRIER_DATAGRAM_SOCKET_HPP
+#define CRIER_DATAGRAM_SOCKET_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#include <crier/EventLoop.hpp>
+
+namespace crier {
+
+  /// DatagramSocket
+  /// A non-blocking, connected, udp socket driven by an EventLoop. Every datagram carries exactly one message, so no framing is involved.
+  //  Outbound datagrams are queued by send and flushed from the loop thread, so everything sent until the loop gets to run leaves in a single sendmmsg.
+  //  If enabled, runs of same sized datagrams are further coalesced into a single GSO send, which the kernel splits back into datagrams.
+  //  Inbound datagrams are drained with recvmmsg, many per syscall, and handed over as a pointer into the socket's receive buffers,
+  //  valid only for the duration of the datagram handler call. If GRO is enabled, coalesced datagrams are split back before being handed over.
+  //  Being udp, datagrams may be lost or arrive out of order, and nothing in here will tell. send and close can be called from any thread.
+  class DatagramSocket : public std::enable_shared_from_this<DatagramSocket> {
+  public:
+    using DatagramHandler = std::function<void(const char* data, size_t size)>;
+    using CloseHandler = std::function<void(const std::string& reason)>;
+    using RefusedHandler = std::function<void()>;
+
+    /// Largest payload an ipv4 udp datagram can carry.
+    static constexpr size_t kMaxDatagramSize = 65507;
+    /// Most segments the kernel accepts in a single GSO send.
+    static constexpr size_t kMaxSegments = 64;
+
+    struct Options {
+      /// How many datagrams are drained from the socket per recvmmsg call. Each of them takes a max_datagram_size receive buffer.
+      unsigned int recv_batch = 32;
+      /// Inbound datagrams larger than this are truncated by the kernel, and dropped.
+      size_t max_datagram_size = kMaxDatagramSize;
+      /// Coalesces runs of outbound datagrams of the same size (up to gso_max_segment_size) into a single send, segmented by the kernel (UDP_SEGMENT).
+      //  Disabled on its own if the kernel or device refuses segmented sends.
+      bool gso = false;
+      /// Datagrams bigger than this are never coalesced. Must not exceed what the path MTU can carry (1472 bytes, for an ethernet MTU).
+      size_t gso_max_segment_size = 1472;
+      /// Lets the kernel hand over runs of same sized datagrams as a single buffer (UDP_GRO). Receive buffers become kMaxDatagramSize to fit them.
+      bool gro = false;
+      /// If not 0, the SO_SNDBUF and SO_RCVBUF sizes requested for the socket. Bigger buffers survive larger bursts without dropping datagrams.
+      int socket_buffer_size = 0;
+    };
+
+    /// Creates a socket handler for an already created, non-blocking and connected, udp socket. Takes ownership of the fd.
+    static std::shared_ptr<DatagramSocket> create(EventLoop& loop, int fd, const Options& options);
+
+    ~DatagramSocket();
+
+    /// Registers the socket with the loop.
+    //  - onRefused, if set, is invoked whenever the kernel reports that an earlier datagram hit a closed port (the socket stays usable).
+    bool start(const DatagramHandler& onDatagram, const CloseHandler& onClose, const RefusedHandler& onRefused = nullptr);
+
+    /// Queues a datagram to be sent by the loop thread. Returns false if the socket is already closed, in which case the data is dropped.
+    bool send(const char* data, size_t size);
+
+    /// Closes the socket. Returns true if this call was the one to close it (only the first of many concurrent closes succeeds).
+    //  - notify, if true the onClose handler will be called with the given reason.
+    bool close(const std::string& reason, bool notify);
+
+    /// Returns true until the socket is closed.
+    bool open() const;
+
+    /// Returns the amount of datagrams queued waiting to be sent.
+    size_t pendingDatagrams() const;
+
+  private:
+    static constexpr unsigned int kSendBatch = 64;
+    static constexpr size_t kMaxSendIov = 1024;
+
+    DatagramSocket(EventLoop& loop, int fd, const Options& options);
+
+    void onEvents(uint32_t events);
+    void onReadable();
+    void deliver(const msghdr& msg, size_t size);
+    void flush();
+    size_t gsoRunLength(size_t index, size_t iov_left) const;
+    void teardown(const std::string& reason, bool notify);
+
+    EventLoop& _loop;
+    int _fd;
+    Options _options;
+    bool _gso;
+    std::atomic<bool> _closed;
+
+    DatagramHandler _onDatagram;
+    CloseHandler _onClose;
+    RefusedHandler _onRefused;
+
+    // Receive side, only touched from the loop thread
+    size_t _recv_buffer_size;
+    std::vector<char> _recv_memory;
+    std::vector<iovec> _recv_iovs;
+    std::vector<mmsghdr> _recv_msgs;
+    std::vector<char> _recv_control;
+
+    // Datagrams taken from _outbound by the loop thread, and still being sent
+    std::vector<std::string> _sending;
+    size_t _sending_next;
+    std::vector<mmsghdr> _send_msgs;
+    std::vector<iovec> _send_iovs;
+    std::vector<char> _send_control;
+    std::vector<size_t> _send_msg_datagrams;
+
+    std::vector<std::string> _outbound;
+    bool _flush_posted;
+    mutable std::mutex _outboundMutex;
+  };
+
+  inline std::shared_ptr<DatagramSocket> DatagramSocket::create(EventLoop& loop, int fd, const Options& options) {
+    return std::shared_ptr<DatagramSocket>(new DatagramSocket(loop, fd, options));
+  }
+
+  inline DatagramSocket::DatagramSocket(EventLoop& loop, int fd, const Options& options) :
+  _loop(loop), _fd(fd), _options(options), _gso(options.gso), _closed(false), _sending_next(0), _flush_posted(false) {
+    if(_options.recv_batch == 0)
+      _options.recv_batch = 1;
+    if(_options.socket_buffer_size > 0) {
+      setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, &_options.socket_buffer_size, sizeof(_options.socket_buffer_size));
+      setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &_options.socket_buffer_size, sizeof(_options.socket_buffer_size));
+    }
+    if(_options.gro) {
+      int one = 1;
+      if(setsockopt(_fd, SOL_UDP, UDP_GRO, &one, sizeof(one)) != 0)
+        _options.gro = false;
+    }
+
+    _recv_buffer_size = (_options.gro || _options.max_datagram_size > kMaxDatagramSize) ? kMaxDatagramSize : _options.max_datagram_size;
+    _recv_memory.resize(_options.recv_batch * _recv_buffer_size);
+    _recv_iovs.resize(_options.recv_batch);
+    _recv_msgs.resize(_options.recv_batch);
+    _recv_control.resize(_options.recv_batch * CMSG_SPACE(sizeof(int)));
+
+    _send_msgs.resize(kSendBatch);
+    _send_iovs.resize(kMaxSendIov);
+    _send_control.resize(kSendBatch * CMSG_SPACE(sizeof(uint16_t)));
+    _send_msg_datagrams.resize(kSendBatch);
+  }
+
+  inline DatagramSocket::~DatagramSocket() {
+    if(_fd >= 0)
+      ::close(_fd);
+  }
+
+  inline bool DatagramSocket::start(const DatagramHandler& onDatagram, const CloseHandler& onClose, const RefusedHandler& onRefused) {
+    _onDatagram = onDatagram;
+    _onClose = onClose;
+    _onRefused = onRefused;
+
+    std::shared_ptr<DatagramSocket> self = shared_from_this();
+    return _loop.addFd(_fd, EPOLLIN | EPOLLOUT | EPOLLET, [self](uint32_t events){ self->onEvents(events); });
+  }
+
+  inline bool DatagramSocket::send(const char* data, size_t size) {
+    if(_closed)
+      return false;
+    bool post_flush;
+    {
+      std::lock_guard<std::mutex> guard(_outboundMutex);
+      _outbound.emplace_back(data, size);
+      post_flush = !_flush_posted;
+      _flush_posted = true;
+    }
+    // A single flush per wakeup picks up every datagram queued until it runs
+    if(post_flush) {
+      std::shared_ptr<DatagramSocket> self = shared_from_this();
+      _loop.post([self](){ self->flush(); });
+    }
+    return true;
+  }
+
+  inline bool DatagramSocket::close(const std::string& reason, bool notify) {
+    if(_closed.exchange(true))
+      return false;
+
+    // Always deferred, as close might have been called from within one of this socket's own handlers
+    std::shared_ptr<DatagramSocket> self = shared_from_this();
+    if(_loop.running()) {
+      _loop.post([self, reason, notify](){ self->teardown(reason, notify); });
+    } else {
+      teardown(reason, notify);
+    }
+    return true;
+  }
+
+  inline bool DatagramSocket::open() const {
+    return !_closed;
+  }
+
+  inline size_t DatagramSocket::pendingDatagrams() const {
+    std::lock_guard<std::mutex> guard(_outboundMutex);
+    return _outbound.size();
+  }
+
+  inline void DatagramSocket::onEvents(uint32_t events) {
+    if(_closed)
+      return;
+    // EPOLLERR only means the kernel got an icmp error for one of our datagrams, which the next recv reports and clears
+    if(events & (EPOLLIN | EPOLLERR)) {
+      onReadable();
+      if(_closed)
+        return;
+    }
+    if(events & EPOLLOUT)
+      flush();
+  }
+
+  inline void DatagramSocket::onReadable() {
+    const size_t control_size = CMSG_SPACE(sizeof(int));
+    while(!_closed) {
+      for(size_t i = 0; i < _recv_msgs.size(); i++) {
+        _recv_iovs[i].iov_base = _recv_memory.data() + i * _recv_buffer_size;
+        _recv_iovs[i].iov_len = _recv_buffer_size;
+        msghdr& msg = _recv_msgs[i].msg_hdr;
+        msg = msghdr{};
+        msg.msg_iov = &_recv_iovs[i];
+        msg.msg_iovlen = 1;
+        if(_options.gro) {
+          msg.msg_control = _recv_control.data() + i * control_size;
+          msg.msg_controllen = control_size;
+        }
+      }
+
+      int received = recvmmsg(_fd, _recv_msgs.data(), static_cast<unsigned int>(_recv_msgs.size()), MSG_DONTWAIT, nullptr);
+      if(received < 0) {
+        // Refused means an earlier datagram hit a closed port, which doesn't stop the socket from being used
+        if(errno == ECONNREFUSED) {
+          if(_onRefused)
+            _onRefused();
+          continue;
+        }
+        if(errno == EINTR)
+          continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+          close(std::strerror(errno), true);
+        return;
+      }
+
+      for(int i = 0; i < received && !_closed; i++) {
+        deliver(_recv_msgs[i].msg_hdr, _recv_msgs[i].msg_len);
+      }
+      // A partial batch means the socket was drained, and edge-triggered epoll will signal anything arriving after it
+      if(received < static_cast<int>(_recv_msgs.size()))
+        return;
+    }
+  }
+
+  inline void DatagramSocket::deliver(const msghdr& msg, size_t size) {
+    if(msg.msg_flags & MSG_TRUNC) {
+      std::cout << "[CRIER] ERROR: Received a datagram bigger than max_datagram_size, it was dropped" << std::endl;
+      return;
+    }
+
+    size_t segment_size = size;
+    if(_options.gro) {
+      for(cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&msg), cmsg)) {
+        if(cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+          int gro_size;
+          std::memcpy(&gro_size, CMSG_DATA(cmsg), sizeof(gro_size));
+          if(gro_size > 0)
+            segment_size = static_cast<size_t>(gro_size);
+        }
+      }
+    }
+
+    const char* data = static_cast<const char*>(msg.msg_iov->iov_base);
+    if(size == 0 && _onDatagram) {
+      _onDatagram(data, 0);
+      return;
+    }
+    for(size_t offset = 0; offset < size && !_closed; offset += segment_size) {
+      if(_onDatagram)
+        _onDatagram(data + offset, std::min(segment_size, size - offset));
+    }
+  }
+
+  inline size_t DatagramSocket::gsoRunLength(size_t index, size_t iov_left) const {
+    size_t segment_size = _sending[index].size();
+    if(!_gso || segment_size == 0 || segment_size > _options.gso_max_segment_size)
+      return 1;
+
+    // Every segment must be segment_size bytes long, except for the last one, which may be shorter
+    size_t run = 1;
+    size_t total = segment_size;
+    while(index + run < _sending.size() && run < kMaxSegments && run < iov_left) {
+      size_t next_size = _sending[index + run].size();
+      if(next_size == 0 || next_size > segment_size || total + next_size > kMaxDatagramSize)
+        break;
+      total += next_size;
+      run++;
+      if(next_size < segment_size)
+        break;
+    }
+    return run;
+  }
+
+  inline void DatagramSocket::flush() {
+    {
+      std::lock_guard<std::mutex> guard(_outboundMutex);
+      _flush_posted = false;
+      if(_sending.empty()) {
+        _sending.swap(_outbound);
+      } else {
+        for(auto& datagram : _outbound) {
+          _sending.push_back(std::move(datagram));
+        }
+        _outbound.clear();
+      }
+    }
+
+    const size_t control_size = CMSG_SPACE(sizeof(uint16_t));
+    while(_sending_next < _sending.size() && !_closed) {
+      unsigned int msg_count = 0;
+      size_t iov_count = 0;
+      for(size_t index = _sending_next; index < _sending.size() && msg_count < kSendBatch && iov_count < kMaxSendIov; msg_count++) {
+        size_t run = gsoRunLength(index, kMaxSendIov - iov_count);
+        for(size_t i = 0; i < run; i++) {
+          _send_iovs[iov_count + i].iov_base = const_cast<char*>(_sending[index + i].data());
+          _send_iovs[iov_count + i].iov_len = _sending[index + i].size();
+        }
+
+        msghdr& msg = _send_msgs[msg_count].msg_hdr;
+        msg = msghdr{};
+        msg.msg_iov = &_send_iovs[iov_count];
+        msg.msg_iovlen = run;
+        if(run > 1) {
+          msg.msg_control = _send_control.data() + msg_count * control_size;
+          msg.msg_controllen = control_size;
+          cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+          cmsg->cmsg_level = SOL_UDP;
+          cmsg->cmsg_type = UDP_SEGMENT;
+          cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+          uint16_t segment_size = static_cast<uint16_t>(_sending[index].size());
+          std::memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+        }
+        _send_msg_datagrams[msg_count] = run;
+        iov_count += run;
+        index += run;
+      }
+
+      int sent = sendmmsg(_fd, _send_msgs.data(), msg_count, MSG_NOSIGNAL);
+      if(sent < 0) {
+        if(errno == ECONNREFUSED) {
+          if(_onRefused)
+            _onRefused();
+          continue;
+        }
+        if(errno == EINTR)
+          continue;
+        // The socket buffer is full, an EPOLLOUT edge will resume the flush
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+          return;
+        if(_send_msg_datagrams[0] > 1 && (errno == EIO || errno == EINVAL)) {
+          _gso = false;
+          continue;
+        }
+        std::cout << "[CRIER] ERROR: Failed to send datagram, it was dropped: " << std::strerror(errno) << std::endl;
+        _sending_next += _send_msg_datagrams[0];
+        continue;
+      }
+      for(int i = 0; i < sent; i++) {
+        _sending_next += _send_msg_datagrams[i];
+      }
+    }
+    _sending.clear();
+    _sending_next = 0;
+  }
+
+  inline void DatagramSocket::teardown(const std::string& reason, bool notify) {
+    if(_fd >= 0) {
+      _loop.removeFd(_fd);
+      ::close(_fd);
+      _fd = -1;
+    }
+    {
+      std::lock_guard<std::mutex> guard(_outboundMutex);
+      _outbound.clear();
+    }
+    _sending.clear();
+    _sending_next = 0;
+    CloseHandler onClose = std::move(_onClose);
+    _onDatagram = nullptr;
+    _onClose = nullptr;
+    _onRefused = nullptr;
+    if(notify && onClose)
+      onClose(reason);
+  }
+}
+
+#endif
@@ -0,0 +1,580 @@
+#ifndef CRIER_IO_URING_TRANSPORT_HPP
+#define CRIER_IO_URING_TRANSPORT_HPP
+
+#include <memory>
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <crier/TransportConcept.hpp>
+#include <crier/transports/StreamConnection.hpp>
+#include <crier/transports/private/IoUring.hpp>
+#include <crier/transports/private/ResolvedAddress.hpp>
+
+namespace crier {
+
+  /// IoUringTransport
+  /// Implementation of the Transport concept over tcp sockets driven by io_uring (Linux 6.0 or newer). Uses the same length-prefixed framing as TcpTransport,
+  /// so both transports can talk to one another.
+  //  - Inbound data is received with a single multishot recv, which picks buffers out of a provided buffer ring. Frames that fit entirely in one of those
+  //    buffers are handed to crier straight from it (through the raw data callback), without ever being copied into a std::string.
+  //  - Outbound frames are copied once, by sendData, into buffers registered with the ring, and sent from there with zero-copy sends.
+  //    Frames sent in a burst are packed into the same buffer, and go out in a single operation.
+  //  - Everything sendData queues until the ring thread wakes up is submitted in one batch, together with any buffer returns, in one io_uring_enter.
+  //  The transport runs a single thread for its ring, started on connect. This is the thread your Immediate callbacks will run on.
+  //  connect is asynchronous, just like TcpTransport's. If the kernel doesn't support the required io_uring features, connect fails with
+  //  the transport closed event describing the reason.
+  class IoUringTransport : public TransportConcept {
+  public:
+    struct Options {
+      /// Submission queue size.
+      unsigned int ring_entries = 256;
+      /// Number of buffers in the provided buffer ring used for receiving. Must be a power of 2.
+      unsigned int recv_buffers = 64;
+      unsigned int recv_buffer_size = 64 * 1024;
+      /// Number of registered buffers used for sending. Frames bigger than a send buffer are sent from a regular heap allocation instead.
+      unsigned int send_buffers = 8;
+      unsigned int send_buffer_size = 256 * 1024;
+      /// Frames larger than this will be considered garbage, and will result in the connection being dropped.
+      size_t max_frame_size = StreamConnection::kDefaultMaxFrameSize;
+      /// Disables Nagle's algorithm, trading some bandwidth for latency on small messages.
+      bool tcp_no_delay = true;
+    };
+
+    IoUringTransport();
+    explicit IoUringTransport(const Options& options);
+
+    /// Moving an IoUringTransport is only supported before it's connected (for handing an instance over to a crier constructor).
+    IoUringTransport(IoUringTransport&& other);
+
+    ~IoUringTransport();
+
+    void connect(const std::string& host, int port) override;
+    void disconnect() override;
+    bool isConnected() const override;
+
+    void sendData(const std::string& data_to_send) override;
+
+  private:
+    struct Session;
+
+    enum CompletionTag : unsigned long long { kConnectTag = 1, kWakeTag, kRecvTag, kWriteTag, kZeroCopyWriteTag = 16 };
+
+    std::shared_ptr<Session> currentSession() const;
+    int openSocket(Session& session, size_t first);
+    bool setupSession(Session& session, std::string& err);
+    void run(std::shared_ptr<Session> session);
+    void armConnect(Session& session);
+    void handleCompletion(Session& session, const io_uring_cqe& cqe);
+    void onWriteCompleted(Session& session, const io_uring_cqe& cqe);
+    void armWake(Session& session);
+    void armRecv(Session& session);
+    void submitNextWrite(Session& session);
+    void processInbound(Session& session, const char* data, size_t size);
+    void deliverFrame(const char* data, size_t size);
+    void closeSession(Session& session, const std::string& reason, bool notify);
+    void joinRingThread();
+
+    Options _options;
+    std::shared_ptr<Session> _session;
+    mutable std::mutex _sessionMutex;
+    std::thread _thread;
+    std::atomic<bool> _connected;
+  };
+
+  /// Everything tied to a single connection. Shared between the ring thread and sendData callers, so it's only released once both are done with it.
+  struct IoUringTransport::Session {
+    struct OutboundChunk {
+      int buffer_index;   // -1 when the chunk lives in heap instead of a registered buffer
+      std::string heap;
+      size_t size;
+      size_t sent;
+    };
+
+    IoUring ring;
+    int socket_fd = -1;
+    int wake_fd = -1;
+    std::vector<ResolvedAddress> addresses;
+    size_t address_index = 0;
+    uint64_t wake_value = 0;
+
+    io_uring_buf_ring* recv_ring = nullptr;
+    char* recv_memory = static_cast<char*>(MAP_FAILED);
+    size_t recv_memory_size = 0;
+    std::vector<char> partial_frame;
+
+    char* send_memory = static_cast<char*>(MAP_FAILED);
+    size_t send_memory_size = 0;
+    std::vector<int> free_send_buffers;
+    std::vector<int> send_notifications_pending;
+    std::vector<bool> send_buffer_queued;
+    std::deque<OutboundChunk> outbound;
+    bool write_in_flight = false;
+    std::mutex outboundMutex;
+
+    bool connected = false;   // Only touched from the ring thread
+    std::atomic<bool> wake_pending{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> closed{false};
+
+    ~Session() {
+      // Stop anything else from arriving, and release the ring before the buffers it may still be pointing to
+      if(socket_fd >= 0)
+        shutdown(socket_fd, SHUT_RDWR);
+      ring.shutdown();
+      if(recv_memory != MAP_FAILED)
+        munmap(recv_memory, recv_memory_size);
+      if(send_memory != MAP_FAILED)
+        munmap(send_memory, send_memory_size);
+      if(socket_fd >= 0)
+        close(socket_fd);
+      if(wake_fd >= 0)
+        close(wake_fd);
+    }
+  };
+
+  inline IoUringTransport::IoUringTransport() : IoUringTransport(Options()) {}
+
+  inline IoUringTransport::IoUringTransport(const Options& options) : _options(options), _connected(false) {}
+
+  inline IoUringTransport::IoUringTransport(IoUringTransport&& other) : TransportConcept(std::move(other)), _options(other._options), _connected(false) {}
+
+  inline IoUringTransport::~IoUringTransport() {
+    auto session = currentSession();
+    if(session) {
+      session->closed = true;
+      session->stopping = true;
+      uint64_t one = 1;
+      ssize_t written = write(session->wake_fd, &one, sizeof(one));
+      (void)written;
+    }
+    joinRingThread();
+  }
+
+  inline void IoUringTransport::connect(const std::string& host, int port) {
+    auto previous = currentSession();
+    if(previous) {
+      previous->closed = true;
+      previous->stopping = true;
+      uint64_t one = 1;
+      ssize_t written = write(previous->wake_fd, &one, sizeof(one));
+      (void)written;
+    }
+    joinRingThread();
+    _connected = false;
+
+    auto session = std::make_shared<Session>();
+
+    std::string err;
+    session->addresses = resolveAddresses(host, port, SOCK_STREAM, err);
+    if(session->addresses.empty()) {
+      _on_disconnect_cb(err);
+      return;
+    }
+    int socket_err = openSocket(*session, 0);
+    if(socket_err != 0) {
+      _on_disconnect_cb(std::strerror(socket_err));
+      return;
+    }
+    if(!setupSession(*session, err)) {
+      _on_disconnect_cb(err);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(_sessionMutex);
+      _session = session;
+    }
+    _thread = std::thread([this, session](){ run(session); });
+  }
+
+  inline void IoUringTransport::disconnect() {
+    auto session = currentSession();
+    _connected = false;
+    if(!session || session->closed.exchange(true))
+      return;
+
+    session->stopping = true;
+    uint64_t one = 1;
+    ssize_t written = write(session->wake_fd, &one, sizeof(one));
+    (void)written;
+    joinRingThread();
+    _on_disconnect_cb("User closed transport");
+  }
+
+  inline bool IoUringTransport::isConnected() const {
+    return _connected;
+  }
+
+  inline void IoUringTransport::sendData(const std::string& data_to_send) {
+    auto session = currentSession();
+    if(!session || session->closed)
+      return;
+
+    const size_t size = data_to_send.size();
+    const size_t total = StreamConnection::kHeaderSize + size;
+    const size_t buffer_size = _options.send_buffer_size;
+    {
+      std::lock_guard<std::mutex> guard(session->outboundMutex);
+      auto& outbound = session->outbound;
+
+      // Pack into the last registered buffer if it isn't being sent already and has room for the whole frame
+      bool appended = false;
+      if(!outbound.empty()) {
+        auto& back = outbound.back();
+        bool back_in_flight = session->write_in_flight && outbound.size() == 1;
+        if(back.buffer_index >= 0 && !back_in_flight && back.size + total <= buffer_size) {
+          char* out = session->send_memory + back.buffer_index * buffer_size + back.size;
+          StreamConnection::writeFrameHeader(out, size);
+          std::memcpy(out + StreamConnection::kHeaderSize, data_to_send.data(), size);
+          back.size += total;
+          appended = true;
+        }
+      }
+
+      if(!appended) {
+        if(total <= buffer_size && !session->free_send_buffers.empty()) {
+          int index = session->free_send_buffers.back();
+          session->free_send_buffers.pop_back();
+          session->send_buffer_queued[index] = true;
+          char* out = session->send_memory + index * buffer_size;
+          StreamConnection::writeFrameHeader(out, size);
+          std::memcpy(out + StreamConnection::kHeaderSize, data_to_send.data(), size);
+          outbound.push_back(Session::OutboundChunk{index, std::string(), total, 0});
+        } else {
+          std::string frame(StreamConnection::kHeaderSize, '\0');
+          StreamConnection::writeFrameHeader(&frame[0], size);
+          frame.append(data_to_send);
+          outbound.push_back(Session::OutboundChunk{-1, std::move(frame), total, 0});
+        }
+      }
+    }
+
+    // One wake up per batch: whatever else is queued before the ring thread runs goes out with it
+    if(!session->wake_pending.exchange(true)) {
+      uint64_t one = 1;
+      ssize_t written = write(session->wake_fd, &one, sizeof(one));
+      (void)written;
+    }
+  }
+
+  inline std::shared_ptr<IoUringTransport::Session> IoUringTransport::currentSession() const {
+    std::lock_guard<std::mutex> guard(_sessionMutex);
+    return _session;
+  }
+
+  inline int IoUringTransport::openSocket(Session& session, size_t first) {
+    if(session.socket_fd >= 0) {
+      close(session.socket_fd);
+      session.socket_fd = -1;
+    }
+    int socket_err = EADDRNOTAVAIL;
+    for(size_t i = first; i < session.addresses.size(); i++) {
+      const ResolvedAddress& address = session.addresses[i];
+      session.socket_fd = socket(address.family, address.socktype | SOCK_CLOEXEC, address.protocol);
+      if(session.socket_fd < 0) {
+        socket_err = errno;
+        continue;
+      }
+      session.address_index = i;
+      if(_options.tcp_no_delay) {
+        int one = 1;
+        setsockopt(session.socket_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      }
+      return 0;
+    }
+    return socket_err;
+  }
+
+  inline bool IoUringTransport::setupSession(Session& session, std::string& err) {
+    session.wake_fd = eventfd(0, EFD_CLOEXEC);
+    if(session.wake_fd < 0) {
+      err = std::strerror(errno);
+      return false;
+    }
+    if(!session.ring.init(_options.ring_entries, err))
+      return false;
+
+    // Receive side: one provided buffer ring, handed over to the kernel in full
+    session.recv_memory_size = size_t(_options.recv_buffers) * _options.recv_buffer_size;
+    session.recv_memory = static_cast<char*>(mmap(nullptr, session.recv_memory_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0));
+    if(session.recv_memory == MAP_FAILED) {
+      err = std::strerror(errno);
+      return false;
+    }
+    session.recv_ring = session.ring.registerBufferRing(_options.recv_buffers, 0, err);
+    if(session.recv_ring == nullptr)
+      return false;
+    for(unsigned int i = 0; i < _options.recv_buffers; i++) {
+      IoUring::bufferRingAdd(session.recv_ring, _options.recv_buffers, session.recv_memory + size_t(i) * _options.recv_buffer_size,
+                             _options.recv_buffer_size, static_cast<unsigned short>(i), i);
+    }
+    IoUring::bufferRingAdvance(session.recv_ring, _options.recv_buffers);
+
+    // Send side: registered buffers, used for zero-copy sends
+    session.send_memory_size = size_t(_options.send_buffers) * _options.send_buffer_size;
+    session.send_memory = static_cast<char*>(mmap(nullptr, session.send_memory_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0));
+    if(session.send_memory == MAP_FAILED) {
+      err = std::strerror(errno);
+      return false;
+    }
+    std::vector<iovec> send_buffers(_options.send_buffers);
+    for(unsigned int i = 0; i < _options.send_buffers; i++) {
+      send_buffers[i].iov_base = session.send_memory + size_t(i) * _options.send_buffer_size;
+      send_buffers[i].iov_len = _options.send_buffer_size;
+      session.free_send_buffers.push_back(static_cast<int>(_options.send_buffers - 1 - i));
+    }
+    session.send_notifications_pending.assign(_options.send_buffers, 0);
+    session.send_buffer_queued.assign(_options.send_buffers, false);
+    return session.ring.registerBuffers(send_buffers.data(), _options.send_buffers, err);
+  }
+
+  inline void IoUringTransport::run(std::shared_ptr<Session> session) {
+    armConnect(*session);
+    armWake(*session);
+
+    while(!session->stopping) {
+      int res = session->ring.submitAndWait(1);
+      if(res < 0 && res != -EBUSY && res != -EAGAIN) {
+        closeSession(*session, std::string("io_uring_enter failed: ") + std::strerror(-res), true);
+        break;
+      }
+      session->ring.forEachCompletion([this, &session](const io_uring_cqe& cqe){
+        if(!session->stopping)
+          handleCompletion(*session, cqe);
+      });
+      if(!session->stopping)
+        submitNextWrite(*session);
+    }
+  }
+
+  inline void IoUringTransport::armConnect(Session& session) {
+    const ResolvedAddress& address = session.addresses[session.address_index];
+    io_uring_sqe* sqe = session.ring.getSqe();
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = session.socket_fd;
+    sqe->addr = reinterpret_cast<unsigned long>(address.sockAddr());
+    sqe->off = address.length;
+    sqe->user_data = kConnectTag;
+  }
+
+  inline void IoUringTransport::handleCompletion(Session& session, const io_uring_cqe& cqe) {
+    switch(cqe.user_data) {
+      case kConnectTag:
+        if(cqe.res < 0) {
+          // Refused, the next address gets its turn before giving up
+          if(openSocket(session, session.address_index + 1) == 0) {
+            armConnect(session);
+            return;
+          }
+          closeSession(session, std::strerror(-cqe.res), true);
+          return;
+        }
+        session.connected = true;
+        _connected = true;
+        armRecv(session);
+        _on_connect_cb();
+        break;
+
+      case kWakeTag:
+        session.wake_pending = false;
+        armWake(session);
+        break;
+
+      case kRecvTag: {
+        if(cqe.res == -ENOBUFS) {
+          armRecv(session);
+          return;
+        }
+        if(cqe.res <= 0) {
+          closeSession(session, cqe.res == 0 ? "Connection closed by peer" : std::strerror(-cqe.res), true);
+          return;
+        }
+        unsigned short buffer_id = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        char* buffer = session.recv_memory + size_t(buffer_id) * _options.recv_buffer_size;
+        processInbound(session, buffer, static_cast<size_t>(cqe.res));
+
+        // Frames were either delivered or copied aside, so the buffer goes straight back to the kernel
+        IoUring::bufferRingAdd(session.recv_ring, _options.recv_buffers, buffer, _options.recv_buffer_size, buffer_id, 0);
+        IoUring::bufferRingAdvance(session.recv_ring, 1);
+        if(!(cqe.flags & IORING_CQE_F_MORE) && !session.closed)
+          armRecv(session);
+        break;
+      }
+
+      default:
+        onWriteCompleted(session, cqe);
+        break;
+    }
+  }
+
+  inline void IoUringTransport::onWriteCompleted(Session& session, const io_uring_cqe& cqe) {
+    bool failed = false;
+    {
+      std::lock_guard<std::mutex> guard(session.outboundMutex);
+      // Zero-copy sends carry their registered buffer index in the user data. Their buffer can only be reused once the kernel notifies it's done with it,
+      // which comes as a separate completion, unless the result completion already says no notification will follow.
+      if(cqe.user_data >= kZeroCopyWriteTag) {
+        int index = static_cast<int>(cqe.user_data - kZeroCopyWriteTag);
+        bool notification_done = (cqe.flags & IORING_CQE_F_NOTIF) || !(cqe.flags & IORING_CQE_F_MORE);
+        if(notification_done && --session.send_notifications_pending[index] == 0 && !session.send_buffer_queued[index])
+          session.free_send_buffers.push_back(index);
+        if(cqe.flags & IORING_CQE_F_NOTIF)
+          return;
+      }
+
+      session.write_in_flight = false;
+      if(cqe.res < 0) {
+        failed = true;
+      } else {
+        auto& front = session.outbound.front();
+        front.sent += static_cast<size_t>(cqe.res);
+        if(front.sent == front.size) {
+          if(front.buffer_index >= 0) {
+            session.send_buffer_queued[front.buffer_index] = false;
+            if(session.send_notifications_pending[front.buffer_index] == 0)
+              session.free_send_buffers.push_back(front.buffer_index);
+          }
+          session.outbound.pop_front();
+        }
+      }
+    }
+    if(failed)
+      closeSession(session, std::strerror(-cqe.res), true);
+  }
+
+  inline void IoUringTransport::armWake(Session& session) {
+    io_uring_sqe* sqe = session.ring.getSqe();
+    if(sqe == nullptr)
+      return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = session.wake_fd;
+    sqe->addr = reinterpret_cast<unsigned long>(&session.wake_value);
+    sqe->len = sizeof(session.wake_value);
+    sqe->user_data = kWakeTag;
+  }
+
+  inline void IoUringTransport::armRecv(Session& session) {
+    io_uring_sqe* sqe = session.ring.getSqe();
+    if(sqe == nullptr)
+      return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = session.socket_fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = kRecvTag;
+  }
+
+  inline void IoUringTransport::submitNextWrite(Session& session) {
+    std::lock_guard<std::mutex> guard(session.outboundMutex);
+    if(session.write_in_flight || session.outbound.empty() || !session.connected || session.closed)
+      return;
+    io_uring_sqe* sqe = session.ring.getSqe();
+    if(sqe == nullptr)
+      return;
+
+    auto& front = session.outbound.front();
+    sqe->fd = session.socket_fd;
+    sqe->len = static_cast<unsigned int>(front.size - front.sent);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    if(front.buffer_index >= 0) {
+      sqe->opcode = IORING_OP_SEND_ZC;
+      sqe->user_data = kZeroCopyWriteTag + front.buffer_index;
+      sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+      sqe->buf_index = static_cast<unsigned short>(front.buffer_index);
+      sqe->addr = reinterpret_cast<unsigned long>(session.send_memory + front.buffer_index * _options.send_buffer_size + front.sent);
+      session.send_notifications_pending[front.buffer_index]++;
+    } else {
+      sqe->opcode = IORING_OP_SEND;
+      sqe->user_data = kWriteTag;
+      sqe->addr = reinterpret_cast<unsigned long>(front.heap.data() + front.sent);
+    }
+    session.write_in_flight = true;
+  }
+
+  inline void IoUringTransport::processInbound(Session& session, const char* data, size_t size) {
+    const size_t header_size = StreamConnection::kHeaderSize;
+    auto& partial = session.partial_frame;
+
+    // Complete a frame left over from previous buffers first (the only case where received data gets copied)
+    while(!partial.empty() && size > 0 && !session.closed) {
+      size_t needed = header_size;
+      if(partial.size() >= header_size)
+        needed += StreamConnection::readFrameHeader(partial.data());
+      size_t take = std::min(needed - partial.size(), size);
+      partial.insert(partial.end(), data, data + take);
+      data += take;
+      size -= take;
+
+      if(partial.size() == header_size && StreamConnection::readFrameHeader(partial.data()) > _options.max_frame_size) {
+        closeSession(session, "Frame exceeds maximum allowed size", true);
+        return;
+      }
+      if(partial.size() >= header_size && partial.size() == header_size + StreamConnection::readFrameHeader(partial.data())) {
+        deliverFrame(partial.data() + header_size, partial.size() - header_size);
+        partial.clear();
+      }
+    }
+
+    // Frames entirely contained in this buffer are handed over in place
+    while(size >= header_size && !session.closed) {
+      size_t frame_size = StreamConnection::readFrameHeader(data);
+      if(frame_size > _options.max_frame_size) {
+        closeSession(session, "Frame exceeds maximum allowed size", true);
+        return;
+      }
+      if(size < header_size + frame_size)
+        break;
+      deliverFrame(data + header_size, frame_size);
+      data += header_size + frame_size;
+      size -= header_size + frame_size;
+    }
+
+    if(size > 0 && !session.closed)
+      partial.insert(partial.end(), data, data + size);
+  }
+
+  inline void IoUringTransport::deliverFrame(const char* data, size_t size) {
+    if(_on_raw_data_cb) {
+      _on_raw_data_cb(data, size);
+    } else {
+      _on_data_cb(std::string(data, size));
+    }
+  }
+
+  inline void IoUringTransport::closeSession(Session& session, const std::string& reason, bool notify) {
+    if(session.closed.exchange(true))
+      return;
+    session.stopping = true;
+    _connected = false;
+    if(notify)
+      _on_disconnect_cb(reason);
+  }
+
+  inline void IoUringTransport::joinRingThread() {
+    if(!_thread.joinable())
+      return;
+    if(_thread.get_id() == std::this_thread::get_id()) {
+      // Disconnected from within one of our own callbacks, the ring thread exits on its own once it returns
+      _thread.detach();
+    } else {
+      _thread.join();
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef CRIER_LOAD_GENERATOR_TRANSPORT_HPP
+#define CRIER_LOAD_GENERATOR_TRANSPORT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <crier/TransportConcept.hpp>
+#include <crier/Metrics.hpp>
+#include <crier/transports/private/InjectorThread.hpp>
+
+namespace crier {
+
+  /// LoadGeneratorTransport
+  /// Implementation of the Transport concept with no peer behind it: it feeds crier a synthetic stream of inbound messages, following a load profile,
+  /// for soak and throughput testing dispatch, queues and memory use locally, for as long as needed.
+  //  Payloads are root messages serialized once up front (see addMessage), each injected message being drawn from them at random, by weight.
+  //  They're handed to crier through the raw data callback, straight out of the transport's own copy, so generating them costs next to nothing.
+  //  The profile is a list of phases, each injecting at a target rate for a while, played in order and looped (see Options::constantRate and Options::bursts).
+  //  connect starts a generator thread, which is the thread your Immediate callbacks will run on. The transport opened event triggers right away,
+  //  and the transport closed event on disconnect, or if there are no payloads to inject. Messages sent go nowhere, they're only counted.
+  //  stats() reports how fast crier took the load in: how long it took with each message, and how far behind the profile that left the generator.
+  class LoadGeneratorTransport : public TransportConcept {
+  public:
+    /// A stretch of the profile, injecting messages_per_second for duration. A rate of 0 injects as fast as crier takes them in.
+    struct Phase {
+      std::chrono::milliseconds duration;
+      double messages_per_second;
+    };
+
+    struct Options {
+      /// Phases to play, in order. Empty injects as fast as crier takes them in, with no end.
+      std::vector<Phase> profile;
+      /// Whether to start over once the last phase ends, or stop injecting.
+      bool loop = true;
+      /// Stops injecting after this many messages, 0 for no limit.
+      uint64_t max_messages = 0;
+      /// Seed payloads are drawn with, so runs can be repeated.
+      uint32_t seed = 1;
+
+      /// A steady messages_per_second, with no end.
+      static Options constantRate(double messages_per_second) {
+        Options options;
+        options.profile.push_back({std::chrono::milliseconds{1000}, messages_per_second});
+        return options;
+      }
+
+      /// base_rate, bursting to burst_rate for burst_length out of every period, with no end.
+      static Options bursts(double base_rate, double burst_rate, std::chrono::milliseconds period, std::chrono::milliseconds burst_length) {
+        Options options;
+        options.profile.push_back({burst_length, burst_rate});
+        if(period > burst_length)
+          options.profile.push_back({period - burst_length, base_rate});
+        return options;
+      }
+    };
+
+    /// How the latest connection's load went.
+    struct Stats {
+      /// Messages handed to crier, and their total size.
+      uint64_t injected = 0;
+      uint64_t injected_bytes = 0;
+      /// Messages the profile called for that weren't injected before their phase ended, crier having been too slow with the ones before them.
+      uint64_t missed = 0;
+      /// Messages crier sent, and were discarded.
+      uint64_t sent = 0;
+      /// Time since connecting, or until the generator stopped.
+      std::chrono::nanoseconds elapsed{0};
+      /// How long crier took with each message, from handing it over until it returned: parsing and dispatching, and running its callbacks when Immediate.
+      HistogramSnapshot consume_time;
+      /// How far behind its scheduled time the latest message was injected, and the furthest behind any was. A lag that keeps on
+      //  growing means crier can't keep up with the rate.
+      std::chrono::nanoseconds lag{0};
+      std::chrono::nanoseconds max_lag{0};
+
+      double injectedPerSecond() const {
+        return elapsed.count() > 0 ? static_cast<double>(injected) * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+      }
+    };
+
+    LoadGeneratorTransport();
+    explicit LoadGeneratorTransport(const Options& options);
+
+    /// Moving a LoadGeneratorTransport is only supported before it's connected (for handing an instance over to a crier constructor).
+    LoadGeneratorTransport(LoadGeneratorTransport&& other);
+
+    /// Adds serialized root message data to the payloads, drawn weight out of the sum of all weights of the time. Must be called before connecting.
+    void addPayload(const std::string& data, double weight = 1.0);
+
+    /// Serializes the root message once, and adds it to the payloads (see addPayload).
+    template <typename ProtoRootMsg>
+    void addMessage(const ProtoRootMsg& root, double weight = 1.0) {
+      addPayload(root.SerializeAsString(), weight);
+    }
+
+    void connect(const std::string& host, int port) override;
+    void disconnect() override;
+    bool isConnected() const override;
+
+    void sendData(const std::string& data_to_send) override;
+
+    /// True once the generator stopped on its own, at the end of a profile that doesn't loop, or after max_messages.
+    bool finished() const;
+
+    /// Blocks until the generator stops on its own, or timeout passes. Returns finished().
+    bool waitUntilFinished(std::chrono::milliseconds timeout);
+
+    Stats stats() const;
+
+  private:
+    struct Run;
+
+    static void run(Run& run);
+
+    Options _options;
+    std::vector<std::string> _payloads;
+    std::vector<double> _cumulativeWeights;
+    InjectorThread<Run> _generator;
+  };
+
+  /// Everything tied to a single connection, the generator thread's own copy of the options and payloads among it.
+  struct LoadGeneratorTransport::Run : InjectorRun {
+    using InjectorRun::InjectorRun;
+
+    Options options;
+    std::vector<std::string> payloads;
+    std::vector<double> cumulative_weights;
+
+    std::atomic<uint64_t> injected{0};
+    std::atomic<uint64_t> injected_bytes{0};
+    std::atomic<uint64_t> missed{0};
+    std::atomic<int64_t> lag{0};
+  };
+
+  inline LoadGeneratorTransport::LoadGeneratorTransport() : LoadGeneratorTransport(Options()) {}
+
+  inline LoadGeneratorTransport::LoadGeneratorTransport(const Options& options) : _options(options) {}
+
+  inline LoadGeneratorTransport::LoadGeneratorTransport(LoadGeneratorTransport&& other)
+    : TransportConcept(std::move(other)), _options(std::move(other._options)), _payloads(std::move(other._payloads)),
+      _cumulativeWeights(std::move(other._cumulativeWeights)) {}
+
+  inline void LoadGeneratorTransport::addPayload(const std::string& data, double weight) {
+    if(weight <= 0)
+      return;
+    _payloads.push_back(data);
+    _cumulativeWeights.push_back((_cumulativeWeights.empty() ? 0.0 : _cumulativeWeights.back()) + weight);
+  }
+
+  inline void LoadGeneratorTransport::connect(const std::string&, int) {
+    auto previous = _generator.current();
+    _generator.stop();
+    if(previous)
+      previous->connected = false;
+
+    if(_payloads.empty()) {
+      _on_disconnect_cb("Load generator has no payloads to inject");
+      return;
+    }
+
+    auto run = std::make_shared<Run>(_on_connect_cb, _on_data_cb, _on_raw_data_cb, _on_disconnect_cb);
+    run->options = _options;
+    run->payloads = _payloads;
+    run->cumulative_weights = _cumulativeWeights;
+    _generator.start(run, &LoadGeneratorTransport::run, true);
+  }
+
+  inline void LoadGeneratorTransport::disconnect() {
+    auto run = _generator.current();
+    if(!run || !run->connected)
+      return;
+
+    _generator.stop();
+    run->close("User closed transport");
+  }
+
+  inline bool LoadGeneratorTransport::isConnected() const {
+    auto run = _generator.current();
+    return run && run->connected;
+  }
+
+  inline void LoadGeneratorTransport::sendData(const std::string&) {
+    auto run = _generator.current();
+    if(run)
+      run->sent.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  inline bool LoadGeneratorTransport::finished() const {
+    auto run = _generator.current();
+    return run && run->finished;
+  }
+
+  inline bool LoadGeneratorTransport::waitUntilFinished(std::chrono::milliseconds timeout) {
+    return _generator.waitUntilFinished(timeout);
+  }
+
+  inline LoadGeneratorTransport::Stats LoadGeneratorTransport::stats() const {
+    Stats stats;
+    auto run = _generator.current();
+    if(!run)
+      return stats;
+    stats.injected = run->injected.load(std::memory_order_relaxed);
+    stats.injected_bytes = run->injected_bytes.load(std::memory_order_relaxed);
+    stats.missed = run->missed.load(std::memory_order_relaxed);
+    stats.sent = run->sent.load(std::memory_order_relaxed);
+    stats.elapsed = run->elapsedTime();
+    stats.consume_time = run->consume_time.snapshot();
+    stats.lag = std::chrono::nanoseconds{run->lag.load(std::memory_order_relaxed)};
+    stats.max_lag = std::chrono::nanoseconds{run->max_lag.load(std::memory_order_relaxed)};
+    return stats;
+  }
+
+  inline void LoadGeneratorTransport::run(Run& run) {
+    using Clock = std::chrono::steady_clock;
+    const Options& options = run.options;
+    const std::vector<std::string>& payloads = run.payloads;
+    const std::vector<double>& cumulative_weights = run.cumulative_weights;
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<double> draw(0.0, cumulative_weights.back());
+    std::vector<Phase> profile;
+    std::copy_if(options.profile.begin(), options.profile.end(), std::back_inserter(profile),
+      [](const Phase& phase){ return phase.duration.count() > 0; });
+    const bool loop = options.loop || profile.empty();
+    if(profile.empty())
+      profile.push_back({std::chrono::milliseconds{1000}, 0.0});
+
+    // Messages are scheduled k / rate into their phase, and phases back to back from when the generator started, so falling behind doesn't shift the profile
+    size_t phase = 0;
+    Clock::time_point phase_start = run.started;
+    uint64_t phase_injected = 0;
+    Clock::time_point now = Clock::now();
+    while(!run.stopping.load(std::memory_order_relaxed)) {
+      if(options.max_messages > 0 && run.injected.load(std::memory_order_relaxed) >= options.max_messages)
+        break;
+      const Phase& current = profile[phase];
+      const double rate = current.messages_per_second;
+      const Clock::time_point phase_end = phase_start + current.duration;
+      if(now >= phase_end) {
+        if(rate > 0) {
+          uint64_t scheduled = static_cast<uint64_t>(std::chrono::duration<double>(current.duration).count() * rate);
+          if(scheduled > phase_injected)
+            run.missed.fetch_add(scheduled - phase_injected, std::memory_order_relaxed);
+        }
+        phase_start = phase_end;
+        phase_injected = 0;
+        if(++phase == profile.size()) {
+          if(!loop)
+            break;
+          phase = 0;
+        }
+        continue;
+      }
+
+      if(rate > 0) {
+        auto due = phase_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(phase_injected / rate));
+        if(due >= phase_end) {
+          // Everything this phase called for went out, idle until the next one
+          if(!run.sleepUntil(phase_end))
+            break;
+          now = Clock::now();
+          continue;
+        }
+        if(due > now) {
+          if(!run.sleepUntil(due))
+            break;
+          now = Clock::now();
+        }
+        int64_t lag = std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count();
+        lag = lag > 0 ? lag : 0;
+        run.lag.store(lag, std::memory_order_relaxed);
+        run.recordLag(lag);
+      }
+
+      size_t payload = 0;
+      if(payloads.size() > 1) {
+        payload = static_cast<size_t>(std::upper_bound(cumulative_weights.begin(), cumulative_weights.end(), draw(random)) - cumulative_weights.begin());
+        payload = std::min(payload, payloads.size() - 1);
+      }
+      const std::string& data = payloads[payload];
+      now = run.inject(data.data(), data.size(), now);
+      run.injected.fetch_add(1, std::memory_order_relaxed);
+      run.injected_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+      phase_injected++;
+    }
+  }
+}
+
+#endif
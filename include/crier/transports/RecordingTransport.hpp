@@ -0,0 +1,101 @@
+#ifndef CRIER_RECORDING_TRANSPORT_HPP
+#define CRIER_RECORDING_TRANSPORT_HPP
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <crier/TransportConcept.hpp>
+#include <crier/private/TransportTraits.hpp>
+#include <crier/transports/private/CaptureFile.hpp>
+
+namespace crier {
+
+  /// RecordingTransport
+  /// Decorator over any other transport, recording all of its traffic into a capture file (see capture::Writer for the format) for ReplayTransport
+  /// to play back later: inbound and outbound data as it goes through, and the transport opened and closed events, each with the time it happened at.
+  //  The capture is a file mapped in memory, and recording a message a copy into it under a lock, so it can stay on while chasing down a problem
+  //  under real traffic. The file is created (or truncated) on construction, and trimmed to its records once the transport is destroyed.
+  //  If it can't be created an error is logged, and the transport works just the same, recording nothing.
+  //  Everything else is up to the inner transport, reachable through 'inner()', which runs with crier as it would without the decorator.
+  template <typename Inner>
+  class RecordingTransport : public TransportConcept {
+  public:
+    explicit RecordingTransport(const std::string& capture_path, Inner inner = Inner())
+      : _inner(std::move(inner)), _capture(new capture::Writer()) {
+      std::string err;
+      if(!_capture->open(capture_path, err))
+        std::cout << "[CRIER] ERROR: " << err << ", traffic won't be recorded" << std::endl;
+    }
+
+    /// Moving a RecordingTransport is only supported before crier sets its callbacks (for handing an instance over to a crier constructor).
+    RecordingTransport(RecordingTransport&& other) = default;
+
+    void connect(const std::string& host, int port) override { _inner.connect(host, port); }
+    void disconnect() override { _inner.disconnect(); }
+    bool isConnected() const override { return _inner.isConnected(); }
+
+    void sendData(const std::string& data_to_send) override {
+      _capture->append(capture::RecordKind::Outbound, data_to_send);
+      _inner.sendData(data_to_send);
+    }
+
+    void sendDataBatch(const std::vector<std::string>& batch) override {
+      for(const auto& data : batch) {
+        _capture->append(capture::RecordKind::Outbound, data);
+      }
+      transport_traits::sendDataBatch(_inner, batch, 0);
+    }
+
+    void setOnConnectCallback(const std::function<void(void)>& on_connect) override {
+      _on_connect_cb = on_connect;
+      _inner.setOnConnectCallback([this](){
+        _capture->append(capture::RecordKind::Connect);
+        _on_connect_cb();
+      });
+    }
+
+    void setOnDataCallback(const std::function<void(const std::string&)>& on_data) override {
+      _on_data_cb = on_data;
+      _inner.setOnDataCallback([this](const std::string& data){
+        _capture->append(capture::RecordKind::Inbound, data);
+        _on_data_cb(data);
+      });
+    }
+
+    void setOnRawDataCallback(const std::function<void(const char*, size_t)>& on_raw_data) override {
+      _on_raw_data_cb = on_raw_data;
+      transport_traits::setOnRawDataCallback(_inner, [this](const char* data, size_t size){
+        _capture->append(capture::RecordKind::Inbound, data, size);
+        _on_raw_data_cb(data, size);
+      }, 0);
+    }
+
+    void setOnDisconnectCallback(const std::function<void(const std::string&)>& on_disconnect) override {
+      _on_disconnect_cb = on_disconnect;
+      _inner.setOnDisconnectCallback([this](const std::string& reason){
+        _capture->append(capture::RecordKind::Disconnect, reason);
+        _on_disconnect_cb(reason);
+      });
+    }
+
+    /// Runs the inner transport on the given loop, for inner transports that can be (see UdpTransport::attachToLoop, for instance).
+    template <typename Loop, typename Wrapped = Inner>
+    auto attachToLoop(Loop& loop) -> decltype(std::declval<Wrapped&>().attachToLoop(loop), void()) {
+      _inner.attachToLoop(loop);
+    }
+
+    Inner& inner() { return _inner; }
+
+    /// Whether traffic is being recorded: false if the capture couldn't be created, or stopped growing.
+    bool recording() const { return _capture->isOpen(); }
+
+  private:
+    Inner _inner;
+    std::unique_ptr<capture::Writer> _capture;
+  };
+}
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef CRIER_REPLAY_TRANSPORT_HPP
+#define CRIER_REPLAY_TRANSPORT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <crier/TransportConcept.hpp>
+#include <crier/Metrics.hpp>
+#include <crier/transports/private/CaptureFile.hpp>
+#include <crier/transports/private/InjectorThread.hpp>
+
+namespace crier {
+
+  /// ReplayTransport
+  /// Implementation of the Transport concept playing a capture recorded by RecordingTransport back into crier, turning real traffic into a
+  /// repeatable test or benchmark. Inbound data is handed to crier straight out of the mapped capture, and the recorded transport opened and
+  /// closed events trigger as they happened, either at their original timing (optionally sped up) or as fast as crier takes them in.
+  //  connect starts a replay thread, which is the thread your Immediate callbacks will run on. If the capture doesn't start with a transport
+  //  opened event, it triggers right away. Connecting again while a replay is under way (reconnecting after a recorded closed event, for instance)
+  //  carries on with it rather than starting over, and the capture's next opened event reconnects.
+  //  What crier sends is only counted, next to the amount of outbound messages recorded up to that point of the capture, for telling apart a
+  //  replay where crier didn't answer as it did originally.
+  //  A capture that can't be read triggers the transport closed event, with the reason.
+  class ReplayTransport : public TransportConcept {
+  public:
+    enum class Timing {
+      /// Each record at the time it was recorded at, from the start of the replay, divided by speed.
+      Original,
+      /// Each record as soon as crier returns from the one before.
+      AsFastAsPossible
+    };
+
+    struct Options {
+      Timing timing = Timing::Original;
+      /// How many times faster than recorded to replay with Original timing.
+      double speed = 1.0;
+      /// Whether to start over once the capture ends.
+      bool loop = false;
+    };
+
+    /// How the latest replay went.
+    struct Stats {
+      /// Inbound messages handed to crier, and their total size.
+      uint64_t replayed = 0;
+      uint64_t replayed_bytes = 0;
+      /// Messages crier sent during the replay, and outbound messages recorded up to where it got to.
+      uint64_t sent = 0;
+      uint64_t recorded_sent = 0;
+      /// Times the capture was played through.
+      uint64_t passes = 0;
+      /// Time since connecting, or until the replay stopped.
+      std::chrono::nanoseconds elapsed{0};
+      /// How long crier took with each inbound message, from handing it over until it returned.
+      HistogramSnapshot consume_time;
+      /// How far behind its original time the furthest behind message was replayed (Original timing only). Crier slower than the
+      //  recorded traffic shows here.
+      std::chrono::nanoseconds max_lag{0};
+
+      double replayedPerSecond() const {
+        return elapsed.count() > 0 ? static_cast<double>(replayed) * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+      }
+    };
+
+    explicit ReplayTransport(const std::string& capture_path);
+    ReplayTransport(const std::string& capture_path, const Options& options);
+
+    /// Moving a ReplayTransport is only supported before it's connected (for handing an instance over to a crier constructor).
+    ReplayTransport(ReplayTransport&& other);
+
+    void connect(const std::string& host, int port) override;
+    void disconnect() override;
+    bool isConnected() const override;
+
+    void sendData(const std::string& data_to_send) override;
+
+    /// True once the whole capture was replayed (never, when looping).
+    bool finished() const;
+
+    /// Blocks until the whole capture was replayed, or timeout passes. Returns finished().
+    bool waitUntilFinished(std::chrono::milliseconds timeout);
+
+    Stats stats() const;
+
+  private:
+    struct Replay;
+
+    static void run(Replay& replay);
+
+    std::string _path;
+    Options _options;
+    InjectorThread<Replay> _replayer;
+  };
+
+  /// Everything tied to a single replay, the replay thread's own copy of the options among it.
+  struct ReplayTransport::Replay : InjectorRun {
+    using InjectorRun::InjectorRun;
+
+    Options options;
+    capture::Reader reader;
+
+    std::atomic<uint64_t> replayed{0};
+    std::atomic<uint64_t> replayed_bytes{0};
+    std::atomic<uint64_t> recorded_sent{0};
+    std::atomic<uint64_t> passes{0};
+  };
+
+  inline ReplayTransport::ReplayTransport(const std::string& capture_path) : ReplayTransport(capture_path, Options()) {}
+
+  inline ReplayTransport::ReplayTransport(const std::string& capture_path, const Options& options) : _path(capture_path), _options(options) {}
+
+  inline ReplayTransport::ReplayTransport(ReplayTransport&& other)
+    : TransportConcept(std::move(other)), _path(std::move(other._path)), _options(other._options) {}
+
+  inline void ReplayTransport::connect(const std::string&, int) {
+    auto previous = _replayer.current();
+    if(previous && !previous->stopping && !previous->finished)
+      return;
+    _replayer.stop();
+    if(previous)
+      previous->connected = false;
+
+    auto replay = std::make_shared<Replay>(_on_connect_cb, _on_data_cb, _on_raw_data_cb, _on_disconnect_cb);
+    replay->options = _options;
+    std::string err;
+    if(!replay->reader.open(_path, err)) {
+      _on_disconnect_cb(err);
+      return;
+    }
+    _replayer.start(replay, &ReplayTransport::run);
+  }
+
+  inline void ReplayTransport::disconnect() {
+    auto replay = _replayer.current();
+    if(!replay)
+      return;
+    _replayer.stop();
+    replay->close("User closed transport");
+  }
+
+  inline bool ReplayTransport::isConnected() const {
+    auto replay = _replayer.current();
+    return replay && replay->connected;
+  }
+
+  inline void ReplayTransport::sendData(const std::string&) {
+    auto replay = _replayer.current();
+    if(replay)
+      replay->sent.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  inline bool ReplayTransport::finished() const {
+    auto replay = _replayer.current();
+    return replay && replay->finished;
+  }
+
+  inline bool ReplayTransport::waitUntilFinished(std::chrono::milliseconds timeout) {
+    return _replayer.waitUntilFinished(timeout);
+  }
+
+  inline ReplayTransport::Stats ReplayTransport::stats() const {
+    Stats stats;
+    auto replay = _replayer.current();
+    if(!replay)
+      return stats;
+    stats.replayed = replay->replayed.load(std::memory_order_relaxed);
+    stats.replayed_bytes = replay->replayed_bytes.load(std::memory_order_relaxed);
+    stats.sent = replay->sent.load(std::memory_order_relaxed);
+    stats.recorded_sent = replay->recorded_sent.load(std::memory_order_relaxed);
+    stats.passes = replay->passes.load(std::memory_order_relaxed);
+    stats.elapsed = replay->elapsedTime();
+    stats.consume_time = replay->consume_time.snapshot();
+    stats.max_lag = std::chrono::nanoseconds{replay->max_lag.load(std::memory_order_relaxed)};
+    return stats;
+  }
+
+  inline void ReplayTransport::run(Replay& r) {
+    using Clock = std::chrono::steady_clock;
+    const Options& options = r.options;
+    const bool original_timing = options.timing == Timing::Original && options.speed > 0;
+    Clock::time_point pass_start = r.started;
+    std::chrono::nanoseconds first_time{-1};
+    capture::Record record;
+
+    while(!r.stopping) {
+      if(!r.reader.next(record)) {
+        r.passes.fetch_add(1, std::memory_order_relaxed);
+        if(!options.loop || first_time.count() < 0)
+          break;
+        r.reader.rewind();
+        pass_start = Clock::now();
+        first_time = std::chrono::nanoseconds{-1};
+        continue;
+      }
+      if(first_time.count() < 0) {
+        first_time = record.time;
+        // Recorded from a transport that was already open
+        if(record.kind != capture::RecordKind::Connect)
+          r.open();
+      }
+
+      if(original_timing) {
+        auto due = pass_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::nano>(
+          static_cast<double>((record.time - first_time).count()) / options.speed));
+        auto now = Clock::now();
+        if(due > now) {
+          if(!r.sleepUntil(due))
+            break;
+        } else {
+          r.recordLag(std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count());
+        }
+      }
+
+      switch(record.kind) {
+        case capture::RecordKind::Connect:
+          r.open();
+          break;
+        case capture::RecordKind::Disconnect:
+          r.close(std::string(record.data, record.size));
+          break;
+        case capture::RecordKind::Inbound:
+          r.inject(record.data, record.size, Clock::now());
+          r.replayed.fetch_add(1, std::memory_order_relaxed);
+          r.replayed_bytes.fetch_add(record.size, std::memory_order_relaxed);
+          break;
+        case capture::RecordKind::Outbound:
+          r.recorded_sent.fetch_add(1, std::memory_order_relaxed);
+          break;
+        default:
+          // Written by a later version, skip it
+          break;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,425 @@
+#ifndef CRIER_SHM_TRANSPORT_HPP
+#define CRIER_SHM_TRANSPORT_HPP
+
+#include <memory>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <new>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <crier/TransportConcept.hpp>
+#include <crier/transports/private/ShmChannel.hpp>
+
+namespace crier {
+
+  /// ShmTransport
+  /// Implementation of the Transport concept for processes on the same host (Linux only), over a pair of single-producer, single-consumer rings
+  /// in shared memory (see shm::ChannelHeader for the layout). Messages are copied once into the outbound ring, and read by the other side straight out of it.
+  //  connect(name, channel) opens the shared memory object "/crier-<name>-<channel>". The first endpoint to connect creates it, and the second attaches to it.
+  //  The name is released as soon as both are on, so connecting with it again starts a brand new channel.
+  //  The creator's transport opened event triggers once the other endpoint attaches, while the attacher's triggers right away.
+  //  Messages sent before the other endpoint attaches wait in the ring for it.
+  //  Each endpoint runs a reader thread, which is the thread your Immediate callbacks will run on. Once its inbound ring runs dry it keeps polling it for
+  //  busy_poll_us, and then goes to sleep on a futex the writer wakes it through. While the reader is awake, sending and receiving make no syscalls at all.
+  //  sendData never blocks: if the outbound ring is full, messages are held (in order) and written by the reader thread as soon as the peer makes room.
+  //  The transport closed event triggers when the peer disconnects or its process exits.
+  class ShmTransport : public TransportConcept {
+  public:
+    struct Options {
+      /// Size in bytes of each of the two rings. Must be a power of 2. Messages can be up to half of it.
+      //  Only the endpoint creating the channel uses its own, the one attaching uses whatever the channel was created with.
+      uint32_t ring_size = 4 * 1024 * 1024;
+      /// How long the reader thread polls an empty ring before going to sleep. Polling keeps latency to a minimum, but burns a core while doing so.
+      unsigned int busy_poll_us = 0;
+    };
+
+    ShmTransport();
+    explicit ShmTransport(const Options& options);
+
+    /// Moving a ShmTransport is only supported before it's connected (for handing an instance over to a crier constructor).
+    ShmTransport(ShmTransport&& other);
+
+    ~ShmTransport();
+
+    void connect(const std::string& host, int port) override;
+    void disconnect() override;
+    bool isConnected() const override;
+
+    void sendData(const std::string& data_to_send) override;
+
+    /// Returns the amount of messages held waiting for room in the outbound ring.
+    size_t pendingMessages() const;
+
+  private:
+    struct Session;
+
+    std::shared_ptr<Session> currentSession() const;
+    bool openChannel(Session& session, const std::string& name, std::string& err);
+    void run(std::shared_ptr<Session> session);
+    bool flushHeld(Session& session);
+    void closeSession(Session& session, const std::string& reason, bool notify);
+    void stopSession(Session& session);
+    void joinReaderThread();
+
+    Options _options;
+    std::shared_ptr<Session> _session;
+    mutable std::mutex _sessionMutex;
+    std::thread _thread;
+    std::atomic<bool> _connected;
+  };
+
+  /// Everything tied to a single channel. Shared between the reader thread and sendData callers, so it's only unmapped once both are done with it.
+  struct ShmTransport::Session {
+    std::string name;
+    char* mapping = static_cast<char*>(MAP_FAILED);
+    size_t mapping_size = 0;
+    shm::ChannelHeader* header = nullptr;
+    int role = 0;
+    shm::RingWriter writer;
+    shm::RingReader reader;
+
+    std::deque<std::string> held;
+    std::mutex sendMutex;
+
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> closed{false};
+
+    shm::EndpointState& self() { return header->endpoints[role]; }
+    shm::EndpointState& peer() { return header->endpoints[1 - role]; }
+
+    ~Session() {
+      if(mapping != MAP_FAILED)
+        munmap(mapping, mapping_size);
+    }
+  };
+
+  inline ShmTransport::ShmTransport() : ShmTransport(Options()) {}
+
+  inline ShmTransport::ShmTransport(const Options& options) : _options(options), _connected(false) {}
+
+  inline ShmTransport::ShmTransport(ShmTransport&& other) : TransportConcept(std::move(other)), _options(other._options), _connected(false) {}
+
+  inline ShmTransport::~ShmTransport() {
+    auto session = currentSession();
+    if(session) {
+      session->closed = true;
+      stopSession(*session);
+    }
+    joinReaderThread();
+  }
+
+  inline void ShmTransport::connect(const std::string& host, int port) {
+    auto previous = currentSession();
+    if(previous) {
+      previous->closed = true;
+      stopSession(*previous);
+    }
+    joinReaderThread();
+    _connected = false;
+
+    if(host.find('/') != std::string::npos) {
+      _on_disconnect_cb("Shared memory channel names can't contain '/'");
+      return;
+    }
+
+    auto session = std::make_shared<Session>();
+    std::string err;
+    session->name = "/crier-" + host + "-" + std::to_string(port);
+    if(!openChannel(*session, session->name, err)) {
+      _on_disconnect_cb(err);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(_sessionMutex);
+      _session = session;
+    }
+    _thread = std::thread([this, session](){ run(session); });
+  }
+
+  inline void ShmTransport::disconnect() {
+    auto session = currentSession();
+    _connected = false;
+    if(!session || session->closed.exchange(true))
+      return;
+
+    stopSession(*session);
+    joinReaderThread();
+    _on_disconnect_cb("User closed transport");
+  }
+
+  inline bool ShmTransport::isConnected() const {
+    return _connected;
+  }
+
+  inline void ShmTransport::sendData(const std::string& data_to_send) {
+    auto session = currentSession();
+    if(!session || session->closed)
+      return;
+    if(data_to_send.size() > shm::maxPayloadSize(session->header->ring_size)) {
+      std::cout << "[CRIER] ERROR: Message doesn't fit the shared memory ring, it was dropped" << std::endl;
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(session->sendMutex);
+      // Anything already held goes first, the reader thread will get to this one after it
+      if(!session->held.empty() || !session->writer.write(data_to_send.data(), data_to_send.size())) {
+        bool first_held = session->held.empty();
+        session->held.push_back(data_to_send);
+        session->self().waiting_space.store(1, std::memory_order_relaxed);
+        // Our own reader thread is the one in charge of flushing what's held, and may be asleep
+        if(first_held)
+          shm::notify(session->self(), true);
+        return;
+      }
+    }
+    shm::notify(session->peer(), false);
+  }
+
+  inline size_t ShmTransport::pendingMessages() const {
+    auto session = currentSession();
+    if(!session)
+      return 0;
+    std::lock_guard<std::mutex> guard(session->sendMutex);
+    return session->held.size();
+  }
+
+  inline std::shared_ptr<ShmTransport::Session> ShmTransport::currentSession() const {
+    std::lock_guard<std::mutex> guard(_sessionMutex);
+    return _session;
+  }
+
+  inline bool ShmTransport::openChannel(Session& session, const std::string& name, std::string& err) {
+    const uint32_t ring_size = _options.ring_size;
+    if(ring_size < 4096 || (ring_size & (ring_size - 1)) != 0) {
+      err = "Shared memory ring size must be a power of 2, and at least 4096";
+      return false;
+    }
+
+    for(int attempt = 0; attempt < 2; attempt++) {
+      int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+      if(fd >= 0) {
+        // Creator: size and map the channel, and only then publish it through the magic value
+        session.mapping_size = shm::channelSize(ring_size);
+        if(ftruncate(fd, static_cast<off_t>(session.mapping_size)) != 0) {
+          err = std::string("Failed to size shared memory channel: ") + std::strerror(errno);
+          ::close(fd);
+          shm_unlink(name.c_str());
+          return false;
+        }
+        session.mapping = static_cast<char*>(mmap(nullptr, session.mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        ::close(fd);
+        if(session.mapping == MAP_FAILED) {
+          err = std::string("Failed to map shared memory channel: ") + std::strerror(errno);
+          shm_unlink(name.c_str());
+          return false;
+        }
+        session.header = new (session.mapping) shm::ChannelHeader();
+        session.header->ring_size = ring_size;
+        session.role = 0;
+        session.self().pid.store(getpid(), std::memory_order_relaxed);
+        session.self().attached.store(1, std::memory_order_relaxed);
+        session.header->magic.store(shm::kMagic, std::memory_order_release);
+        break;
+      }
+      if(errno != EEXIST) {
+        err = std::string("Failed to create shared memory channel: ") + std::strerror(errno);
+        return false;
+      }
+
+      // Attacher: the channel might still be being set up, give its creator a moment to publish it
+      fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+      if(fd < 0) {
+        // Unlinked between both calls, try to be the creator again
+        continue;
+      }
+      struct stat st{};
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+      while(fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) < shm::ringsOffset() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      if(static_cast<size_t>(st.st_size) < shm::ringsOffset()) {
+        ::close(fd);
+        err = "Shared memory channel was never set up by its creator";
+        return false;
+      }
+      session.mapping_size = static_cast<size_t>(st.st_size);
+      session.mapping = static_cast<char*>(mmap(nullptr, session.mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+      ::close(fd);
+      if(session.mapping == MAP_FAILED) {
+        err = std::string("Failed to map shared memory channel: ") + std::strerror(errno);
+        return false;
+      }
+      session.header = reinterpret_cast<shm::ChannelHeader*>(session.mapping);
+      while(session.header->magic.load(std::memory_order_acquire) != shm::kMagic && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      int creator_pid = session.header->endpoints[0].pid.load(std::memory_order_relaxed);
+      bool creator_alive = creator_pid > 0 && (kill(creator_pid, 0) == 0 || errno != ESRCH);
+      if(session.header->magic.load(std::memory_order_acquire) != shm::kMagic || !creator_alive || session.header->endpoints[0].closed.load()) {
+        // Left behind by an endpoint that's gone, take its place
+        munmap(session.mapping, session.mapping_size);
+        session.mapping = static_cast<char*>(MAP_FAILED);
+        shm_unlink(name.c_str());
+        continue;
+      }
+      if(session.mapping_size < shm::channelSize(session.header->ring_size)) {
+        err = "Shared memory channel is smaller than its rings";
+        return false;
+      }
+
+      session.role = 1;
+      if(session.self().attached.exchange(1) != 0) {
+        err = "Shared memory channel already has both of its endpoints";
+        return false;
+      }
+      session.self().pid.store(getpid(), std::memory_order_relaxed);
+      // Both ends have it mapped now, so the name can go (and be reused by a new channel)
+      shm_unlink(name.c_str());
+      shm::notify(session.peer(), true);
+      break;
+    }
+    if(session.header == nullptr) {
+      err = "Failed to open shared memory channel";
+      return false;
+    }
+
+    const uint32_t size = session.header->ring_size;
+    char* rings = session.mapping + shm::ringsOffset();
+    const int out = session.role;
+    const int in = 1 - session.role;
+    session.writer = shm::RingWriter(rings + size_t(out) * size, size, &session.header->tails[out], &session.header->heads[out]);
+    session.reader = shm::RingReader(rings + size_t(in) * size, size, &session.header->tails[in], &session.header->heads[in]);
+    return true;
+  }
+
+  inline void ShmTransport::run(std::shared_ptr<Session> session) {
+    Session& s = *session;
+    bool announced = false;
+    auto idle_since = std::chrono::steady_clock::now();
+    const auto busy_poll = std::chrono::microseconds(_options.busy_poll_us);
+
+    while(!s.stopping) {
+      if(!announced && s.peer().attached.load(std::memory_order_acquire)) {
+        announced = true;
+        _connected = true;
+        _on_connect_cb();
+        continue;
+      }
+
+      size_t received = s.reader.drain([this, &s](const char* data, size_t size){
+        if(s.closed)
+          return;
+        if(_on_raw_data_cb) {
+          _on_raw_data_cb(data, size);
+        } else {
+          _on_data_cb(std::string(data, size));
+        }
+      });
+      // The peer may be holding messages until there's room for them
+      if(received > 0 && s.peer().waiting_space.exchange(0))
+        shm::notify(s.peer(), true);
+      bool flushed = flushHeld(s);
+
+      if(announced && s.peer().closed.load(std::memory_order_acquire) && s.reader.empty()) {
+        closeSession(s, "Connection closed by peer", true);
+        break;
+      }
+      if(received > 0 || flushed) {
+        idle_since = std::chrono::steady_clock::now();
+        continue;
+      }
+      if(std::chrono::steady_clock::now() - idle_since < busy_poll)
+        continue;
+
+      // Nothing to do: announce we're going to sleep, and check once more before actually doing so
+      uint32_t doorbell = s.self().doorbell.load(std::memory_order_acquire);
+      s.self().sleeping.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      bool has_work = !s.reader.empty() || s.stopping || (!announced && s.peer().attached.load()) || s.peer().closed.load();
+      if(!has_work) {
+        // Wakes up every now and then to find out whether the peer process is still around
+        timespec timeout{0, 100 * 1000 * 1000};
+        shm::futexWait(s.self().doorbell, doorbell, &timeout);
+        int peer_pid = s.peer().pid.load(std::memory_order_relaxed);
+        if(announced && peer_pid > 0 && kill(peer_pid, 0) != 0 && errno == ESRCH) {
+          s.self().sleeping.store(0, std::memory_order_relaxed);
+          closeSession(s, "Peer process exited", true);
+          break;
+        }
+      }
+      s.self().sleeping.store(0, std::memory_order_relaxed);
+      idle_since = std::chrono::steady_clock::now();
+    }
+  }
+
+  inline bool ShmTransport::flushHeld(Session& session) {
+    bool wrote = false;
+    {
+      std::lock_guard<std::mutex> guard(session.sendMutex);
+      while(!session.held.empty()) {
+        if(!session.writer.write(session.held.front().data(), session.held.front().size())) {
+          // Still full: ask the reader to ring us once it makes room, and check again in case it did so before seeing the request
+          session.self().waiting_space.store(1, std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if(!session.writer.write(session.held.front().data(), session.held.front().size()))
+            break;
+        }
+        session.held.pop_front();
+        wrote = true;
+      }
+      if(session.held.empty())
+        session.self().waiting_space.store(0, std::memory_order_relaxed);
+    }
+    if(wrote)
+      shm::notify(session.peer(), false);
+    return wrote;
+  }
+
+  inline void ShmTransport::closeSession(Session& session, const std::string& reason, bool notify) {
+    if(session.closed.exchange(true))
+      return;
+    session.stopping = true;
+    session.self().closed.store(1, std::memory_order_release);
+    _connected = false;
+    if(notify)
+      _on_disconnect_cb(reason);
+  }
+
+  inline void ShmTransport::stopSession(Session& session) {
+    session.stopping = true;
+    session.self().closed.store(1, std::memory_order_release);
+    // Nobody attached, so the name is still ours to remove
+    if(session.role == 0 && !session.peer().attached.load(std::memory_order_acquire))
+      shm_unlink(session.name.c_str());
+    // Wake both readers up: ours so it exits, the peer's so it finds out
+    shm::notify(session.self(), true);
+    shm::notify(session.peer(), true);
+  }
+
+  inline void ShmTransport::joinReaderThread() {
+    if(!_thread.joinable())
+      return;
+    if(_thread.get_id() == std::this_thread::get_id()) {
+      // Disconnected from within one of our own callbacks, the reader thread exits on its own once it returns
+      _thread.detach();
+    } else {
+      _thread.join();
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,388 @@
+#ifndef CRIER_STREAM_CONNECTION_HPP
+#define CRIER_STREAM_CONNECTION_HPP
+
+#include <memory>
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+
+#include <crier/EventLoop.hpp>
+
+namespace crier {
+
+  /// StreamConnection
+  /// A non-blocking stream socket (tcp, unix, ...) driven by an EventLoop, which splits the byte stream into length-prefixed frames.
+  /// Every frame is a 4 byte big-endian payload size followed by the payload itself, which maps one to one with what crier hands to Transport::sendData.
+  //  Outbound frames are kept in a queue and flushed with scatter/gather writes, so many small messages sent in a burst leave in a single syscall.
+  //  Inbound frames are handed over as a pointer into the connection's read buffer, valid only for the duration of the frame handler call.
+  //  The fd is registered edge-triggered, so reads and writes always run until the kernel reports EAGAIN.
+  //  send and close can be called from any thread. The handlers are always invoked on the loop thread.
+  class StreamConnection : public std::enable_shared_from_this<StreamConnection> {
+  public:
+    using ConnectHandler = std::function<void()>;
+    using FrameHandler = std::function<void(const char* data, size_t size)>;
+    using CloseHandler = std::function<void(const std::string& reason)>;
+
+    static constexpr size_t kHeaderSize = 4;
+    static constexpr size_t kDefaultMaxFrameSize = 64 * 1024 * 1024;
+
+    /// Encodes a frame header for a payload of the given size into out, which must have room for kHeaderSize bytes.
+    static void writeFrameHeader(char* out, size_t size);
+
+    /// Decodes the payload size out of a frame header.
+    static size_t readFrameHeader(const char* header);
+
+    /// Creates a connection for an already created, non-blocking, socket. The connection takes ownership of the fd.
+    static std::shared_ptr<StreamConnection> create(EventLoop& loop, int fd, size_t max_frame_size = kDefaultMaxFrameSize);
+
+    ~StreamConnection();
+
+    /// Registers the socket with the loop.
+    //  - connecting, should be true if a non-blocking connect is still in progress. The onConnect handler is invoked once it completes, and frames sent
+    //    meanwhile are held until then. If false, the connection is considered established right away (for accepted sockets, for instance).
+    bool start(bool connecting, const ConnectHandler& onConnect, const FrameHandler& onFrame, const CloseHandler& onClose);
+
+    /// Frames and queues the data to be sent, and attempts to write it right away from the calling thread.
+    /// Returns false if the connection is already closed, in which case the data is dropped.
+    bool send(const char* data, size_t size);
+
+    /// Same as above, queuing a batch of frames together so they can leave in as few writes as possible.
+    bool sendBatch(const std::vector<std::string>& frames);
+
+    /// Closes the connection. Returns true if this call was the one to close it (only the first of many concurrent closes succeeds).
+    //  - notify, if true the onClose handler will be called with the given reason.
+    bool close(const std::string& reason, bool notify);
+
+    /// Returns true once the connection is established and until it is closed.
+    bool connected() const;
+
+    /// Returns the amount of bytes queued waiting for the socket to accept them.
+    size_t pendingBytes() const;
+
+  private:
+    StreamConnection(EventLoop& loop, int fd, size_t max_frame_size);
+
+    void onEvents(uint32_t events);
+    void onConnectCompleted();
+    void onReadable();
+    bool deliverFrames();
+    void queueFrameLocked(const char* data, size_t size);
+    bool flushLocked();
+    void teardown(const std::string& reason, bool notify);
+
+    EventLoop& _loop;
+    int _fd;
+    size_t _max_frame_size;
+    std::atomic<bool> _connecting;
+    std::atomic<bool> _closed;
+
+    ConnectHandler _onConnect;
+    FrameHandler _onFrame;
+    CloseHandler _onClose;
+
+    // Inbound buffer, only touched from the loop thread
+    std::vector<char> _inbound;
+    size_t _inbound_begin;
+    size_t _inbound_end;
+
+    std::deque<std::string> _outbound;
+    size_t _outbound_offset;
+    size_t _outbound_bytes;
+    mutable std::mutex _outboundMutex;
+  };
+
+  inline void StreamConnection::writeFrameHeader(char* out, size_t size) {
+    out[0] = static_cast<char>((size >> 24) & 0xFF);
+    out[1] = static_cast<char>((size >> 16) & 0xFF);
+    out[2] = static_cast<char>((size >> 8) & 0xFF);
+    out[3] = static_cast<char>(size & 0xFF);
+  }
+
+  inline size_t StreamConnection::readFrameHeader(const char* header) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(header);
+    return (size_t(bytes[0]) << 24) | (size_t(bytes[1]) << 16) | (size_t(bytes[2]) << 8) | size_t(bytes[3]);
+  }
+
+  inline std::shared_ptr<StreamConnection> StreamConnection::create(EventLoop& loop, int fd, size_t max_frame_size) {
+    return std::shared_ptr<StreamConnection>(new StreamConnection(loop, fd, max_frame_size));
+  }
+
+  inline StreamConnection::StreamConnection(EventLoop& loop, int fd, size_t max_frame_size) :
+  _loop(loop), _fd(fd), _max_frame_size(max_frame_size), _connecting(false), _closed(false),
+  _inbound(64 * 1024), _inbound_begin(0), _inbound_end(0), _outbound_offset(0), _outbound_bytes(0) {}
+
+  inline StreamConnection::~StreamConnection() {
+    if(_fd >= 0)
+      ::close(_fd);
+  }
+
+  inline bool StreamConnection::start(bool connecting, const ConnectHandler& onConnect, const FrameHandler& onFrame, const CloseHandler& onClose) {
+    _onConnect = onConnect;
+    _onFrame = onFrame;
+    _onClose = onClose;
+    _connecting = connecting;
+
+    std::shared_ptr<StreamConnection> self = shared_from_this();
+    return _loop.addFd(_fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [self](uint32_t events){ self->onEvents(events); });
+  }
+
+  inline bool StreamConnection::send(const char* data, size_t size) {
+    if(_closed)
+      return false;
+    bool ok = true;
+    {
+      std::lock_guard<std::mutex> guard(_outboundMutex);
+      bool was_idle = _outbound.empty();
+      queueFrameLocked(data, size);
+      // If there was something queued already, a write is pending on EPOLLOUT and will pick this frame up as well
+      if(was_idle && !_connecting)
+        ok = flushLocked();
+    }
+    if(!ok)
+      close(std::strerror(errno), true);
+    return ok;
+  }
+
+  inline bool StreamConnection::sendBatch(const std::vector<std::string>& frames) {
+    if(_closed)
+      return false;
+    bool ok = true;
+    {
+      std::lock_guard<std::mutex> guard(_outboundMutex);
+      bool was_idle = _outbound.empty();
+      for(const auto& frame : frames) {
+        queueFrameLocked(frame.data(), frame.size());
+      }
+      if(was_idle && !_connecting)
+        ok = flushLocked();
+    }
+    if(!ok)
+      close(std::strerror(errno), true);
+    return ok;
+  }
+
+  inline bool StreamConnection::close(const std::string& reason, bool notify) {
+    if(_closed.exchange(true))
+      return false;
+
+    // Always deferred, as close might have been called from within one of this connection's own handlers
+    std::shared_ptr<StreamConnection> self = shared_from_this();
+    if(_loop.running()) {
+      _loop.post([self, reason, notify](){ self->teardown(reason, notify); });
+    } else {
+      teardown(reason, notify);
+    }
+    return true;
+  }
+
+  inline bool StreamConnection::connected() const {
+    return !_connecting && !_closed;
+  }
+
+  inline size_t StreamConnection::pendingBytes() const {
+    std::lock_guard<std::mutex> guard(_outboundMutex);
+    return _outbound_bytes;
+  }
+
+  inline void StreamConnection::onEvents(uint32_t events) {
+    if(_closed)
+      return;
+
+    if(_connecting && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+      onConnectCompleted();
+      if(_closed)
+        return;
+    }
+
+    if(events & EPOLLIN) {
+      onReadable();
+      if(_closed)
+        return;
+    }
+
+    if(events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      close(err != 0 ? std::strerror(err) : "Connection closed by peer", true);
+      return;
+    }
+
+    if(events & EPOLLOUT) {
+      bool ok;
+      {
+        std::lock_guard<std::mutex> guard(_outboundMutex);
+        ok = flushLocked();
+      }
+      if(!ok)
+        close(std::strerror(errno), true);
+    }
+  }
+
+  inline void StreamConnection::onConnectCompleted() {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if(getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
+      err = errno;
+    if(err != 0) {
+      close(std::strerror(err), true);
+      return;
+    }
+
+    _connecting = false;
+    if(_onConnect)
+      _onConnect();
+
+    bool ok;
+    {
+      std::lock_guard<std::mutex> guard(_outboundMutex);
+      ok = flushLocked();
+    }
+    if(!ok)
+      close(std::strerror(errno), true);
+  }
+
+  inline void StreamConnection::onReadable() {
+    while(!_closed) {
+      // Keep at least a chunk worth of free space at the end of the buffer, compacting before growing
+      const size_t min_free = 16 * 1024;
+      if(_inbound.size() - _inbound_end < min_free) {
+        if(_inbound_begin > 0) {
+          std::memmove(_inbound.data(), _inbound.data() + _inbound_begin, _inbound_end - _inbound_begin);
+          _inbound_end -= _inbound_begin;
+          _inbound_begin = 0;
+        }
+        if(_inbound.size() - _inbound_end < min_free)
+          _inbound.resize(_inbound.size() * 2);
+      }
+
+      ssize_t n = ::recv(_fd, _inbound.data() + _inbound_end, _inbound.size() - _inbound_end, 0);
+      if(n > 0) {
+        _inbound_end += static_cast<size_t>(n);
+        if(!deliverFrames())
+          return;
+      } else if(n == 0) {
+        close("Connection closed by peer", true);
+        return;
+      } else if(errno == EINTR) {
+        continue;
+      } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      } else {
+        close(std::strerror(errno), true);
+        return;
+      }
+    }
+  }
+
+  inline bool StreamConnection::deliverFrames() {
+    while(!_closed && _inbound_end - _inbound_begin >= kHeaderSize) {
+      size_t frame_size = readFrameHeader(_inbound.data() + _inbound_begin);
+      if(frame_size > _max_frame_size) {
+        close("Frame exceeds maximum allowed size", true);
+        return false;
+      }
+      if(_inbound_end - _inbound_begin < kHeaderSize + frame_size) {
+        // Make sure a partially received large frame will fit once it's complete
+        if(kHeaderSize + frame_size > _inbound.size() - _inbound_begin && _inbound_begin == 0)
+          _inbound.resize(kHeaderSize + frame_size);
+        break;
+      }
+
+      const char* frame = _inbound.data() + _inbound_begin + kHeaderSize;
+      _inbound_begin += kHeaderSize + frame_size;
+      if(_onFrame)
+        _onFrame(frame, frame_size);
+    }
+    if(_inbound_begin == _inbound_end) {
+      _inbound_begin = 0;
+      _inbound_end = 0;
+    }
+    return !_closed;
+  }
+
+  inline void StreamConnection::queueFrameLocked(const char* data, size_t size) {
+    std::string frame(kHeaderSize, '\0');
+    writeFrameHeader(&frame[0], size);
+    frame.append(data, size);
+    _outbound_bytes += frame.size();
+    _outbound.push_back(std::move(frame));
+  }
+
+  inline bool StreamConnection::flushLocked() {
+    const size_t max_iov = 64;
+    iovec iov[max_iov];
+    // Torn down since the frame was queued
+    if(_fd < 0)
+      return false;
+
+    while(!_outbound.empty() && !_connecting) {
+      size_t iov_count = 0;
+      for(auto it = _outbound.begin(); it != _outbound.end() && iov_count < max_iov; ++it, ++iov_count) {
+        size_t offset = iov_count == 0 ? _outbound_offset : 0;
+        iov[iov_count].iov_base = const_cast<char*>(it->data() + offset);
+        iov[iov_count].iov_len = it->size() - offset;
+      }
+
+      msghdr msg{};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = iov_count;
+      ssize_t n = ::sendmsg(_fd, &msg, MSG_NOSIGNAL);
+      if(n < 0) {
+        if(errno == EINTR)
+          continue;
+        // The socket buffer is full, an EPOLLOUT edge will resume the flush
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+
+      size_t written = static_cast<size_t>(n);
+      _outbound_bytes -= written;
+      while(written > 0) {
+        size_t front_left = _outbound.front().size() - _outbound_offset;
+        if(written >= front_left) {
+          written -= front_left;
+          _outbound.pop_front();
+          _outbound_offset = 0;
+        } else {
+          _outbound_offset += written;
+          written = 0;
+        }
+      }
+    }
+    return true;
+  }
+
+  inline void StreamConnection::teardown(const std::string& reason, bool notify) {
+    if(_fd >= 0)
+      _loop.removeFd(_fd);
+    {
+      // Senders on other threads may be flushing into the socket, so it's closed under their lock
+      std::lock_guard<std::mutex> guard(_outboundMutex);
+      if(_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+      }
+      _outbound.clear();
+      _outbound_offset = 0;
+      _outbound_bytes = 0;
+    }
+    CloseHandler onClose = std::move(_onClose);
+    _onConnect = nullptr;
+    _onFrame = nullptr;
+    _onClose = nullptr;
+    if(notify && onClose)
+      onClose(reason);
+  }
+}
+
+#endif
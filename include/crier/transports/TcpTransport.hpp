@@ -0,0 +1,229 @@
+#ifndef CRIER_TCP_TRANSPORT_HPP
+#define CRIER_TCP_TRANSPORT_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <crier/TransportConcept.hpp>
+#include <crier/EventLoop.hpp>
+#include <crier/transports/StreamConnection.hpp>
+#include <crier/transports/private/ResolvedAddress.hpp>
+
+namespace crier {
+
+  /// TcpTransport
+  /// First-party implementation of the Transport concept over non-blocking tcp sockets (Linux only, as it's built on epoll).
+  /// Each message crier sends is written as a length-prefixed frame (see StreamConnection), so the other end must speak the same framing,
+  /// which is the case if it's also a crier instance using this transport.
+  //  The transport runs its own EventLoop thread, started on connect. This is the thread your Immediate callbacks will run on.
+  //  connect is asynchronous: the transport opened event triggers once the connection is actually established, and a failure to connect
+  //  triggers the transport closed event with the reason. Messages sent while the connection is still being established are held and sent once it is.
+  //  sendData is thread-safe and never blocks on the socket: data that doesn't fit in the socket buffer is queued and flushed when it drains.
+  class TcpTransport : public TransportConcept {
+  public:
+    struct Options {
+      /// Frames larger than this will be considered garbage, and will result in the connection being dropped.
+      size_t max_frame_size = StreamConnection::kDefaultMaxFrameSize;
+      /// Disables Nagle's algorithm, trading some bandwidth for latency on small messages.
+      bool tcp_no_delay = true;
+    };
+
+    TcpTransport();
+    explicit TcpTransport(const Options& options);
+
+    /// Moving a TcpTransport is only supported before it's connected (for handing an instance over to a crier constructor).
+    TcpTransport(TcpTransport&& other);
+
+    ~TcpTransport();
+
+    void connect(const std::string& host, int port) override;
+    void disconnect() override;
+    bool isConnected() const override;
+
+    void sendData(const std::string& data_to_send) override;
+    void sendDataBatch(const std::vector<std::string>& batch) override;
+
+    /// Runs the transport on the given loop (a Reactor's, typically) instead of on a thread of its own. Must be called before connect,
+    /// and the loop must outlive the transport. Crier calls this when attached to a Reactor.
+    void attachToLoop(EventLoop& loop);
+
+    /// Returns the amount of bytes queued waiting for the socket to accept them.
+    size_t pendingBytes() const;
+
+  protected:
+    /// Prepares the transport for a new connection, dropping the previous one (if any). Called before creating the socket.
+    void resetConnection();
+
+    /// Hands a socket, with a non-blocking connect already in progress, over to the transport's loop.
+    //  - retry, if set, runs instead of triggering the transport closed event if the connect fails, and returns false if there was nothing left to try.
+    void startConnection(int fd, const std::function<bool()>& retry = nullptr);
+
+    Options _options;
+
+  private:
+    /// Starts a connect to the first of the addresses, from first on, one can be started to. Returns 0, or the error of the last one tried.
+    int connectFrom(const std::shared_ptr<std::vector<ResolvedAddress>>& addresses, size_t first);
+
+    std::shared_ptr<StreamConnection> currentConnection() const;
+
+    std::unique_ptr<EventLoop> _own_loop;
+    EventLoop* _loop;
+    std::shared_ptr<StreamConnection> _connection;
+    mutable std::mutex _connectionMutex;
+    std::atomic<bool> _connected;
+  };
+
+  inline TcpTransport::TcpTransport() : TcpTransport(Options()) {}
+
+  inline TcpTransport::TcpTransport(const Options& options) : _options(options), _loop(nullptr), _connected(false) {}
+
+  inline TcpTransport::TcpTransport(TcpTransport&& other) : TransportConcept(std::move(other)), _options(other._options), _loop(other._loop), _connected(false) {}
+
+  inline TcpTransport::~TcpTransport() {
+    auto connection = currentConnection();
+    if(_own_loop) {
+      _own_loop->stop();
+      if(connection)
+        connection->close("Transport destroyed", false);
+    } else if(_loop && connection) {
+      // The loop is shared: close from its thread, so none of this transport's handlers is running, or will run again, once we're gone
+      _loop->runAndWait([connection](){ connection->close("Transport destroyed", false); });
+    }
+  }
+
+  inline void TcpTransport::attachToLoop(EventLoop& loop) {
+    if(!_own_loop)
+      _loop = &loop;
+  }
+
+  inline void TcpTransport::connect(const std::string& host, int port) {
+    resetConnection();
+
+    std::string err;
+    auto resolved = std::make_shared<std::vector<ResolvedAddress>>(resolveAddresses(host, port, SOCK_STREAM, err));
+    if(resolved->empty()) {
+      _on_disconnect_cb(err);
+      return;
+    }
+
+    // Each address is tried in turn, until a connection is established
+    int connect_err = connectFrom(resolved, 0);
+    if(connect_err != 0)
+      _on_disconnect_cb(std::strerror(connect_err));
+  }
+
+  inline int TcpTransport::connectFrom(const std::shared_ptr<std::vector<ResolvedAddress>>& addresses, size_t first) {
+    int connect_err = ECONNREFUSED;
+    for(size_t i = first; i < addresses->size(); i++) {
+      const ResolvedAddress& address = (*addresses)[i];
+      int fd = socket(address.family, address.socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address.protocol);
+      if(fd < 0) {
+        connect_err = errno;
+        continue;
+      }
+      if(_options.tcp_no_delay) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      }
+      if(::connect(fd, address.sockAddr(), address.length) == 0 || errno == EINPROGRESS) {
+        // Refused later on, once the connect completes, the next address gets its turn
+        startConnection(fd, [this, addresses, i](){ return connectFrom(addresses, i + 1) == 0; });
+        return 0;
+      }
+      connect_err = errno;
+      ::close(fd);
+    }
+    return connect_err;
+  }
+
+  inline void TcpTransport::resetConnection() {
+    auto previous = currentConnection();
+    if(previous)
+      previous->close("Reconnecting", false);
+    _connected = false;
+
+    if(!_loop) {
+      _own_loop.reset(new EventLoop());
+      _loop = _own_loop.get();
+    }
+    _loop->start();
+  }
+
+  inline void TcpTransport::startConnection(int fd, const std::function<bool()>& retry) {
+    auto connection = StreamConnection::create(*_loop, fd, _options.max_frame_size);
+    {
+      std::lock_guard<std::mutex> guard(_connectionMutex);
+      _connection = connection;
+    }
+    std::weak_ptr<StreamConnection> weak_connection = connection;
+    connection->start(true,
+      [this](){
+        _connected = true;
+        _on_connect_cb();
+      },
+      [this](const char* data, size_t size){
+        if(_on_raw_data_cb) {
+          _on_raw_data_cb(data, size);
+        } else {
+          _on_data_cb(std::string(data, size));
+        }
+      },
+      [this, weak_connection, retry](const std::string& reason){
+        // Only report if this is still the active connection, and not one replaced by a reconnect
+        if(currentConnection() != weak_connection.lock())
+          return;
+        if(!_connected && retry && retry())
+          return;
+        _connected = false;
+        _on_disconnect_cb(reason);
+      });
+  }
+
+  inline void TcpTransport::disconnect() {
+    auto connection = currentConnection();
+    _connected = false;
+    if(connection && connection->close("User closed transport", false))
+      _on_disconnect_cb("User closed transport");
+  }
+
+  inline bool TcpTransport::isConnected() const {
+    return _connected;
+  }
+
+  inline void TcpTransport::sendData(const std::string& data_to_send) {
+    auto connection = currentConnection();
+    if(connection)
+      connection->send(data_to_send.data(), data_to_send.size());
+  }
+
+  inline void TcpTransport::sendDataBatch(const std::vector<std::string>& batch) {
+    auto connection = currentConnection();
+    if(connection)
+      connection->sendBatch(batch);
+  }
+
+  inline size_t TcpTransport::pendingBytes() const {
+    auto connection = currentConnection();
+    return connection ? connection->pendingBytes() : 0;
+  }
+
+  inline std::shared_ptr<StreamConnection> TcpTransport::currentConnection() const {
+    std::lock_guard<std::mutex> guard(_connectionMutex);
+    return _connection;
+  }
+}
+
+#endif
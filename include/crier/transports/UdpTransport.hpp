@@ -0,0 +1,211 @@
+#ifndef CRIER_UDP_TRANSPORT_HPP
+#define CRIER_UDP_TRANSPORT_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <crier/TransportConcept.hpp>
+#include <crier/EventLoop.hpp>
+#include <crier/transports/DatagramSocket.hpp>
+#include <crier/transports/private/ResolvedAddress.hpp>
+
+namespace crier {
+
+  /// UdpTransport
+  /// First-party implementation of the Transport concept over a connected udp socket (Linux only, as it's built on epoll).
+  /// Each message crier sends travels as a single datagram, so messages can't be larger than what a datagram carries (see DatagramSocket::kMaxDatagramSize),
+  /// and, being udp, may be lost, duplicated or reordered along the way. Best suited to small, frequent and loss tolerant messages.
+  //  Messages are batched on both directions: everything sent until the transport thread wakes up leaves in a single sendmmsg, and inbound datagrams are
+  //  drained many per recvmmsg (see DatagramSocket, which also describes the optional GSO and GRO segmentation offloads).
+  //  The transport runs its own EventLoop thread, started on connect. This is the thread your Immediate callbacks will run on.
+  //  Since udp has no connection to establish, the transport opened event triggers right after connect, and the transport closed event only on
+  //  disconnect (or a failure to create the socket). A peer that isn't there just means datagrams go unanswered.
+  //  Of the addresses the host resolves to, the first one a socket can be connected to is used. Until the peer answers, the kernel reporting one of
+  //  the datagrams hit a closed port moves the transport on to the next address: datagrams sent to the previous one are lost.
+  class UdpTransport : public TransportConcept {
+  public:
+    using Options = DatagramSocket::Options;
+
+    UdpTransport();
+    explicit UdpTransport(const Options& options);
+
+    /// Moving a UdpTransport is only supported before it's connected (for handing an instance over to a crier constructor).
+    UdpTransport(UdpTransport&& other);
+
+    ~UdpTransport();
+
+    void connect(const std::string& host, int port) override;
+    void disconnect() override;
+    bool isConnected() const override;
+
+    void sendData(const std::string& data_to_send) override;
+
+    /// Runs the transport on the given loop (a Reactor's, typically) instead of on a thread of its own. Must be called before connect,
+    /// and the loop must outlive the transport. Crier calls this when attached to a Reactor.
+    void attachToLoop(EventLoop& loop);
+
+    /// Returns the amount of datagrams queued waiting to be sent.
+    size_t pendingDatagrams() const;
+
+  private:
+    /// Opens a socket to the first of the addresses, from first on, one can be connected to. Returns 0, or the error of the last one tried.
+    int openFrom(const std::shared_ptr<std::vector<ResolvedAddress>>& addresses, size_t first);
+
+    std::shared_ptr<DatagramSocket> currentSocket() const;
+
+    Options _options;
+    std::unique_ptr<EventLoop> _own_loop;
+    EventLoop* _loop;
+    std::shared_ptr<DatagramSocket> _socket;
+    mutable std::mutex _socketMutex;
+    std::atomic<bool> _connected;
+  };
+
+  inline UdpTransport::UdpTransport() : UdpTransport(Options()) {}
+
+  inline UdpTransport::UdpTransport(const Options& options) : _options(options), _loop(nullptr), _connected(false) {}
+
+  inline UdpTransport::UdpTransport(UdpTransport&& other) : TransportConcept(std::move(other)), _options(other._options), _loop(other._loop), _connected(false) {}
+
+  inline UdpTransport::~UdpTransport() {
+    auto socket = currentSocket();
+    if(_own_loop) {
+      _own_loop->stop();
+      if(socket)
+        socket->close("Transport destroyed", false);
+    } else if(_loop && socket) {
+      // The loop is shared: close from its thread, so none of this transport's handlers is running, or will run again, once we're gone
+      _loop->runAndWait([socket](){ socket->close("Transport destroyed", false); });
+    }
+  }
+
+  inline void UdpTransport::attachToLoop(EventLoop& loop) {
+    if(!_own_loop)
+      _loop = &loop;
+  }
+
+  inline void UdpTransport::connect(const std::string& host, int port) {
+    auto previous = currentSocket();
+    if(previous)
+      previous->close("Reconnecting", false);
+    _connected = false;
+
+    if(!_loop) {
+      _own_loop.reset(new EventLoop());
+      _loop = _own_loop.get();
+    }
+    _loop->start();
+
+    std::string err;
+    auto resolved = std::make_shared<std::vector<ResolvedAddress>>(resolveAddresses(host, port, SOCK_DGRAM, err));
+    if(resolved->empty()) {
+      _on_disconnect_cb(err);
+      return;
+    }
+    int open_err = openFrom(resolved, 0);
+    if(open_err != 0) {
+      _on_disconnect_cb(std::strerror(open_err));
+      return;
+    }
+
+    _connected = true;
+    // Reported from the loop thread, just like the stream transports do
+    std::weak_ptr<DatagramSocket> weak_socket = currentSocket();
+    _loop->post([this, weak_socket](){
+      auto socket = weak_socket.lock();
+      if(socket && socket->open() && currentSocket() == socket)
+        _on_connect_cb();
+    });
+  }
+
+  inline int UdpTransport::openFrom(const std::shared_ptr<std::vector<ResolvedAddress>>& addresses, size_t first) {
+    int connect_err = EADDRNOTAVAIL;
+    for(size_t i = first; i < addresses->size(); i++) {
+      const ResolvedAddress& address = (*addresses)[i];
+      int fd = socket(address.family, address.socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address.protocol);
+      if(fd < 0) {
+        connect_err = errno;
+        continue;
+      }
+      // Connecting a udp socket only fixes its peer address, so it completes right away (failing if the address can't be reached at all)
+      if(::connect(fd, address.sockAddr(), address.length) != 0) {
+        connect_err = errno;
+        ::close(fd);
+        continue;
+      }
+
+      auto socket = DatagramSocket::create(*_loop, fd, _options);
+      {
+        std::lock_guard<std::mutex> guard(_socketMutex);
+        _socket = socket;
+      }
+      std::weak_ptr<DatagramSocket> weak_socket = socket;
+      // Only touched from the loop thread
+      auto answered = std::make_shared<bool>(false);
+      socket->start(
+        [this, answered](const char* data, size_t size){
+          *answered = true;
+          if(_on_raw_data_cb) {
+            _on_raw_data_cb(data, size);
+          } else {
+            _on_data_cb(std::string(data, size));
+          }
+        },
+        [this, weak_socket](const std::string& reason){
+          // Only report if this is still the active socket, and not one replaced by a reconnect
+          if(currentSocket() == weak_socket.lock()) {
+            _connected = false;
+            _on_disconnect_cb(reason);
+          }
+        },
+        [this, weak_socket, answered, addresses, i](){
+          // Nobody there: the peer may be listening on another of the addresses (say, 127.0.0.1 rather than the ::1 localhost resolved to first)
+          auto refused = weak_socket.lock();
+          if(*answered || i + 1 >= addresses->size() || !refused || currentSocket() != refused)
+            return;
+          if(openFrom(addresses, i + 1) == 0)
+            refused->close("Refused", false);
+        });
+      return 0;
+    }
+    return connect_err;
+  }
+
+  inline void UdpTransport::disconnect() {
+    auto socket = currentSocket();
+    _connected = false;
+    if(socket && socket->close("User closed transport", false))
+      _on_disconnect_cb("User closed transport");
+  }
+
+  inline bool UdpTransport::isConnected() const {
+    return _connected;
+  }
+
+  inline void UdpTransport::sendData(const std::string& data_to_send) {
+    auto socket = currentSocket();
+    if(socket)
+      socket->send(data_to_send.data(), data_to_send.size());
+  }
+
+  inline size_t UdpTransport::pendingDatagrams() const {
+    auto socket = currentSocket();
+    return socket ? socket->pendingDatagrams() : 0;
+  }
+
+  inline std::shared_ptr<DatagramSocket> UdpTransport::currentSocket() const {
+    std::lock_guard<std::mutex> guard(_socketMutex);
+    return _socket;
+  }
+}
+
+#endif
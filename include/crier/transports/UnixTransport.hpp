@@ -0,0 +1,60 @@
+#ifndef CRIER_UNIX_TRANSPORT_HPP
+#define CRIER_UNIX_TRANSPORT_HPP
+
+#include <string>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <crier/transports/TcpTransport.hpp>
+
+namespace crier {
+
+  /// UnixTransport
+  /// TcpTransport over a unix domain stream socket, for talking to processes on the same host. Same framing and threading as TcpTransport.
+  //  connect takes the socket's path as host, and ignores the port. Paths starting with '@' are in the abstract namespace (nothing on the filesystem).
+  class UnixTransport : public TcpTransport {
+  public:
+    UnixTransport() = default;
+    explicit UnixTransport(const Options& options) : TcpTransport(options) {}
+    UnixTransport(UnixTransport&& other) = default;
+
+    void connect(const std::string& host, int port) override;
+  };
+
+  inline void UnixTransport::connect(const std::string& host, int) {
+    resetConnection();
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if(host.empty() || host.size() >= sizeof(addr.sun_path)) {
+      _on_disconnect_cb("Invalid unix socket path");
+      return;
+    }
+    std::memcpy(addr.sun_path, host.data(), host.size());
+    socklen_t addr_len = sizeof(addr);
+    if(host[0] == '@') {
+      addr.sun_path[0] = '\0';
+      addr_len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + host.size());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+      _on_disconnect_cb(std::strerror(errno));
+      return;
+    }
+    int res = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), addr_len);
+    if(res != 0 && errno != EINPROGRESS) {
+      int connect_err = errno;
+      ::close(fd);
+      _on_disconnect_cb(std::strerror(connect_err));
+      return;
+    }
+    startConnection(fd);
+  }
+}
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef CRIER_CAPTURE_FILE_HPP
+#define CRIER_CAPTURE_FILE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace crier {
+  /// Layout and access of the capture files RecordingTransport writes and ReplayTransport reads.
+  /// A capture is a FileHeader followed by records, each a 16 byte RecordHeader followed by its data, rounded up to 8 bytes.
+  //  Record times are nanoseconds since the capture was opened, by the steady clock. The header keeps when that was by the system clock,
+  //  for reference, and how many bytes of records were written so far, bumped after every record: a capture cut short by a crash reads
+  //  fine up to its last whole record.
+  namespace capture {
+
+    static constexpr uint64_t kMagic = 0x3170637265697263; // "criercp1"
+    static constexpr uint32_t kVersion = 1;
+
+    enum class RecordKind : uint8_t { Connect = 1, Disconnect = 2, Inbound = 3, Outbound = 4 };
+
+    struct FileHeader {
+      uint64_t magic;
+      uint32_t version;
+      uint32_t reserved;
+      int64_t started_at;
+      uint64_t used;
+    };
+
+    struct RecordHeader {
+      uint64_t time;
+      uint32_t size;
+      RecordKind kind;
+      uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(FileHeader) == 32 && sizeof(RecordHeader) == 16, "Capture headers must keep their on-disk size");
+
+    inline size_t recordSize(size_t data_size) {
+      return sizeof(RecordHeader) + ((data_size + 7) & ~size_t(7));
+    }
+
+    /// A record as read out of a capture. Data points straight into the mapping, and stays valid for as long as the Reader lives.
+    struct Record {
+      RecordKind kind;
+      std::chrono::nanoseconds time;
+      const char* data;
+      size_t size;
+    };
+
+    /// Appends records to a capture file mapped in memory, growing it (doubling) as it fills up. Safe to append to from many threads.
+    class Writer {
+    public:
+      Writer() = default;
+      Writer(const Writer&) = delete;
+      void operator=(const Writer&) = delete;
+
+      ~Writer() { close(); }
+
+      /// Creates (or truncates) the file at path. Returns false, with err set, if it can't.
+      bool open(const std::string& path, std::string& err, size_t initial_capacity = 1024 * 1024) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(_fd < 0) {
+          err = "Failed to create capture file '" + path + "': " + std::strerror(errno);
+          return false;
+        }
+        if(!map(std::max(initial_capacity, sizeof(FileHeader) + recordSize(0)), err)) {
+          ::close(_fd);
+          _fd = -1;
+          return false;
+        }
+        _started = std::chrono::steady_clock::now();
+        FileHeader* header = reinterpret_cast<FileHeader*>(_mapping);
+        header->version = kVersion;
+        header->started_at = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        header->used = 0;
+        header->magic = kMagic;
+        _used = sizeof(FileHeader);
+        return true;
+      }
+
+      bool isOpen() const { return _fd >= 0; }
+
+      /// Appends a record, timed now. Returns false if the file couldn't grow to fit it (the record is lost, and so is every one after it).
+      bool append(RecordKind kind, const char* data, size_t size) {
+        auto time = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> guard(_mutex);
+        if(_fd < 0)
+          return false;
+        const size_t needed = recordSize(size);
+        if(_used + needed > _capacity) {
+          std::string err;
+          size_t capacity = _capacity;
+          while(_used + needed > capacity) {
+            capacity *= 2;
+          }
+          if(!map(capacity, err)) {
+            closeLocked();
+            return false;
+          }
+        }
+        RecordHeader* record = reinterpret_cast<RecordHeader*>(_mapping + _used);
+        record->time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - _started).count());
+        record->size = static_cast<uint32_t>(size);
+        record->kind = kind;
+        std::memset(record->reserved, 0, sizeof(record->reserved));
+        if(size > 0)
+          std::memcpy(_mapping + _used + sizeof(RecordHeader), data, size);
+        _used += needed;
+        reinterpret_cast<FileHeader*>(_mapping)->used = _used - sizeof(FileHeader);
+        return true;
+      }
+
+      bool append(RecordKind kind, const std::string& data = std::string()) { return append(kind, data.data(), data.size()); }
+
+      /// Trims the file down to the records written, and closes it.
+      void close() {
+        std::lock_guard<std::mutex> guard(_mutex);
+        closeLocked();
+      }
+
+    private:
+      /// (Re)maps the file at the given capacity, growing the file to it.
+      bool map(size_t capacity, std::string& err) {
+        if(ftruncate(_fd, static_cast<off_t>(capacity)) != 0) {
+          err = std::string("Failed to grow capture file: ") + std::strerror(errno);
+          return false;
+        }
+        void* mapping = _mapping == nullptr ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0)
+                                            : mremap(_mapping, _capacity, capacity, MREMAP_MAYMOVE);
+        if(mapping == MAP_FAILED) {
+          err = std::string("Failed to map capture file: ") + std::strerror(errno);
+          return false;
+        }
+        _mapping = static_cast<char*>(mapping);
+        _capacity = capacity;
+        return true;
+      }
+
+      void closeLocked() {
+        if(_fd < 0)
+          return;
+        if(_mapping != nullptr)
+          munmap(_mapping, _capacity);
+        if(ftruncate(_fd, static_cast<off_t>(_used)) != 0) {
+          // Left at its capacity, readers go by the header's count anyway
+        }
+        ::close(_fd);
+        _fd = -1;
+        _mapping = nullptr;
+        _capacity = 0;
+      }
+
+      int _fd = -1;
+      char* _mapping = nullptr;
+      size_t _capacity = 0;
+      size_t _used = 0;
+      std::chrono::steady_clock::time_point _started;
+      std::mutex _mutex;
+    };
+
+    /// Reads the records of a capture file, mapped in memory, in the order they were written.
+    class Reader {
+    public:
+      Reader() = default;
+      Reader(const Reader&) = delete;
+      void operator=(const Reader&) = delete;
+
+      ~Reader() {
+        if(_mapping != nullptr)
+          munmap(const_cast<char*>(_mapping), _size);
+      }
+
+      /// Maps the file at path. Returns false, with err set, if it can't or it isn't a capture.
+      bool open(const std::string& path, std::string& err) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+          err = "Failed to open capture file '" + path + "': " + std::strerror(errno);
+          return false;
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+          ::close(fd);
+          err = "Capture file '" + path + "' is too short to be one";
+          return false;
+        }
+        _size = static_cast<size_t>(st.st_size);
+        void* mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED) {
+          err = std::string("Failed to map capture file: ") + std::strerror(errno);
+          return false;
+        }
+        _mapping = static_cast<const char*>(mapping);
+        const FileHeader* header = reinterpret_cast<const FileHeader*>(_mapping);
+        if(header->magic != kMagic || header->version != kVersion) {
+          err = "'" + path + "' isn't a capture file, or one of another version";
+          return false;
+        }
+        _end = sizeof(FileHeader) + std::min<uint64_t>(header->used, _size - sizeof(FileHeader));
+        rewind();
+        return true;
+      }
+
+      /// System clock time the capture was started at.
+      std::chrono::system_clock::time_point startedAt() const {
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds{reinterpret_cast<const FileHeader*>(_mapping)->started_at}));
+      }
+
+      /// Reads the next record into record. Returns false at the end of the capture.
+      bool next(Record& record) {
+        if(_next + sizeof(RecordHeader) > _end)
+          return false;
+        const RecordHeader* header = reinterpret_cast<const RecordHeader*>(_mapping + _next);
+        if(_next + recordSize(header->size) > _end)
+          return false;
+        record.kind = header->kind;
+        record.time = std::chrono::nanoseconds{static_cast<int64_t>(header->time)};
+        record.data = _mapping + _next + sizeof(RecordHeader);
+        record.size = header->size;
+        _next += recordSize(header->size);
+        return true;
+      }
+
+      /// Starts reading over from the first record.
+      void rewind() { _next = sizeof(FileHeader); }
+
+    private:
+      const char* _mapping = nullptr;
+      size_t _size = 0;
+      size_t _end = 0;
+      size_t _next = 0;
+    };
+  }
+}
+
+#endif
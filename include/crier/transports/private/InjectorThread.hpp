@@ -0,0 +1,174 @@
+#ifndef CRIER_INJECTOR_THREAD_HPP
+#define CRIER_INJECTOR_THREAD_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <crier/Metrics.hpp>
+#include <crier/private/MetricsRegistry.hpp>
+
+namespace crier {
+
+  /// InjectorRun
+  /// State of a single run of a transport feeding crier from a thread of its own rather than from a peer (LoadGeneratorTransport, ReplayTransport),
+  /// shared between the transport and that thread. Transports derive their own run from it, adding what else their thread reads and counts.
+  //  The thread only ever reaches its run, never the transport: crier's callbacks, like everything else it needs, are copied in before it starts.
+  //  The transport can then go away while its thread is still on its way out, as it does when destroyed from within one of its callbacks.
+  struct InjectorRun {
+    std::function<void(void)> on_connect;
+    std::function<void(const std::string&)> on_data;
+    std::function<void(const char*, size_t)> on_raw_data;
+    std::function<void(const std::string&)> on_disconnect;
+
+    std::atomic<bool> connected{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> finished{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+
+    std::chrono::steady_clock::time_point started;
+    std::atomic<int64_t> elapsed{0};
+
+    /// Messages crier sent during the run.
+    std::atomic<uint64_t> sent{0};
+    /// How long crier took with each message handed over.
+    LatencyHistogram consume_time;
+    std::atomic<int64_t> max_lag{0};
+
+    /// Takes a copy of the transport's callbacks, and starts the clock.
+    InjectorRun(const std::function<void(void)>& on_connect, const std::function<void(const std::string&)>& on_data,
+                const std::function<void(const char*, size_t)>& on_raw_data, const std::function<void(const std::string&)>& on_disconnect)
+      : on_connect(on_connect), on_data(on_data), on_raw_data(on_raw_data), on_disconnect(on_disconnect), started(std::chrono::steady_clock::now()) {}
+
+    /// Triggers the transport opened event, unless already open.
+    void open() {
+      if(!connected.exchange(true))
+        on_connect();
+    }
+
+    /// Triggers the transport closed event with reason, unless already closed.
+    void close(const std::string& reason) {
+      if(connected.exchange(false))
+        on_disconnect(reason);
+    }
+
+    /// Hands data to crier, timing how long it took. Returns the time crier returned at.
+    std::chrono::steady_clock::time_point inject(const char* data, size_t size, std::chrono::steady_clock::time_point handed) {
+      if(on_raw_data) {
+        on_raw_data(data, size);
+      } else {
+        on_data(std::string(data, size));
+      }
+      auto returned = std::chrono::steady_clock::now();
+      consume_time.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(returned - handed).count()));
+      return returned;
+    }
+
+    void recordLag(int64_t lag) {
+      if(lag > max_lag.load(std::memory_order_relaxed))
+        max_lag.store(lag, std::memory_order_relaxed);
+    }
+
+    /// Sleeps until the given time, or until stopped. Returns false once stopped.
+    bool sleepUntil(std::chrono::steady_clock::time_point time) {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait_until(lock, time, [this](){ return stopping.load(); });
+      return !stopping;
+    }
+
+    void stop() {
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+      }
+      wake.notify_all();
+    }
+
+    /// Time since the run started, or until it stopped.
+    std::chrono::nanoseconds elapsedTime() const {
+      int64_t ended = elapsed.load();
+      return ended > 0 ? std::chrono::nanoseconds{ended} : std::chrono::steady_clock::now() - started;
+    }
+  };
+
+  /// InjectorThread
+  /// The thread behind an injecting transport, and its current run (see InjectorRun). Runs are shared with their thread, so stats outlive it.
+  template <typename Run>
+  class InjectorThread {
+  public:
+    InjectorThread() = default;
+    InjectorThread(const InjectorThread&) = delete;
+    InjectorThread& operator=(const InjectorThread&) = delete;
+
+    ~InjectorThread() { stop(); }
+
+    std::shared_ptr<Run> current() const {
+      std::lock_guard<std::mutex> guard(_mutex);
+      return _run;
+    }
+
+    /// Makes run the current one, and runs body on it from a new thread. The previous run must be stopped or finished.
+    //  With open, the transport opened event triggers first, from the calling thread.
+    void start(const std::shared_ptr<Run>& run, const std::function<void(Run&)>& body, bool open = false) {
+      join();
+      {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _run = run;
+      }
+      if(open)
+        run->open();
+      _thread = std::thread([run, body](){
+        body(*run);
+        run->elapsed = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - run->started).count());
+        if(!run->stopping) {
+          std::lock_guard<std::mutex> guard(run->mutex);
+          run->finished = true;
+        }
+        run->wake.notify_all();
+      });
+    }
+
+    /// Stops the current run, and waits for its thread.
+    void stop() {
+      auto run = current();
+      if(run)
+        run->stop();
+      join();
+    }
+
+    /// Blocks until the current run finishes on its own, or timeout passes.
+    bool waitUntilFinished(std::chrono::milliseconds timeout) {
+      auto run = current();
+      if(!run)
+        return false;
+      std::unique_lock<std::mutex> lock(run->mutex);
+      return run->wake.wait_for(lock, timeout, [&run](){ return run->finished.load(); });
+    }
+
+  private:
+    void join() {
+      if(!_thread.joinable())
+        return;
+      if(_thread.get_id() == std::this_thread::get_id()) {
+        // Stopped from within one of crier's callbacks, the thread exits on its own once it returns, touching nothing but its run
+        _thread.detach();
+      } else {
+        _thread.join();
+      }
+    }
+
+    std::shared_ptr<Run> _run;
+    mutable std::mutex _mutex;
+    std::thread _thread;
+  };
+}
+
+#endif
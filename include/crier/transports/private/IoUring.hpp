@@ -0,0 +1,233 @@
+#ifndef CRIER_IO_URING_HPP
+#define CRIER_IO_URING_HPP
+
+#include <string>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+namespace crier {
+
+  /// Minimal wrapper over the raw io_uring syscalls, covering just what IoUringTransport needs (so there's no dependency on liburing).
+  /// Not thread-safe: it is meant to be owned and driven by a single thread.
+  class IoUring {
+  public:
+    IoUring() = default;
+    IoUring(const IoUring& copy) = delete;
+    void operator=(const IoUring& copy) = delete;
+    ~IoUring();
+
+    /// Creates the ring and maps its queues. On failure returns false and fills err in.
+    bool init(unsigned int entries, std::string& err);
+
+    /// Closes the ring (which cancels whatever is still in flight) and unmaps its queues. Called by the destructor, but can be used to release the ring earlier.
+    void shutdown();
+
+    /// Returns a zeroed submission entry, or nullptr if the submission queue is full (submit and try again).
+    io_uring_sqe* getSqe();
+
+    /// Submits every entry taken since the last submit, and waits for at least wait_nr completions. Returns the syscall result (negative errno on failure).
+    int submitAndWait(unsigned int wait_nr);
+
+    /// Invokes handler for every available completion entry, marking them as seen. Returns how many were handled.
+    template <typename Handler>
+    unsigned int forEachCompletion(Handler handler);
+
+    /// Registers buffers to be used by the *_FIXED operations.
+    bool registerBuffers(const iovec* buffers, unsigned int count, std::string& err);
+
+    /// Creates and registers a provided buffer ring for the given buffer group. entries must be a power of 2.
+    io_uring_buf_ring* registerBufferRing(unsigned int entries, unsigned short group_id, std::string& err);
+
+    /// Hands a buffer over to a provided buffer ring. The ring tail is only published by bufferRingAdvance.
+    static void bufferRingAdd(io_uring_buf_ring* ring, unsigned int entries, void* addr, unsigned int len, unsigned short buffer_id, unsigned int offset);
+    static void bufferRingAdvance(io_uring_buf_ring* ring, unsigned int count);
+
+    int fd() const { return _fd; }
+
+  private:
+    int _fd = -1;
+
+    void* _sq_ring = MAP_FAILED;
+    size_t _sq_ring_size = 0;
+    void* _cq_ring = MAP_FAILED;
+    size_t _cq_ring_size = 0;
+    io_uring_sqe* _sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t _sqes_size = 0;
+
+    unsigned int* _sq_khead = nullptr;
+    unsigned int* _sq_ktail = nullptr;
+    unsigned int* _sq_array = nullptr;
+    unsigned int _sq_mask = 0;
+    unsigned int _sq_entries = 0;
+    unsigned int _sqe_head = 0;
+    unsigned int _sqe_tail = 0;
+
+    unsigned int* _cq_khead = nullptr;
+    unsigned int* _cq_ktail = nullptr;
+    io_uring_cqe* _cqes = nullptr;
+    unsigned int _cq_mask = 0;
+
+    void* _buf_ring = MAP_FAILED;
+    size_t _buf_ring_size = 0;
+  };
+
+  inline IoUring::~IoUring() {
+    shutdown();
+  }
+
+  inline void IoUring::shutdown() {
+    if(_fd >= 0)
+      close(_fd);
+    _fd = -1;
+    if(_buf_ring != MAP_FAILED)
+      munmap(_buf_ring, _buf_ring_size);
+    _buf_ring = MAP_FAILED;
+    if(_sqes != MAP_FAILED)
+      munmap(_sqes, _sqes_size);
+    _sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    if(_cq_ring != MAP_FAILED && _cq_ring != _sq_ring)
+      munmap(_cq_ring, _cq_ring_size);
+    _cq_ring = MAP_FAILED;
+    if(_sq_ring != MAP_FAILED)
+      munmap(_sq_ring, _sq_ring_size);
+    _sq_ring = MAP_FAILED;
+  }
+
+  inline bool IoUring::init(unsigned int entries, std::string& err) {
+    io_uring_params params{};
+    _fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if(_fd < 0) {
+      err = std::string("io_uring_setup failed: ") + std::strerror(errno);
+      return false;
+    }
+
+    _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap) {
+      _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+    }
+
+    _sq_ring = mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    if(_sq_ring == MAP_FAILED) {
+      err = std::string("io_uring sq ring mmap failed: ") + std::strerror(errno);
+      return false;
+    }
+    _cq_ring = single_mmap ? _sq_ring : mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+    if(_cq_ring == MAP_FAILED) {
+      err = std::string("io_uring cq ring mmap failed: ") + std::strerror(errno);
+      return false;
+    }
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = static_cast<io_uring_sqe*>(mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES));
+    if(_sqes == MAP_FAILED) {
+      err = std::string("io_uring sqes mmap failed: ") + std::strerror(errno);
+      return false;
+    }
+
+    char* sq = static_cast<char*>(_sq_ring);
+    _sq_khead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+    _sq_ktail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+    _sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+    _sq_mask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+    _sq_entries = params.sq_entries;
+
+    char* cq = static_cast<char*>(_cq_ring);
+    _cq_khead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+    _cq_ktail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+    _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    _cq_mask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+    return true;
+  }
+
+  inline io_uring_sqe* IoUring::getSqe() {
+    unsigned int head = __atomic_load_n(_sq_khead, __ATOMIC_ACQUIRE);
+    if(_sqe_tail - head >= _sq_entries)
+      return nullptr;
+    io_uring_sqe* sqe = &_sqes[_sqe_tail & _sq_mask];
+    _sqe_tail++;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  }
+
+  inline int IoUring::submitAndWait(unsigned int wait_nr) {
+    unsigned int to_submit = _sqe_tail - _sqe_head;
+    for(; _sqe_head != _sqe_tail; _sqe_head++) {
+      _sq_array[_sqe_head & _sq_mask] = _sqe_head & _sq_mask;
+    }
+    __atomic_store_n(_sq_ktail, _sqe_tail, __ATOMIC_RELEASE);
+
+    unsigned int flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int res;
+    do {
+      res = static_cast<int>(syscall(__NR_io_uring_enter, _fd, to_submit, wait_nr, flags, nullptr, 0));
+      // Entries were consumed even if the wait got interrupted, don't submit them twice
+      to_submit = 0;
+    } while(res < 0 && errno == EINTR);
+    return res < 0 ? -errno : res;
+  }
+
+  template <typename Handler>
+  unsigned int IoUring::forEachCompletion(Handler handler) {
+    unsigned int head = *_cq_khead;
+    unsigned int tail = __atomic_load_n(_cq_ktail, __ATOMIC_ACQUIRE);
+    unsigned int handled = 0;
+    for(; head != tail; head++, handled++) {
+      // Copied out so the slot can be released before the handler runs (it may queue more work)
+      io_uring_cqe cqe = _cqes[head & _cq_mask];
+      __atomic_store_n(_cq_khead, head + 1, __ATOMIC_RELEASE);
+      handler(cqe);
+    }
+    return handled;
+  }
+
+  inline bool IoUring::registerBuffers(const iovec* buffers, unsigned int count, std::string& err) {
+    if(syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS, buffers, count) != 0) {
+      err = std::string("io_uring buffer registration failed: ") + std::strerror(errno);
+      return false;
+    }
+    return true;
+  }
+
+  inline io_uring_buf_ring* IoUring::registerBufferRing(unsigned int entries, unsigned short group_id, std::string& err) {
+    _buf_ring_size = entries * sizeof(io_uring_buf);
+    _buf_ring = mmap(nullptr, _buf_ring_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if(_buf_ring == MAP_FAILED) {
+      err = std::string("io_uring buffer ring mmap failed: ") + std::strerror(errno);
+      return nullptr;
+    }
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<unsigned long>(_buf_ring);
+    reg.ring_entries = entries;
+    reg.bgid = group_id;
+    if(syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+      err = std::string("io_uring provided buffer ring registration failed: ") + std::strerror(errno);
+      return nullptr;
+    }
+    io_uring_buf_ring* ring = static_cast<io_uring_buf_ring*>(_buf_ring);
+    ring->tail = 0;
+    return ring;
+  }
+
+  inline void IoUring::bufferRingAdd(io_uring_buf_ring* ring, unsigned int entries, void* addr, unsigned int len, unsigned short buffer_id, unsigned int offset) {
+    // Not ring->bufs: the kernel header declares it behind an empty struct, which takes a byte in C++ and shifts the array. Entries start at the ring base.
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(ring) + ((ring->tail + offset) & (entries - 1));
+    buf->addr = reinterpret_cast<unsigned long>(addr);
+    buf->len = len;
+    buf->bid = buffer_id;
+  }
+
+  inline void IoUring::bufferRingAdvance(io_uring_buf_ring* ring, unsigned int count) {
+    __atomic_store_n(&ring->tail, static_cast<unsigned short>(ring->tail + count), __ATOMIC_RELEASE);
+  }
+}
+
+#endif
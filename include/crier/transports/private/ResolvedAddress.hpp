@@ -0,0 +1,51 @@
+#ifndef CRIER_RESOLVED_ADDRESS_HPP
+#define CRIER_RESOLVED_ADDRESS_HPP
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+namespace crier {
+
+  /// An address a host name resolved to, copied out of getaddrinfo's list so it can be kept around while connecting.
+  struct ResolvedAddress {
+    sockaddr_storage address;
+    socklen_t length;
+    int family;
+    int socktype;
+    int protocol;
+
+    const sockaddr* sockAddr() const { return reinterpret_cast<const sockaddr*>(&address); }
+  };
+
+  /// Resolves host and port to every address of the given socket type, in getaddrinfo's order. On failure returns none and fills err in.
+  //  Names often resolve to several addresses (::1 before 127.0.0.1 for localhost), of which a peer may only listen on some: transports try each in turn.
+  inline std::vector<ResolvedAddress> resolveAddresses(const std::string& host, int port, int socktype, std::string& err) {
+    std::vector<ResolvedAddress> resolved;
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = socktype;
+    addrinfo* addresses = nullptr;
+    int gai_err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    if(gai_err != 0 || addresses == nullptr) {
+      err = gai_strerror(gai_err);
+      return resolved;
+    }
+    for(addrinfo* address = addresses; address != nullptr; address = address->ai_next) {
+      ResolvedAddress copy{};
+      std::memcpy(&copy.address, address->ai_addr, address->ai_addrlen);
+      copy.length = address->ai_addrlen;
+      copy.family = address->ai_family;
+      copy.socktype = address->ai_socktype;
+      copy.protocol = address->ai_protocol;
+      resolved.push_back(copy);
+    }
+    freeaddrinfo(addresses);
+    return resolved;
+  }
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef CRIER_SHM_CHANNEL_HPP
+#define CRIER_SHM_CHANNEL_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace crier {
+  /// Layout and primitives of the shared memory channel behind ShmTransport.
+  /// A channel is a single shared mapping holding a header and two byte rings, one per direction. Ring i is written by endpoint i and read by the other one.
+  //  Each ring is single-producer, single-consumer: only the writer moves its tail and only the reader moves its head, so neither needs a lock.
+  //  Frames are an 8 byte header (payload size, then padding) followed by the payload, rounded up to 8 bytes. A frame never wraps around the end of the ring:
+  //  if it doesn't fit before the end, a wrap marker is written and the frame starts over at the beginning. Readers can then parse frames in place.
+  namespace shm {
+
+    static constexpr uint64_t kMagic = 0x31736d7265697263; // "criersm1"
+    static constexpr uint32_t kWrapMarker = 0xFFFFFFFF;
+    static constexpr size_t kFrameHeaderSize = 8;
+
+    /// Per endpoint state, written by its owner and read by the peer (other than the futex words, which the peer bumps to wake it).
+    struct alignas(64) EndpointState {
+      /// Futex word the endpoint sleeps on. Bumped by the peer whenever it has something for the endpoint to look at.
+      std::atomic<uint32_t> doorbell;
+      /// Set while the endpoint is (about to be) asleep on its doorbell. Peers only make the wake syscall when it is.
+      std::atomic<uint32_t> sleeping;
+      /// Set while the endpoint has frames waiting for room in its outbound ring. The reader rings the doorbell once it frees some.
+      std::atomic<uint32_t> waiting_space;
+      std::atomic<uint32_t> attached;
+      std::atomic<uint32_t> closed;
+      std::atomic<int32_t> pid;
+    };
+
+    struct alignas(64) RingIndex {
+      std::atomic<uint64_t> value;
+    };
+
+    struct ChannelHeader {
+      std::atomic<uint64_t> magic;
+      uint32_t ring_size;
+      EndpointState endpoints[2];
+      RingIndex tails[2];
+      RingIndex heads[2];
+    };
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex words must be plain 32 bit integers");
+
+    /// Ring data starts on its own page, right after the header.
+    inline size_t ringsOffset() {
+      return (sizeof(ChannelHeader) + 4095) & ~size_t(4095);
+    }
+
+    inline size_t channelSize(uint32_t ring_size) {
+      return ringsOffset() + 2 * size_t(ring_size);
+    }
+
+    /// Amount of ring space a frame with the given payload takes.
+    inline size_t frameSpan(size_t payload_size) {
+      return (kFrameHeaderSize + payload_size + 7) & ~size_t(7);
+    }
+
+    /// Largest payload a ring of the given size accepts. Kept to half the ring, so a frame always fits once the reader catches up, even after a wrap.
+    inline size_t maxPayloadSize(uint32_t ring_size) {
+      return ring_size / 2 - kFrameHeaderSize;
+    }
+
+    /// Sleeps while the word still holds expected, for up to timeout (nullptr waits forever). Works across processes, the word lives in shared memory.
+    inline void futexWait(std::atomic<uint32_t>& word, uint32_t expected, const timespec* timeout) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, timeout, nullptr, 0);
+    }
+
+    inline void futexWake(std::atomic<uint32_t>& word) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+
+    /// Rings an endpoint's doorbell, skipping the syscall if it isn't asleep.
+    //  Pairs with the sleeping side setting its flag and re-checking its rings before waiting: one of the two always sees the other.
+    inline void notify(EndpointState& endpoint, bool force) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(force || endpoint.sleeping.load(std::memory_order_relaxed)) {
+        endpoint.doorbell.fetch_add(1, std::memory_order_release);
+        futexWake(endpoint.doorbell);
+      }
+    }
+
+    /// Producer side of a ring.
+    class RingWriter {
+    public:
+      RingWriter() = default;
+      RingWriter(char* data, uint32_t size, RingIndex* tail, RingIndex* head) : _data(data), _mask(size - 1), _size(size), _tail(tail), _head(head) {}
+
+      /// Copies a frame into the ring and publishes it. Returns false, writing nothing, if there isn't room for it right now.
+      bool write(const char* payload, size_t payload_size) {
+        const size_t span = frameSpan(payload_size);
+        uint64_t tail = _tail->value.load(std::memory_order_relaxed);
+        uint64_t head = _head->value.load(std::memory_order_acquire);
+        size_t offset = tail & _mask;
+        size_t until_end = _size - offset;
+        size_t skip = span > until_end ? until_end : 0;
+        if(tail + skip + span - head > _size)
+          return false;
+
+        if(skip > 0) {
+          std::memcpy(_data + offset, &kWrapMarker, sizeof(kWrapMarker));
+          tail += skip;
+          offset = 0;
+        }
+        uint32_t size32 = static_cast<uint32_t>(payload_size);
+        std::memcpy(_data + offset, &size32, sizeof(size32));
+        std::memcpy(_data + offset + kFrameHeaderSize, payload, payload_size);
+        _tail->value.store(tail + span, std::memory_order_release);
+        return true;
+      }
+
+    private:
+      char* _data = nullptr;
+      size_t _mask = 0;
+      size_t _size = 0;
+      RingIndex* _tail = nullptr;
+      RingIndex* _head = nullptr;
+    };
+
+    /// Consumer side of a ring.
+    class RingReader {
+    public:
+      RingReader() = default;
+      RingReader(char* data, uint32_t size, RingIndex* tail, RingIndex* head) : _data(data), _mask(size - 1), _size(size), _tail(tail), _head(head) {}
+
+      bool empty() const {
+        return _head->value.load(std::memory_order_relaxed) == _tail->value.load(std::memory_order_acquire);
+      }
+
+      /// Hands every published frame to handler(const char* data, size_t size), in place. The space of a frame is released once its handler returns.
+      /// Returns how many frames were handled.
+      template <typename Handler>
+      size_t drain(Handler handler) {
+        uint64_t head = _head->value.load(std::memory_order_relaxed);
+        uint64_t tail = _tail->value.load(std::memory_order_acquire);
+        size_t handled = 0;
+        while(head != tail) {
+          size_t offset = head & _mask;
+          uint32_t size32;
+          std::memcpy(&size32, _data + offset, sizeof(size32));
+          if(size32 == kWrapMarker) {
+            head += _size - offset;
+            continue;
+          }
+          handler(_data + offset + kFrameHeaderSize, size_t(size32));
+          head += frameSpan(size32);
+          _head->value.store(head, std::memory_order_release);
+          handled++;
+        }
+        _head->value.store(head, std::memory_order_release);
+        return handled;
+      }
+
+    private:
+      char* _data = nullptr;
+      size_t _mask = 0;
+      size_t _size = 0;
+      RingIndex* _tail = nullptr;
+      RingIndex* _head = nullptr;
+    };
+  }
+}
+
+#endif
@@ -4,11 +4,53 @@
 
 #include "tests/ConnectionTests.hpp"
 #include "tests/MessageSendReceiveTests.hpp"
+#include "tests/SerializationTests.hpp"
+#include "tests/TcpTransportTests.hpp"
+#include "tests/IoUringTransportTests.hpp"
+#include "tests/UdpTransportTests.hpp"
+#include "tests/ShmTransportTests.hpp"
+#include "tests/LoadGeneratorTransportTests.hpp"
+#include "tests/RecordReplayTests.hpp"
+#include "tests/ReactorTests.hpp"
+#include "tests/CrierServerTests.hpp"
+#include "tests/ReconnectTests.hpp"
+#include "tests/AsyncSendTests.hpp"
+#include "tests/FlowControlTests.hpp"
+#include "tests/RequestLimiterTests.hpp"
+#include "tests/ResponseFutureTests.hpp"
+#include "tests/StreamingRequestTests.hpp"
+#include "tests/RequestPolicyTests.hpp"
+#include "tests/CancellationTests.hpp"
+#include "tests/MetricsTests.hpp"
+#include "tests/TracingTests.hpp"
+#include "tests/CoroutineTests.hpp"
 
 int main(int, const char *[]) {
   std::cout << std::endl;
   std::cout << "========== Executing Crier Tests ==========" << std::endl;
   std::cout << " > Connection Tests: " << (TestCrierTransportConnection() ? "PASSED" : "FAILED") << std::endl;
   std::cout << " > Message Send And Receive Tests: " << (TestMessageSendReceive() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Custom Serialization Tests: " << (TestCustomSerialization() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Tcp Transport Tests: " << (TestTcpTransport() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > IoUring Transport Tests: " << (TestIoUringTransport() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Udp Transport Tests: " << (TestUdpTransport() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Shm Transport Tests: " << (TestShmTransport() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Load Generator Transport Tests: " << (TestLoadGeneratorTransport() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Record And Replay Tests: " << (TestRecordReplay() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Reactor Tests: " << (TestReactor() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Crier Server Tests: " << (TestCrierServer() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Reconnect Tests: " << (TestReconnect() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Async Send Tests: " << (TestAsyncSend() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Flow Control Tests: " << (TestFlowControl() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Request Limiter Tests: " << (TestRequestLimiter() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Response Future Tests: " << (TestResponseFutures() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Streaming Request Tests: " << (TestStreamingRequests() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Request Policy Tests: " << (TestRequestPolicies() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Cancellation Tests: " << (TestCancellation() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Metrics Tests: " << (TestMetrics() ? "PASSED" : "FAILED") << std::endl;
+  std::cout << " > Tracing Tests: " << (TestTracing() ? "PASSED" : "FAILED") << std::endl;
+#ifdef CRIER_HAS_COROUTINES
+  std::cout << " > Coroutine Request Tests: " << (TestCoroutineRequests() ? "PASSED" : "FAILED") << std::endl;
+#endif
   std::cout << std::endl;
 }
@@ -0,0 +1,153 @@
+#ifndef AsyncSendTests_hpp
+#define AsyncSendTests_hpp
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/GatedEchoTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+using GatedCrier = crier::Crier<GatedEchoTransport, crier::test::root_msg>;
+using AsyncTcpCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+
+/// Size of a test_msg_1 once wrapped in the root message, to set watermarks in messages.
+size_t WrappedMsgSize() {
+  crier::test::root_msg root;
+  root.mutable_test_msg_1_field()->set_id(1);
+  return root.ByteSizeLong();
+}
+
+bool TestAsyncSendKeepsOrder() {
+  const unsigned int senders = 4;
+  const unsigned int per_sender = 500;
+  TcpEchoServer server;
+  AsyncTcpCrier net_crier{};
+  net_crier.enableAsyncSend();
+  std::atomic<unsigned int> received{0};
+  std::atomic<bool> in_order{true};
+  std::vector<unsigned int> last_seen(senders, 0);
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestAsyncSendKeepsOrder", [&](const crier::test::test_msg_1& msg){
+    // Each sender's messages must arrive in the order it sent them
+    unsigned int sender = msg.id() / per_sender;
+    unsigned int sequence = msg.id() % per_sender + 1;
+    if(sequence != last_seen[sender] + 1) {
+      in_order = false;
+    }
+    last_seen[sender] = sequence;
+    received++;
+  });
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  std::vector<std::thread> threads;
+  for(unsigned int s = 0; s < senders; s++) {
+    threads.emplace_back([&net_crier, s, per_sender](){
+      for(unsigned int i = 0; i < per_sender; i++) {
+        crier::test::test_msg_1 msg;
+        msg.set_id(s * per_sender + i);
+        net_crier.sendMessage(msg);
+      }
+    });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  return WaitUntil([&received, senders, per_sender](){ return received == senders * per_sender; }, 5000) && in_order && net_crier.queuedOutboundBytes() == 0;
+}
+
+bool TestAsyncSendFailFast() {
+  crier::AsyncSendOptions options;
+  options.high_watermark_bytes = WrappedMsgSize() * 4;
+  options.policy = crier::HighWatermarkPolicy::FailFast;
+  GatedCrier gated_crier{};
+  gated_crier.enableAsyncSend(options);
+  std::atomic<unsigned int> received{0};
+  gated_crier.registerPermanentCallback<crier::test::test_msg_1>("TestAsyncSendFailFast", [&received](const crier::test::test_msg_1&){ received++; });
+  gated_crier.connectTransport("", 0);
+  gated_crier.transport().closeGate();
+
+  // The first message gets the writer stuck on the transport, the next four fill the queue, the rest bounce
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  gated_crier.sendMessage(msg);
+  WaitUntil([&gated_crier](){ return gated_crier.queuedOutboundBytes() == 0; }, 1000);
+  unsigned int accepted = 1;
+  unsigned int refused = 0;
+  for(int i = 0; i < 10; i++) {
+    if(gated_crier.sendMessage(msg)) {
+      accepted++;
+    } else {
+      refused++;
+    }
+  }
+
+  gated_crier.transport().openGate();
+  return accepted == 5 && refused == 6 && WaitUntil([&received](){ return received == 5; }, 1000) && gated_crier.transport().sendingThreads() == 1;
+}
+
+bool TestAsyncSendSignal() {
+  std::atomic<unsigned int> signals{0};
+  crier::AsyncSendOptions options;
+  options.high_watermark_bytes = WrappedMsgSize() * 4;
+  options.policy = crier::HighWatermarkPolicy::Signal;
+  options.on_high_watermark = [&signals](size_t){ signals++; };
+  GatedCrier gated_crier{};
+  gated_crier.enableAsyncSend(options);
+  std::atomic<unsigned int> received{0};
+  gated_crier.registerPermanentCallback<crier::test::test_msg_1>("TestAsyncSendSignal", [&received](const crier::test::test_msg_1&){ received++; });
+  gated_crier.connectTransport("", 0);
+  gated_crier.transport().closeGate();
+
+  // Every message is taken, the caller is told once that the queue went past the watermark
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  bool all_accepted = true;
+  for(int i = 0; i < 20; i++) {
+    all_accepted = gated_crier.sendMessage(msg) && all_accepted;
+  }
+  bool signaled_once = signals == 1;
+  gated_crier.transport().openGate();
+  return all_accepted && signaled_once && WaitUntil([&received](){ return received == 20; }, 1000);
+}
+
+bool TestAsyncSendBlock() {
+  crier::AsyncSendOptions options;
+  options.high_watermark_bytes = WrappedMsgSize() * 4;
+  options.policy = crier::HighWatermarkPolicy::Block;
+  GatedCrier gated_crier{};
+  gated_crier.enableAsyncSend(options);
+  std::atomic<unsigned int> received{0};
+  gated_crier.registerPermanentCallback<crier::test::test_msg_1>("TestAsyncSendBlock", [&received](const crier::test::test_msg_1&){ received++; });
+  gated_crier.connectTransport("", 0);
+  gated_crier.transport().closeGate();
+
+  std::atomic<bool> done{false};
+  std::thread sender([&gated_crier, &done](){
+    crier::test::test_msg_1 msg;
+    msg.set_id(1);
+    for(int i = 0; i < 20; i++) {
+      gated_crier.sendMessage(msg);
+    }
+    done = true;
+  });
+  // Stuck until the transport lets the writer drain the queue
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  bool blocked = !done && gated_crier.queuedOutboundBytes() <= options.high_watermark_bytes;
+  gated_crier.transport().openGate();
+  bool finished = WaitUntil([&done, &received](){ return done && received == 20; }, 1000);
+  sender.join();
+  return blocked && finished;
+}
+
+bool TestAsyncSend() {
+  return TestAsyncSendKeepsOrder() &&
+         TestAsyncSendFailFast() &&
+         TestAsyncSendSignal() &&
+         TestAsyncSendBlock();
+}
+
+#endif /* AsyncSendTests_hpp */
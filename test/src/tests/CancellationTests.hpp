@@ -0,0 +1,159 @@
+#ifndef CancellationTests_hpp
+#define CancellationTests_hpp
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/CrierServer.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "tests/TestUtils.hpp"
+
+using CancelCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+using CancelServer = crier::CrierServer<crier::test::root_msg>;
+
+/// Holds back its answer to each test_msg_1 (a test_msg_2 holding the request's id) until told to reply, so tests can cancel requests while still pending.
+class HeldResponder {
+public:
+  HeldResponder() {
+    _server.registerHandler<crier::test::test_msg_1>([this](const CancelServer::SessionHandle& session, const crier::test::test_msg_1& request){
+      crier::test::test_msg_2 response;
+      response.set_data(std::to_string(request.id()));
+      std::lock_guard<std::mutex> guard(_heldMutex);
+      _held.emplace_back(session, response);
+      received++;
+    });
+    _server.listen("127.0.0.1", 0);
+  }
+
+  int port() const { return _server.port(); }
+
+  /// Answers every request held so far, in the order they arrived.
+  void replyAll() {
+    std::vector<std::pair<CancelServer::SessionHandle, crier::test::test_msg_2>> held;
+    {
+      std::lock_guard<std::mutex> guard(_heldMutex);
+      held.swap(_held);
+    }
+    for(const auto& reply : held) {
+      reply.first->sendMessage(reply.second);
+    }
+  }
+
+  std::atomic<unsigned int> received{0};
+
+private:
+  CancelServer _server;
+  std::mutex _heldMutex;
+  std::vector<std::pair<CancelServer::SessionHandle, crier::test::test_msg_2>> _held;
+};
+
+bool TestCancelDropsCallbacksAndResponse() {
+  HeldResponder responder;
+  CancelCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", responder.port());
+
+  auto captured = std::make_shared<int>(0);
+  std::atomic<unsigned int> cancelled_calls{0};
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  crier::RequestHandle handle = net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [captured, &cancelled_calls](const crier::test::test_msg_2&){ cancelled_calls++; }, 100,
+    [captured, &cancelled_calls](){ cancelled_calls++; });
+  bool sent = WaitUntil([&responder](){ return responder.received == 1; }, 1000);
+
+  // Cancelling frees whatever the callbacks captured right away, and only works once
+  bool cancelled = handle.cancel() && captured.use_count() == 1 && !handle.cancel();
+
+  // The cancelled request's response is dropped, rather than answering the one sent after it
+  std::string next_answer;
+  std::atomic<bool> next_answered{false};
+  msg.set_id(2);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [&next_answer, &next_answered](const crier::test::test_msg_2& response){ next_answer = response.data(); next_answered = true; });
+  sent = sent && WaitUntil([&responder](){ return responder.received == 2; }, 1000);
+  responder.replyAll();
+  bool kept_apart = WaitUntil([&next_answered](){ return next_answered.load(); }, 1000) && next_answer == "2";
+
+  // Past its timeout, neither callback ever ran
+  std::this_thread::sleep_for(std::chrono::milliseconds{150});
+  return sent && cancelled && kept_apart && cancelled_calls == 0;
+}
+
+bool TestCancellationTokenCancelsAll() {
+  HeldResponder responder;
+  CancelCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", responder.port());
+
+  crier::CancellationToken token;
+  std::atomic<unsigned int> calls{0};
+  crier::test::test_msg_1 msg;
+  for(unsigned int i = 0; i < 3; i++) {
+    msg.set_id(i);
+    token.add(net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+      [&calls](const crier::test::test_msg_2&){ calls++; }, 1000, [&calls](){ calls++; }));
+  }
+  auto future = net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 1000);
+  token.add(future.handle());
+  crier::RequestPolicy policy;
+  policy.max_retries = 2;
+  token.add(net_crier.sendMessageWithRetCallbackAndPolicy<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [&calls](const crier::test::test_msg_2&){ calls++; }, policy, [&calls](){ calls++; }));
+  auto stream = net_crier.sendStreamingRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [&calls](const crier::test::test_msg_2&){ calls++; return true; }, crier::StreamOptions(), nullptr);
+  token.add(stream);
+  bool sent = WaitUntil([&responder](){ return responder.received == 6; }, 1000);
+
+  bool all_cancelled = token.cancel() == 6 && token.cancelled() && future.status() == crier::ResponseStatus::Abandoned &&
+                       !stream.active() && stream.endReason() == crier::StreamEnd::Cancelled;
+
+  // Requests added once the token is cancelled are cancelled right away
+  auto late = net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 1000);
+  token.add(late.handle());
+  bool late_cancelled = late.status() == crier::ResponseStatus::Abandoned;
+
+  WaitUntil([&responder](){ return responder.received == 7; }, 1000);
+  responder.replyAll();
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  return sent && all_cancelled && late_cancelled && calls == 0;
+}
+
+bool TestCancelQueuedRequest() {
+  HeldResponder responder;
+  CancelCrier net_crier{};
+  net_crier.setMaxRequestsInFlight(1);
+  net_crier.connectTransport("127.0.0.1", responder.port());
+
+  std::atomic<unsigned int> answers{0};
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [&answers](const crier::test::test_msg_2&){ answers++; });
+  msg.set_id(2);
+  auto queued = net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 0);
+  bool was_queued = net_crier.requestQueueStats().queued == 1;
+
+  // Cancelled while queued, it's never sent, and gives nothing back once its turn comes
+  bool cancelled = queued.cancel() && queued.status() == crier::ResponseStatus::Abandoned;
+  bool sent = WaitUntil([&responder](){ return responder.received == 1; }, 1000);
+  responder.replyAll();
+  bool answered = WaitUntil([&answers](){ return answers == 1; }, 1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  crier::RequestQueueStats stats = net_crier.requestQueueStats();
+  return was_queued && cancelled && sent && answered && responder.received == 1 && stats.in_flight == 0 && stats.queued == 0;
+}
+
+bool TestCancellation() {
+  return TestCancelDropsCallbacksAndResponse() &&
+         TestCancellationTokenCancelsAll() &&
+         TestCancelQueuedRequest();
+}
+
+#endif /* CancellationTests_hpp */
@@ -0,0 +1,185 @@
+#ifndef CoroutineTests_hpp
+#define CoroutineTests_hpp
+
+#include "crier/CrierTypes.hpp"
+
+#ifdef CRIER_HAS_COROUTINES
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+using CoroutineCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+
+/// Bare coroutine type for the tests: starts right away, and nobody waits on it.
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+/// Runs what's posted to it only when told to, from the thread that tells it to.
+struct ManualExecutor {
+  void post(std::function<void()> task) {
+    std::lock_guard<std::mutex> guard(mutex);
+    tasks.push_back(std::move(task));
+  }
+
+  size_t run() {
+    std::vector<std::function<void()>> ready;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      ready.swap(tasks);
+    }
+    for(const auto& task : ready) {
+      task();
+    }
+    return ready.size();
+  }
+
+  std::mutex mutex;
+  std::vector<std::function<void()>> tasks;
+};
+
+DetachedTask AwaitSequentialRequests(CoroutineCrier& net_crier, unsigned int requests, std::atomic<unsigned int>& answered, std::atomic<bool>& done) {
+  for(unsigned int i = 0; i < requests; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    auto result = co_await net_crier.request<crier::test::test_msg_1, crier::test::test_msg_1>(msg, 1000);
+    if(!result.ok() || result.response.id() != i)
+      break;
+    answered++;
+  }
+  done = true;
+}
+
+bool TestAwaitResponses() {
+  const unsigned int requests = 50;
+  TcpEchoServer server;
+  CoroutineCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  std::atomic<unsigned int> answered{0};
+  std::atomic<bool> done{false};
+  AwaitSequentialRequests(net_crier, requests, answered, done);
+  return WaitUntil([&done](){ return done.load(); }, 2000) && answered == requests;
+}
+
+DetachedTask AwaitTimeout(CoroutineCrier& net_crier, std::atomic<bool>& timed_out, std::thread::id& resumed_on) {
+  crier::test::test_msg_1 msg;
+  msg.set_id(3);
+  // The echo server replies with a test_msg_1, so the test_msg_2 never arrives
+  auto result = co_await net_crier.request<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 20, crier::ResumeOn::DispatchQueue);
+  resumed_on = std::this_thread::get_id();
+  timed_out = result.status == crier::ResponseStatus::TimedOut;
+}
+
+bool TestAwaitTimeoutOnDispatchQueue() {
+  TcpEchoServer server;
+  CoroutineCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  std::atomic<bool> timed_out{false};
+  std::thread::id resumed_on;
+  AwaitTimeout(net_crier, timed_out, resumed_on);
+  std::this_thread::sleep_for(std::chrono::milliseconds{60});
+  // Settled by now, but only resumes once the queue is dispatched
+  bool still_suspended = !timed_out;
+  bool resumed = WaitUntil([&net_crier, &timed_out](){
+    net_crier.dispatchQueuedCallbacks();
+    return timed_out.load();
+  }, 1000);
+  return still_suspended && resumed && resumed_on == std::this_thread::get_id();
+}
+
+DetachedTask AwaitOnExecutor(CoroutineCrier& net_crier, ManualExecutor& executor, std::atomic<bool>& answered) {
+  crier::test::test_msg_2 msg;
+  msg.set_data("on the executor");
+  auto result = co_await net_crier.request<crier::test::test_msg_2, crier::test::test_msg_2>(msg, 1000, executor);
+  answered = result.ok() && result.response.data() == "on the executor";
+}
+
+bool TestAwaitResumesOnExecutor() {
+  TcpEchoServer server;
+  CoroutineCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  ManualExecutor executor;
+  std::atomic<bool> answered{false};
+  AwaitOnExecutor(net_crier, executor, answered);
+  bool resumed = WaitUntil([&executor](){ return executor.run() > 0; }, 1000);
+  return resumed && answered;
+}
+
+DetachedTask AwaitThroughDisconnect(CoroutineCrier& net_crier, std::atomic<bool>& disconnected) {
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  auto result = co_await net_crier.request<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 5000);
+  disconnected = result.status == crier::ResponseStatus::Disconnected;
+}
+
+bool TestAwaitFailsOnDisconnect() {
+  TcpEchoServer server;
+  CoroutineCrier net_crier{};
+  net_crier.setPendingRequestsOnDisconnect(crier::PendingRequestsOnDisconnect::Fail);
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&net_crier](){ return net_crier.transportConnected(); }, 1000)) {
+    return false;
+  }
+
+  std::atomic<bool> disconnected{false};
+  AwaitThroughDisconnect(net_crier, disconnected);
+  server.dropClients();
+  return WaitUntil([&disconnected](){ return disconnected.load(); }, 1000);
+}
+
+DetachedTask AwaitCancellable(CoroutineCrier& net_crier, const crier::CancellationToken& token, std::atomic<bool>& abandoned) {
+  crier::test::test_msg_1 msg;
+  msg.set_id(4);
+  // Never answered with a test_msg_2, it waits on its timeout unless cancelled
+  auto result = co_await net_crier.request<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 5000, token);
+  abandoned = result.status == crier::ResponseStatus::Abandoned;
+}
+
+bool TestAwaitCancelled() {
+  TcpEchoServer server;
+  CoroutineCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  crier::CancellationToken token;
+  std::atomic<bool> abandoned{false};
+  AwaitCancellable(net_crier, token, abandoned);
+  bool cancelled = token.cancel() == 1;
+  bool resumed = WaitUntil([&abandoned](){ return abandoned.load(); }, 1000);
+
+  // Awaited with a cancelled token, it resumes right away
+  std::atomic<bool> abandoned_again{false};
+  AwaitCancellable(net_crier, token, abandoned_again);
+  return cancelled && resumed && abandoned_again;
+}
+
+bool TestCoroutineRequests() {
+  return TestAwaitResponses() &&
+         TestAwaitTimeoutOnDispatchQueue() &&
+         TestAwaitResumesOnExecutor() &&
+         TestAwaitFailsOnDisconnect() &&
+         TestAwaitCancelled();
+}
+
+#endif
+
+#endif /* CoroutineTests_hpp */
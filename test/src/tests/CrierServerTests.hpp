@@ -0,0 +1,161 @@
+#ifndef CrierServerTests_hpp
+#define CrierServerTests_hpp
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/CrierServer.hpp"
+#include "crier/Reactor.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "tests/TestUtils.hpp"
+
+using TestServer = crier::CrierServer<crier::test::root_msg>;
+using ServerClient = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+
+/// Echoes test_msg_1 back with its id doubled, through the session it arrived on.
+void RegisterDoublingHandler(TestServer& server) {
+  server.registerHandler<crier::test::test_msg_1>([](const TestServer::SessionHandle& session, const crier::test::test_msg_1& msg){
+    crier::test::test_msg_1 reply;
+    reply.set_id(msg.id() * 2);
+    session->sendMessage(reply);
+  });
+}
+
+/// Connects the given amount of clients, each sending its index and checking the reply. Returns true once every reply is in.
+bool ExchangeWithClients(int port, unsigned int clients, std::vector<std::unique_ptr<ServerClient>>& criers, crier::Reactor* reactor = nullptr) {
+  auto replies = std::make_shared<std::atomic<unsigned int>>(0);
+  for(unsigned int i = 0; i < clients; i++) {
+    criers.emplace_back(new ServerClient());
+    if(reactor) {
+      criers.back()->attachToReactor(*reactor);
+    }
+    criers.back()->connectTransport("127.0.0.1", port);
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    criers.back()->sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+      [replies, i](const crier::test::test_msg_1& reply){
+        if(reply.id() == i * 2) {
+          (*replies)++;
+        }
+      });
+  }
+  return WaitUntil([replies, clients](){ return *replies == clients; }, 5000);
+}
+
+bool TestServerSessionsShareHandlers() {
+  const unsigned int clients = 32;
+  TestServer server;
+  std::atomic<unsigned int> opened{0};
+  server.setSessionOpenedCallback([&opened](const TestServer::SessionHandle&){ opened++; });
+  RegisterDoublingHandler(server);
+  if(!server.listen("127.0.0.1", 0)) {
+    return false;
+  }
+
+  std::vector<std::unique_ptr<ServerClient>> criers;
+  bool replied = ExchangeWithClients(server.port(), clients, criers);
+  return replied && opened == clients && server.sessionCount() == clients;
+}
+
+bool TestServerSessionClose() {
+  TestServer server;
+  std::atomic<unsigned int> closed{0};
+  std::mutex session_mutex;
+  TestServer::SessionHandle first_session;
+  server.setSessionOpenedCallback([&session_mutex, &first_session](const TestServer::SessionHandle& session){
+    std::lock_guard<std::mutex> guard(session_mutex);
+    if(!first_session) {
+      first_session = session;
+    }
+  });
+  server.setSessionClosedCallback([&closed](const TestServer::SessionHandle&, const std::string&){ closed++; });
+  RegisterDoublingHandler(server);
+  server.listen("127.0.0.1", 0);
+
+  std::vector<std::unique_ptr<ServerClient>> criers;
+  if(!ExchangeWithClients(server.port(), 2, criers)) {
+    return false;
+  }
+
+  // Closed by the server, the client sees its transport closed
+  std::atomic<bool> client_closed{false};
+  criers[0]->registerForTransportClosedCallback("TestServerSessionClose", [&client_closed](const std::string&){ client_closed = true; });
+  {
+    std::lock_guard<std::mutex> guard(session_mutex);
+    first_session->close();
+  }
+  bool server_closed_ok = WaitUntil([&closed, &client_closed](){ return closed == 1 && client_closed; }, 1000);
+
+  // Closed by the client
+  criers[1]->disconnectTransport();
+  bool client_closed_ok = WaitUntil([&closed, &server](){ return closed == 2 && server.sessionCount() == 0; }, 1000);
+
+  // A handle outliving its session just fails to send
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  std::lock_guard<std::mutex> guard(session_mutex);
+  return server_closed_ok && client_closed_ok && !first_session->open() && !first_session->sendMessage(msg);
+}
+
+bool TestServerBroadcast() {
+  const unsigned int clients = 8;
+  TestServer server;
+  RegisterDoublingHandler(server);
+  server.listen("127.0.0.1", 0);
+
+  std::vector<std::unique_ptr<ServerClient>> criers;
+  if(!ExchangeWithClients(server.port(), clients, criers)) {
+    return false;
+  }
+  std::atomic<unsigned int> received{0};
+  for(auto& client : criers) {
+    client->registerPermanentCallback<crier::test::test_msg_2>("TestServerBroadcast", [&received](const crier::test::test_msg_2& msg){
+      if(msg.data() == "to everyone") {
+        received++;
+      }
+    });
+  }
+
+  crier::test::test_msg_2 msg;
+  msg.set_data("to everyone");
+  size_t sent = server.broadcast(msg);
+  return sent == clients && WaitUntil([&received, clients](){ return received == clients; }, 1000);
+}
+
+bool TestServerOnReactor() {
+  const unsigned int clients = 64;
+  crier::Reactor reactor(2);
+  TestServer server;
+  server.attachToReactor(reactor);
+  RegisterDoublingHandler(server);
+  server.listen("127.0.0.1", 0);
+
+  // Clients and sessions all share the reactor's two threads
+  std::vector<std::unique_ptr<ServerClient>> criers;
+  bool replied = ExchangeWithClients(server.port(), clients, criers, &reactor);
+  server.stop();
+  bool all_closed = server.sessionCount() == 0 && WaitUntil([&criers](){
+    for(auto& client : criers) {
+      if(client->transportConnected()) {
+        return false;
+      }
+    }
+    return true;
+  }, 1000);
+  criers.clear();
+  return replied && all_closed;
+}
+
+bool TestCrierServer() {
+  return TestServerSessionsShareHandlers() &&
+         TestServerSessionClose() &&
+         TestServerBroadcast() &&
+         TestServerOnReactor();
+}
+
+#endif /* CrierServerTests_hpp */
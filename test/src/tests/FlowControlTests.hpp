@@ -0,0 +1,139 @@
+#ifndef FlowControlTests_hpp
+#define FlowControlTests_hpp
+
+#include <algorithm>
+#include <atomic>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+using FlowCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+
+/// Talks to a loopback echo server, so the instance is its own peer: the messages it sends come back through its own receive window.
+bool ConnectWithFlowControl(FlowCrier& net_crier, TcpEchoServer& server, const crier::FlowControlOptions& options) {
+  if(!net_crier.enableFlowControl(options)) {
+    return false;
+  }
+  net_crier.connectTransport("127.0.0.1", server.port());
+  // The grant sent on connect comes back as our own credits
+  return WaitUntil([&net_crier, &options](){ return net_crier.sendCredits() == options.window; }, 1000);
+}
+
+bool TestFlowControlBoundsDispatchQueue() {
+  const unsigned int messages = 100;
+  TcpEchoServer server;
+  crier::FlowControlOptions options;
+  options.window = 8;
+  FlowCrier net_crier(crier::UnhandledMessageBehaviour::Ignore, crier::InboundDispatching::DispatchQueue);
+  unsigned int received = 0;
+  bool in_order = true;
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestFlowControlBoundsDispatchQueue", [&received, &in_order](const crier::test::test_msg_1& msg){
+    in_order = in_order && msg.id() == received;
+    received++;
+  });
+  if(!ConnectWithFlowControl(net_crier, server, options)) {
+    return false;
+  }
+
+  for(unsigned int i = 0; i < messages; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessage(msg);
+  }
+  // Nothing is dispatched yet, so only a window's worth of messages made it into the queue
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  bool out_of_credits = net_crier.sendCredits() == 0;
+  net_crier.dispatchQueuedCallbacks();
+  bool bounded = received == options.window;
+
+  // Every dispatch grants credits back, letting the rest through a window at a time
+  unsigned int largest_dispatch = 0;
+  bool completed = WaitUntil([&net_crier, &received, &largest_dispatch, messages](){
+    unsigned int before = received;
+    net_crier.dispatchQueuedCallbacks();
+    largest_dispatch = std::max(largest_dispatch, received - before);
+    return received == messages;
+  }, 2000);
+  return out_of_credits && bounded && completed && in_order && largest_dispatch <= options.window;
+}
+
+bool TestFlowControlSenderBuffer() {
+  TcpEchoServer server;
+  crier::test::root_msg root;
+  root.mutable_test_msg_1_field()->set_id(1);
+  crier::FlowControlOptions options;
+  options.window = 2;
+  options.max_held_bytes = root.ByteSizeLong() * 3;
+  FlowCrier net_crier(crier::UnhandledMessageBehaviour::Ignore, crier::InboundDispatching::DispatchQueue);
+  unsigned int received = 0;
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestFlowControlSenderBuffer", [&received](const crier::test::test_msg_1&){ received++; });
+  if(!ConnectWithFlowControl(net_crier, server, options)) {
+    return false;
+  }
+
+  // Two go out on credit, three are held, the rest don't fit
+  unsigned int refused = 0;
+  for(int i = 0; i < 10; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(1);
+    if(!net_crier.sendMessage(msg)) {
+      refused++;
+    }
+  }
+  bool completed = WaitUntil([&net_crier, &received](){
+    net_crier.dispatchQueuedCallbacks();
+    return received == 5;
+  }, 2000);
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  net_crier.dispatchQueuedCallbacks();
+  return refused == 5 && completed && received == 5;
+}
+
+bool TestFlowControlRepliesFromCallbacks() {
+  const unsigned int messages = 1000;
+  TcpEchoServer server;
+  crier::FlowControlOptions options;
+  options.window = 8;
+  FlowCrier net_crier{};
+  // Both ends answer every message they get from their callbacks (the echo makes this one both), with a window's worth in flight
+  std::atomic<unsigned int> received{0};
+  std::atomic<unsigned int> sent{options.window};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestFlowControlRepliesFromCallbacks",
+    [&net_crier, &received, &sent, messages](const crier::test::test_msg_1& msg){
+      received++;
+      if(sent.fetch_add(1) < messages) {
+        crier::test::test_msg_1 reply;
+        reply.set_id(msg.id() + 1);
+        net_crier.sendMessage(reply);
+      }
+    });
+  if(!ConnectWithFlowControl(net_crier, server, options)) {
+    return false;
+  }
+
+  for(unsigned int i = 0; i < options.window; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessage(msg);
+  }
+  return WaitUntil([&received, messages](){ return received == messages; }, 5000);
+}
+
+bool TestFlowControlFieldTaken() {
+  crier::FlowControlOptions options;
+  options.credit_field_number = 1;
+  FlowCrier net_crier{};
+  return !net_crier.enableFlowControl(options) && net_crier.sendCredits() == 0;
+}
+
+bool TestFlowControl() {
+  return TestFlowControlBoundsDispatchQueue() &&
+         TestFlowControlSenderBuffer() &&
+         TestFlowControlRepliesFromCallbacks() &&
+         TestFlowControlFieldTaken();
+}
+
+#endif /* FlowControlTests_hpp */
@@ -0,0 +1,107 @@
+#ifndef IoUringTransportTests_hpp
+#define IoUringTransportTests_hpp
+
+#include <atomic>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/IoUringTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+bool TestIoUringConnectAndEcho() {
+  TcpEchoServer server;
+  std::atomic<bool> connected{false};
+  std::atomic<bool> test_successful{false};
+  crier::Crier<crier::IoUringTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestIoUringConnectAndEcho", [&connected](){ connected = true; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&connected](){ return connected.load(); }, 1000) || !net_crier.transportConnected()) {
+    return false;
+  }
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(42);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&test_successful](const crier::test::test_msg_1& reply){
+      test_successful = reply.id() == 42;
+    });
+
+  return WaitUntil([&test_successful](){ return test_successful.load(); }, 1000);
+}
+
+bool TestIoUringFramingAcrossBuffers() {
+  TcpEchoServer server;
+  // Small buffers on both sides, so frames get packed together on send and split across provided buffers on receive
+  crier::IoUringTransport::Options options;
+  options.recv_buffers = 4;
+  options.recv_buffer_size = 4096;
+  options.send_buffers = 2;
+  options.send_buffer_size = 8192;
+  crier::Crier<crier::IoUringTransport, crier::test::root_msg> net_crier{crier::IoUringTransport(options)};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  const unsigned int messages_to_send = 5000;
+  std::atomic<unsigned int> received{0};
+  std::atomic<bool> in_order{true};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestIoUringFramingAcrossBuffers",
+    [&received, &in_order](const crier::test::test_msg_1& reply){
+      if(reply.id() != received) {
+        in_order = false;
+      }
+      received++;
+    });
+
+  std::atomic<bool> large_ok{false};
+  const std::string large_payload(1024 * 1024, 'x');
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("TestIoUringFramingAcrossBuffers",
+    [&large_ok, &large_payload](const crier::test::test_msg_2& reply){
+      large_ok = reply.data() == large_payload;
+    });
+
+  for(unsigned int i = 0; i < messages_to_send; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessage(msg);
+  }
+  crier::test::test_msg_2 large_msg;
+  large_msg.set_data(large_payload);
+  net_crier.sendMessage(large_msg);
+
+  bool all_arrived = WaitUntil([&received, &large_ok](){ return received == messages_to_send && large_ok; }, 5000);
+  return all_arrived && in_order;
+}
+
+bool TestIoUringPeerDisconnect() {
+  TcpEchoServer server;
+  std::atomic<bool> connected{false};
+  std::atomic<bool> disconnected{false};
+  crier::Crier<crier::IoUringTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestIoUringPeerDisconnect", [&connected](){ connected = true; });
+  net_crier.registerForTransportClosedCallback("TestIoUringPeerDisconnect", [&disconnected](const std::string&){ disconnected = true; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&connected](){ return connected.load(); }, 1000)) {
+    return false;
+  }
+
+  server.dropClients();
+  return WaitUntil([&disconnected](){ return disconnected.load(); }, 1000) && !net_crier.transportConnected();
+}
+
+bool TestIoUringConnectByName() {
+  // The echo server only listens on 127.0.0.1, while localhost may resolve to ::1 first
+  TcpEchoServer server;
+  std::atomic<bool> connected{false};
+  std::atomic<bool> disconnected{false};
+  crier::Crier<crier::IoUringTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestIoUringConnectByName", [&connected](){ connected = true; });
+  net_crier.registerForTransportClosedCallback("TestIoUringConnectByName", [&disconnected](const std::string&){ disconnected = true; });
+  net_crier.connectTransport("localhost", server.port());
+  return WaitUntil([&connected](){ return connected.load(); }, 1000) && !disconnected;
+}
+
+bool TestIoUringTransport() {
+  return TestIoUringConnectAndEcho() && TestIoUringFramingAcrossBuffers() && TestIoUringPeerDisconnect() && TestIoUringConnectByName();
+}
+
+#endif /* IoUringTransportTests_hpp */
@@ -0,0 +1,132 @@
+#ifndef LoadGeneratorTransportTests_hpp
+#define LoadGeneratorTransportTests_hpp
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/LoadGeneratorTransport.hpp"
+#include "tests/TestUtils.hpp"
+
+using LoadCrier = crier::Crier<crier::LoadGeneratorTransport, crier::test::root_msg>;
+
+/// Root messages for the load generator's payloads.
+inline crier::test::root_msg LoadTestRoot(unsigned int id) {
+  crier::test::root_msg root;
+  root.mutable_test_msg_1_field()->set_id(id);
+  return root;
+}
+
+inline crier::test::root_msg LoadTestRoot(const std::string& data) {
+  crier::test::root_msg root;
+  root.mutable_test_msg_2_field()->set_data(data);
+  return root;
+}
+
+bool TestLoadGeneratorPayloadMix() {
+  crier::LoadGeneratorTransport::Options options;
+  options.max_messages = 4000;
+  crier::LoadGeneratorTransport transport(options);
+  transport.addMessage(LoadTestRoot(7), 3.0);
+  transport.addMessage(LoadTestRoot(std::string(512, 'x')), 1.0);
+  LoadCrier net_crier{std::move(transport)};
+
+  std::atomic<unsigned int> small{0};
+  std::atomic<unsigned int> large{0};
+  std::atomic<bool> intact{true};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestLoadGeneratorPayloadMix", [&small, &intact](const crier::test::test_msg_1& msg){
+    intact = intact && msg.id() == 7;
+    small++;
+  });
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("TestLoadGeneratorPayloadMix", [&large, &intact](const crier::test::test_msg_2& msg){
+    intact = intact && msg.data().size() == 512;
+    large++;
+  });
+  net_crier.connectTransport("localhost", 0);
+  if(!net_crier.transport().waitUntilFinished(std::chrono::milliseconds{5000}))
+    return false;
+
+  auto stats = net_crier.transport().stats();
+  // Drawn 3 to 1, give or take
+  return intact && small + large == 4000 && small > 2700 && small < 3300 && stats.injected == 4000 && stats.consume_time.count == 4000 &&
+    stats.missed == 0 && stats.injectedPerSecond() > 0 && net_crier.transportConnected();
+}
+
+bool TestLoadGeneratorProfile() {
+  // 20ms at 10000/s, then 80ms at 1000/s, once: 280 messages called for
+  auto options = crier::LoadGeneratorTransport::Options::bursts(1000, 10000, std::chrono::milliseconds{100}, std::chrono::milliseconds{20});
+  options.loop = false;
+  crier::LoadGeneratorTransport transport(options);
+  transport.addMessage(LoadTestRoot(1));
+  LoadCrier net_crier{std::move(transport)};
+  std::atomic<unsigned int> received{0};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestLoadGeneratorProfile", [&received](const crier::test::test_msg_1&){ received++; });
+  net_crier.connectTransport("localhost", 0);
+  if(!net_crier.transport().waitUntilFinished(std::chrono::milliseconds{2000}))
+    return false;
+
+  // Whatever a loaded machine couldn't fit in its phase is missed, never sent late into the next one
+  auto stats = net_crier.transport().stats();
+  return stats.injected + stats.missed == 280 && received == stats.injected && stats.elapsed >= std::chrono::milliseconds{100} &&
+    stats.max_lag >= stats.lag;
+}
+
+bool TestLoadGeneratorConnection() {
+  std::atomic<unsigned int> opened{0};
+  std::atomic<unsigned int> closed{0};
+  {
+    // Nothing to inject
+    LoadCrier net_crier{};
+    net_crier.registerForTransportClosedCallback("TestLoadGeneratorConnection", [&closed](const std::string&){ closed++; });
+    net_crier.connectTransport("localhost", 0);
+    if(closed != 1 || net_crier.transportConnected())
+      return false;
+  }
+
+  crier::LoadGeneratorTransport transport(crier::LoadGeneratorTransport::Options::constantRate(5000));
+  transport.addMessage(LoadTestRoot(1));
+  LoadCrier net_crier{std::move(transport)};
+  net_crier.registerForTransportOpenedCallback("TestLoadGeneratorConnection", [&opened](){ opened++; });
+  net_crier.registerForTransportClosedCallback("TestLoadGeneratorConnection", [&closed](const std::string&){ closed++; });
+  net_crier.connectTransport("localhost", 0);
+  if(!WaitUntil([&net_crier](){ return net_crier.transport().stats().injected >= 50; }, 2000))
+    return false;
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  net_crier.sendMessage(msg);
+  net_crier.disconnectTransport();
+  auto stats = net_crier.transport().stats();
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  // Stopped injecting for good, without having finished on its own
+  return opened == 1 && closed == 2 && stats.sent == 1 && net_crier.transport().stats().injected == stats.injected &&
+    !net_crier.transport().finished() && !net_crier.transportConnected();
+}
+
+bool TestLoadGeneratorDestroyedFromCallback() {
+  // The generator thread winds down on its own copy of everything, once the transport it ran for is gone
+  std::unique_ptr<crier::LoadGeneratorTransport> transport(new crier::LoadGeneratorTransport());
+  transport->addMessage(LoadTestRoot(1));
+  std::atomic<unsigned int> received{0};
+  std::atomic<bool> destroyed{false};
+  transport->setOnConnectCallback([](){});
+  transport->setOnDisconnectCallback([](const std::string&){});
+  transport->setOnDataCallback([&transport, &received, &destroyed](const std::string&){
+    if(received++ == 0) {
+      transport.reset();
+      destroyed = true;
+    }
+  });
+  transport->connect("localhost", 0);
+  bool gone = WaitUntil([&destroyed](){ return destroyed.load(); }, 2000);
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  return gone && received == 1;
+}
+
+bool TestLoadGeneratorTransport() {
+  return TestLoadGeneratorPayloadMix() && TestLoadGeneratorProfile() && TestLoadGeneratorConnection() && TestLoadGeneratorDestroyedFromCallback();
+}
+
+#endif /* LoadGeneratorTransportTests_hpp */
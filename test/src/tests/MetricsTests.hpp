@@ -0,0 +1,151 @@
+#ifndef MetricsTests_hpp
+#define MetricsTests_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "transports/EchoTransport.hpp"
+
+using MetricsCrier = crier::Crier<EchoTransport, crier::test::root_msg>;
+
+const crier::MessageTypeMetrics* MetricsForType(const crier::MetricsSnapshot& snapshot, const std::string& type) {
+  for(const auto& metrics : snapshot.types) {
+    if(metrics.type == type)
+      return &metrics;
+  }
+  return nullptr;
+}
+
+bool TestMetricsCountTraffic() {
+  MetricsCrier net_crier{};
+  bool empty_before = net_crier.metricsSnapshot().types.empty();
+  net_crier.enableMetrics();
+  net_crier.connectTransport("localhost", 0); // Echo transport doesn't care
+
+  unsigned int answers = 0;
+  crier::test::test_msg_1 msg;
+  for(unsigned int i = 0; i < 3; i++) {
+    msg.set_id(i);
+    net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+      [&answers](const crier::test::test_msg_1&){ answers++; });
+  }
+
+  crier::MetricsSnapshot snapshot = net_crier.metricsSnapshot();
+  const crier::MessageTypeMetrics* type = MetricsForType(snapshot, crier::test::test_msg_1().GetDescriptor()->full_name());
+  // Echoed back, what went out came back in, byte for byte
+  bool counted = type && type->messages_out == 3 && type->messages_in == 3 && type->bytes_out > 0 && type->bytes_in == type->bytes_out;
+  bool timed = snapshot.request_latency.count == 3 && snapshot.parse_time.count == 3 && snapshot.callback_time.count == 3;
+  // Single threaded, crier's locks were taken without ever waiting
+  bool locks_counted = false;
+  for(const auto& lock : snapshot.locks) {
+    if(lock.name == "callbackMap")
+      locks_counted = lock.acquisitions >= 3 && lock.contended == 0 && lock.wait_time.count == 0;
+  }
+  return empty_before && answers == 3 && counted && timed && locks_counted && snapshot.inbound_dropped == 0 && snapshot.outbound_dropped == 0;
+}
+
+bool TestMetricsUnhandledQueue() {
+  MetricsCrier net_crier{crier::UnhandledMessageBehaviour::Enqueue};
+  net_crier.enableMetrics();
+  net_crier.connectTransport("localhost", 0);
+
+  crier::test::test_msg_2 msg;
+  msg.set_data("unhandled");
+  net_crier.sendMessage(msg);
+  net_crier.sendMessage(msg);
+  crier::MetricsSnapshot queued = net_crier.metricsSnapshot();
+
+  // Registering a callback drains the queue, the peak stays
+  unsigned int delivered = 0;
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("metrics", [&delivered](const crier::test::test_msg_2&){ delivered++; });
+  crier::MetricsSnapshot drained = net_crier.metricsSnapshot();
+
+  // Messages of an ignored type are counted as dropped
+  net_crier.setUnhandledBehaviourForMsg<crier::test::test_msg_1>(crier::UnhandledMessageBehaviour::Ignore);
+  crier::test::test_msg_1 ignored_msg;
+  ignored_msg.set_id(1);
+  net_crier.sendMessage(ignored_msg);
+  crier::MetricsSnapshot ignored = net_crier.metricsSnapshot();
+
+  return queued.unhandled_queue_depth == 2 && queued.unhandled_queue_peak == 2 && delivered == 2 &&
+         drained.unhandled_queue_depth == 0 && drained.unhandled_queue_peak == 2 && ignored.unhandled_ignored == 1;
+}
+
+bool TestMetricsDispatchQueue() {
+  MetricsCrier net_crier{crier::UnhandledMessageBehaviour::Ignore, crier::InboundDispatching::DispatchQueue};
+  net_crier.enableMetrics();
+  net_crier.connectTransport("localhost", 0);
+
+  unsigned int answers = 0;
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  for(unsigned int i = 0; i < 3; i++) {
+    net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+      [&answers](const crier::test::test_msg_1&){ answers++; });
+  }
+  crier::MetricsSnapshot queued = net_crier.metricsSnapshot();
+  net_crier.dispatchQueuedCallbacks();
+  crier::MetricsSnapshot dispatched = net_crier.metricsSnapshot();
+
+  return answers == 3 && queued.dispatch_queue_depth == 3 && queued.dispatch_queue_time.count == 0 &&
+         dispatched.dispatch_queue_depth == 0 && dispatched.dispatch_queue_peak == 3 && dispatched.dispatch_queue_time.count == 3;
+}
+
+bool TestHistogramPercentiles() {
+  crier::LatencyHistogram histogram;
+  for(uint64_t i = 1; i <= 1000; i++) {
+    histogram.record(i * 1000);
+  }
+  crier::HistogramSnapshot snapshot = histogram.snapshot();
+
+  // Within a bucket's width (1/16th) of the exact value
+  auto close_to = [](uint64_t value, uint64_t expected){ return value >= expected && value <= expected + expected / 16; };
+  bool bounds_hold = true;
+  for(uint64_t value : {uint64_t(0), uint64_t(15), uint64_t(16), uint64_t(1000), uint64_t(123456789)}) {
+    size_t bucket = crier::LatencyHistogram::bucketFor(value);
+    bounds_hold = bounds_hold && crier::HistogramSnapshot::bucketLowerBound(bucket) <= value && value < crier::HistogramSnapshot::bucketLowerBound(bucket + 1);
+  }
+  return snapshot.count == 1000 && snapshot.max == 1000000 && snapshot.mean() == 500500.0 && bounds_hold &&
+         close_to(snapshot.percentile(0.5), 501000) && close_to(snapshot.percentile(0.99), 991000) && snapshot.percentile(1.0) == 1000000;
+}
+
+bool TestSlowCallbackAccounting() {
+  MetricsCrier net_crier{};
+  std::vector<crier::SlowCallback> slow_reports;
+  net_crier.setSlowCallbackThreshold(2000, [&slow_reports](const crier::SlowCallback& slow){ slow_reports.push_back(slow); });
+  net_crier.connectTransport("localhost", 0);
+
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("fast", [](const crier::test::test_msg_1&){});
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("slow", [](const crier::test::test_msg_1&){
+    std::this_thread::sleep_for(std::chrono::milliseconds{3});
+  });
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  net_crier.sendMessage(msg);
+  net_crier.sendMessage(msg);
+
+  std::string type = crier::test::test_msg_1().GetDescriptor()->full_name();
+  bool reported = slow_reports.size() == 2 && slow_reports[0].key == "slow" && slow_reports[0].type == type &&
+                  slow_reports[0].wall_time >= std::chrono::milliseconds{3};
+
+  // Sleeping takes wall time, but next to no CPU time
+  std::vector<crier::CallbackStats> top = net_crier.mostExpensiveCallbacks(1);
+  bool ranked = top.size() == 1 && top[0].key == "slow" && top[0].calls == 2 && top[0].wall_time >= std::chrono::milliseconds{6} &&
+                top[0].cpu_time < top[0].wall_time && top[0].max_wall_time >= std::chrono::milliseconds{3};
+  return reported && ranked && net_crier.mostExpensiveCallbacks(10).size() == 2;
+}
+
+bool TestMetrics() {
+  return TestMetricsCountTraffic() &&
+         TestMetricsUnhandledQueue() &&
+         TestMetricsDispatchQueue() &&
+         TestHistogramPercentiles() &&
+         TestSlowCallbackAccounting();
+}
+
+#endif /* MetricsTests_hpp */
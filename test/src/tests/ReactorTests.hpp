@@ -0,0 +1,198 @@
+#ifndef ReactorTests_hpp
+#define ReactorTests_hpp
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/Reactor.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+using ReactorTcpCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+
+/// Records which threads callbacks ran on, to check they all ran on the reactor's.
+class ThreadRecorder {
+public:
+  void record() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _threads.insert(std::this_thread::get_id());
+  }
+
+  bool onlyOn(crier::Reactor& reactor) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    for(const auto& id : _threads) {
+      bool found = false;
+      for(size_t i = 0; i < reactor.size(); i++) {
+        reactor.loop(i).runAndWait([&found, &id](){ found = found || std::this_thread::get_id() == id; });
+      }
+      if(!found) {
+        return false;
+      }
+    }
+    return !_threads.empty();
+  }
+
+private:
+  std::set<std::thread::id> _threads;
+  std::mutex _mutex;
+};
+
+bool TestEventLoopTimers() {
+  crier::EventLoop loop;
+  loop.start();
+  std::mutex order_mutex;
+  std::vector<int> order;
+  auto push = [&order_mutex, &order](int value){ std::lock_guard<std::mutex> guard(order_mutex); order.push_back(value); };
+
+  loop.runAfter(std::chrono::milliseconds{30}, [push](){ push(3); });
+  loop.runAfter(std::chrono::milliseconds{10}, [push](){ push(1); });
+  auto cancelled = loop.runAfter(std::chrono::milliseconds{20}, [push](){ push(2); });
+  bool cancel_ok = loop.cancelTimer(cancelled) && !loop.cancelTimer(cancelled);
+
+  bool done = WaitUntil([&order_mutex, &order](){ std::lock_guard<std::mutex> guard(order_mutex); return order.size() == 2; }, 1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds{30});
+  std::lock_guard<std::mutex> guard(order_mutex);
+  return cancel_ok && done && order == std::vector<int>{1, 3};
+}
+
+bool TestManyCriersOnReactor() {
+  const unsigned int instances = 64;
+  TcpEchoServer server;
+  crier::Reactor reactor(2);
+  ThreadRecorder recorder;
+  std::atomic<unsigned int> replies{0};
+
+  std::vector<std::unique_ptr<ReactorTcpCrier>> criers;
+  for(unsigned int i = 0; i < instances; i++) {
+    criers.emplace_back(new ReactorTcpCrier());
+    criers.back()->attachToReactor(reactor);
+    criers.back()->connectTransport("127.0.0.1", server.port());
+  }
+  for(unsigned int i = 0; i < instances; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    criers[i]->sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+      [&replies, &recorder, i](const crier::test::test_msg_1& reply){
+        recorder.record();
+        if(reply.id() == i) {
+          replies++;
+        }
+      });
+  }
+
+  bool all_replied = WaitUntil([&replies, instances](){ return replies == instances; }, 5000);
+  // Instances come and go while the reactor keeps serving the others
+  criers.erase(criers.begin(), criers.begin() + instances / 2);
+  return all_replied && recorder.onlyOn(reactor) && criers.back()->transportConnected();
+}
+
+bool TestReactorTimeout() {
+  TcpEchoServer server;
+  crier::Reactor reactor(1);
+  ThreadRecorder recorder;
+  std::atomic<bool> timed_out{false};
+  ReactorTcpCrier net_crier{};
+  net_crier.attachToReactor(reactor);
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  // The echo server replies with a test_msg_1, so a test_msg_2 never arrives
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [](const crier::test::test_msg_2&){}, 20,
+    [&timed_out, &recorder](){
+      recorder.record();
+      timed_out = true;
+    });
+
+  // A timeout left pending when its instance goes away must never fire
+  {
+    ReactorTcpCrier short_lived{};
+    short_lived.attachToReactor(reactor);
+    short_lived.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+      [](const crier::test::test_msg_2&){}, 10, [](){ std::abort(); });
+  }
+
+  bool fired = WaitUntil([&timed_out](){ return timed_out.load(); }, 1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  return fired && recorder.onlyOn(reactor);
+}
+
+bool TestReactorCancelDropsTimer() {
+  TcpEchoServer server;
+  crier::Reactor reactor(1);
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+
+  // Requests are sent before connecting, so the echoes of the messages sent once connected are their answers.
+  // A cancelled request still takes its answer, which drops it, and only then lets go of its timer: the next request waits on the one after
+  ReactorTcpCrier net_crier{};
+  net_crier.attachToReactor(reactor);
+  std::atomic<bool> wrongly_answered{false};
+  std::atomic<bool> timed_out{false};
+  auto handle = net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [](const crier::test::test_msg_1&){}, 60000, [](){});
+  bool cancelled = handle.cancel();
+  net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&wrongly_answered](const crier::test::test_msg_1&){ wrongly_answered = true; }, 300, [&timed_out](){ timed_out = true; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  net_crier.sendMessage(msg);
+  // With its timer gone from the loop, nothing holds on to the request anymore
+  bool released = WaitUntil([&handle](){ return !handle.valid(); }, 2000);
+  bool next_timed_out = WaitUntil([&timed_out](){ return timed_out.load(); }, 2000);
+
+  // Answered, the request after the cancelled one gets the second answer
+  ReactorTcpCrier answered_crier{};
+  answered_crier.attachToReactor(reactor);
+  std::atomic<bool> answered{false};
+  bool cancelled_again = answered_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [](const crier::test::test_msg_1&){}, 60000, [](){}).cancel();
+  answered_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&answered](const crier::test::test_msg_1&){ answered = true; }, 2000, [](){});
+  answered_crier.connectTransport("127.0.0.1", server.port());
+  answered_crier.sendMessage(msg);
+  answered_crier.sendMessage(msg);
+  bool next_answered = WaitUntil([&answered](){ return answered.load(); }, 2000);
+
+  return cancelled && released && next_timed_out && !wrongly_answered && cancelled_again && next_answered;
+}
+
+bool TestReactorDrainsDispatchQueue() {
+  TcpEchoServer server;
+  crier::Reactor reactor(1);
+  ThreadRecorder recorder;
+  std::atomic<unsigned int> received{0};
+  ReactorTcpCrier net_crier(crier::UnhandledMessageBehaviour::Ignore, crier::InboundDispatching::DispatchQueue);
+  net_crier.attachToReactor(reactor, true);
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestReactorDrainsDispatchQueue",
+    [&received, &recorder](const crier::test::test_msg_1&){
+      recorder.record();
+      received++;
+    });
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  for(int i = 0; i < 100; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessage(msg);
+  }
+  // Nobody calls dispatchQueuedCallbacks, the reactor does
+  return WaitUntil([&received](){ return received == 100; }, 2000) && recorder.onlyOn(reactor);
+}
+
+bool TestReactor() {
+  return TestEventLoopTimers() &&
+         TestManyCriersOnReactor() &&
+         TestReactorTimeout() &&
+         TestReactorCancelDropsTimer() &&
+         TestReactorDrainsDispatchQueue();
+}
+
+#endif /* ReactorTests_hpp */
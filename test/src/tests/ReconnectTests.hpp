@@ -0,0 +1,195 @@
+#ifndef ReconnectTests_hpp
+#define ReconnectTests_hpp
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/CrierServer.hpp"
+#include "crier/Reactor.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+using ReconnectingCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+using ReconnectServer = crier::CrierServer<crier::test::root_msg>;
+
+crier::ReconnectPolicy FastReconnectPolicy() {
+  crier::ReconnectPolicy policy;
+  policy.initial_delay_ms = 5;
+  policy.max_delay_ms = 40;
+  return policy;
+}
+
+/// Counts the test_msg_1 a server receives.
+std::unique_ptr<ReconnectServer> CountingServer(int port, std::atomic<unsigned int>& received) {
+  std::unique_ptr<ReconnectServer> server(new ReconnectServer());
+  server->registerHandler<crier::test::test_msg_1>([&received](const ReconnectServer::SessionHandle&, const crier::test::test_msg_1&){ received++; });
+  if(!server->listen("127.0.0.1", port)) {
+    server.reset();
+  }
+  return server;
+}
+
+bool TestReconnectAfterPeerDrop(crier::Reactor* reactor) {
+  TcpEchoServer server;
+  std::atomic<unsigned int> opened{0};
+  std::atomic<unsigned int> closed{0};
+  std::atomic<unsigned int> echoed{0};
+  ReconnectingCrier net_crier{};
+  if(reactor) {
+    net_crier.attachToReactor(*reactor);
+  }
+  net_crier.enableAutoReconnect(FastReconnectPolicy());
+  net_crier.registerForTransportOpenedCallback("TestReconnectAfterPeerDrop", [&opened](){ opened++; });
+  net_crier.registerForTransportClosedCallback("TestReconnectAfterPeerDrop", [&closed](const std::string&){ closed++; });
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestReconnectAfterPeerDrop", [&echoed](const crier::test::test_msg_1&){ echoed++; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&opened](){ return opened == 1; }, 1000)) {
+    return false;
+  }
+
+  server.dropClients();
+  if(!WaitUntil([&closed](){ return closed == 1; }, 1000)) {
+    return false;
+  }
+  // Sent during the outage, held and flushed once reconnected
+  for(unsigned int i = 0; i < 10; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessage(msg);
+  }
+  return WaitUntil([&opened, &echoed](){ return opened == 2 && echoed == 10; }, 2000) && closed == 1;
+}
+
+bool TestReconnectBackoffAndOutageLimit() {
+  std::atomic<unsigned int> received{0};
+  auto server = CountingServer(0, received);
+  if(!server) {
+    return false;
+  }
+  const int port = server->port();
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  const size_t msg_size = msg.ByteSizeLong() + 2; // Wrapped in the root message
+  crier::ReconnectPolicy policy = FastReconnectPolicy();
+  policy.outage_buffer_bytes = msg_size * 5;
+
+  std::atomic<unsigned int> opened{0};
+  std::atomic<unsigned int> closed{0};
+  ReconnectingCrier net_crier{};
+  net_crier.enableAutoReconnect(policy);
+  net_crier.registerForTransportOpenedCallback("TestReconnectBackoffAndOutageLimit", [&opened](){ opened++; });
+  net_crier.registerForTransportClosedCallback("TestReconnectBackoffAndOutageLimit", [&closed](const std::string&){ closed++; });
+  net_crier.connectTransport("127.0.0.1", port);
+  if(!WaitUntil([&opened](){ return opened == 1; }, 1000)) {
+    return false;
+  }
+
+  // With the server gone, attempts keep failing, but the outage is only reported once
+  server.reset();
+  if(!WaitUntil([&closed](){ return closed == 1; }, 1000)) {
+    return false;
+  }
+  for(int i = 0; i < 8; i++) {
+    net_crier.sendMessage(msg);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds{150});
+  bool reported_once = closed == 1 && !net_crier.transportConnected();
+
+  server = CountingServer(port, received);
+  if(!server) {
+    return false;
+  }
+  // Only what fit the outage buffer arrives
+  bool flushed = WaitUntil([&opened, &received](){ return opened == 2 && received == 5; }, 2000);
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  return reported_once && flushed && received == 5;
+}
+
+bool TestNoReconnectAfterUserDisconnect() {
+  TcpEchoServer server;
+  std::atomic<unsigned int> opened{0};
+  ReconnectingCrier net_crier{};
+  net_crier.enableAutoReconnect(FastReconnectPolicy());
+  net_crier.registerForTransportOpenedCallback("TestNoReconnectAfterUserDisconnect", [&opened](){ opened++; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&opened](){ return opened == 1; }, 1000)) {
+    return false;
+  }
+  net_crier.disconnectTransport();
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  return opened == 1 && !net_crier.transportConnected();
+}
+
+bool TestFailPendingRequestsOnDisconnect() {
+  TcpEchoServer server;
+  std::atomic<unsigned int> opened{0};
+  ReconnectingCrier net_crier{};
+  net_crier.setPendingRequestsOnDisconnect(crier::PendingRequestsOnDisconnect::Fail);
+  net_crier.enableAutoReconnect(FastReconnectPolicy());
+  net_crier.registerForTransportOpenedCallback("TestFailPendingRequestsOnDisconnect", [&opened](){ opened++; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&opened](){ return opened == 1; }, 1000)) {
+    return false;
+  }
+
+  // The echo server never replies with a test_msg_2, so these would wait out their timeouts, or forever
+  std::atomic<unsigned int> failed{0};
+  auto captured = std::make_shared<int>(0);
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [](const crier::test::test_msg_2&){}, 5000, [&failed](){ failed++; });
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_2>(msg, [captured](const crier::test::test_msg_2&){});
+  auto future = net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 5000);
+  crier::RequestPolicy policy;
+  policy.attempt_timeout_ms = 5000;
+  policy.max_retries = 3;
+  net_crier.sendMessageWithRetCallbackAndPolicy<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [](const crier::test::test_msg_2&){}, policy, [&failed](){ failed++; });
+  std::atomic<bool> stream_disconnected{false};
+  net_crier.sendStreamingRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg, [](const crier::test::test_msg_2&){ return true; },
+    crier::StreamOptions(), [&stream_disconnected](crier::StreamEnd reason){ stream_disconnected = reason == crier::StreamEnd::Disconnected; });
+
+  server.dropClients();
+  bool all_failed = future.waitFor(std::chrono::milliseconds{1000}) == crier::ResponseStatus::Disconnected &&
+                    WaitUntil([&failed, &stream_disconnected](){ return failed == 2 && stream_disconnected; }, 1000) && captured.use_count() == 1;
+
+  // Once reconnected, the failed requests' timeouts don't take the callbacks of new requests
+  std::atomic<unsigned int> answered{0};
+  bool reconnected = WaitUntil([&opened](){ return opened == 2; }, 2000);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg, [&answered](const crier::test::test_msg_1&){ answered++; });
+  return all_failed && reconnected && WaitUntil([&answered](){ return answered == 1; }, 1000) && failed == 2;
+}
+
+bool TestKeepPendingRequestsOnDisconnect() {
+  TcpEchoServer server;
+  ReconnectingCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&net_crier](){ return net_crier.transportConnected(); }, 1000)) {
+    return false;
+  }
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  auto future = net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 200);
+  server.dropClients();
+  // Left to their timeout by default
+  return future.waitFor(std::chrono::milliseconds{100}) == crier::ResponseStatus::Pending &&
+         future.waitFor(std::chrono::milliseconds{1000}) == crier::ResponseStatus::TimedOut;
+}
+
+bool TestReconnect() {
+  crier::Reactor reactor(1);
+  return TestReconnectAfterPeerDrop(nullptr) &&
+         TestReconnectAfterPeerDrop(&reactor) &&
+         TestReconnectBackoffAndOutageLimit() &&
+         TestNoReconnectAfterUserDisconnect() &&
+         TestFailPendingRequestsOnDisconnect() &&
+         TestKeepPendingRequestsOnDisconnect();
+}
+
+#endif /* ReconnectTests_hpp */
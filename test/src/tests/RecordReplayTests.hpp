@@ -0,0 +1,121 @@
+#ifndef RecordReplayTests_hpp
+#define RecordReplayTests_hpp
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/RecordingTransport.hpp"
+#include "crier/transports/ReplayTransport.hpp"
+#include "transports/EchoTransport.hpp"
+#include "tests/TestUtils.hpp"
+
+using RecordingCrier = crier::Crier<crier::RecordingTransport<EchoTransport>, crier::test::root_msg>;
+using ReplayCrier = crier::Crier<crier::ReplayTransport, crier::test::root_msg>;
+
+/// Capture paths are made unique per test run, so runs at once can't get in each other's way.
+inline std::string CaptureTestPath(const std::string& test) {
+  return "/tmp/crier-test-" + test + "-" + std::to_string(getpid()) + ".capture";
+}
+
+/// Records a session through EchoTransport: three requests echoed back, pause_ms apart, then a disconnect.
+inline bool RecordEchoSession(const std::string& path, unsigned int pause_ms) {
+  RecordingCrier net_crier{crier::RecordingTransport<EchoTransport>(path)};
+  if(!net_crier.transport().recording())
+    return false;
+  net_crier.connectTransport("localhost", 0);
+  for(unsigned int id = 1; id <= 3; id++) {
+    if(id > 1)
+      std::this_thread::sleep_for(std::chrono::milliseconds{pause_ms});
+    crier::test::test_msg_1 msg;
+    msg.set_id(id);
+    net_crier.sendMessage(msg);
+  }
+  net_crier.disconnectTransport();
+  return true;
+}
+
+bool TestRecordingCapturesTraffic() {
+  const std::string path = CaptureTestPath("record");
+  if(!RecordEchoSession(path, 0))
+    return false;
+
+  crier::capture::Reader reader;
+  std::string err;
+  if(!reader.open(path, err))
+    return false;
+  std::vector<crier::capture::RecordKind> kinds;
+  crier::capture::Record record;
+  bool ordered = true;
+  std::chrono::nanoseconds last{0};
+  while(reader.next(record)) {
+    kinds.push_back(record.kind);
+    ordered = ordered && record.time >= last;
+    last = record.time;
+  }
+  unlink(path.c_str());
+
+  using Kind = crier::capture::RecordKind;
+  // EchoTransport answers within sendData, so each message is recorded going out, then coming back
+  std::vector<Kind> expected{Kind::Connect, Kind::Outbound, Kind::Inbound, Kind::Outbound, Kind::Inbound, Kind::Outbound, Kind::Inbound, Kind::Disconnect};
+  return ordered && kinds == expected;
+}
+
+/// Replays the capture at path, returning the ids received, in order, and the transport opened and closed events seen.
+inline std::vector<unsigned int> ReplayEchoSession(const std::string& path, const crier::ReplayTransport::Options& options, crier::ReplayTransport::Stats& stats,
+                                                   unsigned int& opened, unsigned int& closed) {
+  std::vector<unsigned int> ids;
+  ReplayCrier net_crier{crier::ReplayTransport(path, options)};
+  net_crier.registerForTransportOpenedCallback("ReplayEchoSession", [&opened](){ opened++; });
+  net_crier.registerForTransportClosedCallback("ReplayEchoSession", [&closed](const std::string&){ closed++; });
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("ReplayEchoSession", [&ids](const crier::test::test_msg_1& msg){ ids.push_back(msg.id()); });
+  net_crier.connectTransport("", 0);
+  net_crier.transport().waitUntilFinished(std::chrono::milliseconds{5000});
+  stats = net_crier.transport().stats();
+  return ids;
+}
+
+bool TestReplayFeedsCapture() {
+  const std::string path = CaptureTestPath("replay");
+  if(!RecordEchoSession(path, 40))
+    return false;
+
+  crier::ReplayTransport::Options options;
+  options.timing = crier::ReplayTransport::Timing::AsFastAsPossible;
+  crier::ReplayTransport::Stats fast;
+  unsigned int opened = 0;
+  unsigned int closed = 0;
+  bool fast_ok = ReplayEchoSession(path, options, fast, opened, closed) == std::vector<unsigned int>{1, 2, 3} && opened == 1 && closed == 1 &&
+    fast.replayed == 3 && fast.recorded_sent == 3 && fast.sent == 0 && fast.passes == 1 && fast.consume_time.count == 3 &&
+    fast.elapsed < std::chrono::milliseconds{40};
+
+  // At the original timing the 40ms pauses come back, halved at twice the speed
+  options.timing = crier::ReplayTransport::Timing::Original;
+  crier::ReplayTransport::Stats original;
+  bool original_ok = ReplayEchoSession(path, options, original, opened, closed) == std::vector<unsigned int>{1, 2, 3} &&
+    original.elapsed >= std::chrono::milliseconds{75};
+  options.speed = 2.0;
+  crier::ReplayTransport::Stats doubled;
+  bool doubled_ok = ReplayEchoSession(path, options, doubled, opened, closed) == std::vector<unsigned int>{1, 2, 3} &&
+    doubled.elapsed >= std::chrono::milliseconds{35} && doubled.elapsed < original.elapsed;
+  unlink(path.c_str());
+  return fast_ok && original_ok && doubled_ok && opened == 3 && closed == 3;
+}
+
+bool TestReplayMissingCapture() {
+  std::atomic<bool> closed{false};
+  ReplayCrier net_crier{crier::ReplayTransport(CaptureTestPath("missing"))};
+  net_crier.registerForTransportClosedCallback("TestReplayMissingCapture", [&closed](const std::string&){ closed = true; });
+  net_crier.connectTransport("", 0);
+  return closed && !net_crier.transportConnected() && !net_crier.transport().finished();
+}
+
+bool TestRecordReplay() {
+  return TestRecordingCapturesTraffic() && TestReplayFeedsCapture() && TestReplayMissingCapture();
+}
+
+#endif /* RecordReplayTests_hpp */
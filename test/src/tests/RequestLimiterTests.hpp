@@ -0,0 +1,92 @@
+#ifndef RequestLimiterTests_hpp
+#define RequestLimiterTests_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+using LimitedCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+
+bool TestRequestLimitQueuesAndTimesOutFromSend() {
+  const unsigned int requests = 10;
+  const unsigned int timeout_ms = 50;
+  TcpEchoServer server;
+  LimitedCrier net_crier{};
+  net_crier.setMaxRequestsInFlight(4);
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  // The echo server replies with a test_msg_1, so waiting on a test_msg_2 keeps each request in flight until it times out
+  std::mutex times_mutex;
+  std::vector<long long> timed_out_after;
+  auto start = std::chrono::steady_clock::now();
+  for(unsigned int i = 0; i < requests; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessageWithRetCallbackAndTimeout<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+      [](const crier::test::test_msg_2&){}, timeout_ms,
+      [&times_mutex, &timed_out_after, start](){
+        std::lock_guard<std::mutex> guard(times_mutex);
+        timed_out_after.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+      });
+  }
+  crier::RequestQueueStats queued_stats = net_crier.requestQueueStats();
+  bool limited = queued_stats.in_flight == 4 && queued_stats.queued == 6 && net_crier.queuedRequestsForMsg<crier::test::test_msg_1>() == 6;
+
+  bool all_timed_out = WaitUntil([&times_mutex, &timed_out_after, requests](){
+    std::lock_guard<std::mutex> guard(times_mutex);
+    return timed_out_after.size() == requests;
+  }, 2000);
+  // Three rounds of four, each timing out a full timeout after being sent
+  std::lock_guard<std::mutex> guard(times_mutex);
+  bool timed_from_send = all_timed_out && *std::max_element(timed_out_after.begin(), timed_out_after.end()) >= 3 * timeout_ms;
+  crier::RequestQueueStats final_stats = net_crier.requestQueueStats();
+  return limited && timed_from_send && final_stats.in_flight == 0 && final_stats.queued == 0 &&
+         final_stats.peak_queued == 6 && final_stats.total_queued == 6 && final_stats.total_wait_us > 0;
+}
+
+bool TestRequestLimitPerType() {
+  const unsigned int requests = 50;
+  TcpEchoServer server;
+  LimitedCrier net_crier{};
+  net_crier.setMaxRequestsInFlightForMsg<crier::test::test_msg_1>(2);
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  std::atomic<unsigned int> replies{0};
+  std::atomic<size_t> most_in_flight{0};
+  for(unsigned int i = 0; i < requests; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+      [&net_crier, &replies, &most_in_flight](const crier::test::test_msg_1&){
+        size_t in_flight = net_crier.requestQueueStats().in_flight;
+        size_t most = most_in_flight;
+        while(in_flight > most && !most_in_flight.compare_exchange_weak(most, in_flight)) {}
+        replies++;
+      });
+  }
+  // Other request types aren't held back by test_msg_1's cap
+  std::atomic<bool> other_replied{false};
+  crier::test::test_msg_2 other;
+  other.set_data("not capped");
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_2, crier::test::test_msg_2>(other,
+    [&other_replied](const crier::test::test_msg_2&){ other_replied = true; });
+  bool other_not_queued = net_crier.queuedRequestsForMsg<crier::test::test_msg_2>() == 0;
+
+  bool all_replied = WaitUntil([&replies, &other_replied, requests](){ return replies == requests && other_replied; }, 2000);
+  return all_replied && other_not_queued && most_in_flight <= 3 && net_crier.requestQueueStats().in_flight == 0;
+}
+
+bool TestRequestLimiter() {
+  return TestRequestLimitQueuesAndTimesOutFromSend() &&
+         TestRequestLimitPerType();
+}
+
+#endif /* RequestLimiterTests_hpp */
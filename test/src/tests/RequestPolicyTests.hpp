@@ -0,0 +1,149 @@
+#ifndef RequestPolicyTests_hpp
+#define RequestPolicyTests_hpp
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/CrierServer.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "tests/TestUtils.hpp"
+
+using PolicyCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+using PolicyServer = crier::CrierServer<crier::test::root_msg>;
+
+/// Answers each test_msg_1 with a test_msg_2 holding the request's id, after however many milliseconds delay_for says for the nth request received
+/// (counting from 1). A negative delay leaves the request unanswered.
+class SlowResponder {
+public:
+  explicit SlowResponder(const std::function<int(unsigned int)>& delay_for) {
+    _server.registerHandler<crier::test::test_msg_1>([this, delay_for](const PolicyServer::SessionHandle& session, const crier::test::test_msg_1& request){
+      int delay_ms = delay_for(++received);
+      if(delay_ms < 0)
+        return;
+      crier::test::test_msg_2 response;
+      response.set_data(std::to_string(request.id()));
+      std::lock_guard<std::mutex> guard(_repliesMutex);
+      _replies.emplace_back([session, response, delay_ms](){
+        std::this_thread::sleep_for(std::chrono::milliseconds{delay_ms});
+        session->sendMessage(response);
+      });
+    });
+    _server.listen("127.0.0.1", 0);
+  }
+
+  ~SlowResponder() {
+    std::lock_guard<std::mutex> guard(_repliesMutex);
+    for(auto& reply : _replies) {
+      reply.join();
+    }
+  }
+
+  int port() const { return _server.port(); }
+
+  std::atomic<unsigned int> received{0};
+
+private:
+  PolicyServer _server;
+  std::mutex _repliesMutex;
+  std::vector<std::thread> _replies;
+};
+
+bool TestPolicyRetriesOnTimeout() {
+  // Only the third attempt is answered
+  SlowResponder responder([](unsigned int nth){ return nth < 3 ? -1 : 0; });
+  PolicyCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", responder.port());
+
+  crier::RequestPolicy policy;
+  policy.attempt_timeout_ms = 40;
+  policy.max_retries = 2;
+  policy.retry_backoff_ms = 10;
+  std::atomic<unsigned int> successes{0};
+  std::atomic<unsigned int> timeouts{0};
+  std::string answer;
+  crier::test::test_msg_1 msg;
+  msg.set_id(5);
+  net_crier.sendMessageWithRetCallbackAndPolicy<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [&successes, &answer](const crier::test::test_msg_2& response){ answer = response.data(); successes++; },
+    policy, [&timeouts](){ timeouts++; });
+  bool answered = WaitUntil([&successes](){ return successes == 1; }, 2000);
+  bool answered_once = answered && answer == "5" && responder.received == 3 && timeouts == 0;
+
+  // Out of retries, it times out once
+  SlowResponder silent([](unsigned int){ return -1; });
+  PolicyCrier silent_crier{};
+  silent_crier.connectTransport("127.0.0.1", silent.port());
+  auto future = silent_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg, policy);
+  bool timed_out = future.waitFor(std::chrono::seconds{2}) == crier::ResponseStatus::TimedOut;
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  return answered_once && timed_out && silent.received == 3;
+}
+
+bool TestPolicyHedgesSlowResponse() {
+  // The first attempt gets stuck behind something slow, the hedged duplicate doesn't
+  SlowResponder responder([](unsigned int nth){ return nth == 1 ? 300 : 0; });
+  PolicyCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", responder.port());
+
+  crier::RequestPolicy policy;
+  policy.attempt_timeout_ms = 1000;
+  policy.hedge = true;
+  policy.hedge_delay_ms = 20;
+  std::atomic<unsigned int> successes{0};
+  crier::test::test_msg_1 msg;
+  msg.set_id(9);
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<long long> answered_after{0};
+  net_crier.sendMessageWithRetCallbackAndPolicy<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+    [&successes, &answered_after, start](const crier::test::test_msg_2&){
+      answered_after = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+      successes++;
+    }, policy, nullptr);
+  bool hedged = WaitUntil([&successes](){ return successes == 1; }, 1000) && answered_after < 200 && responder.received == 2;
+
+  // The late duplicate is dropped, instead of answering the next request
+  std::this_thread::sleep_for(std::chrono::milliseconds{350});
+  std::string next_answer;
+  std::atomic<bool> next_answered{false};
+  crier::test::test_msg_1 next;
+  next.set_id(10);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_2>(next,
+    [&next_answer, &next_answered](const crier::test::test_msg_2& response){ next_answer = response.data(); next_answered = true; });
+  bool kept_apart = WaitUntil([&next_answered](){ return next_answered.load(); }, 1000) && next_answer == "10";
+  return hedged && kept_apart && successes == 1;
+}
+
+bool TestPolicyRetriesDuringDestruction() {
+  // Retries still firing while the instance goes away mustn't reach a transport that's already gone
+  SlowResponder silent([](unsigned int){ return -1; });
+  {
+    PolicyCrier net_crier{};
+    net_crier.connectTransport("127.0.0.1", silent.port());
+    crier::RequestPolicy policy;
+    policy.attempt_timeout_ms = 10;
+    policy.max_retries = 5;
+    policy.retry_backoff_ms = 0;
+    crier::test::test_msg_1 msg;
+    for(unsigned int id = 0; id < 200; id++) {
+      msg.set_id(id);
+      net_crier.sendMessageWithRetCallbackAndPolicy<crier::test::test_msg_1, crier::test::test_msg_2>(msg,
+        [](const crier::test::test_msg_2&){}, policy, nullptr);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{15});
+  }
+  return silent.received >= 200;
+}
+
+bool TestRequestPolicies() {
+  return TestPolicyRetriesOnTimeout() &&
+         TestPolicyHedgesSlowResponse() &&
+         TestPolicyRetriesDuringDestruction();
+}
+
+#endif /* RequestPolicyTests_hpp */
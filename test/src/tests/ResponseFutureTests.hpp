@@ -0,0 +1,76 @@
+#ifndef ResponseFutureTests_hpp
+#define ResponseFutureTests_hpp
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+
+using FutureCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+
+bool TestFutureFanOut() {
+  const unsigned int requests = 100;
+  TcpEchoServer server;
+  FutureCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  std::vector<crier::ResponseFuture<crier::test::test_msg_1>> futures;
+  for(unsigned int i = 0; i < requests; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    futures.push_back(net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_1>(msg, 2000));
+  }
+  if(!crier::whenAll(futures).waitFor(std::chrono::seconds{2})) {
+    return false;
+  }
+  for(unsigned int i = 0; i < requests; i++) {
+    if(futures[i].status() != crier::ResponseStatus::Ready || futures[i].get().id() != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TestFutureTimeoutAndJoin() {
+  TcpEchoServer server;
+  FutureCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  // The echo server replies with a test_msg_1, so the test_msg_2 never arrives
+  crier::test::test_msg_1 msg;
+  msg.set_id(7);
+  auto answered = net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_1>(msg, 1000);
+  auto unanswered = net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg, 20);
+  auto joined = crier::whenAll(answered, unanswered);
+  bool joined_with_failure = !joined.wait() && joined.failures() == 1;
+  return joined_with_failure && answered.get().id() == 7 && unanswered.wait() == crier::ResponseStatus::TimedOut;
+}
+
+bool TestFutureAbandoned() {
+  TcpEchoServer server;
+  crier::ResponseFuture<crier::test::test_msg_2> future;
+  {
+    FutureCrier net_crier{};
+    net_crier.connectTransport("127.0.0.1", server.port());
+    crier::test::test_msg_1 msg;
+    msg.set_id(1);
+    future = net_crier.sendRequest<crier::test::test_msg_1, crier::test::test_msg_2>(msg);
+    if(future.waitFor(std::chrono::milliseconds{20}) != crier::ResponseStatus::Pending) {
+      return false;
+    }
+  }
+  // Nothing would ever resolve it once its instance is gone, so it doesn't wait forever
+  return future.valid() && future.wait() == crier::ResponseStatus::Abandoned;
+}
+
+bool TestResponseFutures() {
+  return TestFutureFanOut() &&
+         TestFutureTimeoutAndJoin() &&
+         TestFutureAbandoned();
+}
+
+#endif /* ResponseFutureTests_hpp */
@@ -0,0 +1,58 @@
+#ifndef SerializationTests_hpp
+#define SerializationTests_hpp
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "transports/EchoTransport.hpp"
+
+bool TestInPlaceCustomSerializationRoundTrip() {
+  bool test_successful = false;
+  crier::Crier<EchoTransport, crier::test::root_msg> net_crier{};
+  net_crier.connectTransport("localhost", 0); // Echo transport doesn't care
+
+  // Emulate a framing layer by prefixing every message with a marker byte
+  net_crier.SetCustomSerializationIntoBufferFun([](const crier::test::root_msg& msg, std::string& out){
+    out.push_back('#');
+    return msg.AppendToString(&out);
+  });
+  net_crier.SetCustomInPlaceDeserializationFun([](const char* data, size_t size, crier::test::root_msg& out){
+    if(size == 0 || data[0] != '#') {
+      return false;
+    }
+    return out.ParseFromArray(data + 1, static_cast<int>(size - 1));
+  });
+
+  crier::test::test_msg_2 msg;
+  msg.set_data("in place");
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_2, crier::test::test_msg_2>(msg,
+    [&test_successful](const crier::test::test_msg_2& reply){
+      test_successful = reply.data() == "in place";
+    });
+
+  return test_successful;
+}
+
+bool TestInPlaceCustomDeserializationDropsOnFailure() {
+  bool callback_called = false;
+  crier::Crier<EchoTransport, crier::test::root_msg> net_crier{};
+  net_crier.connectTransport("localhost", 0); // Echo transport doesn't care
+
+  net_crier.SetCustomInPlaceDeserializationFun([](const char*, size_t, crier::test::root_msg&){
+    return false;
+  });
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(42);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&callback_called](const crier::test::test_msg_1&){
+      callback_called = true;
+    });
+
+  return !callback_called;
+}
+
+bool TestCustomSerialization() {
+  return TestInPlaceCustomSerializationRoundTrip() && TestInPlaceCustomDeserializationDropsOnFailure();
+}
+
+#endif /* SerializationTests_hpp */
@@ -0,0 +1,131 @@
+#ifndef ShmTransportTests_hpp
+#define ShmTransportTests_hpp
+
+#include <atomic>
+#include <string>
+
+#include <unistd.h>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/ShmTransport.hpp"
+#include "transports/ShmEchoPeer.hpp"
+#include "tests/TestUtils.hpp"
+
+/// Channel names are made unique per test run, so leftovers from a crashed run can't get in the way.
+inline std::string ShmTestChannelName(const std::string& test) {
+  return "test-" + test + "-" + std::to_string(getpid());
+}
+
+bool TestShmConnectAndEcho() {
+  const std::string name = ShmTestChannelName("echo");
+  std::atomic<bool> connected{false};
+  std::atomic<bool> test_successful{false};
+  crier::Crier<crier::ShmTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestShmConnectAndEcho", [&connected](){ connected = true; });
+  net_crier.connectTransport(name, 1);
+  // Created the channel, so it only opens once the other endpoint attaches
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  if(connected) {
+    return false;
+  }
+
+  ShmEchoPeer peer;
+  peer.connect(name, 1);
+  if(!WaitUntil([&connected, &peer](){ return connected && peer.connected(); }, 1000) || !net_crier.transportConnected()) {
+    return false;
+  }
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(42);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&test_successful](const crier::test::test_msg_1& reply){
+      test_successful = reply.id() == 42;
+    });
+
+  return WaitUntil([&test_successful](){ return test_successful.load(); }, 1000);
+}
+
+bool TestShmFullRingKeepsOrder() {
+  const std::string name = ShmTestChannelName("full");
+  // A tiny ring, so it keeps filling up and wrapping around
+  crier::ShmTransport::Options options;
+  options.ring_size = 16 * 1024;
+  crier::Crier<crier::ShmTransport, crier::test::root_msg> net_crier{crier::ShmTransport(options)};
+  net_crier.connectTransport(name, 1);
+  ShmEchoPeer peer;
+  peer.connect(name, 1);
+
+  const unsigned int messages_to_send = 20000;
+  std::atomic<unsigned int> received{0};
+  std::atomic<bool> in_order{true};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestShmFullRingKeepsOrder",
+    [&received, &in_order](const crier::test::test_msg_1& reply){
+      if(reply.id() != received) {
+        in_order = false;
+      }
+      received++;
+    });
+
+  std::atomic<bool> large_ok{false};
+  const std::string large_payload(6000, 'x');
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("TestShmFullRingKeepsOrder",
+    [&large_ok, &large_payload](const crier::test::test_msg_2& reply){
+      large_ok = reply.data() == large_payload;
+    });
+
+  for(unsigned int i = 0; i < messages_to_send; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessage(msg);
+  }
+  crier::test::test_msg_2 large_msg;
+  large_msg.set_data(large_payload);
+  net_crier.sendMessage(large_msg);
+
+  bool all_arrived = WaitUntil([&received, &large_ok](){ return received == messages_to_send && large_ok; }, 5000);
+  return all_arrived && in_order;
+}
+
+bool TestShmPeerDisconnect() {
+  const std::string name = ShmTestChannelName("disconnect");
+  std::atomic<bool> connected{false};
+  std::atomic<bool> disconnected{false};
+  crier::Crier<crier::ShmTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestShmPeerDisconnect", [&connected](){ connected = true; });
+  net_crier.registerForTransportClosedCallback("TestShmPeerDisconnect", [&disconnected](const std::string&){ disconnected = true; });
+  ShmEchoPeer peer;
+  peer.connect(name, 1);
+  net_crier.connectTransport(name, 1);
+  if(!WaitUntil([&connected](){ return connected.load(); }, 1000)) {
+    return false;
+  }
+
+  peer.disconnect();
+  return WaitUntil([&disconnected](){ return disconnected.load(); }, 1000) && !net_crier.transportConnected();
+}
+
+bool TestShmNameReleasedOnceAttached() {
+  const std::string name = ShmTestChannelName("released");
+  ShmEchoPeer first;
+  ShmEchoPeer second;
+  first.connect(name, 1);
+  second.connect(name, 1);
+  if(!WaitUntil([&first, &second](){ return first.connected() && second.connected(); }, 1000)) {
+    return false;
+  }
+
+  // The name is released once both endpoints attach, so a third one ends up creating a brand new channel nobody else is on
+  std::atomic<bool> connected{false};
+  crier::Crier<crier::ShmTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestShmNameReleasedOnceAttached", [&connected](){ connected = true; });
+  net_crier.connectTransport(name, 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  return !connected;
+}
+
+bool TestShmTransport() {
+  return TestShmConnectAndEcho() && TestShmFullRingKeepsOrder() && TestShmPeerDisconnect() && TestShmNameReleasedOnceAttached();
+}
+
+#endif /* ShmTransportTests_hpp */
@@ -0,0 +1,124 @@
+#ifndef StreamingRequestTests_hpp
+#define StreamingRequestTests_hpp
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+using StreamCrier = crier::Crier<crier::TcpTransport, crier::test::root_msg>;
+
+const unsigned int kEndOfStreamId = 999;
+
+/// The echo server replies once per message, so a stream's later responses are echoes of plain messages sent after the request.
+void SendStreamIds(StreamCrier& net_crier, unsigned int from, unsigned int to) {
+  for(unsigned int i = from; i < to; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessage(msg);
+  }
+}
+
+bool TestStreamUntilEndMarker() {
+  TcpEchoServer server;
+  StreamCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  std::mutex ids_mutex;
+  std::vector<unsigned int> ids;
+  std::atomic<bool> ended{false};
+  crier::StreamEnd end_reason = crier::StreamEnd::Cancelled;
+  crier::test::test_msg_1 request;
+  request.set_id(0);
+  crier::StreamHandle stream = net_crier.sendStreamingRequest<crier::test::test_msg_1, crier::test::test_msg_1>(request,
+    [&ids_mutex, &ids](const crier::test::test_msg_1& response){
+      std::lock_guard<std::mutex> guard(ids_mutex);
+      ids.push_back(response.id());
+      return response.id() != kEndOfStreamId;
+    }, crier::StreamOptions(), [&ended, &end_reason](crier::StreamEnd reason){ end_reason = reason; ended = true; });
+  SendStreamIds(net_crier, 1, 10);
+  SendStreamIds(net_crier, kEndOfStreamId, kEndOfStreamId + 1);
+
+  // Past the marker, responses go to the next request again
+  std::atomic<unsigned int> after_stream{0};
+  crier::test::test_msg_1 next;
+  next.set_id(1000);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(next,
+    [&after_stream](const crier::test::test_msg_1& response){ after_stream = response.id(); });
+
+  bool completed = WaitUntil([&ended, &after_stream](){ return ended && after_stream == 1000; }, 2000);
+  std::lock_guard<std::mutex> guard(ids_mutex);
+  bool in_order = ids.size() == 11 && ids.back() == kEndOfStreamId;
+  for(unsigned int i = 0; in_order && i < 10; i++) {
+    in_order = ids[i] == i;
+  }
+  return completed && in_order && end_reason == crier::StreamEnd::Completed && !stream.active() && stream.responses() == 11;
+}
+
+bool TestStreamCountLimitAndCancel() {
+  TcpEchoServer server;
+  StreamCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  crier::StreamOptions options;
+  options.max_responses = 3;
+  std::atomic<unsigned int> delivered{0};
+  crier::test::test_msg_1 request;
+  request.set_id(0);
+  crier::StreamHandle limited = net_crier.sendStreamingRequest<crier::test::test_msg_1, crier::test::test_msg_1>(request,
+    [&delivered](const crier::test::test_msg_1&){ delivered++; return true; }, options);
+  SendStreamIds(net_crier, 1, 5);
+  bool hit_limit = WaitUntil([&limited](){ return !limited.active(); }, 1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  bool limited_ok = hit_limit && delivered == 3 && limited.endReason() == crier::StreamEnd::CountLimit;
+
+  // The echo server replies with a test_msg_1, so this one only ends once cancelled
+  std::atomic<bool> cancelled{false};
+  crier::StreamHandle waiting = net_crier.sendStreamingRequest<crier::test::test_msg_1, crier::test::test_msg_2>(request,
+    [](const crier::test::test_msg_2&){ return true; }, crier::StreamOptions(),
+    [&cancelled](crier::StreamEnd reason){ cancelled = reason == crier::StreamEnd::Cancelled; });
+  bool was_active = waiting.active();
+  bool cancel_ok = waiting.cancel() && !waiting.cancel() && cancelled && !waiting.active();
+  return limited_ok && was_active && cancel_ok;
+}
+
+bool TestStreamIdleTimeout() {
+  const unsigned int idle_timeout_ms = 150;
+  TcpEchoServer server;
+  StreamCrier net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  crier::StreamOptions options;
+  options.idle_timeout_ms = idle_timeout_ms;
+  std::atomic<bool> idled_out{false};
+  crier::test::test_msg_1 request;
+  request.set_id(0);
+  auto start = std::chrono::steady_clock::now();
+  crier::StreamHandle stream = net_crier.sendStreamingRequest<crier::test::test_msg_1, crier::test::test_msg_1>(request,
+    [](const crier::test::test_msg_1&){ return true; }, options,
+    [&idled_out](crier::StreamEnd reason){ idled_out = reason == crier::StreamEnd::IdleTimeout; });
+  // Responses keep coming for well past a single idle timeout, so it stays open
+  for(unsigned int i = 1; i <= 6; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{idle_timeout_ms / 3});
+    SendStreamIds(net_crier, i, i + 1);
+  }
+  bool kept_open = stream.active();
+  bool ended = WaitUntil([&idled_out](){ return idled_out.load(); }, 2000);
+  auto lasted = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  return kept_open && ended && stream.responses() == 7 && lasted >= 2 * idle_timeout_ms;
+}
+
+bool TestStreamingRequests() {
+  return TestStreamUntilEndMarker() &&
+         TestStreamCountLimitAndCancel() &&
+         TestStreamIdleTimeout();
+}
+
+#endif /* StreamingRequestTests_hpp */
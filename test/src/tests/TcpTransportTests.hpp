@@ -0,0 +1,137 @@
+#ifndef TcpTransportTests_hpp
+#define TcpTransportTests_hpp
+
+#include <atomic>
+#include <string>
+
+#include <unistd.h>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/TcpTransport.hpp"
+#include "crier/transports/UnixTransport.hpp"
+#include "transports/TcpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+bool TestTcpConnectAndEcho() {
+  TcpEchoServer server;
+  std::atomic<bool> connected{false};
+  std::atomic<bool> test_successful{false};
+  crier::Crier<crier::TcpTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestTcpConnectAndEcho", [&connected](){ connected = true; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&connected](){ return connected.load(); }, 1000) || !net_crier.transportConnected()) {
+    return false;
+  }
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(42);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&test_successful](const crier::test::test_msg_1& reply){
+      test_successful = reply.id() == 42;
+    });
+
+  return WaitUntil([&test_successful](){ return test_successful.load(); }, 1000);
+}
+
+bool TestTcpFramingKeepsOrderAndSize() {
+  TcpEchoServer server;
+  crier::Crier<crier::TcpTransport, crier::test::root_msg> net_crier{};
+  // Messages are sent before the connection completes, so they must be held and flushed once it does
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  const unsigned int messages_to_send = 2000;
+  std::atomic<unsigned int> received{0};
+  std::atomic<bool> in_order{true};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestTcpFramingKeepsOrderAndSize",
+    [&received, &in_order](const crier::test::test_msg_1& reply){
+      if(reply.id() != received) {
+        in_order = false;
+      }
+      received++;
+    });
+
+  std::atomic<bool> large_ok{false};
+  const std::string large_payload(4 * 1024 * 1024, 'x');
+  net_crier.registerPermanentCallback<crier::test::test_msg_2>("TestTcpFramingKeepsOrderAndSize",
+    [&large_ok, &large_payload](const crier::test::test_msg_2& reply){
+      large_ok = reply.data() == large_payload;
+    });
+
+  for(unsigned int i = 0; i < messages_to_send; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(i);
+    net_crier.sendMessage(msg);
+  }
+  crier::test::test_msg_2 large_msg;
+  large_msg.set_data(large_payload);
+  net_crier.sendMessage(large_msg);
+
+  bool all_arrived = WaitUntil([&received, &large_ok](){ return received == messages_to_send && large_ok; }, 5000);
+  return all_arrived && in_order;
+}
+
+bool TestTcpPeerDisconnect() {
+  TcpEchoServer server;
+  std::atomic<bool> connected{false};
+  std::atomic<bool> disconnected{false};
+  crier::Crier<crier::TcpTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestTcpPeerDisconnect", [&connected](){ connected = true; });
+  net_crier.registerForTransportClosedCallback("TestTcpPeerDisconnect", [&disconnected](const std::string&){ disconnected = true; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&connected](){ return connected.load(); }, 1000)) {
+    return false;
+  }
+
+  server.dropClients();
+  return WaitUntil([&disconnected](){ return disconnected.load(); }, 1000) && !net_crier.transportConnected();
+}
+
+bool TestTcpConnectionRefused() {
+  int unused_port;
+  {
+    TcpEchoServer server;
+    unused_port = server.port();
+  }
+  std::atomic<bool> disconnected{false};
+  crier::Crier<crier::TcpTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportClosedCallback("TestTcpConnectionRefused", [&disconnected](const std::string&){ disconnected = true; });
+  net_crier.connectTransport("127.0.0.1", unused_port);
+  return WaitUntil([&disconnected](){ return disconnected.load(); }, 1000) && !net_crier.transportConnected();
+}
+
+bool TestTcpConnectByName() {
+  // The echo server only listens on 127.0.0.1, while localhost may resolve to ::1 first
+  TcpEchoServer server;
+  std::atomic<bool> connected{false};
+  std::atomic<bool> disconnected{false};
+  crier::Crier<crier::TcpTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestTcpConnectByName", [&connected](){ connected = true; });
+  net_crier.registerForTransportClosedCallback("TestTcpConnectByName", [&disconnected](const std::string&){ disconnected = true; });
+  net_crier.connectTransport("localhost", server.port());
+  return WaitUntil([&connected](){ return connected.load(); }, 1000) && !disconnected;
+}
+
+bool TestUnixConnectAndEcho() {
+  const std::string path = "@crier-test-unix-" + std::to_string(getpid());
+  TcpEchoServer server(path);
+  std::atomic<bool> test_successful{false};
+  crier::Crier<crier::UnixTransport, crier::test::root_msg> net_crier{};
+  net_crier.connectTransport(path, 0);
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(42);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&test_successful](const crier::test::test_msg_1& reply){
+      test_successful = reply.id() == 42;
+    });
+
+  return WaitUntil([&test_successful](){ return test_successful.load(); }, 1000) && net_crier.transportConnected();
+}
+
+bool TestTcpTransport() {
+  return TestTcpConnectAndEcho() && TestTcpFramingKeepsOrderAndSize() && TestTcpPeerDisconnect() && TestTcpConnectionRefused() && TestTcpConnectByName() &&
+         TestUnixConnectAndEcho();
+}
+
+#endif /* TcpTransportTests_hpp */
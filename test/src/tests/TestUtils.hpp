@@ -0,0 +1,20 @@
+#ifndef TestUtils_hpp
+#define TestUtils_hpp
+
+#include <chrono>
+#include <thread>
+
+/// Polls the predicate until it returns true, or the given amount of milliseconds pass. Returns the predicate's last result.
+template <typename Predicate>
+bool WaitUntil(Predicate predicate, unsigned int milliseconds) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds{milliseconds};
+  while(!predicate()) {
+    if(std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  return true;
+}
+
+#endif /* TestUtils_hpp */
@@ -0,0 +1,103 @@
+#ifndef TracingTests_hpp
+#define TracingTests_hpp
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/ChromeTraceBuffer.hpp"
+#include "transports/EchoTransport.hpp"
+
+using TracedCrier = crier::Crier<EchoTransport, crier::test::root_msg, crier::Tracing>;
+
+size_t CountSpans(const std::vector<crier::TraceSpan>& spans, crier::TracePhase phase, const std::string& key = std::string()) {
+  size_t count = 0;
+  for(const auto& span : spans) {
+    if(span.phase == phase && (key.empty() || span.key == key))
+      count++;
+  }
+  return count;
+}
+
+bool TestTracingSpans() {
+  auto buffer = std::make_shared<crier::ChromeTraceBuffer>();
+  TracedCrier net_crier{};
+  net_crier.tracer().setSink(buffer);
+  net_crier.connectTransport("localhost", 0); // Echo transport doesn't care
+
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("observer", [](const crier::test::test_msg_1&){});
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  bool answered = false;
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&answered](const crier::test::test_msg_1&){ answered = true; });
+
+  // A parse, a receive, and a callback span for each of the observer and the response
+  std::vector<crier::TraceSpan> spans = buffer->spans();
+  std::string type = crier::test::test_msg_1().GetDescriptor()->full_name();
+  bool typed = true;
+  for(const auto& span : spans) {
+    if(span.phase != crier::TracePhase::Parse)
+      typed = typed && span.type == type;
+  }
+  return answered && typed && CountSpans(spans, crier::TracePhase::Parse) == 1 && CountSpans(spans, crier::TracePhase::Receive) == 1 &&
+         CountSpans(spans, crier::TracePhase::Callback) == 2 && CountSpans(spans, crier::TracePhase::Callback, "observer") == 1;
+}
+
+bool TestTracingDispatchQueue() {
+  auto buffer = std::make_shared<crier::ChromeTraceBuffer>();
+  TracedCrier net_crier{crier::UnhandledMessageBehaviour::Ignore, crier::InboundDispatching::DispatchQueue};
+  net_crier.tracer().setSink(buffer);
+  net_crier.connectTransport("localhost", 0);
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg, [](const crier::test::test_msg_1&){});
+  bool queued = CountSpans(buffer->spans(), crier::TracePhase::Enqueue) == 1 && CountSpans(buffer->spans(), crier::TracePhase::Callback) == 0;
+  net_crier.dispatchQueuedCallbacks();
+
+  // The callback ran nested inside the dequeue
+  std::vector<crier::TraceSpan> spans = buffer->spans();
+  const crier::TraceSpan* dequeue = nullptr;
+  const crier::TraceSpan* callback = nullptr;
+  for(const auto& span : spans) {
+    if(span.phase == crier::TracePhase::Dequeue)
+      dequeue = &span;
+    if(span.phase == crier::TracePhase::Callback)
+      callback = &span;
+  }
+  return queued && dequeue && callback && dequeue->start <= callback->start &&
+         callback->start + callback->duration <= dequeue->start + dequeue->duration;
+}
+
+bool TestChromeTraceBuffer() {
+  crier::ChromeTraceBuffer buffer(2);
+  crier::TraceSpan span;
+  span.phase = crier::TracePhase::Callback;
+  span.start = std::chrono::steady_clock::now();
+  span.duration = std::chrono::microseconds{5};
+  span.thread = std::this_thread::get_id();
+  for(const char* key : {"first", "second", "with \"quotes\""}) {
+    span.key = key;
+    buffer.record(span);
+  }
+
+  // Full, the oldest span was overwritten
+  std::vector<crier::TraceSpan> spans = buffer.spans();
+  bool wrapped = buffer.size() == 2 && buffer.recorded() == 3 && spans[0].key == "second" && spans[1].key == "with \"quotes\"";
+  std::string json = buffer.json();
+  bool written = json.find("{\"traceEvents\":[") == 0 && json.find("\"ph\":\"X\"") != std::string::npos &&
+                 json.find("\"dur\":5.000") != std::string::npos && json.find("with \\\"quotes\\\"") != std::string::npos &&
+                 json.find("first") == std::string::npos;
+  return wrapped && written;
+}
+
+bool TestTracing() {
+  return TestTracingSpans() &&
+         TestTracingDispatchQueue() &&
+         TestChromeTraceBuffer();
+}
+
+#endif /* TracingTests_hpp */
@@ -0,0 +1,137 @@
+#ifndef UdpTransportTests_hpp
+#define UdpTransportTests_hpp
+
+#include <atomic>
+
+#include "protogen/CrierTest.pb.h"
+#include "crier/Crier.hpp"
+#include "crier/transports/UdpTransport.hpp"
+#include "transports/UdpEchoServer.hpp"
+#include "tests/TestUtils.hpp"
+
+bool TestUdpConnectAndEcho() {
+  UdpEchoServer server;
+  std::atomic<bool> connected{false};
+  std::atomic<bool> test_successful{false};
+  crier::Crier<crier::UdpTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestUdpConnectAndEcho", [&connected](){ connected = true; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&connected](){ return connected.load(); }, 1000) || !net_crier.transportConnected()) {
+    return false;
+  }
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(42);
+  net_crier.sendMessageWithRetCallback<crier::test::test_msg_1, crier::test::test_msg_1>(msg,
+    [&test_successful](const crier::test::test_msg_1& reply){
+      test_successful = reply.id() == 42;
+    });
+
+  return WaitUntil([&test_successful](){ return test_successful.load(); }, 1000);
+}
+
+bool TestUdpBurstsKeepOrder() {
+  UdpEchoServer server;
+  crier::Crier<crier::UdpTransport, crier::test::root_msg> net_crier{};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  std::atomic<unsigned int> received{0};
+  std::atomic<bool> in_order{true};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestUdpBurstsKeepOrder",
+    [&received, &in_order](const crier::test::test_msg_1& reply){
+      if(reply.id() != received) {
+        in_order = false;
+      }
+      received++;
+    });
+
+  // Bursts are kept small enough for the socket buffers to hold them, as overflowing them would drop datagrams
+  const unsigned int bursts = 20;
+  const unsigned int burst_size = 100;
+  for(unsigned int burst = 0; burst < bursts; burst++) {
+    for(unsigned int i = 0; i < burst_size; i++) {
+      crier::test::test_msg_1 msg;
+      msg.set_id(burst * burst_size + i);
+      net_crier.sendMessage(msg);
+    }
+    unsigned int expected = (burst + 1) * burst_size;
+    if(!WaitUntil([&received, expected](){ return received == expected; }, 1000)) {
+      return false;
+    }
+  }
+  return in_order;
+}
+
+bool TestUdpSegmentationOffloads() {
+  UdpEchoServer server;
+  // Echoes come back as a single segmented datagram, which GRO hands over whole, and the transport has to split
+  const unsigned int messages_to_send = 10;
+  server.setSegmentedReplies(messages_to_send);
+
+  crier::UdpTransport::Options options;
+  options.gso = true;
+  options.gro = true;
+  crier::Crier<crier::UdpTransport, crier::test::root_msg> net_crier{crier::UdpTransport(options)};
+  net_crier.connectTransport("127.0.0.1", server.port());
+
+  std::atomic<unsigned int> received{0};
+  std::atomic<bool> ids_ok{true};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestUdpSegmentationOffloads",
+    [&received, &ids_ok](const crier::test::test_msg_1& reply){
+      if(reply.id() != 100 + received) {
+        ids_ok = false;
+      }
+      received++;
+    });
+
+  // Same sized messages, so the sends get coalesced as well
+  for(unsigned int i = 0; i < messages_to_send; i++) {
+    crier::test::test_msg_1 msg;
+    msg.set_id(100 + i);
+    net_crier.sendMessage(msg);
+  }
+  return WaitUntil([&received, messages_to_send](){ return received == messages_to_send; }, 1000) && ids_ok;
+}
+
+bool TestUdpDisconnect() {
+  UdpEchoServer server;
+  std::atomic<bool> connected{false};
+  std::atomic<bool> disconnected{false};
+  crier::Crier<crier::UdpTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerForTransportOpenedCallback("TestUdpDisconnect", [&connected](){ connected = true; });
+  net_crier.registerForTransportClosedCallback("TestUdpDisconnect", [&disconnected](const std::string&){ disconnected = true; });
+  net_crier.connectTransport("127.0.0.1", server.port());
+  if(!WaitUntil([&connected](){ return connected.load(); }, 1000)) {
+    return false;
+  }
+
+  net_crier.disconnectTransport();
+  // Sending on a closed transport is a no-op
+  crier::test::test_msg_1 msg;
+  msg.set_id(1);
+  net_crier.sendMessage(msg);
+  return disconnected && !net_crier.transportConnected();
+}
+
+bool TestUdpConnectByName() {
+  // The echo server only listens on 127.0.0.1, while localhost may resolve to ::1 first: datagrams sent there are refused, until the transport moves on
+  UdpEchoServer server;
+  std::atomic<bool> answered{false};
+  crier::Crier<crier::UdpTransport, crier::test::root_msg> net_crier{};
+  net_crier.registerPermanentCallback<crier::test::test_msg_1>("TestUdpConnectByName",
+    [&answered](const crier::test::test_msg_1&){ answered = true; });
+  net_crier.connectTransport("localhost", server.port());
+
+  crier::test::test_msg_1 msg;
+  msg.set_id(7);
+  return WaitUntil([&net_crier, &msg, &answered](){
+    net_crier.sendMessage(msg);
+    return answered.load();
+  }, 1000) && net_crier.transportConnected();
+}
+
+bool TestUdpTransport() {
+  return TestUdpConnectAndEcho() && TestUdpBurstsKeepOrder() && TestUdpSegmentationOffloads() && TestUdpDisconnect() && TestUdpConnectByName();
+}
+
+#endif /* UdpTransportTests_hpp */
@@ -0,0 +1,36 @@
+#include "GatedEchoTransport.hpp"
+
+void GatedEchoTransport::connect(const std::string&, int) {
+  _connected = true;
+  _on_connect_cb();
+}
+void GatedEchoTransport::disconnect() {
+  _connected = false;
+  _on_disconnect_cb("User closed transport");
+}
+bool GatedEchoTransport::isConnected() const {
+  return _connected;
+}
+void GatedEchoTransport::sendData(const std::string& data_to_send) {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _sending_threads.insert(std::this_thread::get_id());
+    _gate_cv.wait(lock, [this](){ return _gate_open; });
+  }
+  _on_data_cb(data_to_send);
+}
+void GatedEchoTransport::openGate() {
+  {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _gate_open = true;
+  }
+  _gate_cv.notify_all();
+}
+void GatedEchoTransport::closeGate() {
+  std::lock_guard<std::mutex> guard(_mutex);
+  _gate_open = false;
+}
+size_t GatedEchoTransport::sendingThreads() {
+  std::lock_guard<std::mutex> guard(_mutex);
+  return _sending_threads.size();
+}
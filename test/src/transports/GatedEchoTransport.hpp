@@ -0,0 +1,35 @@
+#ifndef GatedEchoTransport_hpp
+#define GatedEchoTransport_hpp
+
+#include <string>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <thread>
+
+#include "crier/TransportConcept.hpp"
+
+/// Echoes data back, but only once its gate is open: until then, sendData blocks, like a transport stuck on a slow peer would.
+class GatedEchoTransport : public crier::TransportConcept {
+public:
+  void connect(const std::string& host, int ip);
+  void disconnect();
+  bool isConnected() const;
+
+  void sendData(const std::string& data_to_send);
+
+  void openGate();
+  void closeGate();
+  /// Amount of distinct threads sendData was called from.
+  size_t sendingThreads();
+
+private:
+  bool _connected = false;
+  bool _gate_open = true;
+  std::set<std::thread::id> _sending_threads;
+  std::mutex _mutex;
+  std::condition_variable _gate_cv;
+};
+
+#endif /* GatedEchoTransport_hpp */
@@ -0,0 +1,19 @@
+#include "ShmEchoPeer.hpp"
+
+ShmEchoPeer::ShmEchoPeer(const crier::ShmTransport::Options& options) : _transport(options) {
+  _transport.setOnConnectCallback([this](){ _connected = true; });
+  _transport.setOnDisconnectCallback([this](const std::string&){ _connected = false; });
+  _transport.setOnDataCallback([this](const std::string& data){ _transport.sendData(data); });
+}
+
+void ShmEchoPeer::connect(const std::string& name, int channel) {
+  _transport.connect(name, channel);
+}
+
+void ShmEchoPeer::disconnect() {
+  _transport.disconnect();
+}
+
+bool ShmEchoPeer::connected() const {
+  return _connected;
+}
@@ -0,0 +1,23 @@
+#ifndef ShmEchoPeer_hpp
+#define ShmEchoPeer_hpp
+
+#include <atomic>
+#include <string>
+
+#include "crier/transports/ShmTransport.hpp"
+
+/// The other endpoint of a shared memory channel, writing back every message it reads. Used as is, without a crier instance on top.
+class ShmEchoPeer {
+public:
+  explicit ShmEchoPeer(const crier::ShmTransport::Options& options = crier::ShmTransport::Options());
+
+  void connect(const std::string& name, int channel);
+  void disconnect();
+  bool connected() const;
+
+private:
+  crier::ShmTransport _transport;
+  std::atomic<bool> _connected{false};
+};
+
+#endif /* ShmEchoPeer_hpp */
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "TcpEchoServer.hpp"
+
+TcpEchoServer::TcpEchoServer() {
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  listenOn(AF_INET, &addr, sizeof(addr));
+
+  socklen_t len = sizeof(addr);
+  getsockname(_listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  _port = ntohs(addr.sin_port);
+
+  _running = true;
+  _accept_thread = std::thread([this](){ acceptLoop(); });
+}
+
+TcpEchoServer::TcpEchoServer(const std::string& unix_path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, unix_path.data(), std::min(unix_path.size(), sizeof(addr.sun_path) - 1));
+  socklen_t addr_len = sizeof(addr);
+  if(!unix_path.empty() && unix_path[0] == '@') {
+    addr.sun_path[0] = '\0';
+    addr_len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + unix_path.size());
+  } else {
+    unlink(unix_path.c_str());
+  }
+  listenOn(AF_UNIX, &addr, addr_len);
+
+  _running = true;
+  _accept_thread = std::thread([this](){ acceptLoop(); });
+}
+
+void TcpEchoServer::listenOn(int family, const void* addr, unsigned int addr_len) {
+  _listen_fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  int one = 1;
+  setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  bind(_listen_fd, static_cast<const sockaddr*>(addr), addr_len);
+  listen(_listen_fd, 16);
+}
+
+TcpEchoServer::~TcpEchoServer() {
+  _running = false;
+  shutdown(_listen_fd, SHUT_RDWR);
+  close(_listen_fd);
+  _accept_thread.join();
+  dropClients();
+  for(auto& thread : _client_threads) {
+    thread.join();
+  }
+  for(int fd : _client_fds) {
+    close(fd);
+  }
+}
+
+int TcpEchoServer::port() const {
+  return _port;
+}
+
+void TcpEchoServer::dropClients() {
+  std::lock_guard<std::mutex> guard(_clientsMutex);
+  for(int fd : _client_fds) {
+    shutdown(fd, SHUT_RDWR);
+  }
+}
+
+void TcpEchoServer::acceptLoop() {
+  while(_running) {
+    int fd = accept4(_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if(fd < 0) {
+      continue;
+    }
+    std::lock_guard<std::mutex> guard(_clientsMutex);
+    _client_fds.push_back(fd);
+    _client_threads.emplace_back([this, fd](){ echoLoop(fd); });
+  }
+}
+
+void TcpEchoServer::echoLoop(int fd) {
+  char buffer[64 * 1024];
+  while(true) {
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if(received <= 0) {
+      break;
+    }
+    ssize_t sent = 0;
+    while(sent < received) {
+      ssize_t n = send(fd, buffer + sent, received - sent, MSG_NOSIGNAL);
+      if(n <= 0) {
+        break;
+      }
+      sent += n;
+    }
+  }
+}
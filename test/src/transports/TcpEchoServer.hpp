@@ -0,0 +1,39 @@
+#ifndef TcpEchoServer_hpp
+#define TcpEchoServer_hpp
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Minimal blocking tcp server, listening on an ephemeral loopback port, that writes back every byte it receives.
+/// Since it doesn't care about framing, it echoes crier frames back as they were sent.
+class TcpEchoServer {
+public:
+  TcpEchoServer();
+
+  /// Listens on a unix socket at the given path instead (for UnixTransport). Paths starting with '@' are abstract.
+  explicit TcpEchoServer(const std::string& unix_path);
+  ~TcpEchoServer();
+
+  int port() const;
+
+  /// Closes every accepted connection, as if the server had dropped its clients.
+  void dropClients();
+
+private:
+  void listenOn(int family, const void* addr, unsigned int addr_len);
+  void acceptLoop();
+  void echoLoop(int fd);
+
+  int _listen_fd = -1;
+  int _port = 0;
+  std::atomic<bool> _running{false};
+  std::thread _accept_thread;
+  std::vector<std::thread> _client_threads;
+  std::vector<int> _client_fds;
+  std::mutex _clientsMutex;
+};
+
+#endif /* TcpEchoServer_hpp */
@@ -0,0 +1,96 @@
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+
+#include "UdpEchoServer.hpp"
+
+UdpEchoServer::UdpEchoServer() {
+  _fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  int buffer_size = 4 * 1024 * 1024;
+  setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+  setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+
+  socklen_t len = sizeof(addr);
+  getsockname(_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  _port = ntohs(addr.sin_port);
+
+  _running = true;
+  _thread = std::thread([this](){ echoLoop(); });
+}
+
+UdpEchoServer::~UdpEchoServer() {
+  _running = false;
+  _thread.join();
+  close(_fd);
+}
+
+int UdpEchoServer::port() const {
+  return _port;
+}
+
+void UdpEchoServer::setSegmentedReplies(size_t count) {
+  _segmented_replies = count;
+}
+
+void UdpEchoServer::echoLoop() {
+  std::vector<char> buffer(64 * 1024);
+  std::vector<std::string> held;
+  while(_running) {
+    // Polled with a timeout so the destructor doesn't need to wake the thread up
+    pollfd pfd{_fd, POLLIN, 0};
+    if(poll(&pfd, 1, 20) <= 0) {
+      continue;
+    }
+
+    sockaddr_storage from{};
+    socklen_t from_len = sizeof(from);
+    ssize_t received = recvfrom(_fd, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&from), &from_len);
+    if(received < 0) {
+      continue;
+    }
+
+    size_t segmented = _segmented_replies;
+    if(segmented == 0) {
+      sendto(_fd, buffer.data(), received, 0, reinterpret_cast<sockaddr*>(&from), from_len);
+      continue;
+    }
+
+    held.emplace_back(buffer.data(), received);
+    if(held.size() < segmented) {
+      continue;
+    }
+    std::vector<iovec> iov(held.size());
+    for(size_t i = 0; i < held.size(); i++) {
+      iov[i].iov_base = &held[i][0];
+      iov[i].iov_len = held[i].size();
+    }
+    char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+    msghdr msg{};
+    msg.msg_name = &from;
+    msg.msg_namelen = from_len;
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = iov.size();
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t segment_size = static_cast<uint16_t>(held[0].size());
+    std::memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+    sendmsg(_fd, &msg, 0);
+    held.clear();
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef UdpEchoServer_hpp
+#define UdpEchoServer_hpp
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Minimal blocking udp server, bound to an ephemeral loopback port, that sends every datagram it receives back to where it came from.
+class UdpEchoServer {
+public:
+  UdpEchoServer();
+  ~UdpEchoServer();
+
+  int port() const;
+
+  /// Holds echoes until count datagrams were received, and sends them all back at once as a single segmented (UDP_SEGMENT) send.
+  /// The held datagrams must all be the same size, except for the last one, which may be shorter. 0 goes back to echoing right away.
+  void setSegmentedReplies(size_t count);
+
+private:
+  void echoLoop();
+
+  int _fd = -1;
+  int _port = 0;
+  std::atomic<bool> _running{false};
+  std::atomic<size_t> _segmented_replies{0};
+  std::thread _thread;
+};
+
+#endif /* UdpEchoServer_hpp */